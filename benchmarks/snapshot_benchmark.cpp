@@ -0,0 +1,378 @@
+#include "distcache/failover_manager.h"
+#include "distcache/io_scheduler.h"
+#include "distcache/latency_histogram.h"
+#include "distcache/recovery_manager.h"
+#include "distcache/snapshot_manager.h"
+#include "distcache/storage_engine.h"
+#include "distcache/wal.h"
+#include "distcache/cache_entry.h"
+#include "distcache/logger.h"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <iomanip>
+#include <filesystem>
+#include <sstream>
+#include <atomic>
+#include <unistd.h>
+#include <grpcpp/grpcpp.h>
+
+using namespace distcache;
+
+// Snapshot write and cold-start restore: fills a table, writes it as a
+// chunked snapshot without and then with checksums (reporting what they
+// cost), then recovers the checksummed one into empty tables with 1..N
+// restore threads through RecoveryManager, which reports the cold-start
+// time with every chunk verified. With --bootstrap it also ships the
+// snapshot to an empty table over loopback gRPC, as a joining node
+// would receive it. With --io-rate-mb it also writes a snapshot under
+// live reads, unthrottled and then within that I/O budget, and reports
+// the readers' p99 for each. With --lazy it also recovers lazily and
+// reports how soon the node could serve, the first read's latency and
+// how long the background load took.
+
+constexpr size_t kMaxMemory = 64ull * 1024 * 1024 * 1024;  // Never evict
+
+struct RestoreResult {
+    int64_t restore_ms = 0;
+    int64_t recovery_ms = 0;
+    size_t keys = 0;
+    bool ok = false;
+};
+
+RestoreResult RunRestore(const std::filesystem::path& dir, size_t num_shards, size_t threads) {
+    auto storage = std::make_shared<ShardedHashTable>(num_shards, kMaxMemory);
+    auto metrics = std::make_shared<Metrics>();
+
+    SnapshotManager::Config snapshot_config;
+    snapshot_config.node_id = "bench";
+    snapshot_config.snapshot_dir = dir / "snapshots";
+    snapshot_config.restore_threads = threads;
+    auto snapshots = std::make_shared<SnapshotManager>(snapshot_config, storage, metrics);
+
+    WAL::Config wal_config;
+    wal_config.node_id = "bench";
+    wal_config.wal_dir = dir / "wal";
+    auto wal = std::make_shared<WAL>(wal_config);
+
+    RecoveryManager::Config recovery_config;
+    recovery_config.node_id = "bench";
+    recovery_config.snapshot_dir = snapshot_config.snapshot_dir;
+    recovery_config.wal_dir = wal_config.wal_dir;
+    RecoveryManager recovery(recovery_config, storage, snapshots, wal);
+
+    auto result = recovery.Recover();
+    RestoreResult restore;
+    restore.ok = result.success && result.snapshot_restored;
+    restore.restore_ms = result.snapshot_restore_ms;
+    restore.recovery_ms = result.recovery_duration_ms;
+    restore.keys = storage->size();
+    return restore;
+}
+
+struct LazyRun {
+    int64_t serving_ms = 0;       // Recover() returned
+    int64_t first_read_us = 0;    // Including the fault of its shard
+    int64_t loaded_ms = 0;        // Every shard loaded
+    uint64_t faulted = 0;
+    size_t keys = 0;
+    bool ok = false;
+};
+
+LazyRun RunLazyRestore(const std::filesystem::path& dir, size_t num_shards, size_t num_keys) {
+    auto storage = std::make_shared<ShardedHashTable>(num_shards, kMaxMemory);
+
+    SnapshotManager::Config snapshot_config;
+    snapshot_config.node_id = "bench";
+    snapshot_config.snapshot_dir = dir / "snapshots";
+    auto snapshots = std::make_shared<SnapshotManager>(snapshot_config, storage,
+                                                       std::make_shared<Metrics>());
+
+    WAL::Config wal_config;
+    wal_config.node_id = "bench";
+    wal_config.wal_dir = dir / "wal";
+    auto wal = std::make_shared<WAL>(wal_config);
+
+    RecoveryManager::Config recovery_config;
+    recovery_config.node_id = "bench";
+    recovery_config.snapshot_dir = snapshot_config.snapshot_dir;
+    recovery_config.wal_dir = wal_config.wal_dir;
+    recovery_config.lazy_restore = true;
+    RecoveryManager recovery(recovery_config, storage, snapshots, wal);
+
+    LazyRun run;
+    auto result = recovery.Recover();
+    run.serving_ms = result.recovery_duration_ms;
+
+    auto read_start = std::chrono::steady_clock::now();
+    bool found = storage->get("key:" + std::to_string(num_keys / 2)).has_value();
+    run.first_read_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - read_start).count();
+
+    snapshots->WaitForLazyRestore();
+    auto stats = snapshots->GetStats();
+    run.loaded_ms = stats.lazy_restore_ms;
+    run.faulted = stats.lazy_shards_faulted;
+    run.keys = storage->size();
+    run.ok = result.success && result.snapshot_lazy && found;
+    return run;
+}
+
+struct BootstrapRun {
+    FailoverManager::BootstrapResult result;
+    size_t keys = 0;
+};
+
+BootstrapRun RunBootstrap(const std::filesystem::path& dir, size_t num_shards) {
+    auto metrics = std::make_shared<Metrics>();
+    SnapshotManager::Config snapshot_config;
+    snapshot_config.node_id = "donor";
+    snapshot_config.snapshot_dir = dir / "snapshots";
+    auto snapshots = std::make_shared<SnapshotManager>(
+        snapshot_config, std::make_shared<ShardedHashTable>(num_shards, kMaxMemory), metrics);
+
+    FailoverServiceImpl service(nullptr, nullptr, metrics, snapshots);
+    int port = 0;
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+    builder.RegisterService(&service);
+    auto server = builder.BuildAndStart();
+
+    BootstrapRun run;
+    if (!server) {
+        return run;
+    }
+    auto storage = std::make_shared<ShardedHashTable>(num_shards, kMaxMemory);
+    FailoverManager::Config config;
+    config.node_id = "joiner";
+    FailoverManager joiner(config, std::make_shared<HashRing>(), storage, nullptr, metrics);
+    run.result = joiner.BootstrapFromPeer("127.0.0.1:" + std::to_string(port));
+    run.keys = storage->size();
+    server->Shutdown();
+    return run;
+}
+
+struct ForegroundRun {
+    int64_t snapshot_ms = 0;
+    uint64_t throttled_ms = 0;
+    uint64_t p99_us = 0;
+    uint64_t reads = 0;
+};
+
+// Write a snapshot while a reader thread issues gets, timing each one
+ForegroundRun RunUnderLoad(const std::shared_ptr<ShardedHashTable>& storage,
+                           const std::filesystem::path& dir, size_t num_keys,
+                           bool compression, uint64_t io_bytes_per_second) {
+    auto scheduler = std::make_shared<IoScheduler>();
+    if (io_bytes_per_second > 0) {
+        IoScheduler::Config io;
+        io.bytes_per_second = io_bytes_per_second;
+        scheduler->Reconfigure(io);
+    }
+
+    LatencyHistogram latency;
+    std::atomic<bool> done{false};
+    std::thread reader([&] {
+        size_t i = 0;
+        while (!done.load(std::memory_order_relaxed)) {
+            std::string key = "key:" + std::to_string(i++ % num_keys);
+            auto started = std::chrono::steady_clock::now();
+            storage->get_with(key, [](const CacheEntry&) {});
+            auto elapsed = std::chrono::steady_clock::now() - started;
+            latency.record(elapsed);
+            scheduler->RecordForeground(elapsed);
+        }
+    });
+
+    SnapshotManager::Config config;
+    config.node_id = "bench";
+    config.snapshot_dir = dir;
+    config.enable_compression = compression;
+    SnapshotManager manager(config, storage, std::make_shared<Metrics>());
+    manager.SetIoScheduler(scheduler);
+    manager.CreateSnapshot();
+    done.store(true);
+    reader.join();
+
+    auto stats = manager.GetStats();
+    auto snap = latency.snapshot();
+    ForegroundRun run;
+    run.snapshot_ms = stats.last_snapshot_duration_ms;
+    run.throttled_ms = stats.io_throttled_ms;
+    run.p99_us = snap.percentile_us(99);
+    run.reads = snap.count;
+    return run;
+}
+
+std::vector<size_t> ParseList(const std::string& text) {
+    std::vector<size_t> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            values.push_back(std::stoul(item));
+        }
+    }
+    return values;
+}
+
+void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "Options:\n"
+              << "  -n N         Keys in the snapshot (default: 10000000)\n"
+              << "  -v BYTES     Value size (default: 64)\n"
+              << "  -s N         Storage shards (default: 256)\n"
+              << "  -t LIST      Restore thread counts (default: 1,<cores>)\n"
+              << "  -d DIR       Scratch directory (default: system temp)\n"
+              << "  --no-compression  Write chunks uncompressed\n"
+              << "  --lazy       Also recover lazily and report time to first serve\n"
+              << "  --bootstrap  Also ship the snapshot to an empty node over loopback\n"
+              << "  --io-rate-mb N  Also compare read p99 during a snapshot within N MB/s\n"
+              << "  -h, --help   Show this help message\n";
+}
+
+int main(int argc, char** argv) {
+    size_t num_keys = 10000000;
+    size_t value_size = 64;
+    size_t num_shards = 256;
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> thread_counts = {1};
+    if (cores > 1) {
+        thread_counts.push_back(cores);
+    }
+    bool compression = true;
+    bool bootstrap = false;
+    bool lazy = false;
+    uint64_t io_rate_mb = 0;
+    std::filesystem::path dir = std::filesystem::temp_directory_path() /
+        ("distcache_snapshot_bench_" + std::to_string(::getpid()));
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);
+            return 0;
+        } else if (arg == "-n" && i + 1 < argc) {
+            num_keys = std::stoull(argv[++i]);
+        } else if (arg == "-v" && i + 1 < argc) {
+            value_size = std::stoull(argv[++i]);
+        } else if (arg == "-s" && i + 1 < argc) {
+            num_shards = std::stoull(argv[++i]);
+        } else if (arg == "-t" && i + 1 < argc) {
+            thread_counts = ParseList(argv[++i]);
+        } else if (arg == "-d" && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (arg == "--no-compression") {
+            compression = false;
+        } else if (arg == "--lazy") {
+            lazy = true;
+        } else if (arg == "--bootstrap") {
+            bootstrap = true;
+        } else if (arg == "--io-rate-mb" && i + 1 < argc) {
+            io_rate_mb = std::stoull(argv[++i]);
+        }
+    }
+
+    // Keep per-snapshot and recovery messages out of the report
+    Logger::init("snapshot_benchmark", "warn");
+    std::filesystem::remove_all(dir);
+
+    std::cout << "\n===== Snapshot Benchmark =====" << std::endl;
+    std::cout << "Keys: " << num_keys << std::endl;
+    std::cout << "Value size: " << value_size << " bytes" << std::endl;
+    std::cout << "Shards: " << num_shards << std::endl;
+    std::cout << "Compression: " << (compression ? "on" : "off") << std::endl;
+
+    // Write the snapshots, then free the source table before restoring
+    bool ok = true;
+    {
+        auto storage = std::make_shared<ShardedHashTable>(num_shards, kMaxMemory);
+        storage->reserve(num_keys);
+        auto fill_start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < num_keys; ++i) {
+            std::string key = "key:" + std::to_string(i);
+            std::vector<uint8_t> value(value_size, static_cast<uint8_t>('a' + i % 26));
+            storage->set(key, CacheEntry(key, std::move(value)));
+        }
+        double fill_s = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - fill_start).count();
+
+        std::cout << "Fill: " << std::fixed << std::setprecision(1) << fill_s << " s" << std::endl;
+
+        // The checksummed snapshot is written last, so recovery picks it
+        int64_t write_ms[2] = {0, 0};
+        for (bool checksums : {false, true}) {
+            SnapshotManager::Config config;
+            config.node_id = "bench";
+            config.snapshot_dir = dir / "snapshots";
+            config.enable_compression = compression;
+            config.enable_checksums = checksums;
+            SnapshotManager manager(config, storage, std::make_shared<Metrics>());
+            ok = ok && !manager.CreateSnapshot().empty();
+            auto stats = manager.GetStats();
+            write_ms[checksums] = stats.last_snapshot_duration_ms;
+
+            std::cout << "Snapshot write (checksums " << (checksums ? "on" : "off") << "): "
+                      << stats.last_snapshot_duration_ms << " ms, "
+                      << stats.last_snapshot_size_bytes / (1024 * 1024) << " MB" << std::endl;
+        }
+        if (write_ms[0] > 0) {
+            std::cout << "Checksum overhead: " << std::setprecision(1)
+                      << (write_ms[1] - write_ms[0]) * 100.0 / write_ms[0] << "%" << std::endl;
+        }
+
+        // Scratch snapshots go to their own directory, so recovery below
+        // still picks the checksummed one
+        if (io_rate_mb > 0) {
+            std::cout << std::endl;
+            for (uint64_t rate : {uint64_t{0}, io_rate_mb * 1024 * 1024}) {
+                auto run = RunUnderLoad(storage, dir / "loaded", num_keys, compression, rate);
+                std::cout << "Snapshot under reads ("
+                          << (rate == 0 ? std::string("unthrottled")
+                                        : std::to_string(io_rate_mb) + " MB/s budget")
+                          << "): " << run.snapshot_ms << " ms, throttled " << run.throttled_ms
+                          << " ms, read p99 " << run.p99_us << " us over " << run.reads
+                          << " reads" << std::endl;
+            }
+        }
+    }
+
+    std::cout << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "keys" << std::setw(13) << "restore ms"
+              << std::setw(14) << "recovery ms" << std::setw(14) << "keys/sec" << std::endl;
+    for (size_t threads : thread_counts) {
+        auto result = ok ? RunRestore(dir, num_shards, threads) : RestoreResult{};
+        ok = ok && result.ok && result.keys == num_keys;
+        double keys_per_sec = result.restore_ms > 0 ? result.keys * 1000.0 / result.restore_ms : 0;
+        std::cout << std::setw(8) << threads << std::setw(12) << result.keys
+                  << std::setw(13) << result.restore_ms << std::setw(14) << result.recovery_ms
+                  << std::setw(14) << std::fixed << std::setprecision(0) << keys_per_sec << std::endl;
+    }
+    if (lazy && ok) {
+        auto run = RunLazyRestore(dir, num_shards, num_keys);
+        ok = run.ok && run.keys == num_keys;
+        std::cout << std::endl << "Lazy restore: serving after " << run.serving_ms
+                  << " ms, first read " << run.first_read_us << " us, fully loaded after "
+                  << run.loaded_ms << " ms (" << run.faulted << " shards faulted in by reads)"
+                  << std::endl;
+    }
+    if (bootstrap && ok) {
+        auto run = RunBootstrap(dir, num_shards);
+        ok = run.result.success && run.keys == num_keys;
+        double seconds = run.result.duration_ms / 1000.0;
+        std::cout << std::endl << "Bootstrap over loopback: " << run.keys << " keys, "
+                  << run.result.bytes_received / (1024 * 1024) << " MB in "
+                  << run.result.duration_ms << " ms";
+        if (seconds > 0) {
+            std::cout << " (" << std::setprecision(0)
+                      << run.result.bytes_received / (1024.0 * 1024.0) / seconds << " MB/s, "
+                      << run.keys / seconds << " keys/sec)";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "==============================\n" << std::endl;
+
+    std::filesystem::remove_all(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+#include "distcache/wal.h"
+#include "distcache/io_ring.h"
+#include "distcache/cache_entry.h"
+#include "distcache/logger.h"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <iomanip>
+#include <filesystem>
+#include <sstream>
+#include <unistd.h>
+
+using namespace distcache;
+
+// WAL write throughput: concurrent writers calling AppendSet (which waits
+// for its group commit) against 1..N independent WAL streams, committed
+// with pwrite+fdatasync or through io_uring. A second table compares
+// whole-file write/read (the snapshot path) on both backends.
+
+struct RunConfig {
+    size_t num_threads;
+    size_t num_streams;
+    size_t ops_per_thread;
+    size_t value_size;
+    bool sync_on_write;
+    bool use_io_uring;
+    std::filesystem::path dir;
+};
+
+struct RunResult {
+    double ops_per_sec = 0;
+    uint64_t p50_us = 0;
+    uint64_t p99_us = 0;
+    uint64_t group_commits = 0;
+    uint64_t failed = 0;
+};
+
+RunResult RunWorkload(const RunConfig& config) {
+    std::filesystem::remove_all(config.dir);
+
+    WAL::Config wal_config;
+    wal_config.wal_dir = config.dir;
+    wal_config.node_id = "bench";
+    wal_config.sync_on_write = config.sync_on_write;
+    wal_config.num_streams = config.num_streams;
+    wal_config.use_io_uring = config.use_io_uring;
+    wal_config.max_file_size_bytes = 64 * 1024 * 1024;
+
+    WAL wal(wal_config);
+    wal.Open();
+    if (!wal.IsOpen()) {
+        std::cerr << "Failed to open WAL in " << config.dir << std::endl;
+        return {};
+    }
+
+    std::atomic<uint64_t> failed{0};
+    std::vector<std::vector<uint64_t>> latencies(config.num_threads);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < config.num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            auto& samples = latencies[t];
+            samples.reserve(config.ops_per_thread);
+            std::vector<uint8_t> value(config.value_size, static_cast<uint8_t>('a' + t % 26));
+            for (size_t i = 0; i < config.ops_per_thread; ++i) {
+                std::string key = "key:" + std::to_string(t) + ":" + std::to_string(i);
+                CacheEntry entry(key, value);
+
+                auto op_start = std::chrono::steady_clock::now();
+                if (!wal.AppendSet(key, entry)) {
+                    failed++;
+                }
+                samples.push_back(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - op_start).count()));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    RunResult result;
+    result.group_commits = wal.GetStats().total_group_commits;
+    result.failed = failed.load();
+    wal.Close();
+    std::filesystem::remove_all(config.dir);
+
+    std::vector<uint64_t> all;
+    for (auto& samples : latencies) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    if (!all.empty()) {
+        std::sort(all.begin(), all.end());
+        result.p50_us = all[all.size() * 50 / 100];
+        result.p99_us = all[all.size() * 99 / 100];
+    }
+    result.ops_per_sec = elapsed > 0 ? all.size() / elapsed : 0;
+    return result;
+}
+
+struct FileResult {
+    double write_mb_per_sec = 0;
+    double read_mb_per_sec = 0;
+    bool ok = false;
+};
+
+FileResult RunFileWorkload(const std::filesystem::path& dir, size_t file_mb, bool use_io_uring) {
+    std::filesystem::create_directories(dir);
+    auto path = dir / "file_bench.dat";
+    const size_t piece = 64 * 1024;
+    std::string data(piece, 'x');
+    size_t total = file_mb * 1024 * 1024;
+
+    FileResult result;
+    auto start = std::chrono::steady_clock::now();
+    FileWriter writer(use_io_uring);
+    bool ok = writer.Open(path);
+    for (size_t written = 0; ok && written < total; written += piece) {
+        ok = writer.Append(data.data(), piece);
+    }
+    ok = writer.Finish(true) && ok;
+    double write_elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::string contents;
+    start = std::chrono::steady_clock::now();
+    ok = ok && ReadWholeFile(path, contents, use_io_uring);
+    double read_elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    std::filesystem::remove_all(dir);
+
+    double mb = static_cast<double>(total) / (1024 * 1024);
+    result.ok = ok && contents.size() == total;
+    result.write_mb_per_sec = write_elapsed > 0 ? mb / write_elapsed : 0;
+    result.read_mb_per_sec = read_elapsed > 0 ? mb / read_elapsed : 0;
+    return result;
+}
+
+std::vector<std::string> ParseNames(const std::string& text) {
+    std::vector<std::string> names;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            names.push_back(item);
+        }
+    }
+    return names;
+}
+
+std::vector<size_t> ParseList(const std::string& text) {
+    std::vector<size_t> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            values.push_back(std::stoul(item));
+        }
+    }
+    return values;
+}
+
+void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "Options:\n"
+              << "  -t LIST      Writer thread counts (default: 1,8,32)\n"
+              << "  -s LIST      WAL stream counts (default: 1,4,8)\n"
+              << "  -n N         Appends per thread (default: 2000)\n"
+              << "  -v BYTES     Value size (default: 128)\n"
+              << "  -b LIST      I/O backends: posix, uring (default: posix,uring)\n"
+              << "  -f MB        File size for the write/read comparison (default: 256)\n"
+              << "  -d DIR       Scratch directory (default: system temp)\n"
+              << "  --no-sync    Skip fdatasync on commits\n"
+              << "  -h, --help   Show this help message\n";
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> thread_counts = {1, 8, 32};
+    std::vector<size_t> stream_counts = {1, 4, 8};
+    size_t ops_per_thread = 2000;
+    size_t value_size = 128;
+    bool sync_on_write = true;
+    std::vector<std::string> backends = {"posix", "uring"};
+    size_t file_mb = 256;
+    std::filesystem::path dir = std::filesystem::temp_directory_path() /
+        ("distcache_wal_bench_" + std::to_string(::getpid()));
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);
+            return 0;
+        } else if (arg == "-t" && i + 1 < argc) {
+            thread_counts = ParseList(argv[++i]);
+        } else if (arg == "-s" && i + 1 < argc) {
+            stream_counts = ParseList(argv[++i]);
+        } else if (arg == "-n" && i + 1 < argc) {
+            ops_per_thread = std::stoull(argv[++i]);
+        } else if (arg == "-v" && i + 1 < argc) {
+            value_size = std::stoull(argv[++i]);
+        } else if (arg == "-b" && i + 1 < argc) {
+            backends = ParseNames(argv[++i]);
+        } else if (arg == "-f" && i + 1 < argc) {
+            file_mb = std::stoull(argv[++i]);
+        } else if (arg == "-d" && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (arg == "--no-sync") {
+            sync_on_write = false;
+        }
+    }
+
+    // Keep rotation and open/close messages out of the report
+    Logger::init("wal_benchmark", "warn");
+
+    std::cout << "\n===== WAL Write Benchmark =====" << std::endl;
+    std::cout << "Appends per thread: " << ops_per_thread << std::endl;
+    std::cout << "Value size: " << value_size << " bytes" << std::endl;
+    std::cout << "fdatasync: " << (sync_on_write ? "on" : "off") << std::endl;
+    std::cout << "io_uring: " << (IORing::IsSupported() ? "available" : "unavailable (falls back to posix)")
+              << std::endl;
+    std::cout << std::endl;
+    std::cout << std::setw(8) << "backend" << std::setw(8) << "threads" << std::setw(9) << "streams"
+              << std::setw(14) << "ops/sec" << std::setw(10) << "p50 us"
+              << std::setw(10) << "p99 us" << std::setw(10) << "commits" << std::endl;
+
+    bool ok = true;
+    for (const auto& backend : backends) {
+        bool uring = backend == "uring";
+        for (size_t threads : thread_counts) {
+            for (size_t streams : stream_counts) {
+                RunConfig config{threads, streams, ops_per_thread, value_size,
+                                 sync_on_write, uring, dir};
+                auto result = RunWorkload(config);
+                ok = ok && result.failed == 0 && result.ops_per_sec > 0;
+
+                std::cout << std::setw(8) << backend << std::setw(8) << threads << std::setw(9) << streams
+                          << std::setw(14) << std::fixed << std::setprecision(0) << result.ops_per_sec
+                          << std::setw(10) << result.p50_us << std::setw(10) << result.p99_us
+                          << std::setw(10) << result.group_commits << std::endl;
+            }
+        }
+    }
+
+    if (file_mb > 0) {
+        std::cout << std::endl;
+        std::cout << "Whole-file I/O (" << file_mb << " MB, 1 MB chunks)" << std::endl;
+        std::cout << std::setw(8) << "backend" << std::setw(14) << "write MB/s"
+                  << std::setw(14) << "read MB/s" << std::endl;
+        for (const auto& backend : backends) {
+            auto result = RunFileWorkload(dir, file_mb, backend == "uring");
+            ok = ok && result.ok;
+            std::cout << std::setw(8) << backend << std::setw(14) << std::fixed << std::setprecision(0)
+                      << result.write_mb_per_sec << std::setw(14) << result.read_mb_per_sec << std::endl;
+        }
+    }
+    std::cout << "===============================\n" << std::endl;
+
+    return ok ? 0 : 1;
+}
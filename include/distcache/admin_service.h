@@ -2,6 +2,7 @@
 
 #include "admin.grpc.pb.h"
 #include "hash_ring.h"
+#include "io_scheduler.h"
 #include "rebalance_orchestrator.h"
 #include "storage_engine.h"
 #include "sharding_client.h"
@@ -30,6 +31,7 @@ enum class NodeState {
  * - Drain node before graceful shutdown
  * - Get node and cluster status
  * - Retrieve metrics
+ * - Inspect and retune the background I/O budget at runtime
  *
  * Example usage:
  *   AdminServiceImpl admin(&storage, &client, node_id);
@@ -68,6 +70,12 @@ public:
      */
     void set_hash_rings(const HashRing* old_ring, const HashRing* new_ring);
 
+    /**
+     * Set the I/O scheduler that GetIoThrottle/SetIoThrottle manage and
+     * GetMetrics reports on.
+     */
+    void set_io_scheduler(std::shared_ptr<IoScheduler> scheduler);
+
     /**
      * Trigger rebalancing after node add/remove.
      */
@@ -96,6 +104,20 @@ public:
                            const distcache::v1::MetricsRequest* request,
                            distcache::v1::MetricsResponse* response) override;
 
+    /**
+     * Get the background I/O budget and how much it has throttled.
+     */
+    grpc::Status GetIoThrottle(grpc::ServerContext* context,
+                              const distcache::v1::GetIoThrottleRequest* request,
+                              distcache::v1::IoThrottleResponse* response) override;
+
+    /**
+     * Change the background I/O budget; takes effect immediately.
+     */
+    grpc::Status SetIoThrottle(grpc::ServerContext* context,
+                              const distcache::v1::SetIoThrottleRequest* request,
+                              distcache::v1::IoThrottleResponse* response) override;
+
     /**
      * Set the node state.
      */
@@ -117,6 +139,12 @@ private:
      */
     std::vector<distcache::v1::StatusResponse::NodeStatus> get_cluster_status() const;
 
+    /**
+     * Fill an I/O throttle response from the scheduler's config and stats.
+     */
+    static void fill_io_throttle(const IoScheduler& scheduler,
+                                 distcache::v1::IoThrottleResponse* response);
+
     // Dependencies
     ShardedHashTable* storage_;
     ShardingClient* client_;
@@ -137,6 +165,10 @@ private:
 
     // Active drain/rebalance job
     std::string active_job_id_;
+
+    // Background I/O budget
+    mutable std::mutex io_mutex_;
+    std::shared_ptr<IoScheduler> io_scheduler_;
 };
 
 /**
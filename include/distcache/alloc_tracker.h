@@ -0,0 +1,73 @@
+#pragma once
+
+#include "metrics.h"
+#include <cstdint>
+
+namespace distcache {
+
+/**
+ * AllocationTracker counts heap allocations made by the current thread.
+ *
+ * Linking distcache_alloc_tracker replaces the global operator new/delete
+ * with thin malloc/free wrappers that bump a thread-local counter, so the
+ * count covers our code, protobuf, gRPC handler code and the standard
+ * library alike. Counting is a single thread-local increment.
+ *
+ * Only distcache_server links it, and only when configured with
+ * -DDISTCACHE_ALLOC_TRACKING=ON; otherwise no binary's allocator changes.
+ */
+class AllocationTracker {
+public:
+    /**
+     * Get the number of allocations made by this thread so far.
+     */
+    static uint64_t thread_allocations();
+};
+
+/**
+ * AllocationScope measures the allocations made by the current thread
+ * between construction and destruction, and records them as one request
+ * in Metrics.
+ *
+ * Handlers get one through RequestPipeline::track_allocations(), which
+ * is empty unless allocation tracking is built in.
+ *
+ * Example:
+ *   {
+ *       AllocationScope allocs(&metrics);
+ *       ...
+ *   }
+ */
+class AllocationScope {
+public:
+    /**
+     * Start measuring.
+     * @param metrics Metrics to record into on destruction (may be null)
+     */
+    explicit AllocationScope(Metrics* metrics = nullptr)
+        : metrics_(metrics)
+        , start_(AllocationTracker::thread_allocations()) {}
+
+    ~AllocationScope() {
+        if (metrics_) {
+            metrics_->record_request_allocations(allocations());
+        }
+    }
+
+    // Disable copy/move
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+    /**
+     * Get the number of allocations made since construction.
+     */
+    uint64_t allocations() const {
+        return AllocationTracker::thread_allocations() - start_;
+    }
+
+private:
+    Metrics* metrics_;
+    uint64_t start_;
+};
+
+} // namespace distcache
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace distcache {
+
+/**
+ * CommitLog is a node's single ordered log of mutations, indexed by
+ * sequence number. A producer (normally the WAL, which assigns the
+ * sequence) appends each write once; consumers such as replication tail
+ * the log from their own sequence and acknowledge what they have
+ * handled. Records are shared between consumers, never copied per
+ * consumer.
+ *
+ * Records may be appended out of order (WAL streams commit
+ * independently); consumers only see the contiguous prefix, and with
+ * gate_on_durable only the part the producer has marked durable.
+ *
+ * Memory is bounded: records every consumer has acknowledged are
+ * dropped, and once the log exceeds max_bytes the oldest records are
+ * evicted anyway. A consumer that falls behind the retained window is
+ * served from the backfill (the WAL segments on disk), so catch-up is
+ * lossless as long as the producer still has the records.
+ */
+class CommitLog {
+public:
+    struct Record {
+        enum class Op {
+            SET,
+            DELETE
+        };
+
+        Op op = Op::SET;
+        int64_t sequence = 0;
+        std::string key;
+        std::string value;        // Empty for DELETE
+        int32_t ttl_seconds = 0;  // 0 means no expiry
+        int64_t version = 0;
+        bool replicated = false;  // Applied from another node; not shipped on
+
+        // A producer that already holds the value encoded (the WAL's
+        // group commit batch) shares that buffer instead of filling value
+        std::shared_ptr<const std::string> buffer;
+        std::string_view shared_value;
+
+        std::string_view value_view() const {
+            return buffer ? shared_value : std::string_view(value);
+        }
+    };
+    using RecordPtr = std::shared_ptr<const Record>;
+
+    /**
+     * Supplies evicted records: appends records with after < sequence
+     * <= up_to to out in sequence order, at most max_records of them.
+     * Sequences the producer no longer has (e.g. compacted away) are
+     * simply absent.
+     * @return False if the records could not be read
+     */
+    using Backfill = std::function<bool(int64_t after, int64_t up_to, size_t max_records,
+                                        std::vector<Record>& out)>;
+
+    struct Config {
+        size_t max_bytes = 64 * 1024 * 1024;  // Retained in memory (64MB)
+        bool gate_on_durable = false;         // Only expose records marked durable
+    };
+
+    CommitLog();
+    explicit CommitLog(const Config& config);
+
+    /**
+     * Position the log after an existing sequence (e.g. the WAL's
+     * recovered sequence). Must be called before the first Append().
+     */
+    void StartAfter(int64_t sequence);
+
+    /**
+     * Add a record. A zero sequence is assigned the next one after the
+     * highest seen, for producers that do not number their own writes.
+     * @return The record's sequence, or 0 if it was already appended
+     */
+    int64_t Append(Record record);
+
+    /**
+     * Producer's durable watermark: every sequence up to here is safe.
+     */
+    void MarkDurable(int64_t sequence);
+
+    /**
+     * Highest sequence consumers may read.
+     */
+    int64_t ReadableSequence() const;
+
+    void SetBackfill(Backfill backfill);
+
+    /**
+     * Read up to max_records records after a sequence, in order.
+     * @return Sequence the caller has now consumed through (after, if
+     *         nothing is readable yet), or -1 if records after it were
+     *         evicted and cannot be backfilled
+     */
+    int64_t Read(int64_t after, size_t max_records, std::vector<RecordPtr>& out);
+
+    /**
+     * Block until a record after the sequence is readable.
+     * @return False on timeout
+     */
+    bool WaitForRecords(int64_t after, std::chrono::milliseconds timeout);
+
+    /**
+     * Record that a consumer has handled everything up to a sequence.
+     * Records are only dropped early (before max_bytes forces it) once
+     * every registered consumer has acknowledged them.
+     */
+    void Acknowledge(const std::string& consumer, int64_t sequence);
+    void RemoveConsumer(const std::string& consumer);
+
+    struct Stats {
+        uint64_t records_appended = 0;
+        uint64_t records_evicted = 0;    // Dropped before every consumer had them
+        uint64_t records_backfilled = 0;
+        size_t retained_records = 0;
+        size_t retained_bytes = 0;
+        int64_t first_sequence = 0;      // Oldest sequence held in memory
+        int64_t readable_sequence = 0;
+        int64_t acknowledged_sequence = 0;  // Slowest consumer
+    };
+    Stats GetStats() const;
+
+private:
+    static size_t RecordBytes(const Record& record);
+    void AdvanceLocked();
+    void TrimLocked();
+    int64_t ReadableLocked() const;
+    int64_t AcknowledgedLocked() const;
+
+    Config config_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable readable_cv_;
+    std::deque<RecordPtr> slots_;  // slots_[i] holds sequence base_ + i
+    int64_t base_ = 1;
+    int64_t contiguous_ = 0;       // Every sequence up to here is present
+    int64_t highest_ = 0;
+    int64_t durable_ = 0;
+    size_t retained_bytes_ = 0;
+    std::map<std::string, int64_t> consumers_;
+    Backfill backfill_;
+
+    uint64_t records_appended_ = 0;
+    uint64_t records_evicted_ = 0;
+    uint64_t records_backfilled_ = 0;
+};
+
+} // namespace distcache
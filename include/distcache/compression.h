@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace distcache {
+namespace compression {
+
+/**
+ * Block codecs for persisted data. The numeric values are stored on
+ * disk next to each compressed block, so they must never change.
+ *
+ * zlib is always available; LZ4 is used when the build found liblz4
+ * and is preferred because it decompresses several times faster.
+ */
+enum class Codec : uint8_t {
+    kNone = 0,
+    kZlib = 1,
+    kLZ4 = 2,
+};
+
+/**
+ * Fastest codec compiled into this build.
+ */
+Codec DefaultCodec();
+
+/**
+ * Check whether a codec is compiled into this build.
+ */
+bool IsAvailable(Codec codec);
+
+const char* CodecName(Codec codec);
+
+/**
+ * Compress a buffer, appending the result to out.
+ * @return False if the codec is unavailable or compression failed
+ */
+bool Compress(Codec codec, const char* data, size_t size, std::string& out);
+
+/**
+ * Decompress a block whose original size is known.
+ * @param uncompressed_size Exact size of the original data
+ * @param out Replaced with the original data
+ * @return False if the codec is unavailable or the block is malformed
+ */
+bool Decompress(Codec codec, const char* data, size_t size,
+                size_t uncompressed_size, std::string& out);
+
+} // namespace compression
+} // namespace distcache
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace distcache {
+namespace crc32c {
+
+/**
+ * CRC-32C (Castagnoli), as used for WAL record checksums.
+ *
+ * Uses the SSE4.2 crc32 instruction on x86-64 and the ARMv8 CRC32
+ * extension on AArch64 when the CPU supports them (checked once at
+ * startup), and a table-driven implementation otherwise.
+ */
+
+/**
+ * Extend a running CRC with more data.
+ * @param crc CRC of the preceding data (0 to start)
+ * @param data Bytes to add
+ * @param size Number of bytes
+ * @return CRC of the preceding data followed by data
+ */
+uint32_t Extend(uint32_t crc, const void* data, size_t size);
+
+/**
+ * Compute the CRC of a buffer.
+ */
+inline uint32_t Value(const void* data, size_t size) {
+    return Extend(0, data, size);
+}
+
+/**
+ * Table-driven implementation, exposed for testing against Extend().
+ */
+uint32_t ExtendPortable(uint32_t crc, const void* data, size_t size);
+
+/**
+ * Check whether Extend() uses a hardware CRC instruction.
+ */
+bool IsHardwareAccelerated();
+
+} // namespace crc32c
+} // namespace distcache
@@ -2,8 +2,10 @@
 
 #pragma once
 
+#include "distcache/commit_log.h"
 #include "distcache/hash_ring.h"
 #include "distcache/metrics.h"
+#include "distcache/snapshot_manager.h"
 #include "distcache/storage_engine.h"
 #include "distcache/sharding_client.h"
 #include <failover.grpc.pb.h>
@@ -27,6 +29,9 @@ namespace distcache {
  * - Promote replica to primary on failure
  * - Update hash ring with new topology
  * - Coordinate catchup sync for rejoining nodes
+ * - Bootstrap a new or rejoining node from a peer: the peer's latest
+ *   snapshot, shipped as compressed chunks filtered to the ring ranges
+ *   this node owns, then its commit log from the snapshot's sequence
  * - Track failover history and statistics
  * - Thread-safe operations
  */
@@ -37,6 +42,7 @@ public:
         size_t replication_factor = 2;
         uint32_t failover_timeout_ms = 30000;  // 30 seconds
         bool auto_failover_enabled = true;
+        size_t bootstrap_apply_threads = 0;  // Snapshot chunk appliers; 0 = one per core
     };
 
     struct FailoverInfo {
@@ -87,6 +93,26 @@ public:
     // Set callback for failover events
     void SetFailoverCallback(FailoverCallback callback);
 
+    struct BootstrapResult {
+        bool success = false;
+        std::string error;
+        std::string snapshot_id;
+        size_t snapshot_chunks = 0;
+        size_t snapshot_keys = 0;   // Keys set or deleted from snapshot chunks
+        size_t tail_entries = 0;    // Log records applied after the snapshot
+        int64_t last_sequence = 0;  // Donor log position this node is current to
+        size_t bytes_received = 0;
+        int64_t duration_ms = 0;
+    };
+
+    /**
+     * Load this node's data from a peer's FailoverService. Chunks are
+     * applied in parallel as they arrive, so the transfer, not the
+     * apply, bounds the time. Only keys in the ring ranges this node
+     * owns are requested (every key if it is not in the ring yet).
+     */
+    BootstrapResult BootstrapFromPeer(const std::string& donor_address);
+
     // Statistics
     struct Stats {
         uint64_t total_failovers = 0;
@@ -142,9 +168,16 @@ private:
  */
 class FailoverServiceImpl final : public v1::FailoverService::Service {
 public:
+    /**
+     * @param snapshots Serves snapshot bootstraps (optional)
+     * @param commit_log Serves the log tail after the snapshot; snapshot
+     *                   bootstraps are refused without one
+     */
     explicit FailoverServiceImpl(std::shared_ptr<FailoverManager> manager,
                                   std::shared_ptr<ShardedHashTable> storage,
-                                  std::shared_ptr<Metrics> metrics);
+                                  std::shared_ptr<Metrics> metrics,
+                                  std::shared_ptr<SnapshotManager> snapshots = nullptr,
+                                  std::shared_ptr<CommitLog> commit_log = nullptr);
 
     // Initiate failover
     grpc::Status InitiateFailover(grpc::ServerContext* context,
@@ -156,6 +189,11 @@ public:
                                  const v1::CatchupRequest* request,
                                  grpc::ServerWriter<v1::CatchupEntry>* writer) override;
 
+    // Ship the latest snapshot and the log tail after it
+    grpc::Status RequestSnapshotBootstrap(grpc::ServerContext* context,
+                                          const v1::BootstrapRequest* request,
+                                          grpc::ServerWriter<v1::BootstrapMessage>* writer) override;
+
     // Get failover status
     grpc::Status GetFailoverStatus(grpc::ServerContext* context,
                                     const v1::FailoverStatusRequest* request,
@@ -165,6 +203,8 @@ private:
     std::shared_ptr<FailoverManager> manager_;
     std::shared_ptr<ShardedHashTable> storage_;
     std::shared_ptr<Metrics> metrics_;
+    std::shared_ptr<SnapshotManager> snapshots_;
+    std::shared_ptr<CommitLog> commit_log_;
 };
 
 } // namespace distcache
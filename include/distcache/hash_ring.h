@@ -30,6 +30,18 @@ struct Node {
     }
 };
 
+/**
+ * A span of ring positions, inclusive at both ends.
+ */
+struct HashRange {
+    uint64_t first = 0;
+    uint64_t last = 0;
+
+    bool operator==(const HashRange& other) const {
+        return first == other.first && last == other.last;
+    }
+};
+
 /**
  * HashRing implements consistent hashing for distributing keys across nodes.
  *
@@ -149,6 +161,25 @@ public:
         const std::vector<std::string>& keys,
         const std::optional<Node>& new_node) const;
 
+    /**
+     * Get the ring ranges whose keys have a node among their first n
+     * replicas: what the node holds once it joins. Lets another node
+     * select those keys by position alone, without its own ring view.
+     *
+     * @param node_id The node to compute ranges for
+     * @param n Replicas per key (as passed to get_replicas)
+     * @return Sorted, non-adjacent ranges; empty if the node is not in the ring
+     */
+    std::vector<HashRange> get_owned_ranges(const std::string& node_id, size_t n) const;
+
+    /**
+     * Compute the ring position of a key, as get_node() looks it up.
+     *
+     * @param key The key to hash
+     * @return 64-bit position on the ring
+     */
+    static uint64_t key_position(const std::string& key);
+
 private:
     /**
      * Compute hash for a string using MurmurHash3.
@@ -180,6 +211,15 @@ private:
     // Can be optimized to reader-writer lock in future
 };
 
+/**
+ * Helper function to test a ring position against sorted ranges.
+ *
+ * @param ranges Sorted, non-overlapping ranges (as from get_owned_ranges)
+ * @param position Ring position of a key
+ * @return True if a range contains the position
+ */
+bool hash_ranges_contain(const std::vector<HashRange>& ranges, uint64_t position);
+
 /**
  * Helper function to generate a unique node ID.
  *
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <sys/uio.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace distcache {
+
+/**
+ * IORing is a minimal io_uring submission/completion queue, driven
+ * through the raw syscalls so there is no liburing dependency.
+ *
+ * Operations are queued with the Prepare* calls and handed to the kernel
+ * by Submit(); completions are reaped with WaitCompletion(). A ring is
+ * meant to be used by one thread at a time. On kernels without io_uring
+ * (or where it is blocked) IsSupported() is false and callers keep their
+ * POSIX path.
+ */
+class IORing {
+public:
+    struct Completion {
+        uint64_t user_data = 0;
+        int32_t result = 0;  // Bytes transferred, or -errno
+    };
+
+    IORing() = default;
+    ~IORing();
+
+    IORing(const IORing&) = delete;
+    IORing& operator=(const IORing&) = delete;
+
+    /**
+     * Check once whether io_uring can be set up here and supports the
+     * read, write, fixed-buffer write and fsync operations.
+     */
+    static bool IsSupported();
+
+    /**
+     * Create the ring.
+     * @param entries Submission queue size (rounded up to a power of two)
+     * @return False if io_uring is unavailable
+     */
+    bool Init(unsigned entries);
+    bool IsInitialized() const { return ring_fd_ >= 0; }
+
+    /**
+     * Register buffers for PrepareWrite(..., buffer_index). Registration
+     * pins the pages once instead of on every write. Replaces any
+     * previously registered set; the ring must have nothing in flight.
+     */
+    bool RegisterBuffers(const std::vector<iovec>& buffers);
+    void UnregisterBuffers();
+
+    /**
+     * Queue a write. With buffer_index >= 0, data must lie inside that
+     * registered buffer. With link set, the next queued operation only
+     * starts once this one succeeds (and is cancelled otherwise).
+     * @return False if the submission queue is full
+     */
+    bool PrepareWrite(int fd, const void* data, size_t size, uint64_t offset,
+                      uint64_t user_data, int buffer_index = -1, bool link = false);
+    bool PrepareRead(int fd, void* data, size_t size, uint64_t offset, uint64_t user_data);
+    bool PrepareFsync(int fd, uint64_t user_data, bool datasync = true, bool link = false);
+
+    /**
+     * Hand queued operations to the kernel.
+     * @return Number submitted, or -errno
+     */
+    int Submit();
+
+    /**
+     * Reap one completion.
+     * @param timeout How long to block if none is ready; zero polls and
+     *                a negative value blocks until one arrives
+     * @return False if none arrived in time (or the wait failed)
+     */
+    bool WaitCompletion(Completion& completion,
+                        std::chrono::microseconds timeout = std::chrono::microseconds(-1));
+
+    unsigned sq_entries() const { return sq_entries_; }
+
+private:
+    void* PrepareSqe();
+    bool PeekCompletion(Completion& completion);
+
+    int ring_fd_ = -1;
+    unsigned sq_entries_ = 0;
+    bool ext_arg_ = false;  // Kernel accepts a timeout on waits
+
+    void* sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    void* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    void* cqes_ = nullptr;
+
+    unsigned local_tail_ = 0;  // Queued but not yet published to the kernel
+    bool buffers_registered_ = false;
+};
+
+/**
+ * FileWriter writes a file sequentially through a chunk buffer. With
+ * io_uring it keeps several chunk writes in flight while the caller
+ * fills the next one; otherwise each full chunk is written with pwrite.
+ */
+class FileWriter {
+public:
+    /**
+     * @param use_io_uring Use io_uring when supported (POSIX otherwise)
+     * @param chunk_size Bytes per write
+     * @param queue_depth Chunk writes in flight with io_uring
+     */
+    explicit FileWriter(bool use_io_uring, size_t chunk_size = 1024 * 1024,
+                        unsigned queue_depth = 4);
+    ~FileWriter();
+
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    /**
+     * Create (or truncate) the file.
+     */
+    bool Open(const std::filesystem::path& path);
+
+    /**
+     * Append bytes; they reach the file as chunks fill up.
+     * @return False once any write has failed
+     */
+    bool Append(const void* data, size_t size);
+
+    /**
+     * Write what is buffered, wait for every write and close the file.
+     * @param sync fdatasync before closing
+     * @return False if any write (or the sync) failed
+     */
+    bool Finish(bool sync);
+
+    bool uses_io_uring() const { return ring_ != nullptr; }
+    uint64_t bytes_written() const { return offset_ + buffers_[current_].size(); }
+
+private:
+    bool FlushCurrent();
+    bool ReapOne();
+
+    int fd_ = -1;
+    size_t chunk_size_;
+    std::unique_ptr<IORing> ring_;
+    std::vector<std::string> buffers_;
+    std::vector<bool> in_flight_;
+    size_t current_ = 0;
+    size_t pending_ = 0;  // Writes in flight
+    uint64_t offset_ = 0;  // File offset of the current buffer
+    bool failed_ = false;
+};
+
+/**
+ * Read a whole file into memory. With io_uring the file is read as
+ * chunk-sized reads, up to queue_depth of them at once.
+ * @return False if the file could not be read completely
+ */
+bool ReadWholeFile(const std::filesystem::path& path, std::string& out, bool use_io_uring,
+                   size_t chunk_size = 1024 * 1024, unsigned queue_depth = 8);
+
+} // namespace distcache
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "distcache/latency_histogram.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace distcache {
+
+/**
+ * IoScheduler is the I/O budget shared by a node's background disk work
+ * (snapshot writes and restores, WAL compaction and backfill reads), so
+ * it cannot starve foreground requests of disk bandwidth.
+ *
+ * Background work asks for its bytes before each read or write and is
+ * paced by a token bucket refilled at the effective rate. Foreground
+ * request latencies are fed in as well; every adjust interval the
+ * scheduler takes the p99 of the latencies seen since the last one and,
+ * when it is over target, multiplies the effective rate by
+ * backoff_factor (starting from the observed background throughput if
+ * no rate is configured). While the p99 is back under target the rate
+ * grows again by recovery_step per interval, up to the configured rate;
+ * with no configured rate the limit is lifted once it stops binding.
+ *
+ * The foreground path only touches relaxed atomics; only background
+ * callers take the scheduler's lock.
+ */
+class IoScheduler {
+public:
+    struct Config {
+        uint64_t bytes_per_second = 0;              // 0 = unlimited
+        uint64_t burst_bytes = 8 * 1024 * 1024;     // Bucket size (8MB)
+
+        // Adaptive backoff on foreground latency
+        bool adaptive = true;
+        uint64_t foreground_p99_target_us = 2000;
+        double backoff_factor = 0.5;                // Rate multiplier per slow interval
+        double recovery_step = 0.1;                 // Growth per healthy interval
+        uint64_t min_bytes_per_second = 1024 * 1024;  // Floor for backoff (1MB/s)
+        uint32_t adjust_interval_ms = 100;
+        uint64_t min_samples = 20;                  // Fewer per interval count as healthy
+    };
+
+    struct Stats {
+        uint64_t configured_bytes_per_second = 0;
+        uint64_t effective_bytes_per_second = 0;    // 0 = unlimited
+        uint64_t bytes_granted = 0;
+        uint64_t requests = 0;
+        uint64_t throttled_requests = 0;            // Requests that had to wait
+        uint64_t throttled_us = 0;                  // Total time background work waited
+        uint64_t backoffs = 0;
+        uint64_t foreground_p99_us = 0;             // Over the last full interval
+        LatencyHistogram::Snapshot foreground_latency;
+    };
+
+    IoScheduler();
+    explicit IoScheduler(const Config& config);
+
+    IoScheduler(const IoScheduler&) = delete;
+    IoScheduler& operator=(const IoScheduler&) = delete;
+
+    /**
+     * Block until bytes of background I/O may proceed. A request larger
+     * than the bucket waits for a full bucket and leaves it in debt.
+     * @return Time spent waiting
+     */
+    std::chrono::microseconds Acquire(size_t bytes);
+
+    /**
+     * Record the latency of one foreground request.
+     */
+    void RecordForeground(std::chrono::nanoseconds elapsed) {
+        foreground_.record(elapsed);
+    }
+
+    /**
+     * Replace the configuration. Waiting callers pick up the new rate
+     * immediately; adaptive state restarts from it.
+     */
+    void Reconfigure(const Config& config);
+    Config GetConfig() const;
+
+    Stats GetStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void RefillLocked(Clock::time_point now);
+    void AdjustLocked(Clock::time_point now);
+
+    mutable std::mutex mutex_;
+    std::condition_variable reconfigured_cv_;
+    Config config_;
+    double rate_ = 0;                  // Effective bytes per second, 0 = unlimited
+    double tokens_ = 0;
+    Clock::time_point last_refill_;
+    Clock::time_point last_adjust_;
+    uint64_t interval_bytes_ = 0;      // Granted since the last adjustment
+    bool interval_throttled_ = false;  // A request waited since the last adjustment
+    LatencyHistogram::Snapshot last_foreground_;
+
+    LatencyHistogram foreground_;
+    std::atomic<uint64_t> bytes_granted_{0};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> throttled_requests_{0};
+    std::atomic<uint64_t> throttled_us_{0};
+    std::atomic<uint64_t> backoffs_{0};
+    std::atomic<uint64_t> foreground_p99_us_{0};
+};
+
+/**
+ * Times one foreground request into an IoScheduler (if any) when it
+ * goes out of scope.
+ */
+class ForegroundTimer {
+public:
+    explicit ForegroundTimer(IoScheduler* scheduler)
+        : scheduler_(scheduler)
+        , started_(scheduler ? std::chrono::steady_clock::now()
+                             : std::chrono::steady_clock::time_point()) {}
+
+    ~ForegroundTimer() {
+        Stop();
+    }
+
+    /**
+     * Record the request now rather than at scope exit, e.g. before a
+     * durability wait that would skew the latency signal.
+     */
+    void Stop() {
+        if (scheduler_) {
+            scheduler_->RecordForeground(std::chrono::steady_clock::now() - started_);
+            scheduler_ = nullptr;
+        }
+    }
+
+    ForegroundTimer(const ForegroundTimer&) = delete;
+    ForegroundTimer& operator=(const ForegroundTimer&) = delete;
+
+private:
+    IoScheduler* scheduler_;
+    std::chrono::steady_clock::time_point started_;
+};
+
+} // namespace distcache
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace distcache {
+
+/**
+ * LatencyHistogram records durations into power-of-two microsecond
+ * buckets using only relaxed atomics, so it can sit on hot I/O paths.
+ *
+ * Bucket 0 counts samples under 1us; bucket i counts samples in
+ * [2^(i-1), 2^i) us. The last bucket also absorbs anything slower.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t kBuckets = 32;
+
+    /**
+     * Point-in-time copy of a histogram.
+     */
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> buckets{};
+        uint64_t count = 0;
+        uint64_t total_us = 0;
+        uint64_t max_us = 0;
+
+        /**
+         * Exclusive upper bound of bucket i in microseconds.
+         */
+        static uint64_t bucket_upper_us(size_t i) { return uint64_t{1} << i; }
+
+        double mean_us() const {
+            return count == 0 ? 0.0 : static_cast<double>(total_us) / count;
+        }
+
+        /**
+         * Estimate a percentile as the upper bound of the bucket it falls in.
+         * @param p Percentile in [0, 100]
+         * @return Latency in microseconds (0 if no samples)
+         */
+        uint64_t percentile_us(double p) const {
+            if (count == 0) {
+                return 0;
+            }
+            uint64_t rank = static_cast<uint64_t>(p / 100.0 * count);
+            if (rank >= count) {
+                rank = count - 1;
+            }
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBuckets; ++i) {
+                seen += buckets[i];
+                if (seen > rank) {
+                    return bucket_upper_us(i);
+                }
+            }
+            return max_us;
+        }
+    };
+
+    /**
+     * Record one sample.
+     */
+    void record(std::chrono::nanoseconds elapsed) {
+        uint64_t us = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+
+        size_t bucket = us == 0 ? 0 : static_cast<size_t>(64 - __builtin_clzll(us));
+        if (bucket >= kBuckets) {
+            bucket = kBuckets - 1;
+        }
+
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        total_us_.fetch_add(us, std::memory_order_relaxed);
+
+        uint64_t max = max_us_.load(std::memory_order_relaxed);
+        while (us > max &&
+               !max_us_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    Snapshot snapshot() const {
+        Snapshot snap;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            snap.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        snap.count = count_.load(std::memory_order_relaxed);
+        snap.total_us = total_us_.load(std::memory_order_relaxed);
+        snap.max_us = max_us_.load(std::memory_order_relaxed);
+        return snap;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> total_us_{0};
+    std::atomic<uint64_t> max_us_{0};
+};
+
+} // namespace distcache
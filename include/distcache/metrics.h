@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 #include <string>
 
 namespace distcache {
@@ -22,6 +23,11 @@ public:
     std::atomic<size_t> entries_count{0};
     std::atomic<size_t> memory_bytes{0};
 
+    // Heap allocations per request (see AllocationScope)
+    std::atomic<uint64_t> request_allocations_total{0};
+    std::atomic<uint64_t> requests_tracked{0};
+    std::atomic<uint64_t> request_allocations_max{0};
+
     /**
      * Get cache hit ratio (0.0 to 1.0)
      */
@@ -40,6 +46,30 @@ public:
                sets_total.load() + deletes_total.load();
     }
 
+    /**
+     * Record the number of heap allocations made by one request
+     */
+    void record_request_allocations(uint64_t count) {
+        request_allocations_total.fetch_add(count, std::memory_order_relaxed);
+        requests_tracked.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t max = request_allocations_max.load(std::memory_order_relaxed);
+        while (count > max &&
+               !request_allocations_max.compare_exchange_weak(max, count,
+                                                              std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * Get average heap allocations per tracked request
+     */
+    double allocations_per_request() const {
+        uint64_t requests = requests_tracked.load();
+        return requests > 0
+            ? static_cast<double>(request_allocations_total.load()) / requests
+            : 0.0;
+    }
+
     /**
      * Export metrics in Prometheus text format
      */
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace distcache {
+
+/**
+ * MurmurHash3 (x64, 128-bit variant folded to 64 bits). Unlike
+ * std::hash it is stable across builds, so it may be used for anything
+ * persisted or shared between nodes: ring positions, on-disk indexes.
+ */
+uint64_t murmur_hash3_64(const void* key, size_t len, uint32_t seed = 0);
+
+} // namespace distcache
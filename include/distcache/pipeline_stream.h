@@ -0,0 +1,135 @@
+#pragma once
+
+#include "cache_service.grpc.pb.h"
+#include <grpc++/grpc++.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace distcache {
+
+/**
+ * PipelineStream multiplexes tagged cache operations over a single
+ * long-lived CacheService::Pipeline bidi stream.
+ *
+ * Features:
+ * - Many callers share one stream; each op is matched to its response by tag
+ * - Responses may arrive out of order; a background reader dispatches them
+ * - Flow control: at most max_in_flight ops are outstanding per stream,
+ *   further callers block until a slot frees up or their deadline passes.
+ *   An op that times out keeps its slot until the server answers it or
+ *   the stream breaks, since the server is still working on it
+ * - A write that cannot go out before its op's deadline (the server has
+ *   stopped reading) cancels the stream rather than hold up every caller
+ * - Once the stream breaks, pending and future calls fail with UNAVAILABLE
+ *   so the owner can replace it
+ *
+ * Thread-safe.
+ *
+ * Example:
+ *   PipelineStream pipeline(stub.get(), 128);
+ *
+ *   v1::PipelineRequest request;
+ *   request.mutable_get()->set_key("user:123");
+ *
+ *   v1::PipelineResponse response;
+ *   auto status = pipeline.Call(std::move(request), &response,
+ *                               std::chrono::milliseconds(1000));
+ */
+class PipelineStream {
+public:
+    /**
+     * Open a pipeline stream on the given stub.
+     *
+     * @param stub Stub to open the stream on (must outlive this object)
+     * @param max_in_flight Maximum outstanding ops on this stream
+     */
+    PipelineStream(v1::CacheService::Stub* stub, size_t max_in_flight);
+
+    /**
+     * Close the stream and fail any outstanding ops.
+     */
+    ~PipelineStream();
+
+    // Disable copy/move
+    PipelineStream(const PipelineStream&) = delete;
+    PipelineStream& operator=(const PipelineStream&) = delete;
+
+    /**
+     * Send one op and wait for its response.
+     * The request's tag is assigned by the stream.
+     *
+     * @param request The op to send
+     * @param response Filled with the matching response on success
+     * @param timeout Maximum time to wait for a slot, the write and the response
+     * @return OK, the per-op status reported by the server, or a transport error
+     */
+    grpc::Status Call(v1::PipelineRequest request,
+                      v1::PipelineResponse* response,
+                      std::chrono::milliseconds timeout);
+
+    /**
+     * Check whether the stream has failed and should be replaced.
+     */
+    bool IsBroken() const { return broken_.load(); }
+
+    /**
+     * Get the number of ops currently awaiting a response.
+     */
+    size_t InFlight() const;
+
+private:
+    /**
+     * An op awaiting its response.
+     */
+    struct PendingCall {
+        bool done = false;
+        bool abandoned = false;  // Caller timed out; the slot is held until answered
+        grpc::Status status;
+        v1::PipelineResponse response;
+    };
+
+    /**
+     * Background loop reading responses and completing pending calls.
+     */
+    void ReadLoop();
+
+    /**
+     * Mark the stream broken and fail all pending calls.
+     */
+    void FailAll(const grpc::Status& status);
+
+    /**
+     * Background loop cancelling the stream when a write outlives its
+     * op's deadline.
+     */
+    void WatchdogLoop();
+
+    size_t max_in_flight_;
+    grpc::ClientContext context_;
+    std::unique_ptr<grpc::ClientReaderWriter<v1::PipelineRequest, v1::PipelineResponse>> stream_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<uint64_t, std::shared_ptr<PendingCall>> pending_;
+    uint64_t next_tag_ = 1;
+
+    std::timed_mutex write_mutex_;
+    bool writes_done_ = false;
+
+    std::mutex watchdog_mutex_;
+    std::condition_variable watchdog_cv_;
+    std::chrono::steady_clock::time_point write_deadline_;  // Of the write in progress
+    uint64_t write_generation_ = 0;  // Odd while a write is in progress
+    bool stopping_ = false;
+    std::thread watchdog_;
+
+    std::atomic<bool> broken_{false};
+    std::thread reader_;
+};
+
+} // namespace distcache
@@ -3,6 +3,7 @@
 #include "distcache/snapshot_manager.h"
 #include "distcache/wal.h"
 #include "distcache/storage_engine.h"
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -18,15 +19,44 @@ namespace distcache {
  * 4. Replay WAL entries in sequence order
  * 5. Mark recovery as complete
  *
+ * WAL replay streams the files through a k-way merge of mapped readers
+ * instead of loading the whole log, and applies entries on one worker
+ * per partition of storage shards. A key always maps to the same worker,
+ * so its entries are applied in log order.
+ *
+ * With lazy_restore, step 2 only maps the snapshot and reads its chunk
+ * index; shards are loaded on first use and in the background while
+ * the node serves (see SnapshotManager::BeginLazyRestore). WAL replay
+ * only writes, so it does not wait for them: replayed writes supersede
+ * the snapshot's entries for their keys.
+ *
  * This ensures durability and consistency even after crashes.
  */
 class RecoveryManager {
 public:
+    /**
+     * WAL replay progress, reported periodically and once at the end.
+     */
+    struct ReplayProgress {
+        size_t files_total = 0;
+        size_t files_done = 0;
+        size_t bytes_read = 0;
+        size_t entries_read = 0;
+        size_t entries_applied = 0;
+        int64_t elapsed_ms = 0;
+    };
+
     struct Config {
         std::string node_id;
         std::filesystem::path snapshot_dir = "./snapshots";
         std::filesystem::path wal_dir = "./wal";
-        bool verify_checksums = true;
+        bool verify_checksums = true;  // Check snapshot chunk CRCs while restoring
+        bool lazy_restore = false;     // Serve while the snapshot loads
+
+        // WAL replay
+        size_t replay_threads = 0;  // Apply workers; 0 = one per core
+        uint32_t progress_interval_ms = 1000;
+        std::function<void(const ReplayProgress&)> progress_callback;  // Optional
     };
 
     struct RecoveryResult {
@@ -37,13 +67,22 @@ public:
         bool snapshot_restored = false;
         std::string snapshot_id;
         size_t snapshot_keys_count = 0;
+        int64_t snapshot_sequence = 0;  // WAL records up to here came from the snapshot
+        size_t snapshot_corrupt_chunks = 0;  // Skipped; their keys were not restored
+        bool snapshot_lazy = false;  // Still loading after Recover() returns
 
         bool wal_replayed = false;
         size_t wal_files_count = 0;
         size_t wal_entries_replayed = 0;
+        size_t wal_corrupt_files = 0;     // Files cut short at a damaged record
+        size_t wal_bytes_discarded = 0;   // Bytes dropped after those records
 
         int64_t last_sequence_number = 0;
+
+        // Cold-start time: the whole recovery and its two phases
         int64_t recovery_duration_ms = 0;
+        int64_t snapshot_restore_ms = 0;
+        int64_t wal_replay_ms = 0;
     };
 
     RecoveryManager(const Config& config,
@@ -57,6 +96,14 @@ public:
      */
     RecoveryResult Recover();
 
+    /**
+     * Tie future snapshots to the WAL: each one is stamped with the WAL
+     * sequence it covers, and once written, the WAL segments it makes
+     * redundant are retired. Replaces any snapshot callback already set.
+     * Call after Recover(), before starting the snapshot manager.
+     */
+    void LinkSnapshotsToWAL();
+
     /**
      * Check if recovery has been performed.
      */
@@ -77,7 +124,11 @@ private:
     RecoveryResult last_result_;
 
     // Recovery steps
+    // Restore the latest snapshot, or an older one the WAL still covers
+    // @return False if no state the WAL can complete was restored
     bool RestoreSnapshot(RecoveryResult& result);
+    bool RestoreSnapshot(const SnapshotManager::SnapshotMetadata& snapshot,
+                         RecoveryResult& result);
     bool ReplayWAL(RecoveryResult& result, int64_t snapshot_sequence);
     bool ApplyWALEntry(const WAL::WALEntry& entry);
 };
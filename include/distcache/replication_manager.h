@@ -1,22 +1,38 @@
 #pragma once
 
 #include "storage_engine.h"
+#include "commit_log.h"
 #include "hash_ring.h"
 #include "metrics.h"
 #include <grpcpp/grpcpp.h>
 #include <replication.grpc.pb.h>
 #include <atomic>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <thread>
 #include <chrono>
 #include <condition_variable>
+#include <unordered_map>
 
 namespace distcache {
 
 /**
  * ReplicationManager handles asynchronous replication of writes
  * from primary to replica nodes.
+ *
+ * By default writes are handed over through QueueWrite/QueueDelete into
+ * a bounded queue. With a CommitLog attached it ships the node's commit
+ * log instead: each replica tails the log from the last sequence it
+ * acknowledged, so nothing is dropped when a replica is slow or down and
+ * it catches up from where it stopped.
+ *
+ * Either way every replica has its own sender thread and receives only
+ * the keys it holds a copy of, so replicas are sent to concurrently and
+ * a slow one does not hold the others up. In queue mode a dispatcher
+ * splits the queue into per-replica batches, each replica's sender
+ * merging whatever has built up for it into one RPC.
  */
 class ReplicationManager {
 public:
@@ -39,9 +55,19 @@ public:
     void Start();
     void Stop();
 
-    // Queue a write operation for replication
-    bool QueueWrite(const std::string& key,
-                    const std::string& value,
+    /**
+     * Ship the commit log rather than the internal queue. When a WAL
+     * feeds the log, writes reach replication through it and the Queue*
+     * calls are not needed; otherwise they append to the log.
+     * Must be called before Start().
+     */
+    void AttachCommitLog(std::shared_ptr<CommitLog> log);
+
+    // Queue a write operation for replication.
+    // Key and value are taken by value and moved into the queue; pass
+    // rvalues to hand over the caller's buffers without copying.
+    bool QueueWrite(std::string key,
+                    std::string value,
                     int32_t ttl_seconds,
                     int64_t version);
 
@@ -50,11 +76,14 @@ public:
     // Get replication statistics
     struct Stats {
         uint64_t queued_ops = 0;
-        uint64_t replicated_ops = 0;
-        uint64_t failed_ops = 0;
-        uint64_t batches_sent = 0;
+        uint64_t replicated_ops = 0;  // Entries delivered, counted per replica
+        uint64_t failed_ops = 0;      // Likewise
+        uint64_t dropped_ops = 0;     // Rejected because a queue was full
+        uint64_t batches_sent = 0;    // RPCs
         double avg_lag_ms = 0.0;
-        size_t queue_depth = 0;
+        size_t queue_depth = 0;      // Entries not yet sent, per replica once dispatched;
+                                     // with a commit log: records the slowest replica lacks
+        int64_t acked_sequence = 0;  // With a commit log: slowest replica's position
     };
     Stats GetStats() const;
 
@@ -69,11 +98,50 @@ private:
         std::chrono::steady_clock::time_point queued_at;
     };
 
-    // Worker thread function
+    // One replica's outgoing stream and the thread sending it
+    struct Destination {
+        Node node;
+        std::thread sender;
+        std::atomic<bool> running{false};
+
+        // Queue mode: batches holding only this replica's keys
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<v1::ReplicationBatch> batches;
+        size_t queued_entries = 0;
+
+        // Log mode: last sequence the replica acknowledged
+        std::atomic<int64_t> cursor{0};
+    };
+
+    // Worker thread functions: the queue dispatcher, or in log mode the
+    // supervisor keeping a sender per replica in the ring
     void ReplicationWorker();
+    void LogShippingWorker();
+
+    // Sender thread functions, one per destination
+    void QueueSender(Destination& destination);
+    void LogSender(Destination& destination);
+
+    // Split entries into one batch per replica holding their keys and
+    // queue each on its replica's sender
+    // Consumes the entries' keys and values
+    void DispatchBatch(std::vector<QueuedEntry>& entries);
 
-    // Send batch to replicas
-    bool SendBatch(const std::vector<QueuedEntry>& entries);
+    // Other nodes in the ring
+    std::vector<Node> GetPeers() const;
+
+    // Add senders for nodes that joined and remove those of nodes that left
+    void SyncDestinations(const std::vector<Node>& peers);
+    Destination& GetDestination(const Node& node);  // Requires destinations_mutex_
+    void StartSender(Destination& destination);
+    void StopSender(Destination& destination);
+
+    // Ship a replica the log records it has not acknowledged
+    // @return False if the replica could not be sent to
+    bool ShipLogTo(Destination& destination);
+    void UpdateAckedSequence();
+    bool SendToReplica(const Node& replica, const v1::ReplicationBatch& batch);
 
     // Get gRPC stub for node
     std::unique_ptr<v1::ReplicationService::Stub> GetStub(const Node& node);
@@ -91,10 +159,20 @@ private:
     std::thread worker_thread_;
     std::atomic<bool> running_{false};
 
+    // Per-replica senders, by node ID; added and removed by the worker.
+    // They outlive Stop, so queued batches and cursors survive a restart
+    std::unordered_map<std::string, std::unique_ptr<Destination>> destinations_;
+    mutable std::mutex destinations_mutex_;
+
+    // Log shipping: the log and the slowest replica's acknowledged sequence
+    std::shared_ptr<CommitLog> commit_log_;
+    std::atomic<int64_t> acked_sequence_{0};
+
     // Stats
     std::atomic<uint64_t> queued_ops_{0};
     std::atomic<uint64_t> replicated_ops_{0};
     std::atomic<uint64_t> failed_ops_{0};
+    std::atomic<uint64_t> dropped_ops_{0};
     std::atomic<uint64_t> batches_sent_{0};
 
     // Connection cache
@@ -110,7 +188,8 @@ public:
     explicit ReplicationServiceImpl(std::shared_ptr<ShardedHashTable> storage,
                                    std::shared_ptr<Metrics> metrics);
 
-    // Apply replication batch
+    // Apply replication batch. Entries carrying a log sequence this
+    // source has already had applied (a resent batch) are skipped
     grpc::Status Replicate(grpc::ServerContext* context,
                           const v1::ReplicationBatch* request,
                           v1::ReplicationAck* response) override;
@@ -125,10 +204,14 @@ public:
         uint64_t batches_received = 0;
         uint64_t entries_applied = 0;
         uint64_t entries_failed = 0;
+        uint64_t entries_skipped = 0;  // Already applied
         int64_t last_applied_timestamp = 0;
     };
     Stats GetStats() const;
 
+    // Highest log sequence applied from a source node (0 if none)
+    int64_t GetAppliedSequence(const std::string& source_node_id) const;
+
 private:
     std::shared_ptr<ShardedHashTable> storage_;
     std::shared_ptr<Metrics> metrics_;
@@ -136,7 +219,11 @@ private:
     std::atomic<uint64_t> batches_received_{0};
     std::atomic<uint64_t> entries_applied_{0};
     std::atomic<uint64_t> entries_failed_{0};
+    std::atomic<uint64_t> entries_skipped_{0};
     std::atomic<int64_t> last_applied_timestamp_{0};
+
+    std::unordered_map<std::string, int64_t> applied_sequences_;
+    mutable std::mutex applied_mutex_;
 };
 
 } // namespace distcache
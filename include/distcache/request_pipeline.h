@@ -0,0 +1,415 @@
+#pragma once
+
+#include "alloc_tracker.h"
+#include "auth_manager.h"
+#include "logger.h"
+#include "rate_limiter.h"
+#include "validator.h"
+#include <grpc++/grpc++.h>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace distcache {
+
+// ============================================================================
+// Stage policies
+//
+// Each stage comes in an enabled and a disabled flavour with the same
+// interface. Disabled stages are empty types whose methods return
+// immediately, and RequestPipeline skips them with `if constexpr`, so a
+// handler instantiated without a stage contains no code for it.
+// ============================================================================
+
+/**
+ * Rate limiting disabled.
+ */
+struct NoRateLimit {
+    static constexpr bool enabled = false;
+
+    grpc::Status admit(grpc::ServerContext*) const { return grpc::Status::OK; }
+    bool allow(const std::string&) const { return true; }
+};
+
+/**
+ * Per-client token bucket rate limiting (see RateLimiter).
+ */
+class TokenBucketRateLimit {
+public:
+    static constexpr bool enabled = true;
+
+    explicit TokenBucketRateLimit(std::shared_ptr<RateLimiter> limiter)
+        : limiter_(std::move(limiter)) {}
+
+    /**
+     * Charge one request to the calling client.
+     * @return OK, or RESOURCE_EXHAUSTED if the client is over its limit
+     */
+    grpc::Status admit(grpc::ServerContext* context) const {
+        std::string client_id = extract_client_id(context);
+        if (!allow(client_id)) {
+            LOG_WARN("Rate limited request from {}", client_id);
+            return grpc::Status(grpc::RESOURCE_EXHAUSTED,
+                                "Rate limit exceeded. Please try again later.");
+        }
+        return grpc::Status::OK;
+    }
+
+    /**
+     * Charge one request to an already-resolved client (streaming ops).
+     */
+    bool allow(const std::string& client_id) const {
+        return limiter_->allow_request(client_id);
+    }
+
+private:
+    std::shared_ptr<RateLimiter> limiter_;
+};
+
+/**
+ * Authentication disabled; every operation is allowed.
+ */
+struct NoAuth {
+    static constexpr bool enabled = false;
+
+    grpc::Status authorize(grpc::ServerContext*, Operation, const char*) const {
+        return grpc::Status::OK;
+    }
+
+    grpc::Status resolve(grpc::ServerContext*, bool& can_read, bool& can_write) const {
+        can_read = true;
+        can_write = true;
+        return grpc::Status::OK;
+    }
+};
+
+/**
+ * Token authentication and role-based authorization (see AuthManager).
+ */
+class TokenAuth {
+public:
+    static constexpr bool enabled = true;
+
+    explicit TokenAuth(std::shared_ptr<AuthManager> auth_manager)
+        : auth_manager_(std::move(auth_manager)) {}
+
+    /**
+     * Authenticate the caller and check it may perform operation.
+     * @param rpc RPC name for log messages
+     * @return OK, UNAUTHENTICATED or PERMISSION_DENIED
+     */
+    grpc::Status authorize(grpc::ServerContext* context, Operation operation,
+                           const char* rpc) const {
+        auto token = auth_manager_->authenticate(context);
+        if (!token.has_value()) {
+            LOG_WARN("Unauthenticated request to {}", rpc);
+            return grpc::Status(grpc::UNAUTHENTICATED, "Authentication required");
+        }
+        if (!auth_manager_->authorize(*token, operation)) {
+            LOG_WARN("Unauthorized {} request from user={}", rpc, token->user_id);
+            return grpc::Status(grpc::PERMISSION_DENIED, "Insufficient permissions");
+        }
+        return grpc::Status::OK;
+    }
+
+    /**
+     * Authenticate once and resolve read/write permissions, for streams
+     * whose credentials are fixed for their lifetime.
+     * @return OK, or UNAUTHENTICATED if the caller has no valid token
+     */
+    grpc::Status resolve(grpc::ServerContext* context, bool& can_read, bool& can_write) const {
+        auto token = auth_manager_->authenticate(context);
+        if (!token.has_value()) {
+            LOG_WARN("Unauthenticated stream request");
+            return grpc::Status(grpc::UNAUTHENTICATED, "Authentication required");
+        }
+        can_read = auth_manager_->authorize(*token, Operation::READ);
+        can_write = auth_manager_->authorize(*token, Operation::WRITE);
+        return grpc::Status::OK;
+    }
+
+private:
+    std::shared_ptr<AuthManager> auth_manager_;
+};
+
+/**
+ * Input validation disabled.
+ */
+struct NoValidation {
+    static constexpr bool enabled = false;
+    const Validator* validator() const { return nullptr; }
+};
+
+/**
+ * Input validation against configured limits (see Validator).
+ */
+class InputValidation {
+public:
+    static constexpr bool enabled = true;
+
+    explicit InputValidation(std::shared_ptr<Validator> validator)
+        : validator_(std::move(validator)) {}
+
+    const Validator* validator() const { return validator_.get(); }
+
+private:
+    std::shared_ptr<Validator> validator_;
+};
+
+/**
+ * Per-request debug/trace logging compiled out.
+ */
+struct NoRequestLogging {
+    static constexpr bool enabled = false;
+};
+
+/**
+ * Per-request debug/trace logging enabled.
+ */
+struct RequestLogging {
+    static constexpr bool enabled = true;
+};
+
+/**
+ * Per-request allocation counting compiled out.
+ */
+struct NoAllocationTracking {
+    static constexpr bool enabled = false;
+
+    struct Scope {};
+    Scope track(Metrics*) const { return {}; }
+};
+
+/**
+ * Per-request allocation counting (see AllocationScope). Only usable when
+ * the binary links distcache_alloc_tracker.
+ */
+struct AllocationTracking {
+    static constexpr bool enabled = true;
+
+    AllocationScope track(Metrics* metrics) const { return AllocationScope(metrics); }
+};
+
+#ifdef DISTCACHE_ALLOC_TRACKING
+using DefaultAllocationTracking = AllocationTracking;
+#else
+using DefaultAllocationTracking = NoAllocationTracking;
+#endif
+
+// ============================================================================
+// RequestPipeline
+// ============================================================================
+
+/**
+ * RequestPipeline composes the per-request interceptor stages that run
+ * in front of every cache RPC: rate limiting, then authentication, then
+ * input validation, with optional request logging and allocation
+ * counting throughout.
+ *
+ * Stages are template policies dispatched statically. A service
+ * instantiated as RequestPipeline<NoRateLimit, NoAuth, NoValidation,
+ * NoRequestLogging> compiles every check down to nothing, which is the
+ * common configuration for an internal cluster. Use MakeRequestPipeline()
+ * to choose the specialization that matches the runtime configuration.
+ *
+ * Example:
+ *   Status Get(ServerContext* context, const GetRequest* request,
+ *              GetResponse* response) override {
+ *       [[maybe_unused]] auto allocs = pipeline_.track_allocations(&metrics_);
+ *       PIPELINE_RETURN_IF_ERROR(pipeline_.admit(context, Operation::READ, "Get"));
+ *       PIPELINE_RETURN_IF_ERROR(pipeline_.validate("GET", [&](const Validator& v) {
+ *           return v.validate_key(request->key());
+ *       }));
+ *
+ *       pipeline_.log([&] { LOG_DEBUG("GET key={}", request->key()); });
+ *       ...
+ *   }
+ */
+template<typename RateLimitPolicy,
+         typename AuthPolicy,
+         typename ValidationPolicy,
+         typename LoggingPolicy,
+         typename AllocationPolicy = NoAllocationTracking>
+class RequestPipeline {
+public:
+    static constexpr bool kRateLimited = RateLimitPolicy::enabled;
+    static constexpr bool kAuthenticated = AuthPolicy::enabled;
+    static constexpr bool kValidated = ValidationPolicy::enabled;
+    static constexpr bool kLogged = LoggingPolicy::enabled;
+    static constexpr bool kAllocationsTracked = AllocationPolicy::enabled;
+
+    RequestPipeline(RateLimitPolicy rate_limit, AuthPolicy auth,
+                    ValidationPolicy validation, LoggingPolicy logging,
+                    AllocationPolicy allocation = AllocationPolicy())
+        : rate_limit_(std::move(rate_limit))
+        , auth_(std::move(auth))
+        , validation_(std::move(validation))
+        , logging_(std::move(logging))
+        , allocation_(std::move(allocation)) {}
+
+    /**
+     * Run the rate limit and auth stages for a unary RPC.
+     * @param context Server context of the call
+     * @param operation Operation class required by the RPC
+     * @param rpc RPC name for log messages
+     * @return OK if the request may proceed, otherwise the status to return
+     */
+    grpc::Status admit(grpc::ServerContext* context, Operation operation,
+                       const char* rpc) const {
+        if constexpr (kRateLimited) {
+            grpc::Status status = rate_limit_.admit(context);
+            if (!status.ok()) {
+                return status;
+            }
+        }
+        if constexpr (kAuthenticated) {
+            return auth_.authorize(context, operation, rpc);
+        }
+        return grpc::Status::OK;
+    }
+
+    /**
+     * Run the validation stage. check is only invoked when validation
+     * is enabled, so building its arguments costs nothing otherwise.
+     * @param what Operation name for log messages
+     * @param check Callable taking const Validator& and returning ValidationResult
+     * @return OK, or INVALID_ARGUMENT with the validation error
+     */
+    template<typename Check>
+    grpc::Status validate(const char* what, Check&& check) const {
+        if constexpr (kValidated) {
+            ValidationResult result = check(*validation_.validator());
+            if (!result.valid) {
+                LOG_WARN("Validation failed: {} - {}", what, result.error_message);
+                return grpc::Status(grpc::INVALID_ARGUMENT, result.error_message);
+            }
+        }
+        return grpc::Status::OK;
+    }
+
+    /**
+     * Run fn only when request logging is compiled in, so log arguments
+     * are never formatted or even evaluated otherwise.
+     */
+    template<typename Fn>
+    void log(Fn&& fn) const {
+        if constexpr (kLogged) {
+            fn();
+        }
+    }
+
+    /**
+     * Start counting the request's allocations into metrics; the count is
+     * recorded when the returned scope ends. An empty object when
+     * allocation tracking is compiled out.
+     */
+    auto track_allocations(Metrics* metrics) const { return allocation_.track(metrics); }
+
+    /**
+     * Get the rate limit stage (streams charge each op individually).
+     */
+    const RateLimitPolicy& rate_limit() const { return rate_limit_; }
+
+    /**
+     * Get the auth stage (streams resolve permissions once).
+     */
+    const AuthPolicy& auth() const { return auth_; }
+
+    /**
+     * Get the validator, or nullptr when validation is compiled out.
+     */
+    const Validator* validator() const { return validation_.validator(); }
+
+private:
+    RateLimitPolicy rate_limit_;
+    AuthPolicy auth_;
+    ValidationPolicy validation_;
+    LoggingPolicy logging_;
+    AllocationPolicy allocation_;
+};
+
+/**
+ * Runtime configuration used to pick a RequestPipeline specialization.
+ * A null component disables its stage.
+ */
+struct RequestPipelineOptions {
+    std::shared_ptr<RateLimiter> rate_limiter;
+    std::shared_ptr<AuthManager> auth_manager;
+    std::shared_ptr<Validator> validator;
+    bool request_logging = false;
+};
+
+namespace detail {
+
+// Choose one stage per step, then hand the finished pipeline to fn
+template<typename Fn, typename... Stages>
+auto select_pipeline_stages(const RequestPipelineOptions& options, Fn&& fn,
+                            Stages... stages) {
+    constexpr size_t kChosen = sizeof...(Stages);
+
+    if constexpr (kChosen == 0) {
+        if (options.rate_limiter) {
+            return select_pipeline_stages(options, std::forward<Fn>(fn),
+                                          TokenBucketRateLimit(options.rate_limiter));
+        }
+        return select_pipeline_stages(options, std::forward<Fn>(fn), NoRateLimit{});
+    } else if constexpr (kChosen == 1) {
+        if (options.auth_manager) {
+            return select_pipeline_stages(options, std::forward<Fn>(fn), stages...,
+                                          TokenAuth(options.auth_manager));
+        }
+        return select_pipeline_stages(options, std::forward<Fn>(fn), stages..., NoAuth{});
+    } else if constexpr (kChosen == 2) {
+        if (options.validator) {
+            return select_pipeline_stages(options, std::forward<Fn>(fn), stages...,
+                                          InputValidation(options.validator));
+        }
+        return select_pipeline_stages(options, std::forward<Fn>(fn), stages..., NoValidation{});
+    } else if constexpr (kChosen == 3) {
+        if (options.request_logging) {
+            return select_pipeline_stages(options, std::forward<Fn>(fn), stages...,
+                                          RequestLogging{});
+        }
+        return select_pipeline_stages(options, std::forward<Fn>(fn), stages...,
+                                      NoRequestLogging{});
+    } else if constexpr (kChosen == 4) {
+        // Fixed at build time: counting needs the replaced operator new
+        return select_pipeline_stages(options, std::forward<Fn>(fn), stages...,
+                                      DefaultAllocationTracking{});
+    } else {
+        return fn(RequestPipeline<Stages...>(std::move(stages)...));
+    }
+}
+
+} // namespace detail
+
+/**
+ * Build the RequestPipeline specialization matching options and pass it
+ * to fn. Every combination is instantiated at compile time; the choice
+ * is made once at startup, so handlers never branch on disabled stages.
+ *
+ * fn must return the same type for every specialization, e.g.
+ * std::unique_ptr<grpc::Service>.
+ *
+ * @param options Which stages to enable
+ * @param fn Generic callable taking the pipeline by value
+ * @return Whatever fn returns
+ */
+template<typename Fn>
+auto MakeRequestPipeline(const RequestPipelineOptions& options, Fn&& fn) {
+    return detail::select_pipeline_stages(options, std::forward<Fn>(fn));
+}
+
+} // namespace distcache
+
+/**
+ * Helper macro to return early from an RPC handler when a pipeline
+ * stage rejects the request.
+ */
+#define PIPELINE_RETURN_IF_ERROR(expr) \
+    do { \
+        grpc::Status pipeline_status_ = (expr); \
+        if (!pipeline_status_.ok()) { \
+            return pipeline_status_; \
+        } \
+    } while(0)
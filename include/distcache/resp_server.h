@@ -0,0 +1,217 @@
+#pragma once
+
+#include "static_dataset.h"
+#include "storage_engine.h"
+#include "wal.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace distcache {
+
+/**
+ * RespParser incrementally parses client commands in the Redis
+ * serialization protocol (RESP).
+ *
+ * Accepts both multibulk requests (*N\r\n$len\r\narg\r\n...) and
+ * space-separated inline commands, as sent by redis-cli and telnet.
+ */
+class RespParser {
+public:
+    enum class Result {
+        OK,          // A command was parsed
+        INCOMPLETE,  // More bytes are needed
+        ERROR        // Malformed input; the connection should be closed
+    };
+
+    /**
+     * Parse one command from buffer, starting at offset.
+     *
+     * @param buffer Received bytes
+     * @param offset Start position; advanced past the command on OK
+     * @param args Filled with the command name and arguments on OK
+     * @param error Filled with a protocol error message on ERROR
+     * @param max_bulk_length Largest accepted bulk string in bytes
+     * @return Parse result
+     */
+    static Result Parse(const std::string& buffer,
+                        size_t& offset,
+                        std::vector<std::string>& args,
+                        std::string& error,
+                        size_t max_bulk_length);
+};
+
+/**
+ * RespServer is an optional Redis-compatible listener that serves
+ * GET/SET/DEL/MGET/MSET/EXPIRE/INCR directly from a ShardedHashTable,
+ * bypassing gRPC and protobuf.
+ *
+ * Features:
+ * - RESP2 by default, RESP3 after HELLO 3
+ * - One epoll reactor thread per core, each with its own SO_REUSEPORT
+ *   listening socket so the kernel spreads connections across reactors
+ * - Pipelined requests: every complete command in a read is answered
+ *   in one write
+ * - Output back-pressure: a connection stops being read while its
+ *   unsent replies exceed max_output_buffer
+ * - Durable writes: with a WAL, a burst's replies from its first write
+ *   on are parked on the connection until the group commits holding its
+ *   writes return; the reactor keeps serving other connections meanwhile
+ * - Mounted datasets: keys in their namespaces are read from them and
+ *   refused for writes, as on the gRPC service
+ *
+ * The listener performs no authentication; only expose it on trusted
+ * networks. Linux only (Start() fails elsewhere).
+ *
+ * Example:
+ *   auto storage = std::make_shared<ShardedHashTable>();
+ *   RespServer::Config config;
+ *   config.port = 6379;
+ *
+ *   RespServer server(config, storage);
+ *   server.Start();
+ */
+class RespServer {
+public:
+    struct Config {
+        std::string bind_address = "0.0.0.0";
+        uint16_t port = 6379;                          // 0 = pick an ephemeral port
+        size_t num_reactors = 0;                       // 0 = one per CPU core
+        bool pin_reactors = true;                      // Pin reactor threads to cores
+        size_t max_bulk_length = 64 * 1024 * 1024;     // Largest accepted argument
+        size_t max_output_buffer = 64 * 1024 * 1024;   // Pause reads above this
+    };
+
+    struct Stats {
+        uint64_t connections_accepted = 0;
+        uint64_t active_connections = 0;
+        uint64_t commands_processed = 0;
+        uint64_t protocol_errors = 0;
+    };
+
+    /**
+     * Construct a RESP server over shared storage.
+     *
+     * @param config Listener configuration
+     * @param storage Storage shared with the gRPC service
+     * @param wal Write-ahead log writes must reach before being
+     *            acknowledged (null when persistence is disabled)
+     * @param datasets Read-only namespaces served ahead of storage, if any
+     */
+    RespServer(const Config& config, std::shared_ptr<ShardedHashTable> storage,
+               std::shared_ptr<WAL> wal = nullptr,
+               std::shared_ptr<StaticDatasets> datasets = nullptr);
+    ~RespServer();
+
+    // Disable copy/move
+    RespServer(const RespServer&) = delete;
+    RespServer& operator=(const RespServer&) = delete;
+
+    /**
+     * Bind the listening sockets and start the reactor threads.
+     *
+     * @return True if the server is listening
+     */
+    bool Start();
+
+    /**
+     * Stop the reactors and close all connections.
+     */
+    void Stop();
+
+    /**
+     * Get the bound port (resolved when Config::port is 0).
+     */
+    uint16_t port() const { return port_; }
+
+    /**
+     * Get listener statistics.
+     */
+    Stats GetStats() const;
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::string in;
+        size_t in_offset = 0;
+        std::string out;
+        size_t out_offset = 0;
+        uint32_t events = 0;       // Current epoll interest mask
+        int protocol = 2;          // RESP protocol version
+        bool close_after_write = false;
+        bool wrote = false;        // Last command changed storage
+
+        // While parked, replies from held_from on wait for the WAL to
+        // commit the burst's writes and no further input is read
+        bool parked = false;
+        size_t held_from = 0;
+        std::vector<std::pair<size_t, size_t>> held_writes;  // Write reply ranges
+        WAL::CommitTicket commit;
+    };
+
+    struct Reactor {
+        int epoll_fd = -1;
+        int listen_fd = -1;
+        int wake_fd = -1;
+        std::thread thread;
+        std::unordered_map<int, std::unique_ptr<Connection>> connections;
+        std::vector<int> parked;               // Connections awaiting a WAL commit
+        std::atomic<size_t> parked_count{0};   // Read by the WAL commit listener
+    };
+
+    // Reactor event loop
+    void RunReactor(Reactor& reactor, size_t index);
+
+    // Accept all pending connections on a reactor's listening socket
+    void AcceptConnections(Reactor& reactor);
+
+    // Read from a connection and execute every complete command
+    bool HandleReadable(Reactor& reactor, Connection& conn);
+
+    // Execute buffered commands until input runs out or output is full;
+    // parks the connection if any of them must wait for the WAL
+    void ProcessInput(Reactor& reactor, Connection& conn);
+
+    // Release parked connections whose WAL commit has completed or failed
+    void ResumeParked(Reactor& reactor);
+
+    // Unpark a connection, turning its held write replies into errors if
+    // the WAL did not commit them
+    void ReleaseHeld(Connection& conn, bool committed);
+
+    // Write pending replies; returns false if the connection failed
+    bool FlushOutput(Connection& conn);
+
+    // Recompute the epoll interest mask for a connection
+    void UpdateInterest(Reactor& reactor, Connection& conn);
+
+    void CloseConnection(Reactor& reactor, int fd);
+
+    // Execute one command and append its reply
+    void ExecuteCommand(Connection& conn, std::vector<std::string>& args);
+
+    // True if the key belongs to a mounted dataset
+    bool IsReadOnly(const std::string& key) const;
+
+    // Open one SO_REUSEPORT listening socket on port_
+    int OpenListener();
+
+    Config config_;
+    std::shared_ptr<ShardedHashTable> storage_;
+    std::shared_ptr<WAL> wal_;  // Null when persistence is disabled
+    std::shared_ptr<StaticDatasets> datasets_;  // Read-only namespaces, if any
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+    uint16_t port_;
+    std::atomic<bool> running_{false};
+
+    std::atomic<uint64_t> connections_accepted_{0};
+    std::atomic<uint64_t> active_connections_{0};
+    std::atomic<uint64_t> commands_processed_{0};
+    std::atomic<uint64_t> protocol_errors_{0};
+};
+
+} // namespace distcache
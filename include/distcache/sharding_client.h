@@ -4,6 +4,7 @@
 #include "cache_service.grpc.pb.h"
 #include <grpc++/grpc++.h>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -11,6 +12,8 @@
 
 namespace distcache {
 
+class PipelineStream;
+
 /**
  * ClientConfig holds configuration for the ShardingClient.
  */
@@ -32,6 +35,13 @@ struct ClientConfig {
 
     // Use insecure credentials (for development only)
     bool insecure = true;
+
+    // Send Get/Set/Delete/CAS over one Pipeline stream per node instead of
+    // one unary RPC per op (default: false)
+    bool enable_pipelining = false;
+
+    // Max outstanding ops per pipeline stream before callers block (default: 128)
+    size_t pipeline_max_in_flight = 128;
 };
 
 /**
@@ -68,6 +78,15 @@ struct OperationResult {
     }
 };
 
+/**
+ * BatchSetItem is a single entry for ShardingClient::BatchSet.
+ */
+struct BatchSetItem {
+    std::string key;
+    std::string value;
+    std::optional<int32_t> ttl_seconds;
+};
+
 /**
  * ShardingClient provides a distributed cache client with client-side sharding.
  *
@@ -76,6 +95,8 @@ struct OperationResult {
  * - Connection pooling to multiple cache nodes
  * - Automatic failover to replica nodes on failure
  * - Configurable retry policies
+ * - Multi-key operations fanned out to owning nodes in parallel
+ * - Optional request pipelining over one bidi stream per node
  * - Thread-safe operations
  *
  * Example:
@@ -151,6 +172,29 @@ public:
                                           const std::string& new_value,
                                           std::optional<int32_t> ttl_seconds = std::nullopt);
 
+    /**
+     * Get multiple keys in one call.
+     * Keys are split by owning node and each node receives a single
+     * BatchGet RPC; nodes are contacted in parallel and results merged.
+     * If a node's batch fails, its keys fall back to per-key Get with
+     * replica failover.
+     *
+     * @param keys The keys to look up
+     * @return One OperationResult per key, in request order
+     */
+    std::vector<OperationResult<std::string>> BatchGet(const std::vector<std::string>& keys);
+
+    /**
+     * Set multiple key-value pairs in one call.
+     * Entries are split by owning node and sent as one BatchSet RPC per
+     * node, in parallel. If a node's batch fails, its entries fall back
+     * to per-key Set with replica failover.
+     *
+     * @param items The entries to set
+     * @return One OperationResult per entry, in request order
+     */
+    std::vector<OperationResult<bool>> BatchSet(const std::vector<BatchSetItem>& items);
+
     /**
      * Check if the client is connected to the cluster.
      *
@@ -196,6 +240,10 @@ private:
         std::unique_ptr<v1::CacheService::Stub> stub;
         Node node;
 
+        // Lazily opened pipeline stream (when pipelining is enabled)
+        std::mutex pipeline_mutex;
+        std::shared_ptr<PipelineStream> pipeline;
+
         Connection(const Node& n, bool insecure);
     };
 
@@ -207,6 +255,19 @@ private:
      */
     Connection* GetConnection(const Node& node);
 
+    /**
+     * Send one op over the node's pipeline stream, opening or replacing
+     * the stream as needed.
+     *
+     * @param conn Connection to the node
+     * @param request The op to send
+     * @param response Filled with the op's response
+     * @return Status of the op
+     */
+    grpc::Status PipelineCall(Connection* conn,
+                              v1::PipelineRequest request,
+                              v1::PipelineResponse* response);
+
     /**
      * Execute a Get operation with retry logic.
      *
@@ -261,6 +322,41 @@ private:
         std::optional<int32_t> ttl_seconds,
         const std::vector<Node>& replicas);
 
+    /**
+     * Send one BatchGet RPC to a node, with retry logic.
+     *
+     * @param node The node owning all of the keys
+     * @param keys The keys to look up
+     * @param results Filled with one result per key on success
+     * @return True if the RPC succeeded
+     */
+    bool ExecuteBatchGet(
+        const Node& node,
+        const std::vector<std::string>& keys,
+        std::vector<OperationResult<std::string>>& results);
+
+    /**
+     * Send one BatchSet RPC to a node, with retry logic.
+     *
+     * @param node The node owning all of the entries
+     * @param items The entries to set
+     * @param results Filled with one result per entry on success
+     * @return True if the RPC succeeded
+     */
+    bool ExecuteBatchSet(
+        const Node& node,
+        const std::vector<const BatchSetItem*>& items,
+        std::vector<OperationResult<bool>>& results);
+
+    /**
+     * Group key indices by the primary node that owns each key.
+     *
+     * @param keys The keys to route
+     * @return Map of node_id -> (node, indices into keys)
+     */
+    std::unordered_map<std::string, std::pair<Node, std::vector<size_t>>>
+    GroupByOwner(const std::vector<std::string>& keys) const;
+
     /**
      * Record a request to a node (for statistics).
      *
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "distcache/cache_entry.h"
+#include "distcache/compression.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace distcache {
+namespace snapshot_format {
+
+/**
+ * Chunked snapshot format (V3, V4).
+ *
+ *   "DISTCACHE_SNAPSHOT_V3\n" <snapshot id> "\n" <wal sequence> "\n"
+ *   "DISTCACHE_SNAPSHOT_V4\n" <snapshot id> "\n" <wal sequence> "\n"
+ *       <covered ms> "\n" <base id, or "-"> "\n" <since ms> "\n"
+ *   chunk*    chunk header + payload (optionally compressed)
+ *   index     one entry per chunk: offset, sizes, entry count, shard,
+ *             kind, and in checksummed files the chunk's CRC32C
+ *   footer    index offset, chunk count, key count, shard count,
+ *             file digest, magic
+ *
+ * Each chunk holds entries of a single storage shard, so chunks can be
+ * encoded, compressed and decoded independently and in parallel, and the
+ * index locates any chunk without scanning the file. All integers are
+ * little-endian and fixed width, independent of the host.
+ *
+ * V4 adds what delta snapshots need: a delta names the snapshot it
+ * applies on top of and holds only entries modified since "since ms",
+ * plus tombstone chunks for keys deleted since then. "covered ms" is
+ * when the snapshot's scan began; changes stamped after it are not
+ * guaranteed to be included.
+ *
+ * Checksummed files (told apart by the footer magic) carry a CRC32C of
+ * every chunk, covering its header and stored payload, computed by the
+ * workers that compress it. The footer digest is a CRC32C of the header
+ * lines, the index and the footer fields before it; as the index holds
+ * every chunk's CRC, the digest vouches for the whole file while chunks
+ * are still verified independently, in parallel.
+ *
+ * Entry encoding inside a chunk payload:
+ *   u32 key length, key, u32 value length, value,
+ *   i32 ttl seconds (0 = none), i64 version, i64 created_at_ms,
+ *   i64 expires_at_ms (0 = none)
+ *
+ * Tombstone encoding inside a tombstone chunk payload:
+ *   u32 key length, key, i64 deleted_at_ms
+ */
+
+constexpr const char* kHeaderV3 = "DISTCACHE_SNAPSHOT_V3";
+constexpr const char* kHeaderV4 = "DISTCACHE_SNAPSHOT_V4";  // Adds delta fields
+constexpr size_t kChunkHeaderSize = 32;
+constexpr size_t kIndexEntrySize = 40;
+constexpr size_t kChecksummedIndexEntrySize = 48;  // Adds the chunk CRC32C
+constexpr size_t kFooterSize = 40;
+
+struct ChunkInfo {
+    uint64_t offset = 0;       // File offset of the chunk header
+    uint64_t stored_size = 0;  // Payload bytes in the file
+    uint64_t raw_size = 0;     // Payload bytes once decompressed
+    uint32_t num_entries = 0;
+    uint32_t shard = 0;        // Storage shard the entries came from
+    compression::Codec codec = compression::Codec::kNone;
+    bool tombstones = false;   // Payload holds deleted keys, not entries
+    uint32_t checksum = 0;     // CRC32C of chunk header and stored payload
+};
+
+struct Footer {
+    uint64_t index_offset = 0;
+    uint64_t num_chunks = 0;
+    uint64_t num_keys = 0;
+    uint32_t shard_count = 0;  // Of the table the snapshot was taken from
+    bool checksummed = false;  // Chunks carry a CRC32C and the file a digest
+    uint32_t digest = 0;       // CRC32C of header lines, index and footer
+};
+
+/**
+ * Append one entry to a raw chunk payload.
+ */
+void EncodeEntry(const std::string& key, const CacheEntry& entry, std::string& out);
+
+/**
+ * Decode every entry of a raw chunk payload.
+ * @return False if the payload is malformed or holds a different count
+ */
+bool DecodeEntries(const char* data, size_t size, uint32_t num_entries,
+                   std::vector<std::pair<std::string, CacheEntry>>& out);
+
+/**
+ * Append one deleted key to a raw tombstone chunk payload.
+ */
+void EncodeTombstone(const std::string& key, int64_t deleted_at_ms, std::string& out);
+
+/**
+ * Decode every key of a raw tombstone chunk payload.
+ */
+bool DecodeTombstones(const char* data, size_t size, uint32_t num_entries,
+                      std::vector<std::string>& out);
+
+/**
+ * Decompress (if needed) and decode one entry chunk's payload.
+ * @param scratch Reused buffer for the decompressed payload
+ */
+bool DecodeChunk(const ChunkInfo& info, const char* payload, std::string& scratch,
+                 std::vector<std::pair<std::string, CacheEntry>>& out);
+
+/**
+ * Decompress (if needed) and decode one tombstone chunk's payload.
+ */
+bool DecodeTombstoneChunk(const ChunkInfo& info, const char* payload, std::string& scratch,
+                          std::vector<std::string>& out);
+
+/**
+ * Compress a raw payload with codec, keeping it uncompressed when that
+ * does not make it smaller. Fills in info's sizes and codec.
+ */
+void CompressChunk(compression::Codec codec, std::string& payload, ChunkInfo& info);
+
+void EncodeChunkHeader(const ChunkInfo& info, std::string& out);
+bool DecodeChunkHeader(const char* data, size_t size, ChunkInfo& info);
+
+/**
+ * CRC32C of a chunk's header followed by its stored payload.
+ */
+uint32_t ChunkChecksum(const ChunkInfo& info, const char* payload);
+
+/**
+ * Check a chunk in place against its index entry's checksum.
+ * @param chunk Start of the chunk header; stored_size payload bytes follow
+ */
+bool VerifyChunk(const ChunkInfo& info, const char* chunk);
+
+/**
+ * Append the index and footer that close a snapshot file. With
+ * footer.checksummed, index entries carry each chunk's checksum and
+ * footer.digest is set from header_crc (the CRC32C of the header lines).
+ */
+void EncodeIndex(const std::vector<ChunkInfo>& chunks, Footer& footer, uint32_t header_crc,
+                 std::string& out);
+
+/**
+ * Parse the index and footer of a snapshot held in memory, checking the
+ * digest of checksummed files.
+ * @return False if the file is not a complete V3+ snapshot
+ */
+bool DecodeIndex(const char* data, size_t size, Footer& footer, std::vector<ChunkInfo>& chunks);
+
+/**
+ * Read just the footer (and optionally the index) from a file. The
+ * header lines are not read, so the digest is not checked.
+ */
+bool ReadIndex(const std::filesystem::path& path, Footer& footer,
+               std::vector<ChunkInfo>* chunks = nullptr);
+
+} // namespace snapshot_format
+} // namespace distcache
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "distcache/storage_engine.h"
+#include "distcache/io_scheduler.h"
 #include "distcache/metrics.h"
 #include <failover.grpc.pb.h>
 #include <atomic>
@@ -20,12 +21,36 @@ namespace distcache {
  *
  * Features:
  * - Periodic full snapshots to disk
+ * - Streamed shard by shard: worker threads encode and compress each
+ *   shard into chunks while the caller writes them sequentially, with an
+ *   index footer locating every chunk (see snapshot_format.h)
  * - Atomic snapshot creation (no partial writes)
  * - Snapshot metadata tracking
- * - Restore from snapshot on startup
+ * - Restore from snapshot on startup: chunked snapshots are mapped and
+ *   their chunks decoded and inserted in parallel into presized shards
+ * - Lazy restore: only the chunk index is read up front and the table
+ *   starts serving at once; a shard's chunks are decoded when a request
+ *   first needs it, while a background thread loads the rest
  * - Incremental catchup after restore
- * - Snapshot retention policy
+ * - Delta snapshots between full ones: only entries modified since the
+ *   previous snapshot, plus tombstones for deleted keys. A delta names
+ *   the snapshot it applies on top of; restoring it restores the chain
+ *   from its base. Once a chain grows past max_delta_chain, it is folded
+ *   shard by shard into a new base without touching the live table
+ * - Checksummed chunks: each chunk's CRC32C is computed while it is
+ *   compressed and stored in the index, with a digest of the header and
+ *   index in the footer. Restore verifies chunks as it decodes them and
+ *   skips (and reports) corrupt ones instead of failing as a whole
+ * - Snapshot shipping: a snapshot chain is streamed chunk by chunk to
+ *   bootstrap another node, optionally filtered down to the keys it owns
+ * - Snapshot retention policy (deltas live and die with their base)
+ * - I/O throttling: with an IoScheduler attached, chunk writes, restore
+ *   and shipping reads are paced by the node's background I/O budget
  * - Thread-safe operations
+ *
+ * With a sequence source attached (normally the WAL's last sequence),
+ * each snapshot records the log position it covers: every record up to
+ * wal_sequence is reflected in it, so recovery only replays newer ones.
  */
 class SnapshotManager {
 public:
@@ -34,8 +59,17 @@ public:
         std::filesystem::path snapshot_dir = "./snapshots";
         uint32_t snapshot_interval_seconds = 3600;  // 1 hour
         size_t max_snapshots_retained = 5;
-        bool enable_compression = true;
+        bool enable_compression = true;  // Fastest available codec per chunk
         size_t chunk_size = 1000;  // Keys per chunk
+        size_t chunk_max_bytes = 4 * 1024 * 1024;  // Close a chunk early past 4MB
+        size_t snapshot_threads = 0;  // Encode/compress workers; 0 = one per core
+        size_t restore_threads = 0;   // Decode/insert workers; 0 = one per core
+        bool use_io_uring = false;  // Chunked io_uring writes/reads, POSIX fallback
+        bool enable_checksums = true;  // Per-chunk CRC32C plus a file digest
+
+        // Delta snapshots between full ones; 0 = full snapshots only
+        uint32_t delta_interval_seconds = 0;
+        size_t max_delta_chain = 8;  // Fold the chain into a new base past this
     };
 
     struct SnapshotMetadata {
@@ -44,15 +78,34 @@ public:
         size_t num_keys = 0;
         size_t total_bytes = 0;
         std::string node_id;
-        std::string checksum;
+        std::string checksum;  // File digest in hex; empty if not checksummed
         std::filesystem::path file_path;
+        int64_t wal_sequence = 0;  // Last WAL record included (0 if untracked)
+        int64_t covered_ms = 0;    // Scan start; later changes may be missing
+        std::string base_id;       // Delta: the snapshot it applies on top of
+
+        bool is_delta() const { return !base_id.empty(); }
 
         SnapshotMetadata() = default;
         SnapshotMetadata(const SnapshotMetadata& other);
         SnapshotMetadata& operator=(const SnapshotMetadata& other);
     };
 
+    /**
+     * A chunk as shipped to another node, in the snapshot file format:
+     * chunk header followed by its (possibly compressed) payload.
+     */
+    struct ShippedChunk {
+        size_t file_index = 0;  // Position in the chain; files apply in order
+        std::string data;
+        uint32_t checksum = 0;  // CRC32C of data
+        size_t num_entries = 0;
+    };
+
     using SnapshotCallback = std::function<void(const SnapshotMetadata&)>;
+    using SequenceSource = std::function<int64_t()>;
+    using KeyFilter = std::function<bool(const std::string& key)>;
+    using ChunkSink = std::function<bool(ShippedChunk&)>;  // May take the data
 
     explicit SnapshotManager(const Config& config,
                              std::shared_ptr<ShardedHashTable> storage,
@@ -66,11 +119,75 @@ public:
     // Create a snapshot immediately
     std::string CreateSnapshot();
 
+    /**
+     * Create a delta on top of the latest snapshot, holding the entries
+     * modified and the keys deleted since that snapshot's scan began.
+     * Falls back to a full snapshot when there is nothing to build on.
+     * @return The new snapshot's ID, or "" on failure
+     */
+    std::string CreateDeltaSnapshot();
+
+    /**
+     * Fold the delta chain ending at the latest snapshot into a new full
+     * snapshot, reading only the chain's files. The old chain stays until
+     * retention removes its base.
+     * @return The new base's ID, or "" if there was no chain or it failed
+     */
+    std::string MergeDeltaChain();
+
     // Restore from the latest snapshot
     bool RestoreFromLatest();
 
-    // Restore from a specific snapshot
-    bool RestoreFromSnapshot(const std::string& snapshot_id);
+    /**
+     * Restore from a specific snapshot (and the chain it builds on).
+     * Chunks that fail their checksum or do not decode are skipped and
+     * counted in last_restore_corrupt_chunks; a file whose index or
+     * digest is damaged fails the restore.
+     * @param verify_checksums Check chunk checksums while decoding
+     */
+    bool RestoreFromSnapshot(const std::string& snapshot_id, bool verify_checksums = true);
+
+    /**
+     * Restore a snapshot (and its chain) lazily: map the files, read
+     * their chunk indexes and return, leaving every storage shard
+     * pending (see ShardedHashTable::begin_lazy_load). A shard's chunks
+     * are decoded across the chain when an operation first needs it; a
+     * background thread loads the others, shards with keys written in
+     * the chain's deltas (the most recently written) first, then the
+     * largest. Corrupt chunks are skipped as in RestoreFromSnapshot.
+     * @return False if the snapshot is missing, any file in the chain is
+     *         not chunked, or it was taken with a different shard count
+     *         (use RestoreFromSnapshot instead), or a lazy restore is
+     *         already under way
+     */
+    bool BeginLazyRestore(const std::string& snapshot_id, bool verify_checksums = true);
+
+    /**
+     * Wait until the background loader of a lazy restore has finished
+     * (immediately if none is running).
+     */
+    void WaitForLazyRestore();
+
+    /**
+     * Ship a snapshot and the chain it builds on, chunk by chunk. Every
+     * chunk is verified first. Without a filter chunks are copied from
+     * the files as they are; with one, worker threads decode, filter and
+     * re-encode them. The sink is called from those workers, one call at
+     * a time, and all of a file's chunks precede the next file's.
+     * @return False if the snapshot is missing or unreadable, a chunk is
+     *         corrupt, or the sink returned false
+     */
+    bool ShipSnapshot(const std::string& snapshot_id, const KeyFilter& filter,
+                      const ChunkSink& sink);
+
+    /**
+     * Apply a shipped chunk to a table: set its entries or delete its
+     * tombstoned keys.
+     * @param applied Number of keys set or deleted
+     * @return False if the chunk fails its checksum or does not decode
+     */
+    static bool ApplyShippedChunk(ShardedHashTable& storage, const std::string& data,
+                                  uint32_t checksum, size_t& applied);
 
     // List all available snapshots
     std::vector<SnapshotMetadata> ListSnapshots() const;
@@ -78,12 +195,33 @@ public:
     // Get snapshot metadata
     std::optional<SnapshotMetadata> GetSnapshotMetadata(const std::string& snapshot_id) const;
 
+    /**
+     * Snapshot files found on startup that could not be read (ID, time and
+     * path only). Recovery counts them as failed restores, so it never
+     * takes an older snapshot for the latest one.
+     */
+    std::vector<SnapshotMetadata> ListUnreadableSnapshots() const;
+
     // Delete old snapshots based on retention policy
     void PruneOldSnapshots();
 
     // Set callback for snapshot events
     void SetSnapshotCallback(SnapshotCallback callback);
 
+    /**
+     * Set where snapshots read their WAL watermark from. It is sampled
+     * before the table is scanned, so every record up to the returned
+     * sequence has already been applied to the table.
+     */
+    void SetSequenceSource(SequenceSource source);
+
+    /**
+     * Charge snapshot writes, restores and shipping to a shared
+     * background I/O budget (nullptr to run unthrottled). Operations
+     * already running keep the scheduler they started with.
+     */
+    void SetIoScheduler(std::shared_ptr<IoScheduler> scheduler);
+
     // Statistics
     struct Stats {
         uint64_t total_snapshots_created = 0;
@@ -93,6 +231,19 @@ public:
         int64_t last_snapshot_timestamp = 0;
         int64_t last_snapshot_duration_ms = 0;
         size_t last_snapshot_size_bytes = 0;
+        int64_t last_restore_duration_ms = 0;
+        size_t last_restore_keys = 0;
+        size_t last_restore_corrupt_chunks = 0;  // Skipped by the last restore
+        uint64_t total_corrupt_chunks = 0;
+        uint64_t total_deltas_created = 0;
+        uint64_t total_merges = 0;
+        uint64_t io_throttled_ms = 0;  // Waiting on the I/O scheduler
+
+        // Last lazy restore
+        size_t lazy_shards_pending = 0;
+        uint64_t lazy_shards_faulted = 0;     // Loaded for a waiting request
+        uint64_t lazy_shards_background = 0;  // Loaded ahead of demand
+        int64_t lazy_restore_ms = 0;          // Until fully loaded; 0 while loading
     };
     Stats GetStats() const;
 
@@ -100,19 +251,87 @@ private:
     // Worker thread for periodic snapshots
     void SnapshotWorker();
 
-    // Create snapshot file and write data
-    bool WriteSnapshotToFile(const std::string& snapshot_id,
-                             const std::vector<std::pair<std::string, CacheEntry>>& entries);
+    // Index snapshot files already in snapshot_dir
+    void LoadExistingSnapshots();
+
+    // Header fields of a snapshot file (V1-V3 leave the delta fields empty)
+    struct SnapshotHeader {
+        int version = 0;
+        std::string snapshot_id;
+        int64_t wal_sequence = 0;
+        size_t num_keys = 0;       // V1/V2 only; V3+ keep it in the footer
+        int64_t covered_ms = 0;
+        std::string base_id;
+        int64_t since_ms = 0;
+    };
+
+    // Totals of a written snapshot
+    struct WriteResult {
+        size_t num_keys = 0;
+        size_t num_tombstones = 0;
+        size_t num_chunks = 0;
+        size_t raw_bytes = 0;  // Encoded entries before compression
+        std::string checksum;
+    };
+
+    // Receives one shard's entries and tombstones while it is encoded
+    using EntrySink = std::function<void(const std::string&, const CacheEntry&)>;
+    using TombstoneSink = std::function<void(const std::string&, int64_t)>;
+    using ShardSource = std::function<bool(size_t shard, const EntrySink&, const TombstoneSink&)>;
+
+    // Write a full snapshot or a delta of the live table
+    std::string CreateSnapshotFrom(const SnapshotMetadata* parent);
+
+    // Stream shards from source into a snapshot file, encoding and
+    // compressing them on worker threads
+    bool WriteSnapshotToFile(const SnapshotHeader& header, size_t shard_count,
+                             const ShardSource& source, WriteResult& result);
+
+    // Record a written snapshot, filling in its file size
+    void AddSnapshot(SnapshotMetadata& metadata);
+
+    // The snapshot with the newest timestamp, if any
+    std::optional<SnapshotMetadata> LatestSnapshot() const;
+
+    // The chain from a full snapshot up to snapshot_id, oldest first;
+    // empty if a link is missing
+    std::vector<SnapshotMetadata> ResolveChain(const std::string& snapshot_id) const;
+
+    // Map a chunked (V3+) snapshot and load its chunks into storage in
+    // parallel, verifying each chunk on the worker that decodes it;
+    // restored is the number of keys inserted and corrupt the number of
+    // chunks skipped. Fails only if the index itself is unusable
+    bool RestoreChunkedSnapshot(const std::filesystem::path& file_path, bool verify,
+                                size_t& restored, size_t& corrupt);
+
+    // Mapped chain and progress of a lazy restore; shared with the
+    // table's shard loader, which may outlive this manager
+    struct LazyRestore;
+
+    // Load the shards of a lazy restore that requests have not faulted
+    // in yet, in priority order
+    void LazyRestoreWorker(std::shared_ptr<LazyRestore> restore, std::vector<size_t> order);
+
+    // Stop and join the background loader of a lazy restore
+    void StopLazyRestore();
 
     // Read snapshot from file
     bool ReadSnapshotFromFile(const std::filesystem::path& file_path,
                               std::vector<std::pair<std::string, CacheEntry>>& entries);
 
-    // Generate snapshot ID
-    std::string GenerateSnapshotId();
+    // Parse the header lines; V1 files have no WAL sequence, and V3+
+    // files keep their key count in the footer (num_keys is left 0)
+    static bool ReadSnapshotHeader(std::istream& in, SnapshotHeader& header);
+    static bool ReadSnapshotHeader(const std::filesystem::path& path, SnapshotHeader& header);
+
+    // The attached I/O scheduler, if any
+    std::shared_ptr<IoScheduler> IoBudget();
 
-    // Calculate checksum
-    std::string CalculateChecksum(const std::vector<std::pair<std::string, CacheEntry>>& entries);
+    // Wait for the I/O budget to cover bytes of background I/O
+    void ThrottleIo(IoScheduler* scheduler, size_t bytes);
+
+    // Generate snapshot ID ("snapshot-..." or "delta-...")
+    std::string GenerateSnapshotId(const char* prefix = "snapshot");
 
     Config config_;
     std::shared_ptr<ShardedHashTable> storage_;
@@ -124,12 +343,22 @@ private:
 
     // Snapshot metadata
     std::vector<SnapshotMetadata> snapshots_;
+    std::vector<SnapshotMetadata> unreadable_snapshots_;
+    int64_t last_id_timestamp_ = 0;  // Newest timestamp used in an ID
     mutable std::mutex snapshots_mutex_;
 
-    // Callback
+    // Callback, watermark source and I/O scheduler, guarded by callback_mutex_
     SnapshotCallback callback_;
+    SequenceSource sequence_source_;
+    std::shared_ptr<IoScheduler> io_scheduler_;
     std::mutex callback_mutex_;
 
+    // Lazy restore, guarded by lazy_mutex_
+    std::shared_ptr<LazyRestore> lazy_restore_;
+    std::thread lazy_thread_;
+    std::atomic<bool> lazy_stop_{false};
+    mutable std::mutex lazy_mutex_;
+
     // Stats
     std::atomic<uint64_t> total_snapshots_created_{0};
     std::atomic<uint64_t> total_snapshots_failed_{0};
@@ -138,6 +367,13 @@ private:
     std::atomic<int64_t> last_snapshot_timestamp_{0};
     std::atomic<int64_t> last_snapshot_duration_ms_{0};
     std::atomic<size_t> last_snapshot_size_bytes_{0};
+    std::atomic<int64_t> last_restore_duration_ms_{0};
+    std::atomic<size_t> last_restore_keys_{0};
+    std::atomic<size_t> last_restore_corrupt_chunks_{0};
+    std::atomic<uint64_t> total_corrupt_chunks_{0};
+    std::atomic<uint64_t> total_deltas_created_{0};
+    std::atomic<uint64_t> total_merges_{0};
+    std::atomic<uint64_t> io_throttled_us_{0};
 };
 
 } // namespace distcache
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace distcache {
+
+/**
+ * Read-only datasets: large static key/value sets built offline (see the
+ * dataset_builder tool) into one immutable file, and served straight out
+ * of a read-only mapping of it.
+ *
+ * Keys are indexed by a minimal perfect hash (BBHash): a cascade of bit
+ * arrays, each key placed at the first level where its position does not
+ * collide with another key's, its slot being the rank of that bit. That
+ * costs about 3.7 bits per key plus an 8-byte record offset, against a
+ * heap-allocated entry per key in ShardedHashTable. Opening a file maps
+ * it and checks the header, so it is near-instant whatever the size, and
+ * pages are read in as lookups touch them. Any key outside the set also
+ * hashes to some slot, so lookups compare the stored key.
+ *
+ * File layout (integers little-endian, fixed width):
+ *   header   magic, format version, level count, key count, hash seed,
+ *            bit array words, data bytes, build time, CRC32C of the body,
+ *            CRC32C of the header
+ *   levels   u64 words per level
+ *   bits     the levels' bit arrays, back to back
+ *   ranks    u64 count of set bits before every 8th word
+ *   slots    u64 data offset of each slot's record
+ *   data     records: u32 key length, u32 value length, key, value
+ */
+namespace static_dataset {
+
+constexpr uint32_t kFormatVersion = 1;
+constexpr size_t kHeaderSize = 64;
+
+} // namespace static_dataset
+
+/**
+ * Builds a dataset file. Records are buffered in memory, encoded as they
+ * will be written, until Write.
+ */
+class StaticDatasetBuilder {
+public:
+    /**
+     * Add a record. Keys must be unique; duplicates fail Write.
+     */
+    void Add(std::string_view key, std::string_view value);
+
+    size_t size() const { return offsets_.size(); }
+
+    /**
+     * Build the index and write the file, under a temporary name renamed
+     * over path, so a server watching path sees either version, never a
+     * partial file.
+     * @return False if a key was added twice or the file cannot be written
+     */
+    bool Write(const std::filesystem::path& path);
+
+private:
+    std::string data_;              // Records, encoded
+    std::vector<uint64_t> offsets_;  // Of each record in data_
+};
+
+/**
+ * An open dataset file. Immutable; values returned by find stay valid
+ * as long as the StaticDataset does.
+ */
+class StaticDataset {
+public:
+    /**
+     * Map a dataset file.
+     * @param verify Also check the body checksum, which reads the whole file
+     * @return Null if the file is missing, truncated or not a dataset
+     */
+    static std::shared_ptr<const StaticDataset> Open(const std::filesystem::path& path,
+                                                     bool verify = false);
+
+    ~StaticDataset();
+
+    StaticDataset(const StaticDataset&) = delete;
+    StaticDataset& operator=(const StaticDataset&) = delete;
+
+    std::optional<std::string_view> find(std::string_view key) const;
+
+    size_t size() const { return num_keys_; }
+    int64_t built_at_ms() const { return built_at_ms_; }
+    const std::filesystem::path& path() const { return path_; }
+
+    // Bytes of the file taken by the hash index and slot table
+    size_t index_bytes() const { return index_bytes_; }
+    size_t file_bytes() const { return size_; }
+
+private:
+    StaticDataset() = default;
+
+    // Slot of a key's fingerprint, or num_keys_ if no level has it
+    uint64_t Slot(uint64_t fingerprint) const;
+
+    std::filesystem::path path_;
+    const char* data_ = nullptr;  // The mapping
+    size_t size_ = 0;
+
+    uint64_t num_keys_ = 0;
+    uint32_t seed_ = 0;
+    int64_t built_at_ms_ = 0;
+    std::vector<uint64_t> level_words_;
+    const char* bits_ = nullptr;
+    const char* ranks_ = nullptr;
+    const char* slots_ = nullptr;
+    const char* records_ = nullptr;
+    uint64_t records_size_ = 0;
+    size_t index_bytes_ = 0;
+};
+
+/**
+ * Datasets mounted as read-only key namespaces: a dataset mounted as
+ * "geo" serves key "geo:<key>" for each <key> in its file. Such keys
+ * are looked up only in the dataset; writes to them are refused.
+ *
+ * A new version of a file is swapped in atomically: readers holding the
+ * old one keep it mapped until they are done. With a check interval,
+ * a background thread remounts files that were replaced on disk. Files
+ * must be replaced by renaming a new one over them (as the builder
+ * does), never rewritten in place under a live mapping.
+ */
+class StaticDatasets {
+public:
+    struct Config {
+        uint32_t check_interval_seconds = 10;  // 0 = only on Refresh()
+    };
+
+    struct Lookup {
+        // Null if the key is in no mounted namespace; keeps value mapped
+        std::shared_ptr<const StaticDataset> dataset;
+        std::optional<std::string_view> value;
+    };
+
+    struct Stats {
+        size_t datasets = 0;
+        size_t keys = 0;
+        uint64_t lookups = 0;
+        uint64_t hits = 0;
+        uint64_t swaps = 0;          // Versions swapped in after the first
+        uint64_t swap_failures = 0;  // Replaced files that could not be opened
+    };
+
+    StaticDatasets();
+    explicit StaticDatasets(const Config& config);
+    ~StaticDatasets();
+
+    StaticDatasets(const StaticDatasets&) = delete;
+    StaticDatasets& operator=(const StaticDatasets&) = delete;
+
+    /**
+     * Mount the file at path as namespace name, replacing any dataset
+     * mounted there.
+     * @return False if the name is invalid or the file cannot be opened
+     */
+    bool Mount(const std::string& name, const std::filesystem::path& path);
+    bool Unmount(const std::string& name);
+
+    /**
+     * Look a key up in the dataset its namespace names, if mounted.
+     */
+    Lookup lookup(std::string_view key) const;
+
+    /**
+     * Check whether a key belongs to a mounted (read-only) namespace.
+     */
+    bool is_read_only(std::string_view key) const;
+
+    std::shared_ptr<const StaticDataset> dataset(std::string_view name) const;
+
+    /**
+     * Remount every dataset whose file was replaced since it was opened.
+     * @return Number of datasets swapped
+     */
+    size_t Refresh();
+
+    void Start();
+    void Stop();
+
+    Stats GetStats() const;
+
+private:
+    // Identity of a file version: a rename over the path changes it
+    struct FileVersion {
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+        bool operator==(const FileVersion& other) const;
+    };
+
+    struct MountPoint {
+        std::filesystem::path path;
+        std::shared_ptr<const StaticDataset> dataset;
+        FileVersion version;
+        FileVersion failed;  // Last version that failed to open, not retried
+    };
+
+    static std::optional<FileVersion> Stat(const std::filesystem::path& path);
+
+    // Dataset mounted under a key's namespace, and the key within it
+    std::shared_ptr<const StaticDataset> Resolve(std::string_view key,
+                                                 std::string_view& local_key) const;
+
+    void RefreshWorker();
+
+    Config config_;
+    mutable std::shared_mutex mutex_;
+    std::map<std::string, MountPoint, std::less<>> mounts_;
+    std::atomic<size_t> mounted_{0};  // Lock-free check for the common case
+
+    mutable std::atomic<uint64_t> lookups_{0};
+    mutable std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> swaps_{0};
+    std::atomic<uint64_t> swap_failures_{0};
+
+    std::thread worker_thread_;
+    std::atomic<bool> running_{false};
+};
+
+} // namespace distcache
@@ -2,16 +2,69 @@
 
 #include "cache_entry.h"
 #include "metrics.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <shared_mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace distcache {
 
+/**
+ * MutationListener receives every mutation a ShardedHashTable applies,
+ * while the shard lock is still held, so notifications for a key arrive
+ * in the same order the writes were applied. Evictions and expirations
+ * are not reported.
+ *
+ * Callbacks run on the writing thread inside the lock: they must be
+ * quick and must not call back into the table.
+ */
+class MutationListener {
+public:
+    virtual ~MutationListener() = default;
+
+    /**
+     * A key was stored (set, CAS, increment or TTL change).
+     * @param entry The entry as stored, including its final version
+     */
+    virtual void on_set(const std::string& key, const CacheEntry& entry) = 0;
+
+    /**
+     * A key was removed by a delete.
+     */
+    virtual void on_delete(const std::string& key) = 0;
+};
+
+/**
+ * Marks the mutations the current thread makes while in scope as applied
+ * from another node's replication stream. Listeners still see them (the
+ * WAL logs them like any write) but can tell them apart from local
+ * writes, so replication does not ship them back.
+ */
+class ReplicatedApplyScope {
+public:
+    ReplicatedApplyScope() : previous_(active_) { active_ = true; }
+    ~ReplicatedApplyScope() { active_ = previous_; }
+
+    ReplicatedApplyScope(const ReplicatedApplyScope&) = delete;
+    ReplicatedApplyScope& operator=(const ReplicatedApplyScope&) = delete;
+
+    /**
+     * True if the calling thread's mutations come from another node.
+     */
+    static bool active() { return active_; }
+
+private:
+    static inline thread_local bool active_ = false;
+    bool previous_;
+};
+
 /**
  * ShardedHashTable implements a thread-safe sharded hash table
  * for storing cache entries with per-bucket locking.
@@ -39,6 +92,38 @@ public:
      */
     std::optional<CacheEntry> get(const std::string& key);
 
+    /**
+     * Look up a key and pass the stored entry to fn without copying it.
+     * fn runs under the shard lock, so it must not call back into the
+     * table; copy out whatever is needed (e.g. into a response message).
+     * @param key The key to look up
+     * @param fn Callable taking const CacheEntry&
+     * @return True if the key was found and not expired
+     */
+    template<typename Fn>
+    bool get_with(const std::string& key, Fn&& fn) {
+        auto& shard = get_shard(key);
+
+        // First check with read lock
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            auto it = shard.data.find(key);
+            if (it == shard.data.end() || it->second.entry.is_expired()) {
+                metrics_.cache_misses.fetch_add(1);
+                return false;
+            }
+        }
+
+        // Upgrade to write lock to update LRU position
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        const CacheEntry* entry = lookup_locked(shard, key);
+        if (!entry) {
+            return false;
+        }
+        fn(*entry);
+        return true;
+    }
+
     /**
      * Set a key-value pair.
      * @param key The key
@@ -54,6 +139,31 @@ public:
      */
     bool del(const std::string& key);
 
+    /**
+     * Delete a key without reporting whether it existed. Unlike del, it
+     * does not wait for a lazily loading shard (see begin_lazy_load), so
+     * it suits blind deletes such as WAL replay.
+     * @param key The key to delete
+     */
+    void discard(const std::string& key);
+
+    /**
+     * Get multiple keys in one pass.
+     * Keys are grouped by shard so each shard lock is taken once per call.
+     * @param keys The keys to look up
+     * @return One optional entry per key, in request order
+     */
+    std::vector<std::optional<CacheEntry>> multi_get(const std::vector<std::string>& keys);
+
+    /**
+     * Set multiple entries in one pass (each entry's key is used).
+     * Entries are grouped by shard so each shard lock is taken once per call.
+     * If a key appears more than once, the last occurrence wins.
+     * @param entries The entries to store
+     * @return One success flag per entry, in request order
+     */
+    std::vector<bool> multi_set(std::vector<CacheEntry> entries);
+
     /**
      * Result of a compare-and-swap operation.
      */
@@ -78,6 +188,65 @@ public:
                               int64_t expected_version,
                               CacheEntry new_entry);
 
+    /**
+     * Result of an atomic increment.
+     */
+    struct IncrResult {
+        bool success;       // False if the value is not an integer or would overflow
+        int64_t value;      // Value after the increment (if success)
+        std::string error;  // Error message if failed
+    };
+
+    /**
+     * Atomically add delta to an integer stored as decimal text.
+     * A missing or expired key is treated as 0. An existing TTL is kept.
+     *
+     * @param key The key to increment
+     * @param delta Amount to add (may be negative)
+     * @return IncrResult with the new value or an error
+     */
+    IncrResult incr_by(const std::string& key, int64_t delta);
+
+    /**
+     * Set a new TTL on an existing key.
+     * A non-positive TTL deletes the key immediately.
+     *
+     * @param key The key
+     * @param ttl_seconds New time-to-live in seconds
+     * @return True if the key existed and was updated
+     */
+    bool expire(const std::string& key, int32_t ttl_seconds);
+
+    /**
+     * A single operation in a mixed batch (see execute_batch).
+     */
+    struct BatchOp {
+        enum class Type { GET, SET, DELETE, CAS };
+
+        Type type = Type::GET;
+        std::string key;
+        CacheEntry entry;               // Value to store for SET/CAS
+        int64_t expected_version = 0;   // Expected version for CAS
+
+        // Filled in by execute_batch
+        bool success = false;               // SET stored / DELETE found / CAS applied
+        std::optional<CacheEntry> found;    // GET result
+        CASResult cas{false, 0, 0, ""};     // CAS result
+    };
+
+    /**
+     * Execute a mixed batch of get/set/delete/CAS operations.
+     * Operations are grouped by shard so each shard lock is taken once per
+     * call. Operations on the same key run in batch order; across shards,
+     * operations complete in shard order rather than batch order.
+     *
+     * @param ops The operations; results are written back into each op
+     * @param on_complete Optional callback invoked with an op's index as
+     *        soon as its shard lock has been released
+     */
+    void execute_batch(std::vector<BatchOp>& ops,
+                       const std::function<void(size_t)>& on_complete = nullptr);
+
     /**
      * Check if a key exists.
      * @param key The key to check
@@ -105,13 +274,36 @@ public:
      */
     const Metrics& metrics() const { return metrics_; }
 
+    /**
+     * Get metrics for recording (e.g. per-request allocation counts)
+     */
+    Metrics& metrics() { return metrics_; }
+
+    /**
+     * Attach a listener notified of every applied mutation (e.g. the WAL).
+     * Not synchronized with writers: attach before the table is shared
+     * and detach only after writers have stopped.
+     * @param listener Listener to notify, or nullptr to detach
+     */
+    void set_mutation_listener(MutationListener* listener) { listener_ = listener; }
+
+    /**
+     * Get the shard index for a given key. Work partitioned by shard
+     * (e.g. parallel WAL replay) keeps each key on one thread.
+     */
+    size_t get_shard_index(const std::string& key) const;
+
+    size_t shard_count() const { return shards_.size(); }
+
     /**
      * Iterate over all entries (for rebalancing, snapshots).
      * Note: This acquires read locks on all shards.
      */
     template<typename Fn>
     void for_each(Fn&& fn) {
-        for (auto& shard : shards_) {
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            fault_in(i);
+            auto& shard = shards_[i];
             std::shared_lock<std::shared_mutex> lock(shard.mutex);
             for (const auto& [key, cache_data] : shard.data) {
                 if (!cache_data.entry.is_expired()) {
@@ -121,6 +313,127 @@ public:
         }
     }
 
+    /**
+     * Iterate over the entries of one shard under its read lock, so
+     * shards can be scanned independently (e.g. by parallel snapshot
+     * workers). fn must not call back into the table.
+     * @param shard_index Shard in [0, shard_count())
+     */
+    template<typename Fn>
+    void for_each_in_shard(size_t shard_index, Fn&& fn) {
+        fault_in(shard_index);
+        auto& shard = shards_[shard_index];
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (const auto& [key, cache_data] : shard.data) {
+            if (!cache_data.entry.is_expired()) {
+                fn(key, cache_data.entry);
+            }
+        }
+    }
+
+    /**
+     * Iterate over one shard's changes since a point in time: entries
+     * modified at or after since_ms, and keys deleted at or after it
+     * (see set_tombstone_tracking). Both run under the shard's read
+     * lock, so a key is reported either as an entry or as a tombstone,
+     * never both. Used for delta snapshots.
+     * @param on_entry Callable taking (const std::string&, const CacheEntry&)
+     * @param on_tombstone Callable taking (const std::string&, int64_t deleted_at_ms)
+     */
+    template<typename EntryFn, typename TombstoneFn>
+    void for_each_changed_in_shard(size_t shard_index, int64_t since_ms,
+                                   EntryFn&& on_entry, TombstoneFn&& on_tombstone) {
+        fault_in(shard_index);
+        auto& shard = shards_[shard_index];
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (const auto& [key, cache_data] : shard.data) {
+            if (cache_data.entry.modified_at_ms >= since_ms && !cache_data.entry.is_expired()) {
+                on_entry(key, cache_data.entry);
+            }
+        }
+        for (const auto& [key, deleted_at] : shard.tombstones) {
+            if (deleted_at >= since_ms) {
+                on_tombstone(key, deleted_at);
+            }
+        }
+    }
+
+    /**
+     * Remember deleted keys (until dropped) so delta snapshots can carry
+     * tombstones for them; a later set of the key forgets it again.
+     * Not synchronized with writers: enable before the table is shared.
+     */
+    void set_tombstone_tracking(bool enabled) { track_tombstones_ = enabled; }
+
+    /**
+     * Forget tombstones for deletes before a point in time, once every
+     * delta that could need them has been written.
+     */
+    void drop_tombstones_before(int64_t before_ms);
+
+    /**
+     * Get the number of tombstones currently tracked.
+     */
+    size_t tombstone_count() const;
+
+    /**
+     * Presize the shards for a bulk load (e.g. a snapshot restore), so
+     * inserting the expected entries does not rehash as the maps grow.
+     * @param expected_entries Total entries the table is expected to hold
+     */
+    void reserve(size_t expected_entries);
+
+    /**
+     * Produces one shard's entries for a lazy load (see begin_lazy_load).
+     * Called without any table lock held, possibly from several threads
+     * at once for different shards; it must not call back into the table.
+     * on_demand is true when an operation is waiting for the shard.
+     */
+    using ShardLoader = std::function<std::vector<CacheEntry>(size_t shard_index, bool on_demand)>;
+
+    /**
+     * Start serving before the table's contents are loaded (e.g. a lazy
+     * snapshot restore). Every shard is marked pending; the first
+     * operation that needs a pending shard's existing contents calls
+     * loader for it and waits, while concurrent operations on the same
+     * shard wait for that load. Blind writes (set, multi_set, discard)
+     * do not wait: they apply at once and the keys they touch are
+     * skipped when the shard's entries arrive, so they supersede the
+     * loaded data. Loaded entries are not reported to the mutation
+     * listener. Not synchronized with other operations: call before
+     * the table is shared.
+     */
+    void begin_lazy_load(ShardLoader loader);
+
+    /**
+     * Load a pending shard now (e.g. from a background loader), or wait
+     * for a load already in progress.
+     * @return True if this call loaded the shard
+     */
+    bool load_shard(size_t shard_index);
+
+    /**
+     * Get the number of shards still waiting to be lazily loaded.
+     */
+    size_t shards_pending_load() const { return lazy_pending_.load(); }
+
+    /**
+     * Reject every further mutation (e.g. while the table is handed to
+     * another process) and wait for writes already under a shard lock to
+     * finish, so once this returns the table and its listener have seen
+     * their last write. Rejected writes fail: set, del and expire return
+     * false, CAS and increments report an error. Lazily loaded entries
+     * still arrive.
+     */
+    void freeze_writes();
+
+    /**
+     * Accept mutations again after freeze_writes.
+     */
+    void thaw_writes() { writes_frozen_.store(false); }
+
+    bool writes_frozen() const { return writes_frozen_.load(std::memory_order_relaxed); }
+
     /**
      * Clear all entries (primarily for testing).
      */
@@ -142,23 +455,106 @@ private:
         std::unordered_map<std::string, CacheData> data;
         LRUList lru_list;  // Most recently used at front, least at back
         size_t memory_bytes = 0;
+        std::unordered_map<std::string, int64_t> tombstones;  // Key -> delete time
+
+        // Lazy load state (see begin_lazy_load); changes under mutex
+        std::atomic<uint8_t> load_state{kShardLoaded};
+        std::unordered_set<std::string> superseded;  // Written while pending
     };
 
+    static constexpr uint8_t kShardLoaded = 0;
+    static constexpr uint8_t kShardPending = 1;
+    static constexpr uint8_t kShardLoading = 2;
+
     std::vector<Shard> shards_;
     size_t max_memory_bytes_;
     mutable std::atomic<size_t> total_memory_bytes_{0};
     mutable std::atomic<size_t> total_entries_{0};
     mutable Metrics metrics_;
+    MutationListener* listener_ = nullptr;
+    bool track_tombstones_ = false;
+    std::atomic<bool> writes_frozen_{false};  // Checked under the shard lock
+
+    // Lazy load: lazy_loading_ is the fast-path check, the rest is
+    // guarded by lazy_mutex_
+    std::atomic<bool> lazy_loading_{false};
+    std::atomic<size_t> lazy_pending_{0};
+    ShardLoader lazy_loader_;
+    std::mutex lazy_mutex_;
+    std::condition_variable lazy_cv_;
 
     /**
-     * Get the shard index for a given key.
+     * Make sure a shard's lazily loaded contents are in place before an
+     * operation reads them; a single atomic load once everything is loaded.
      */
-    size_t get_shard_index(const std::string& key) const;
+    void fault_in(size_t shard_index) {
+        if (lazy_loading_.load(std::memory_order_acquire) &&
+            shards_[shard_index].load_state.load(std::memory_order_acquire) != kShardLoaded) {
+            load_pending_shard(shard_index, true);
+        }
+    }
+
+    /**
+     * Load a shard that was pending (or wait for it to finish loading).
+     * @return True if this call loaded it
+     */
+    bool load_pending_shard(size_t shard_index, bool on_demand);
+
+    /**
+     * Order key indices by shard so batch operations can visit each
+     * shard once. Returns (shard_index, key_index) pairs sorted by shard,
+     * preserving request order within a shard.
+     */
+    std::vector<std::pair<size_t, size_t>> group_by_shard(
+        const std::vector<std::string>& keys) const;
+
+    /**
+     * Look up a key and update its LRU position.
+     * Must be called with shard write lock held.
+     */
+    std::optional<CacheEntry> get_locked(Shard& shard, const std::string& key);
+
+    /**
+     * Look up a key, update its LRU position and record hit/miss.
+     * Must be called with shard write lock held.
+     * @return Pointer to the stored entry, or nullptr if missing/expired
+     */
+    const CacheEntry* lookup_locked(Shard& shard, const std::string& key);
+
+    /**
+     * Insert or update a key. Loaded entries (see begin_lazy_load) are
+     * not reported to the listener.
+     * Must be called with shard write lock held.
+     */
+    bool set_locked(Shard& shard, const std::string& key, CacheEntry entry,
+                    bool loaded = false);
+
+    /**
+     * Remove a key.
+     * Must be called with shard write lock held.
+     */
+    bool del_locked(Shard& shard, const std::string& key);
+
+    /**
+     * Record a delete that a pending shard's loaded entries must not
+     * undo, even though the key is not in memory yet.
+     * Must be called with shard write lock held.
+     */
+    void supersede_delete_locked(Shard& shard, const std::string& key);
+
+    /**
+     * Conditionally update a key if its version matches.
+     * Must be called with shard write lock held.
+     */
+    CASResult cas_locked(Shard& shard, const std::string& key,
+                         int64_t expected_version, CacheEntry new_entry);
 
     /**
-     * Get the shard for a given key.
+     * Get the shard for a given key, loading it first if it is pending.
+     * get_write_shard leaves pending shards pending, for blind writes.
      */
     Shard& get_shard(const std::string& key);
+    Shard& get_write_shard(const std::string& key);
     const Shard& get_shard(const std::string& key) const;
 
     /**
@@ -1,19 +1,26 @@
 #pragma once
 
+#include "distcache/commit_log.h"
+#include "distcache/compression.h"
+#include "distcache/io_ring.h"
+#include "distcache/io_scheduler.h"
+#include "distcache/latency_histogram.h"
+#include "distcache/storage_engine.h"
 #include <string>
 #include <vector>
 #include <optional>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
-#include <fstream>
+#include <thread>
 #include <atomic>
+#include <functional>
+#include <map>
 
 namespace distcache {
 
-// Forward declarations
-struct CacheEntry;
-
 /**
  * WAL (Write-Ahead Log) provides durability for cache operations.
  *
@@ -23,27 +30,87 @@ struct CacheEntry;
  *
  * Features:
  * - Atomic append-only writes
+ * - Group commit: one writer thread turns concurrent appends into a
+ *   single write() and fdatasync(), then releases all their callers
+ * - Segments preallocated with fallocate and written with pwrite in
+ *   aligned blocks (optionally O_DIRECT), so commits never grow the file
+ * - Retired segments are recycled instead of deleted
+ * - Records framed with a CRC32C checksum, type and length, so a torn
+ *   final write is detected and cut off during recovery
+ * - Optional block compression: a group commit is written as one
+ *   compressed frame holding the same checksummed record frames
+ * - Optional multiple streams: independent logs with their own files,
+ *   locks and writer threads, so appends on different keys do not
+ *   contend. Sequence numbers are WAL-wide and every record of a key
+ *   goes to the same stream, so recovery can merge streams by sequence.
+ * - Optional background compaction: closed segments are rewritten into
+ *   one segment holding only the latest record per key
+ * - Optional I/O throttling: compaction and backfill reads and writes
+ *   are paced by the node's shared background I/O budget; group commits
+ *   never are
+ * - Optional commit log feed: each record also enters the node's
+ *   CommitLog, which is marked durable as group commits complete, so
+ *   replication ships the same ordered log instead of a second queue
  * - Log rotation when size limit reached
  * - Efficient binary format with protobuf
- * - fsync for durability
  * - Automatic cleanup after snapshots
+ *
+ * Attached to a ShardedHashTable as its MutationListener, the WAL records
+ * every mutation in the order the table applied it; callers then block
+ * in WaitForCommit() before acknowledging the write.
  */
-class WAL {
+class WAL : public MutationListener {
 public:
     struct Config {
         std::filesystem::path wal_dir = "./wal";
         std::string node_id = "node1";
 
-        // Rotation settings
+        // Rotation settings; each segment is preallocated to max_file_size_bytes
         size_t max_file_size_bytes = 100 * 1024 * 1024;  // 100MB
         size_t max_log_files = 10;
+        size_t max_recycled_segments = 4;  // Retired segments kept for reuse
+
+        // Streams: records route by key hash (the hash storage shards use,
+        // so a stream serves a fixed group of shards when num_streams
+        // divides the shard count). With more than one, stream i logs
+        // to wal_dir/stream-<i>.
+        size_t num_streams = 1;
+
+        // I/O settings
+        size_t io_block_size = 4096;  // Write alignment; power of two
+        bool use_direct_io = false;   // O_DIRECT, falls back to buffered if unsupported
+
+        // io_uring: each group commit is submitted as a write linked to its
+        // fdatasync, so the writer can start the next commit while up to
+        // io_uring_depth fdatasyncs are still running. Falls back to
+        // pwrite/fdatasync where io_uring is unavailable.
+        bool use_io_uring = false;
+        unsigned io_uring_depth = 4;
 
         // Durability settings
-        bool sync_on_write = true;  // fsync after each write
-        size_t sync_batch_size = 100;  // Or batch writes before sync
+        bool sync_on_write = true;  // fdatasync each group commit before releasing callers
+
+        // Group commit: the writer waits up to this long for more records
+        // to join a batch, or commits early once the batch is full
+        uint32_t group_commit_interval_us = 200;
+        size_t group_commit_max_records = 1024;
+        size_t group_commit_max_bytes = 1024 * 1024;  // 1MB
+
+        // Compression: each group commit of at least compression_min_bytes
+        // is written as one block (LZ4 if built with it, zlib otherwise),
+        // unless compressing it does not save space
+        bool enable_compression = false;
+        size_t compression_min_bytes = 512;
 
-        // Compression
-        bool enable_compression = false;  // Future: zstd compression
+        // Compaction: every compaction_interval_ms (0 disables the
+        // background thread), a directory with at least
+        // compaction_min_segments closed segments has its oldest ones, up
+        // to compaction_max_input_bytes of records, rewritten as a single
+        // segment keeping the latest record per key. DELETE records stay
+        // as tombstones until a snapshot covers them.
+        uint32_t compaction_interval_ms = 0;
+        size_t compaction_min_segments = 4;
+        size_t compaction_max_input_bytes = 256 * 1024 * 1024;  // 256MB
     };
 
     struct WALEntry {
@@ -61,42 +128,235 @@ public:
         int64_t version;
         std::optional<int32_t> ttl_seconds;
         std::optional<int64_t> expected_version;  // For CAS
+        bool replicated = false;  // Applied from another node's replication
 
         WALEntry() = default;
     };
 
     explicit WAL(const Config& config);
-    ~WAL();
+    ~WAL() override;
 
     // Lifecycle
     void Open();
     void Close();
     bool IsOpen() const { return is_open_.load(); }
 
-    // Write operations (thread-safe)
+    /**
+     * Continue sequence numbering after a recovered sequence.
+     * Must be called before Open().
+     */
+    void ResumeFromSequence(int64_t sequence);
+
+    /**
+     * Feed every record into a commit log as it is submitted and mark
+     * the log durable as group commits complete. Records the log evicts
+     * are read back from the segments. Must be called before Open().
+     */
+    void AttachCommitLog(std::shared_ptr<CommitLog> log);
+
+    /**
+     * Charge compaction and backfill I/O to a shared background I/O
+     * budget. Must be called before Open().
+     */
+    void AttachIoScheduler(std::shared_ptr<IoScheduler> scheduler);
+
+    // Write operations (thread-safe); each returns once its group commit
+    // has been written (and synced, if sync_on_write)
     bool AppendSet(const std::string& key, const CacheEntry& entry);
     bool AppendDelete(const std::string& key);
     bool AppendCAS(const std::string& key, const CacheEntry& entry, int64_t expected_version);
 
-    // Flush writes to disk
+    // MutationListener: queue the record without waiting for its commit
+    void on_set(const std::string& key, const CacheEntry& entry) override;
+    void on_delete(const std::string& key) override;
+
+    /**
+     * Block until every record up to sequence has been committed.
+     * Passing LastSubmittedSequence() after a write covers that write
+     * and nothing queued after it.
+     * @return False if the WAL failed or closed before committing them
+     */
+    bool WaitForCommit(int64_t sequence);
+
+    /**
+     * Sequence of the last record the calling thread queued (through any
+     * WAL), or 0 if it has queued none. Mutations reach the WAL through the
+     * storage listener, so this is how a writer learns its own sequence.
+     */
+    static int64_t LastSubmittedSequence();
+
+    /**
+     * Block until every record the calling thread queued to this WAL has
+     * been committed. Only the streams the thread appended to are waited
+     * on, and only as far as its own records, so a writer never waits for
+     * another stream's pending group commit.
+     * @return False if the WAL failed or closed before committing them
+     */
+    bool WaitForOwnCommits();
+
+    /**
+     * The calling thread's uncommitted records, per stream, for callers
+     * that cannot block (e.g. an event loop): take a ticket after writing,
+     * then poll it when the commit listener fires.
+     */
+    struct CommitTicket {
+        std::vector<int64_t> streams;  // Last sequence per stream, 0 = none
+    };
+
+    enum class CommitState {
+        PENDING,
+        COMMITTED,
+        FAILED  // The WAL failed or closed first
+    };
+
+    /**
+     * Take the records the calling thread has queued since its last wait
+     * or ticket, without waiting for them.
+     */
+    CommitTicket TakeOwnCommits();
+
+    /**
+     * Check a ticket without blocking.
+     */
+    CommitState PollCommit(const CommitTicket& ticket);
+
+    /**
+     * Set (or clear, with nullptr) the function called after every group
+     * commit and when a stream's writer fails or stops. It runs on WAL
+     * writer threads and must be quick and must not call into the WAL;
+     * clearing it waits for a call in progress.
+     */
+    void SetCommitListener(std::function<void()> listener);
+
+    // Commit queued records and fdatasync the current log
     bool Sync();
 
     // Log rotation
     bool RotateLog();
 
-    // Get current log file info
+    // Get current log file info (of the first stream)
     std::string GetCurrentLogId() const;
     size_t GetCurrentLogSize() const;
     int64_t GetLastSequenceNumber() const { return last_sequence_.load(); }
 
-    // List all WAL files
+    /**
+     * Lowest sequence still in the log, or 0 if it holds no records.
+     * Records before it were retired or compacted once a snapshot held them.
+     */
+    int64_t GetFirstSequenceNumber() const;
+
+    /**
+     * List all WAL files, of every stream, sorted by name. IDs are
+     * relative to wal_dir (e.g. "stream-2/wal-node1-<ts>"), so
+     * wal_dir / (id + ".wal") is always the file's path.
+     */
     std::vector<std::string> ListWALFiles() const;
 
-    // Read WAL entries for recovery
+    /**
+     * Outcome of reading one WAL file.
+     */
+    struct ReadReport {
+        size_t valid_bytes = 0;      // Offset just past the last intact record
+        size_t discarded_bytes = 0;  // Non-padding bytes after it that were dropped
+        bool corrupted = false;      // Reading stopped at a damaged record
+    };
+
+    /**
+     * Streams the entries of one WAL file from a read-only mapping,
+     * decoding a record (or compressed block) at a time so memory use
+     * does not grow with the log. Like ReadWALFile(), it stops at the
+     * end of the log or at the first torn or corrupt record.
+     */
+    class Reader {
+    public:
+        explicit Reader(const std::filesystem::path& file_path);
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        /**
+         * Map the file and parse its header.
+         * @return False if the file or its header could not be read
+         */
+        bool Open();
+
+        /**
+         * Decode the next entry, in sequence order.
+         * @return False once the log ends; report() then says where and why
+         */
+        bool Next(WALEntry& entry);
+
+        const ReadReport& report() const { return report_; }
+        const std::filesystem::path& path() const { return path_; }
+        size_t bytes_consumed() const { return offset_; }
+
+    private:
+        bool DecodeNextRecord();
+        bool Fail(const char* reason);
+
+        std::filesystem::path path_;
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        size_t offset_ = 0;  // Next record, which is also the end of valid data
+        bool framed_ = true;
+        bool done_ = false;
+        int64_t previous_sequence_ = 0;
+        std::vector<WALEntry> decoded_;  // Entries of the current record
+        size_t decoded_index_ = 0;
+        std::string block_;  // Decompression scratch
+        ReadReport report_;
+    };
+
+    /**
+     * Read WAL entries for recovery. Reading stops cleanly at the first
+     * torn or corrupt record; everything before it is returned.
+     * @param report Optional details on where and why reading stopped
+     * @return False if the file or its header could not be read
+     */
     bool ReadWALFile(const std::filesystem::path& file_path,
-                     std::vector<WALEntry>& entries);
+                     std::vector<WALEntry>& entries,
+                     ReadReport* report = nullptr);
+
+    /**
+     * Read logged entries with after < sequence <= up_to from every
+     * stream and segment, in sequence order. Segments that end before
+     * the range or start after it are skipped without being read.
+     * @param max_entries Return at most this many (the lowest sequences)
+     * @return False if the WAL directory could not be listed, or if
+     *         records after `after` were already removed from disk
+     *         (truncated, compacted into a snapshot or retired)
+     */
+    bool ReadEntriesAfter(int64_t after, int64_t up_to, size_t max_entries,
+                          std::vector<WALEntry>& entries) const;
+
+    /**
+     * Outcome of one compaction pass.
+     */
+    struct CompactionResult {
+        size_t segments_compacted = 0;  // Input segments replaced
+        size_t records_read = 0;
+        size_t records_kept = 0;
+        size_t bytes_read = 0;     // Record bytes of the inputs
+        size_t bytes_written = 0;  // Size of the compacted segments
+    };
 
-    // Clean up old WAL files (call after snapshot)
+    /**
+     * Rewrite closed segments into compacted ones holding only the
+     * latest record per key, in sequence order. The compacted segment is
+     * written to a temporary file and renamed over the newest input, then
+     * the older inputs are retired; a crash in between leaves records
+     * logged twice, which replay tolerates. Records a snapshot already
+     * covers (see TruncateBeforeSequence()) are dropped, tombstones
+     * included. Runs in the background when compaction_interval_ms is
+     * set; safe to call concurrently with writes.
+     * @param min_segments Closed segments a directory needs before it is
+     *                     compacted (0 uses the configured minimum)
+     */
+    CompactionResult CompactSegments(size_t min_segments = 0);
+
+    // Clean up old WAL files (call after snapshot); records before
+    // sequence count as covered from then on
     void TruncateBeforeSequence(int64_t sequence);
     void DeleteAllLogs();
 
@@ -105,39 +365,221 @@ public:
         uint64_t total_entries_written = 0;
         uint64_t total_syncs = 0;
         uint64_t total_rotations = 0;
+        uint64_t total_group_commits = 0;
+        uint64_t max_group_commit_records = 0;
+        uint64_t total_segments_recycled = 0;
         int64_t last_sequence_number = 0;
-        size_t current_file_size = 0;
+        size_t current_file_size = 0;  // Summed over streams
+        size_t num_streams = 0;
+        bool direct_io = false;
+        bool io_uring = false;
+        uint64_t total_compressed_blocks = 0;
+        uint64_t total_record_bytes = 0;   // Framed records before compression
+        uint64_t total_written_bytes = 0;  // Bytes logged after compression
+        double compression_ratio = 1.0;    // total_record_bytes / total_written_bytes
+        uint64_t total_compactions = 0;          // Passes that replaced segments
+        uint64_t total_segments_compacted = 0;
+        uint64_t total_records_compacted_away = 0;
+        uint64_t io_throttled_ms = 0;      // Compaction/backfill waiting on the I/O scheduler
+        LatencyHistogram::Snapshot write_latency;  // pwrite per group commit
+        LatencyHistogram::Snapshot fsync_latency;  // fdatasync
     };
     Stats GetStats() const;
 
 private:
     Config config_;
 
-    // Current log file
-    std::string current_log_id_;
-    std::unique_ptr<std::ofstream> log_file_;
-    std::atomic<size_t> current_file_size_{0};
-    std::atomic<int64_t> last_sequence_{0};
+    struct FreeDeleter {
+        void operator()(char* p) const;
+    };
+
+    // Where a queued record's key and value sit in its batch, so the
+    // commit log's record can point into the batch instead of copying
+    struct LogSpan {
+        CommitLog::Record::Op op = CommitLog::Record::Op::SET;
+        int64_t sequence = 0;
+        size_t key_offset = 0;
+        size_t key_size = 0;
+        size_t value_offset = 0;
+        size_t value_size = 0;
+        int32_t ttl_seconds = 0;
+        int64_t version = 0;
+        bool replicated = false;
+    };
+
+    /**
+     * One independent log: its own segment files, file lock, group
+     * commit queue and writer thread.
+     */
+    struct Stream {
+        size_t index = 0;
+        std::filesystem::path dir;
+
+        // Current log file, guarded by mutex. current_file_size is the end
+        // of the logged data; the segment itself is preallocated beyond it.
+        mutable std::mutex mutex;
+        std::string current_log_id;  // Relative to wal_dir
+        int fd = -1;
+        size_t segment_data_start = 0;  // First record offset, after the header
+        std::string tail;  // Bytes of the last, partially filled block
+        std::atomic<size_t> current_file_size{0};
+
+        // Block-aligned staging buffer for pwrite, guarded by mutex
+        std::unique_ptr<char, FreeDeleter> io_buffer;
+        size_t io_buffer_capacity = 0;
+
+        // io_uring backend, guarded by mutex. Writes rewrite the previous
+        // commit's tail block, so each one completes before the next is
+        // submitted; only the linked fdatasyncs overlap. Commits become
+        // durable in submission order.
+        struct RingCommit {
+            uint64_t id = 0;
+            int64_t sequence = 0;
+            size_t length = 0;
+            std::chrono::steady_clock::time_point written_at;
+            bool written = false;
+            bool synced = false;
+        };
+        std::unique_ptr<IORing> ring;
+        bool ring_buffer_registered = false;
+        std::deque<RingCommit> ring_commits;
+        uint64_t ring_next_id = 0;
+        std::atomic<size_t> ring_in_flight{0};  // Completions still to come
+        std::atomic<int64_t> ring_durable_sequence{0};
+        std::atomic<bool> ring_failed{false};
+
+        // Group commit queue, guarded by commit_mutex. Records are encoded
+        // into pending_buffer in sequence order; the writer swaps it out
+        // for write_buffer and commits the whole batch at once. With a
+        // commit log the batch is handed over as log_batch instead, which
+        // the log's records share.
+        std::mutex commit_mutex;
+        std::condition_variable commit_cv;   // Wakes the writer
+        std::condition_variable durable_cv;  // Wakes callers waiting on a commit
+        std::string pending_buffer;
+        std::vector<LogSpan> pending_spans;  // With a commit log
+        size_t pending_records = 0;
+        int64_t submitted_sequence = 0;  // Last record queued
+        int64_t committed_sequence = 0;  // Last record written (and synced)
+        bool commit_failed = false;
+        bool stop_writer = false;
+        bool writer_running = false;
+        std::thread writer_thread;
+        std::string write_buffer;  // Owned by the writer thread
+        std::shared_ptr<const std::string> log_batch;  // Likewise
+        std::vector<LogSpan> log_spans;                // Likewise
+        std::string block_buffer;  // Compressed batch, owned by the writer thread
+    };
+
+    std::vector<std::unique_ptr<Stream>> streams_;
+    std::atomic<int64_t> last_sequence_{0};  // WAL-wide, shared by all streams
+    const uint64_t instance_id_;  // Keys each thread's record of its own writes
     std::atomic<bool> is_open_{false};
+    std::atomic<bool> direct_io_{false};
+    std::atomic<bool> io_uring_{false};
+    compression::Codec codec_ = compression::Codec::kNone;
+    std::shared_ptr<CommitLog> commit_log_;  // Set before Open()
+
+    std::mutex commit_listener_mutex_;  // Taken under a stream's commit_mutex
+    std::function<void()> commit_listener_;
+    std::shared_ptr<IoScheduler> io_scheduler_;  // Set before Open()
 
-    // Thread safety
-    mutable std::mutex mutex_;
+    // Compaction. maintenance_mutex_ serializes compaction with
+    // truncation, which both retire closed segments.
+    std::mutex maintenance_mutex_;
+    std::atomic<int64_t> covered_sequence_{0};  // Highest record a snapshot holds
+    std::atomic<int64_t> lost_sequence_{0};     // Highest record removed from disk
 
-    // Batch buffering (optional)
-    std::vector<WALEntry> pending_entries_;
-    size_t pending_batch_size_{0};
+    // Segment start sequences for ReadEntriesAfter, dropped on retirement
+    mutable std::mutex segment_starts_mutex_;
+    mutable std::map<std::filesystem::path, int64_t> segment_starts_;
+    uint64_t segment_starts_epoch_ = 0;  // Bumped by every removal
+    std::mutex compaction_mutex_;
+    std::condition_variable compaction_cv_;
+    bool stop_compaction_ = false;
+    std::thread compaction_thread_;
 
     // Stats
     std::atomic<uint64_t> total_entries_written_{0};
     std::atomic<uint64_t> total_syncs_{0};
     std::atomic<uint64_t> total_rotations_{0};
+    std::atomic<uint64_t> total_group_commits_{0};
+    std::atomic<uint64_t> max_group_commit_records_{0};
+    std::atomic<uint64_t> total_segments_recycled_{0};
+    std::atomic<uint64_t> total_compressed_blocks_{0};
+    std::atomic<uint64_t> total_record_bytes_{0};
+    std::atomic<uint64_t> total_written_bytes_{0};
+    std::atomic<uint64_t> total_compactions_{0};
+    std::atomic<uint64_t> total_segments_compacted_{0};
+    std::atomic<uint64_t> total_records_compacted_away_{0};
+    mutable std::atomic<uint64_t> io_throttled_us_{0};
+    LatencyHistogram write_latency_;
+    LatencyHistogram fsync_latency_;
+
+    /**
+     * Borrowed view of one record to append. Fields point into the
+     * caller's key and CacheEntry, so nothing is copied before encoding.
+     */
+    struct RecordView {
+        WALEntry::Type type;
+        int64_t sequence_number = 0;
+        int64_t timestamp_ms = 0;
+        const std::string& key;
+        const std::vector<uint8_t>* value = nullptr;
+        int64_t version = 0;
+        std::optional<int32_t> ttl_seconds;
+        std::optional<int64_t> expected_version;
+        bool replicated = false;
+
+        RecordView(WALEntry::Type t, const std::string& k) : type(t), key(k) {}
+    };
 
     // Internal helpers
-    bool AppendEntry(const WALEntry& entry);
-    bool WriteEntryToFile(const WALEntry& entry);
-    std::string GenerateLogId();
+    static void DescribeEntry(RecordView& record, const CacheEntry& entry);
+    static void EncodeRecord(const RecordView& record, std::string& out,
+                             LogSpan* span = nullptr);
+    Stream& StreamFor(const std::string& key);
+    bool AppendRecord(RecordView& record);
+    int64_t SubmitRecord(Stream& stream, RecordView& record);
+    bool WaitForCommit(Stream& stream, int64_t sequence);
+
+    // Wake callers waiting on a stream's commits; commit_mutex is held
+    void NotifyDurable(Stream& stream);
+    void PublishDurable();
+    bool BatchFull(const Stream& stream) const;
+    const std::string& TakeBatch(Stream& stream, size_t& records, int64_t& sequence);
+    void AppendToCommitLog(Stream& stream);
+    void GroupCommitWriter(Stream* stream);
+    void RingCommitWriter(Stream& stream);
+    bool CommitBatch(Stream& stream, const std::string& batch, size_t records,
+                     int64_t sequence);
+    bool EncodeBlock(const std::string& batch, std::string& out) const;
+    bool EncodeHeader(const std::string& wal_id, std::string& out) const;
+    void CompactionLoop();
+    void ThrottleIo(size_t bytes) const;  // Wait for the background I/O budget
+    bool CompactDirectory(const std::vector<std::filesystem::path>& segments,
+                          CompactionResult& result);
+    bool OpenLogFile(Stream& stream);
+    bool RotateLocked(Stream& stream);
+    bool SyncLocked(Stream& stream);
+    bool WriteBlocks(Stream& stream, const char* data, size_t size);
+    char* StageBlocks(Stream& stream, const char* data, size_t size,
+                      size_t& start, size_t& length);
+    bool SubmitRingWrite(Stream& stream, const char* data, size_t size, int64_t sequence);
+    bool ReapRing(Stream& stream, std::chrono::microseconds timeout);
+    bool DrainRing(Stream& stream);
+    char* ReserveIOBuffer(Stream& stream, size_t size);
+    std::filesystem::path TakeRecycledSegment(const Stream& stream);
+    void RetireSegment(const std::filesystem::path& path);
+
+    // First sequence a segment holds, or 0 if it has no records yet
+    int64_t SegmentFirstSequence(const std::filesystem::path& path) const;
+
+    // Note that records up to a sequence may be gone from disk
+    void MarkLost(int64_t sequence);
+    std::string GenerateLogId(const Stream& stream);
     std::filesystem::path GetLogFilePath(const std::string& log_id) const;
-    bool ShouldRotate() const;
+    bool ShouldRotate(const Stream& stream, size_t incoming_bytes) const;
 };
 
 } // namespace distcache
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "distcache/snapshot_manager.h"
+#include "distcache/storage_engine.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace distcache {
+
+/**
+ * Warm restart: a new server process on the same host (e.g. after a
+ * binary upgrade) takes over a running node's table instead of starting
+ * cold.
+ *
+ * The table travels through a named shared-memory segment: a chunked
+ * snapshot written uncompressed to a tmpfs directory (/dev/shm by
+ * default). Its layout is offsets only, so the new process maps the same
+ * pages and attaches them with a lazy restore, serving before the
+ * entries are decoded.
+ *
+ * Protocol, one line per message over a Unix socket the old process
+ * listens on:
+ *   new -> old  TAKEOVER <protocol> <layout>
+ *   old         freezes writes (in-flight ones finish), flushes and
+ *               releases its WAL, writes the segment
+ *   old -> new  READY <segment> <wal sequence> <keys>  or  ERROR <reason>
+ *   new         attaches the segment
+ *   new -> old  TAKEN
+ *   old -> new  RELEASED
+ *   old         stops serving; from here on it never takes the WAL back
+ *   new         opens the WAL after that sequence and starts serving
+ * If the new process fails or hangs up before RELEASED is sent, the old
+ * one thaws writes, takes its WAL back and keeps serving. The new process
+ * touches the WAL only after reading RELEASED, so at most one process
+ * ever has it open.
+ */
+namespace handoff {
+
+constexpr uint32_t kProtocolVersion = 2;  // 2: RELEASED acknowledges TAKEN
+
+// Bump when the segment layout (snapshot format or its use) changes
+constexpr uint32_t kLayoutVersion = 1;
+
+struct Config {
+    std::filesystem::path socket_path;
+    std::filesystem::path segment_dir = "/dev/shm";  // tmpfs mount
+    std::string node_id = "node1";
+    uint32_t timeout_ms = 30000;  // Per protocol step
+};
+
+// Directory holding a node's segment under segment_dir
+std::filesystem::path SegmentPath(const Config& config);
+
+} // namespace handoff
+
+/**
+ * HandoffServer is the old process's side: it listens for a takeover
+ * and hands the table over.
+ */
+class HandoffServer {
+public:
+    struct Callbacks {
+        // Writes are frozen: flush and release the WAL (and stop anything
+        // else writing to the data directory); returns its last sequence
+        std::function<int64_t()> release;
+        // The handoff failed after release: take the WAL back
+        std::function<void()> reclaim;
+        // The new process owns the table: stop serving
+        std::function<void()> handed_off;
+    };
+
+    HandoffServer(const handoff::Config& config,
+                  std::shared_ptr<ShardedHashTable> storage,
+                  Callbacks callbacks);
+    ~HandoffServer();
+
+    HandoffServer(const HandoffServer&) = delete;
+    HandoffServer& operator=(const HandoffServer&) = delete;
+
+    /**
+     * Listen on the socket path, replacing a stale socket there.
+     * @return False if the socket cannot be bound
+     */
+    bool Start();
+    void Stop();
+
+    bool handed_off() const { return handed_off_.load(); }
+
+private:
+    void AcceptLoop();
+
+    // Run one takeover request on a connected socket
+    bool Serve(int fd);
+
+    handoff::Config config_;
+    std::shared_ptr<ShardedHashTable> storage_;
+    Callbacks callbacks_;
+
+    int listen_fd_ = -1;
+    std::thread accept_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> handed_off_{false};
+};
+
+/**
+ * HandoffClient is the new process's side: it asks the old process for
+ * its table and attaches the segment.
+ */
+class HandoffClient {
+public:
+    struct Result {
+        bool success = false;
+        std::string error;
+        std::string segment_id;
+        int64_t wal_sequence = 0;  // Resume the WAL after this
+        size_t keys = 0;
+        bool lazy = false;         // Attached lazily (else copied in)
+        int64_t duration_ms = 0;   // Request to attached, including the export
+    };
+
+    HandoffClient(const handoff::Config& config, std::shared_ptr<ShardedHashTable> storage);
+    ~HandoffClient();
+
+    HandoffClient(const HandoffClient&) = delete;
+    HandoffClient& operator=(const HandoffClient&) = delete;
+
+    /**
+     * Request the table and attach its segment to storage, which must be
+     * empty. The old process stays frozen until Confirm or Abort.
+     */
+    Result Attach();
+
+    /**
+     * Tell the old process the handoff is complete and wait for it to
+     * release the table for good; only then may the WAL be opened here.
+     * Drops the segment's name; the mapping stays.
+     * @return False if the old process did not acknowledge (it may take
+     *         the WAL back, so this process must not serve)
+     */
+    bool Confirm();
+
+    /**
+     * Give the table back: the old process resumes writes.
+     */
+    void Abort();
+
+    /**
+     * Wait for a lazily attached segment to be fully loaded.
+     */
+    void WaitForLoad();
+
+private:
+    handoff::Config config_;
+    std::shared_ptr<ShardedHashTable> storage_;
+    std::shared_ptr<SnapshotManager> segment_;  // Keeps the lazy loader running
+    int fd_ = -1;
+};
+
+} // namespace distcache
@@ -21,6 +21,9 @@ using distcache::v1::StatusRequest;
 using distcache::v1::StatusResponse;
 using distcache::v1::MetricsRequest;
 using distcache::v1::MetricsResponse;
+using distcache::v1::GetIoThrottleRequest;
+using distcache::v1::SetIoThrottleRequest;
+using distcache::v1::IoThrottleResponse;
 
 /**
  * AdminCLI - Command-line tool for DistCache cluster management.
@@ -30,6 +33,7 @@ using distcache::v1::MetricsResponse;
  *   rebalance                 - Trigger rebalancing
  *   drain <node_id> [timeout] - Drain node before shutdown
  *   metrics                   - Get metrics
+ *   io-throttle [rate] [p99]  - Show or set the background I/O budget
  *   help                      - Show help
  */
 class AdminCLI {
@@ -57,6 +61,8 @@ public:
             cmd_drain(args);
         } else if (command == "metrics") {
             cmd_metrics(args);
+        } else if (command == "io-throttle") {
+            cmd_io_throttle(args);
         } else if (command == "help") {
             print_help();
         } else {
@@ -242,12 +248,67 @@ private:
         }
     }
 
+    void cmd_io_throttle(const std::vector<std::string>& args) {
+        IoThrottleResponse response;
+        ClientContext context;
+        Status status;
+
+        // With arguments, set the rate (bytes/s, 0 = unlimited) and p99 target (us)
+        if (args.size() > 1) {
+            SetIoThrottleRequest request;
+            try {
+                request.set_bytes_per_second(std::stoll(args[1]));
+                if (args.size() > 2) {
+                    request.set_foreground_p99_target_us(std::stoll(args[2]));
+                }
+            } catch (const std::exception&) {
+                std::cerr << "Usage: io-throttle [bytes_per_second] [p99_target_us]" << std::endl;
+                return;
+            }
+            status = stub_->SetIoThrottle(&context, request, &response);
+        } else {
+            status = stub_->GetIoThrottle(&context, GetIoThrottleRequest(), &response);
+        }
+
+        if (!status.ok()) {
+            std::cerr << "Error: " << status.error_message() << std::endl;
+            return;
+        }
+
+        if (!response.success()) {
+            std::cout << "I/O throttle failed: " << response.error() << std::endl;
+            return;
+        }
+
+        auto rate = [this](int64_t bytes_per_second) {
+            return bytes_per_second == 0 ? std::string("unlimited")
+                                         : format_bytes(bytes_per_second) + "/s";
+        };
+        std::cout << "\nBackground I/O budget:\n" << std::endl;
+        std::cout << std::left;
+        std::cout << std::setw(24) << "Rate:" << rate(response.bytes_per_second()) << std::endl;
+        std::cout << std::setw(24) << "Effective rate:"
+                  << rate(response.effective_bytes_per_second()) << std::endl;
+        std::cout << std::setw(24) << "Burst:" << format_bytes(response.burst_bytes()) << std::endl;
+        std::cout << std::setw(24) << "Adaptive:" << (response.adaptive() ? "on" : "off")
+                  << " (p99 target " << response.foreground_p99_target_us() << "us, floor "
+                  << rate(response.min_bytes_per_second()) << ")" << std::endl;
+        std::cout << std::setw(24) << "Foreground p99:" << response.foreground_p99_us() << "us"
+                  << std::endl;
+        std::cout << std::setw(24) << "Background I/O:" << format_bytes(response.bytes_granted())
+                  << std::endl;
+        std::cout << std::setw(24) << "Throttled:" << response.throttled_ms() << "ms over "
+                  << response.throttled_requests() << " requests, " << response.backoffs()
+                  << " backoffs" << std::endl;
+    }
+
     void print_help() {
         std::cout << "\nDistCache Admin CLI - Available Commands:\n" << std::endl;
         std::cout << "  status [node_id]          - Get status of node(s)" << std::endl;
         std::cout << "  rebalance                 - Trigger rebalancing" << std::endl;
         std::cout << "  drain <node_id> [timeout] - Drain node before shutdown" << std::endl;
         std::cout << "  metrics                   - Get metrics" << std::endl;
+        std::cout << "  io-throttle [rate] [p99]  - Show or set the background I/O budget" << std::endl;
         std::cout << "  help                      - Show this help" << std::endl;
         std::cout << "  exit                      - Exit interactive mode" << std::endl;
         std::cout << std::endl;
@@ -323,6 +384,7 @@ int main(int argc, char** argv) {
             std::cout << "  rebalance                 - Trigger rebalancing" << std::endl;
             std::cout << "  drain <node_id> [timeout] - Drain node" << std::endl;
             std::cout << "  metrics                   - Get metrics" << std::endl;
+        std::cout << "  io-throttle [rate] [p99]  - Show or set the background I/O budget" << std::endl;
             return 0;
         } else {
             command_args.push_back(arg);
@@ -1,8 +1,15 @@
 #include <iostream>
+#include <algorithm>
 #include <chrono>
 #include <thread>
 #include <vector>
 #include <random>
+#include <string>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include <grpc++/grpc++.h>
 #include "cache_service.grpc.pb.h"
 
@@ -155,6 +162,144 @@ private:
     std::unique_ptr<CacheService::Stub> stub_;
 };
 
+// Same workload as CacheBenchmark, spoken over the Redis protocol to the
+// server's optional RESP listener (--resp-port)
+class RespBenchmark {
+public:
+    explicit RespBenchmark(const std::string& target) {
+        auto colon = target.rfind(':');
+        std::string host = target.substr(0, colon);
+        std::string port = target.substr(colon + 1);
+
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0) {
+            return;
+        }
+
+        fd_ = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+        if (fd_ >= 0 && connect(fd_, result->ai_addr, result->ai_addrlen) != 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+        freeaddrinfo(result);
+
+        if (fd_ >= 0) {
+            int one = 1;
+            setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+    }
+
+    ~RespBenchmark() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    bool connected() const { return fd_ >= 0; }
+
+    BenchmarkStats run_set_benchmark(int num_ops, int value_size) {
+        std::string value(value_size, 'x');
+        return run(num_ops, [&](int i) {
+            return command({"SET", "bench_key_" + std::to_string(i), value}) == '+';
+        });
+    }
+
+    BenchmarkStats run_get_benchmark(int num_ops, int num_keys) {
+        std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<> distrib(0, num_keys - 1);
+        return run(num_ops, [&](int) {
+            return command({"GET", "bench_key_" + std::to_string(distrib(gen))}) == '$';
+        });
+    }
+
+    BenchmarkStats run_delete_benchmark(int num_ops) {
+        return run(num_ops, [&](int i) {
+            return command({"DEL", "bench_key_" + std::to_string(i)}) == ':';
+        });
+    }
+
+private:
+    template <typename Op>
+    BenchmarkStats run(int num_ops, Op&& op) {
+        BenchmarkStats stats;
+        stats.start_time = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < num_ops; i++) {
+            auto op_start = std::chrono::steady_clock::now();
+            bool ok = op(i);
+            auto op_end = std::chrono::steady_clock::now();
+            stats.latencies_ms.push_back(
+                std::chrono::duration<double, std::milli>(op_end - op_start).count());
+            if (ok) {
+                stats.operations++;
+            }
+        }
+
+        stats.end_time = std::chrono::steady_clock::now();
+        return stats;
+    }
+
+    // Send one command and read its reply; returns the reply type byte
+    char command(const std::vector<std::string>& args) {
+        std::string request = "*" + std::to_string(args.size()) + "\r\n";
+        for (const auto& arg : args) {
+            request += "$" + std::to_string(arg.size()) + "\r\n" + arg + "\r\n";
+        }
+        if (send(fd_, request.data(), request.size(), MSG_NOSIGNAL) !=
+            static_cast<ssize_t>(request.size())) {
+            return 0;
+        }
+
+        std::string line = read_line();
+        if (line.empty()) {
+            return 0;
+        }
+        if (line[0] == '$') {
+            long length = std::stol(line.substr(1));
+            if (length >= 0) {
+                read_exact(static_cast<size_t>(length) + 2);
+            }
+        }
+        return line[0];
+    }
+
+    std::string read_line() {
+        while (true) {
+            auto crlf = buffer_.find("\r\n");
+            if (crlf != std::string::npos) {
+                std::string line = buffer_.substr(0, crlf);
+                buffer_.erase(0, crlf + 2);
+                return line;
+            }
+            if (!fill()) {
+                return "";
+            }
+        }
+    }
+
+    void read_exact(size_t bytes) {
+        while (buffer_.size() < bytes && fill()) {
+        }
+        buffer_.erase(0, std::min(bytes, buffer_.size()));
+    }
+
+    bool fill() {
+        char chunk[16 * 1024];
+        ssize_t received = recv(fd_, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            return false;
+        }
+        buffer_.append(chunk, static_cast<size_t>(received));
+        return true;
+    }
+
+    int fd_ = -1;
+    std::string buffer_;
+};
+
 void print_stats(const std::string& name, const BenchmarkStats& stats) {
     std::cout << "\n=== " << name << " ===" << std::endl;
     std::cout << "Operations:     " << stats.operations << std::endl;
@@ -165,14 +310,26 @@ void print_stats(const std::string& name, const BenchmarkStats& stats) {
     std::cout << "P99 Latency:    " << stats.p99_latency() << " ms" << std::endl;
 }
 
+void print_comparison(const std::string& name, const BenchmarkStats& grpc_stats,
+                      const BenchmarkStats& resp_stats) {
+    std::cout << name << ":  gRPC " << static_cast<int>(grpc_stats.throughput_ops_per_sec())
+              << " ops/sec (p50 " << grpc_stats.p50_latency() << " ms)"
+              << "  |  RESP " << static_cast<int>(resp_stats.throughput_ops_per_sec())
+              << " ops/sec (p50 " << resp_stats.p50_latency() << " ms)"
+              << "  |  speedup " << resp_stats.throughput_ops_per_sec() /
+                                   grpc_stats.throughput_ops_per_sec() << "x" << std::endl;
+}
+
 int main(int argc, char** argv) {
     std::string target = "localhost:50051";
     int num_ops = 10000;
     int value_size = 100;
+    std::string resp_target;  // e.g. localhost:6379 to compare protocols
 
     if (argc > 1) target = argv[1];
     if (argc > 2) num_ops = std::stoi(argv[2]);
     if (argc > 3) value_size = std::stoi(argv[3]);
+    if (argc > 4) resp_target = argv[4];
 
     std::cout << "======================================" << std::endl;
     std::cout << "  DistCache Performance Benchmark" << std::endl;
@@ -198,6 +355,32 @@ int main(int argc, char** argv) {
     auto del_stats = bench.run_delete_benchmark(num_ops);
     print_stats("DELETE Benchmark", del_stats);
 
+    if (!resp_target.empty()) {
+        std::cout << "\nRESP target: " << resp_target << std::endl;
+        RespBenchmark resp(resp_target);
+        if (!resp.connected()) {
+            std::cerr << "Failed to connect to RESP listener at " << resp_target << std::endl;
+            return 1;
+        }
+
+        std::cout << "\n[1/3] Running RESP SET benchmark..." << std::endl;
+        auto resp_set = resp.run_set_benchmark(num_ops, value_size);
+        print_stats("RESP SET Benchmark", resp_set);
+
+        std::cout << "\n[2/3] Running RESP GET benchmark..." << std::endl;
+        auto resp_get = resp.run_get_benchmark(num_ops, num_ops);
+        print_stats("RESP GET Benchmark", resp_get);
+
+        std::cout << "\n[3/3] Running RESP DELETE benchmark..." << std::endl;
+        auto resp_del = resp.run_delete_benchmark(num_ops);
+        print_stats("RESP DELETE Benchmark", resp_del);
+
+        std::cout << "\n=== gRPC vs RESP ===" << std::endl;
+        print_comparison("SET   ", set_stats, resp_set);
+        print_comparison("GET   ", get_stats, resp_get);
+        print_comparison("DELETE", del_stats, resp_del);
+    }
+
     std::cout << "\n======================================" << std::endl;
     std::cout << "Benchmark completed!" << std::endl;
     std::cout << "======================================" << std::endl;
@@ -46,6 +46,23 @@ std::string Metrics::to_prometheus() const {
     oss << "# TYPE memory_bytes gauge\n";
     oss << "memory_bytes " << memory_bytes.load() << "\n\n";
 
+    // Allocations per request
+    oss << "# HELP request_allocations_total Total heap allocations made while serving requests\n";
+    oss << "# TYPE request_allocations_total counter\n";
+    oss << "request_allocations_total " << request_allocations_total.load() << "\n\n";
+
+    oss << "# HELP requests_tracked_total Total requests with allocation tracking\n";
+    oss << "# TYPE requests_tracked_total counter\n";
+    oss << "requests_tracked_total " << requests_tracked.load() << "\n\n";
+
+    oss << "# HELP request_allocations_max Most heap allocations made by a single request\n";
+    oss << "# TYPE request_allocations_max gauge\n";
+    oss << "request_allocations_max " << request_allocations_max.load() << "\n\n";
+
+    oss << "# HELP allocations_per_request Average heap allocations per request\n";
+    oss << "# TYPE allocations_per_request gauge\n";
+    oss << "allocations_per_request " << allocations_per_request() << "\n\n";
+
     return oss.str();
 }
 
@@ -61,6 +78,10 @@ std::string Metrics::to_json() const {
     oss << "  \"evictions_total\": " << evictions_total.load() << ",\n";
     oss << "  \"entries_count\": " << entries_count.load() << ",\n";
     oss << "  \"memory_bytes\": " << memory_bytes.load() << ",\n";
+    oss << "  \"request_allocations_total\": " << request_allocations_total.load() << ",\n";
+    oss << "  \"requests_tracked\": " << requests_tracked.load() << ",\n";
+    oss << "  \"request_allocations_max\": " << request_allocations_max.load() << ",\n";
+    oss << "  \"allocations_per_request\": " << allocations_per_request() << ",\n";
     oss << "  \"total_operations\": " << total_operations() << "\n";
     oss << "}\n";
 
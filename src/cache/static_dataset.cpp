@@ -0,0 +1,597 @@
+#include "distcache/static_dataset.h"
+#include "distcache/cache_entry.h"
+#include "distcache/crc32c.h"
+#include "distcache/logger.h"
+#include "distcache/murmur_hash3.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace distcache {
+
+namespace {
+
+constexpr char kMagic[8] = {'D', 'C', 'S', 'T', 'A', 'T', 'I', 'C'};
+constexpr size_t kHeaderCrcOffset = 60;  // Header bytes the header CRC covers
+constexpr size_t kRecordHeaderSize = 8;
+constexpr size_t kWordsPerRank = 8;
+
+// Bits per key at each level: larger builds faster and looks up in fewer
+// levels, smaller takes less space
+constexpr double kGamma = 2.0;
+constexpr uint32_t kMaxLevels = 32;
+constexpr uint32_t kMaxAttempts = 8;  // Seeds to try if keys are left over
+
+void PutFixed32(std::string& out, uint32_t value) {
+    char buf[4];
+    for (int i = 0; i < 4; ++i) {
+        buf[i] = static_cast<char>(value >> (8 * i));
+    }
+    out.append(buf, sizeof(buf));
+}
+
+void PutFixed64(std::string& out, uint64_t value) {
+    char buf[8];
+    for (int i = 0; i < 8; ++i) {
+        buf[i] = static_cast<char>(value >> (8 * i));
+    }
+    out.append(buf, sizeof(buf));
+}
+
+uint32_t GetFixed32(const char* p) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t GetFixed64(const char* p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t Fingerprint(std::string_view key, uint32_t seed) {
+    return murmur_hash3_64(key.data(), key.size(), seed);
+}
+
+// Position of a key in one level's bit array of the given size
+uint64_t LevelPosition(uint64_t fingerprint, uint32_t level, uint64_t bits) {
+    uint64_t h = fingerprint ^ ((level + 1) * 0x9e3779b97f4a7c15ULL);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(h) * bits) >> 64);
+}
+
+uint64_t RankBlocks(uint64_t bit_words) {
+    return bit_words / kWordsPerRank + 1;
+}
+
+std::string_view RecordKey(const std::string& data, uint64_t offset) {
+    uint32_t key_size = GetFixed32(data.data() + offset);
+    return std::string_view(data.data() + offset + kRecordHeaderSize, key_size);
+}
+
+} // namespace
+
+// ====================
+// StaticDatasetBuilder
+// ====================
+
+void StaticDatasetBuilder::Add(std::string_view key, std::string_view value) {
+    offsets_.push_back(data_.size());
+    PutFixed32(data_, static_cast<uint32_t>(key.size()));
+    PutFixed32(data_, static_cast<uint32_t>(value.size()));
+    data_.append(key);
+    data_.append(value);
+}
+
+bool StaticDatasetBuilder::Write(const std::filesystem::path& path) {
+    auto start_time = std::chrono::steady_clock::now();
+    const uint64_t num_keys = offsets_.size();
+    if (num_keys > UINT32_MAX) {
+        LOG_ERROR("Cannot build dataset {}: {} keys is over the limit", path.string(), num_keys);
+        return false;
+    }
+
+    std::vector<uint64_t> fingerprints(num_keys);
+    std::vector<uint64_t> placed(num_keys);  // Global bit of each key
+    std::vector<uint64_t> level_words;
+    std::vector<uint64_t> bits;
+    uint32_t seed = 0;
+    bool built = false;
+
+    for (uint32_t attempt = 0; attempt < kMaxAttempts && !built; ++attempt) {
+        seed = attempt;
+        for (uint64_t i = 0; i < num_keys; ++i) {
+            fingerprints[i] = Fingerprint(RecordKey(data_, offsets_[i]), seed);
+        }
+        level_words.clear();
+        bits.clear();
+
+        std::vector<uint32_t> remaining(num_keys);
+        for (uint32_t i = 0; i < num_keys; ++i) {
+            remaining[i] = i;
+        }
+        std::vector<uint32_t> next;
+        for (uint32_t level = 0; level < kMaxLevels && !remaining.empty(); ++level) {
+            uint64_t words = std::max<uint64_t>(
+                1, static_cast<uint64_t>(remaining.size() * kGamma + 63) / 64);
+            std::vector<uint64_t> seen(words);
+            std::vector<uint64_t> collided(words);
+            for (uint32_t key : remaining) {
+                uint64_t pos = LevelPosition(fingerprints[key], level, words * 64);
+                uint64_t mask = 1ULL << (pos % 64);
+                if (seen[pos / 64] & mask) {
+                    collided[pos / 64] |= mask;
+                }
+                seen[pos / 64] |= mask;
+            }
+
+            // Keys alone at their position are placed; the rest go down a level
+            uint64_t base = bits.size() * 64;
+            next.clear();
+            for (uint32_t key : remaining) {
+                uint64_t pos = LevelPosition(fingerprints[key], level, words * 64);
+                if (collided[pos / 64] & (1ULL << (pos % 64))) {
+                    next.push_back(key);
+                } else {
+                    placed[key] = base + pos;
+                }
+            }
+            for (uint64_t w = 0; w < words; ++w) {
+                bits.push_back(seen[w] & ~collided[w]);
+            }
+            level_words.push_back(words);
+            remaining.swap(next);
+        }
+
+        if (remaining.empty()) {
+            built = true;
+            break;
+        }
+
+        // Equal keys collide at every level, whatever the seed
+        std::sort(remaining.begin(), remaining.end(), [&](uint32_t a, uint32_t b) {
+            return fingerprints[a] < fingerprints[b];
+        });
+        for (size_t i = 1; i < remaining.size(); ++i) {
+            uint32_t a = remaining[i - 1];
+            uint32_t b = remaining[i];
+            if (fingerprints[a] == fingerprints[b] &&
+                RecordKey(data_, offsets_[a]) == RecordKey(data_, offsets_[b])) {
+                LOG_ERROR("Cannot build dataset {}: key '{}' was added twice", path.string(),
+                          std::string(RecordKey(data_, offsets_[a])));
+                return false;
+            }
+        }
+        LOG_WARN("Dataset index left {} keys unplaced with seed {}, retrying",
+                 remaining.size(), seed);
+    }
+    if (!built) {
+        LOG_ERROR("Cannot build dataset {}: no hash seed placed every key", path.string());
+        return false;
+    }
+
+    std::vector<uint64_t> ranks(RankBlocks(bits.size()));
+    uint64_t set_bits = 0;
+    for (uint64_t w = 0; w < bits.size(); ++w) {
+        if (w % kWordsPerRank == 0) {
+            ranks[w / kWordsPerRank] = set_bits;
+        }
+        set_bits += static_cast<uint64_t>(__builtin_popcountll(bits[w]));
+    }
+    if (bits.size() % kWordsPerRank == 0) {
+        ranks.back() = set_bits;
+    }
+
+    // A key's slot is the number of set bits before its own
+    std::vector<uint64_t> slots(num_keys);
+    for (uint64_t i = 0; i < num_keys; ++i) {
+        uint64_t bit = placed[i];
+        uint64_t word = bit / 64;
+        uint64_t slot = ranks[word / kWordsPerRank];
+        for (uint64_t w = word - word % kWordsPerRank; w < word; ++w) {
+            slot += static_cast<uint64_t>(__builtin_popcountll(bits[w]));
+        }
+        slot += static_cast<uint64_t>(
+            __builtin_popcountll(bits[word] & ((1ULL << (bit % 64)) - 1)));
+        slots[slot] = offsets_[i];
+    }
+
+    std::string index;
+    index.reserve(8 * (level_words.size() + bits.size() + ranks.size() + slots.size()));
+    for (const auto* section : {&level_words, &bits, &ranks, &slots}) {
+        for (uint64_t word : *section) {
+            PutFixed64(index, word);
+        }
+    }
+    uint32_t body_crc = crc32c::Extend(crc32c::Value(index.data(), index.size()),
+                                       data_.data(), data_.size());
+
+    std::string header(kMagic, sizeof(kMagic));
+    PutFixed32(header, static_dataset::kFormatVersion);
+    PutFixed32(header, static_cast<uint32_t>(level_words.size()));
+    PutFixed64(header, num_keys);
+    PutFixed32(header, seed);
+    PutFixed32(header, 0);  // Reserved
+    PutFixed64(header, bits.size());
+    PutFixed64(header, data_.size());
+    PutFixed64(header, static_cast<uint64_t>(CacheEntry::get_current_time_ms()));
+    PutFixed32(header, body_crc);
+    PutFixed32(header, crc32c::Value(header.data(), kHeaderCrcOffset));
+
+    auto temp_path = path;
+    temp_path += ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out.write(index.data(), static_cast<std::streamsize>(index.size()));
+        out.write(data_.data(), static_cast<std::streamsize>(data_.size()));
+        out.flush();
+        if (!out) {
+            LOG_ERROR("Failed to write dataset {}", temp_path.string());
+            std::filesystem::remove(temp_path);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        LOG_ERROR("Failed to move dataset into place at {}: {}", path.string(), ec.message());
+        std::filesystem::remove(temp_path);
+        return false;
+    }
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time);
+    LOG_INFO("Dataset {} written: {} keys, {} levels, {:.2f} index bits per key, {} bytes, {}ms",
+             path.string(), num_keys, level_words.size(),
+             num_keys ? bits.size() * 64.0 / num_keys : 0.0,
+             header.size() + index.size() + data_.size(), duration.count());
+    return true;
+}
+
+// ====================
+// StaticDataset
+// ====================
+
+std::shared_ptr<const StaticDataset> StaticDataset::Open(const std::filesystem::path& path,
+                                                         bool verify) {
+    std::shared_ptr<StaticDataset> dataset(new StaticDataset());
+    dataset->path_ = path;
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open dataset {}: {}", path.string(), std::strerror(errno));
+        return nullptr;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < static_dataset::kHeaderSize) {
+        ::close(fd);
+        LOG_ERROR("Dataset {} is truncated", path.string());
+        return nullptr;
+    }
+    dataset->size_ = static_cast<size_t>(st.st_size);
+    void* mapped = ::mmap(nullptr, dataset->size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        LOG_ERROR("Cannot map dataset {}: {}", path.string(), std::strerror(errno));
+        dataset->size_ = 0;
+        return nullptr;
+    }
+    // Lookups touch a few scattered pages each; read-ahead would be wasted
+    ::madvise(mapped, dataset->size_, MADV_RANDOM);
+    dataset->data_ = static_cast<const char*>(mapped);
+
+    const char* header = dataset->data_;
+    if (std::memcmp(header, kMagic, sizeof(kMagic)) != 0 ||
+        GetFixed32(header + kHeaderCrcOffset) != crc32c::Value(header, kHeaderCrcOffset)) {
+        LOG_ERROR("{} is not a dataset file", path.string());
+        return nullptr;
+    }
+    uint32_t version = GetFixed32(header + 8);
+    if (version != static_dataset::kFormatVersion) {
+        LOG_ERROR("Dataset {} has unsupported format version {}", path.string(), version);
+        return nullptr;
+    }
+    uint32_t num_levels = GetFixed32(header + 12);
+    dataset->num_keys_ = GetFixed64(header + 16);
+    dataset->seed_ = GetFixed32(header + 24);
+    uint64_t bit_words = GetFixed64(header + 32);
+    dataset->records_size_ = GetFixed64(header + 40);
+    dataset->built_at_ms_ = static_cast<int64_t>(GetFixed64(header + 48));
+    uint32_t body_crc = GetFixed32(header + 56);
+
+    // Section sizes come from the header; together they must be the file
+    uint64_t words = static_cast<uint64_t>(num_levels) + bit_words + RankBlocks(bit_words) +
+                     dataset->num_keys_;
+    if (num_levels > kMaxLevels || bit_words > dataset->size_ / 8 ||
+        dataset->num_keys_ > dataset->size_ / 8 ||
+        static_dataset::kHeaderSize + words * 8 + dataset->records_size_ != dataset->size_) {
+        LOG_ERROR("Dataset {} is truncated or malformed", path.string());
+        return nullptr;
+    }
+
+    const char* levels = header + static_dataset::kHeaderSize;
+    uint64_t level_total = 0;
+    for (uint32_t level = 0; level < num_levels; ++level) {
+        dataset->level_words_.push_back(GetFixed64(levels + level * 8));
+        level_total += dataset->level_words_.back();
+    }
+    if (level_total != bit_words) {
+        LOG_ERROR("Dataset {} is malformed: levels do not add up", path.string());
+        return nullptr;
+    }
+    dataset->bits_ = levels + num_levels * 8;
+    dataset->ranks_ = dataset->bits_ + bit_words * 8;
+    dataset->slots_ = dataset->ranks_ + RankBlocks(bit_words) * 8;
+    dataset->records_ = dataset->slots_ + dataset->num_keys_ * 8;
+    dataset->index_bytes_ = static_cast<size_t>(dataset->records_ - levels);
+
+    if (verify) {
+        const char* body = header + static_dataset::kHeaderSize;
+        if (crc32c::Value(body, dataset->size_ - static_dataset::kHeaderSize) != body_crc) {
+            LOG_ERROR("Dataset {} failed its checksum", path.string());
+            return nullptr;
+        }
+    }
+    return dataset;
+}
+
+StaticDataset::~StaticDataset() {
+    if (data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+uint64_t StaticDataset::Slot(uint64_t fingerprint) const {
+    uint64_t base = 0;
+    for (uint32_t level = 0; level < level_words_.size(); ++level) {
+        uint64_t bit = base + LevelPosition(fingerprint, level, level_words_[level] * 64);
+        uint64_t word = bit / 64;
+        uint64_t bits = GetFixed64(bits_ + word * 8);
+        if (bits & (1ULL << (bit % 64))) {
+            uint64_t slot = GetFixed64(ranks_ + (word / kWordsPerRank) * 8);
+            for (uint64_t w = word - word % kWordsPerRank; w < word; ++w) {
+                slot += static_cast<uint64_t>(__builtin_popcountll(GetFixed64(bits_ + w * 8)));
+            }
+            return slot + static_cast<uint64_t>(
+                __builtin_popcountll(bits & ((1ULL << (bit % 64)) - 1)));
+        }
+        base += level_words_[level] * 64;
+    }
+    return num_keys_;
+}
+
+std::optional<std::string_view> StaticDataset::find(std::string_view key) const {
+    uint64_t slot = Slot(Fingerprint(key, seed_));
+    if (slot >= num_keys_) {
+        return std::nullopt;
+    }
+
+    uint64_t offset = GetFixed64(slots_ + slot * 8);
+    if (offset > records_size_ || records_size_ - offset < kRecordHeaderSize) {
+        return std::nullopt;  // Malformed; never in a file the builder wrote
+    }
+    const char* record = records_ + offset;
+    uint64_t key_size = GetFixed32(record);
+    uint64_t value_size = GetFixed32(record + 4);
+    if (key_size + value_size > records_size_ - offset - kRecordHeaderSize) {
+        return std::nullopt;
+    }
+    if (std::string_view(record + kRecordHeaderSize, key_size) != key) {
+        return std::nullopt;
+    }
+    return std::string_view(record + kRecordHeaderSize + key_size, value_size);
+}
+
+// ====================
+// StaticDatasets
+// ====================
+
+bool StaticDatasets::FileVersion::operator==(const FileVersion& other) const {
+    return device == other.device && inode == other.inode && size == other.size &&
+           mtime_ns == other.mtime_ns;
+}
+
+StaticDatasets::StaticDatasets() : StaticDatasets(Config()) {}
+
+StaticDatasets::StaticDatasets(const Config& config) : config_(config) {}
+
+StaticDatasets::~StaticDatasets() {
+    Stop();
+}
+
+std::optional<StaticDatasets::FileVersion> StaticDatasets::Stat(const std::filesystem::path& path) {
+    struct stat st {};
+    if (::stat(path.c_str(), &st) != 0) {
+        return std::nullopt;
+    }
+    FileVersion version;
+    version.device = static_cast<uint64_t>(st.st_dev);
+    version.inode = static_cast<uint64_t>(st.st_ino);
+    version.size = static_cast<uint64_t>(st.st_size);
+    version.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return version;
+}
+
+bool StaticDatasets::Mount(const std::string& name, const std::filesystem::path& path) {
+    if (name.empty() || name.find(':') != std::string::npos) {
+        LOG_ERROR("Invalid dataset name '{}'", name);
+        return false;
+    }
+
+    // Stat first: a file replaced while opening is picked up next refresh
+    auto version = Stat(path);
+    auto dataset = StaticDataset::Open(path);
+    if (!version || !dataset) {
+        return false;
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto& mount = mounts_[name];
+        if (mount.dataset) {
+            swaps_++;
+        }
+        mount.path = path;
+        mount.dataset = dataset;
+        mount.version = *version;
+        mount.failed = FileVersion();
+        mounted_.store(mounts_.size());
+    }
+    LOG_INFO("Mounted dataset {} from {} ({} keys, {} index bytes, built at {})", name,
+             path.string(), dataset->size(), dataset->index_bytes(), dataset->built_at_ms());
+    return true;
+}
+
+bool StaticDatasets::Unmount(const std::string& name) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (mounts_.erase(name) == 0) {
+        return false;
+    }
+    mounted_.store(mounts_.size());
+    return true;
+}
+
+std::shared_ptr<const StaticDataset> StaticDatasets::Resolve(std::string_view key,
+                                                             std::string_view& local_key) const {
+    if (mounted_.load(std::memory_order_relaxed) == 0) {
+        return nullptr;
+    }
+    size_t separator = key.find(':');
+    if (separator == std::string_view::npos) {
+        return nullptr;
+    }
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = mounts_.find(key.substr(0, separator));
+    if (it == mounts_.end()) {
+        return nullptr;
+    }
+    local_key = key.substr(separator + 1);
+    return it->second.dataset;
+}
+
+StaticDatasets::Lookup StaticDatasets::lookup(std::string_view key) const {
+    Lookup result;
+    std::string_view local_key;
+    result.dataset = Resolve(key, local_key);
+    if (result.dataset) {
+        lookups_.fetch_add(1, std::memory_order_relaxed);
+        result.value = result.dataset->find(local_key);
+        if (result.value) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+bool StaticDatasets::is_read_only(std::string_view key) const {
+    std::string_view local_key;
+    return Resolve(key, local_key) != nullptr;
+}
+
+std::shared_ptr<const StaticDataset> StaticDatasets::dataset(std::string_view name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = mounts_.find(name);
+    return it == mounts_.end() ? nullptr : it->second.dataset;
+}
+
+size_t StaticDatasets::Refresh() {
+    std::vector<std::pair<std::string, std::filesystem::path>> changed;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        for (const auto& [name, mount] : mounts_) {
+            auto version = Stat(mount.path);
+            if (version && !(*version == mount.version) && !(*version == mount.failed)) {
+                changed.emplace_back(name, mount.path);
+            }
+        }
+    }
+
+    // Open outside the lock; lookups keep using the mounted version
+    size_t swapped = 0;
+    for (const auto& [name, path] : changed) {
+        auto version = Stat(path);
+        auto dataset = version ? StaticDataset::Open(path) : nullptr;
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = mounts_.find(name);
+        if (it == mounts_.end() || it->second.path != path || !version) {
+            continue;  // Unmounted or remounted meanwhile
+        }
+        if (!dataset) {
+            it->second.failed = *version;
+            swap_failures_++;
+            LOG_WARN("Keeping dataset {} at its mounted version: the new file is unusable", name);
+            continue;
+        }
+        it->second.dataset = dataset;
+        it->second.version = *version;
+        swaps_++;
+        swapped++;
+        LOG_INFO("Swapped in a new version of dataset {} ({} keys, built at {})", name,
+                 dataset->size(), dataset->built_at_ms());
+    }
+    return swapped;
+}
+
+void StaticDatasets::Start() {
+    if (config_.check_interval_seconds == 0 || running_.exchange(true)) {
+        return;
+    }
+    worker_thread_ = std::thread(&StaticDatasets::RefreshWorker, this);
+}
+
+void StaticDatasets::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (worker_thread_.joinable()) {
+        worker_thread_.join();
+    }
+}
+
+void StaticDatasets::RefreshWorker() {
+    const auto interval = std::chrono::seconds(config_.check_interval_seconds);
+    auto last_check = std::chrono::steady_clock::now();
+
+    while (running_.load()) {
+        // Sleep in small chunks to allow quick shutdown
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (running_.load() && std::chrono::steady_clock::now() - last_check >= interval) {
+            Refresh();
+            last_check = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+StaticDatasets::Stats StaticDatasets::GetStats() const {
+    Stats stats;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        stats.datasets = mounts_.size();
+        for (const auto& [name, mount] : mounts_) {
+            stats.keys += mount.dataset->size();
+        }
+    }
+    stats.lookups = lookups_.load();
+    stats.hits = hits_.load();
+    stats.swaps = swaps_.load();
+    stats.swap_failures = swap_failures_.load();
+    return stats;
+}
+
+} // namespace distcache
@@ -1,4 +1,6 @@
 #include "distcache/storage_engine.h"
+#include <algorithm>
+#include <charconv>
 #include <functional>
 
 namespace distcache {
@@ -29,10 +31,22 @@ std::optional<CacheEntry> ShardedHashTable::get(const std::string& key) {
 
     // Upgrade to write lock to update LRU position
     std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    return get_locked(shard, key);
+}
+
+std::optional<CacheEntry> ShardedHashTable::get_locked(Shard& shard, const std::string& key) {
+    const CacheEntry* entry = lookup_locked(shard, key);
+    if (!entry) {
+        return std::nullopt;
+    }
+    return *entry;
+}
+
+const CacheEntry* ShardedHashTable::lookup_locked(Shard& shard, const std::string& key) {
     auto it = shard.data.find(key);
     if (it == shard.data.end() || it->second.entry.is_expired()) {
         metrics_.cache_misses.fetch_add(1);
-        return std::nullopt;
+        return nullptr;
     }
 
     // Move to front of LRU list (most recently used)
@@ -44,15 +58,31 @@ std::optional<CacheEntry> ShardedHashTable::get(const std::string& key) {
     // Track cache hit
     metrics_.cache_hits.fetch_add(1);
 
-    return it->second.entry;
+    return &it->second.entry;
 }
 
 bool ShardedHashTable::set(const std::string& key, CacheEntry entry) {
-    auto& shard = get_shard(key);
+    auto& shard = get_write_shard(key);
     std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    return set_locked(shard, key, std::move(entry));
+}
 
+bool ShardedHashTable::set_locked(Shard& shard, const std::string& key, CacheEntry entry,
+                                  bool loaded) {
+    if (!loaded && writes_frozen_.load(std::memory_order_relaxed)) {
+        return false;
+    }
     size_t entry_size = entry.total_size();
 
+    // A write to a shard still waiting for its contents wins over them
+    if (!loaded && shard.load_state.load(std::memory_order_relaxed) != kShardLoaded) {
+        shard.superseded.insert(key);
+    }
+
+    if (track_tombstones_ && !shard.tombstones.empty()) {
+        shard.tombstones.erase(key);
+    }
+
     // Check if key already exists
     auto it = shard.data.find(key);
     if (it != shard.data.end()) {
@@ -68,6 +98,10 @@ bool ShardedHashTable::set(const std::string& key, CacheEntry entry) {
 
         shard.memory_bytes += entry_size;
         total_memory_bytes_.fetch_add(entry_size);
+
+        if (listener_ && !loaded) {
+            listener_->on_set(key, it->second.entry);
+        }
         return true;
     }
 
@@ -80,7 +114,8 @@ bool ShardedHashTable::set(const std::string& key, CacheEntry entry) {
     shard.lru_list.push_front(key);
     auto lru_iter = shard.lru_list.begin();
 
-    shard.data[key] = {std::move(entry), lru_iter};
+    auto& stored = shard.data[key];
+    stored = {std::move(entry), lru_iter};
     shard.memory_bytes += entry_size;
     total_memory_bytes_.fetch_add(entry_size);
     total_entries_.fetch_add(1);
@@ -90,13 +125,97 @@ bool ShardedHashTable::set(const std::string& key, CacheEntry entry) {
     metrics_.entries_count.store(total_entries_.load());
     metrics_.memory_bytes.store(total_memory_bytes_.load());
 
+    if (listener_ && !loaded) {
+        listener_->on_set(key, stored.entry);
+    }
+
     return true;
 }
 
+std::vector<std::optional<CacheEntry>> ShardedHashTable::multi_get(
+    const std::vector<std::string>& keys)
+{
+    std::vector<std::optional<CacheEntry>> results(keys.size());
+    auto order = group_by_shard(keys);
+
+    size_t i = 0;
+    while (i < order.size()) {
+        fault_in(order[i].first);
+        auto& shard = shards_[order[i].first];
+
+        // One write lock per shard (LRU positions are updated on hit)
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        size_t shard_index = order[i].first;
+        for (; i < order.size() && order[i].first == shard_index; ++i) {
+            size_t key_index = order[i].second;
+            results[key_index] = get_locked(shard, keys[key_index]);
+        }
+    }
+
+    return results;
+}
+
+std::vector<bool> ShardedHashTable::multi_set(std::vector<CacheEntry> entries) {
+    std::vector<std::string> keys;
+    keys.reserve(entries.size());
+    for (const auto& entry : entries) {
+        keys.push_back(entry.key);
+    }
+
+    std::vector<bool> results(entries.size(), false);
+    auto order = group_by_shard(keys);
+
+    size_t i = 0;
+    while (i < order.size()) {
+        auto& shard = shards_[order[i].first];
+
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        size_t shard_index = order[i].first;
+        for (; i < order.size() && order[i].first == shard_index; ++i) {
+            size_t key_index = order[i].second;
+            results[key_index] = set_locked(shard, keys[key_index],
+                                            std::move(entries[key_index]));
+        }
+    }
+
+    return results;
+}
+
 bool ShardedHashTable::del(const std::string& key) {
     auto& shard = get_shard(key);
     std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    return del_locked(shard, key);
+}
+
+void ShardedHashTable::discard(const std::string& key) {
+    auto& shard = get_write_shard(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (writes_frozen_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (!del_locked(shard, key) &&
+        shard.load_state.load(std::memory_order_relaxed) != kShardLoaded) {
+        supersede_delete_locked(shard, key);
+    }
+}
+
+void ShardedHashTable::supersede_delete_locked(Shard& shard, const std::string& key) {
+    shard.superseded.insert(key);
 
+    if (track_tombstones_) {
+        shard.tombstones[key] = CacheEntry::get_current_time_ms();
+    }
+
+    // The key may well be in the entries still to come, so log it
+    if (listener_) {
+        listener_->on_delete(key);
+    }
+}
+
+bool ShardedHashTable::del_locked(Shard& shard, const std::string& key) {
+    if (writes_frozen_.load(std::memory_order_relaxed)) {
+        return false;
+    }
     auto it = shard.data.find(key);
     if (it == shard.data.end()) {
         return false;
@@ -113,11 +232,19 @@ bool ShardedHashTable::del(const std::string& key) {
     total_memory_bytes_.fetch_sub(entry_size);
     total_entries_.fetch_sub(1);
 
+    if (track_tombstones_) {
+        shard.tombstones[key] = CacheEntry::get_current_time_ms();
+    }
+
     // Track delete operation
     metrics_.deletes_total.fetch_add(1);
     metrics_.entries_count.store(total_entries_.load());
     metrics_.memory_bytes.store(total_memory_bytes_.load());
 
+    if (listener_) {
+        listener_->on_delete(key);
+    }
+
     return true;
 }
 
@@ -130,6 +257,18 @@ ShardedHashTable::CASResult ShardedHashTable::compare_and_swap(
 
     // CRITICAL: Hold write lock for entire operation (atomic CAS)
     std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    return cas_locked(shard, key, expected_version, std::move(new_entry));
+}
+
+ShardedHashTable::CASResult ShardedHashTable::cas_locked(
+    Shard& shard,
+    const std::string& key,
+    int64_t expected_version,
+    CacheEntry new_entry)
+{
+    if (writes_frozen_.load(std::memory_order_relaxed)) {
+        return CASResult{false, 0, 0, "Writes are frozen"};
+    }
 
     // Check if key exists
     auto it = shard.data.find(key);
@@ -189,7 +328,9 @@ ShardedHashTable::CASResult ShardedHashTable::compare_and_swap(
     metrics_.sets_total.fetch_add(1);
     metrics_.memory_bytes.store(total_memory_bytes_.load());
 
-    // Lock is released here - update was atomic
+    if (listener_) {
+        listener_->on_set(key, it->second.entry);
+    }
 
     return CASResult{
         true,
@@ -199,6 +340,144 @@ ShardedHashTable::CASResult ShardedHashTable::compare_and_swap(
     };
 }
 
+void ShardedHashTable::execute_batch(std::vector<BatchOp>& ops,
+                                     const std::function<void(size_t)>& on_complete)
+{
+    std::vector<std::string> keys;
+    keys.reserve(ops.size());
+    for (const auto& op : ops) {
+        keys.push_back(op.key);
+    }
+
+    auto order = group_by_shard(keys);
+
+    size_t i = 0;
+    while (i < order.size()) {
+        size_t run_start = i;
+        size_t shard_index = order[i].first;
+        fault_in(shard_index);
+        auto& shard = shards_[shard_index];
+
+        {
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            for (; i < order.size() && order[i].first == shard_index; ++i) {
+                auto& op = ops[order[i].second];
+                switch (op.type) {
+                    case BatchOp::Type::GET:
+                        op.found = get_locked(shard, op.key);
+                        op.success = op.found.has_value();
+                        break;
+                    case BatchOp::Type::SET:
+                        op.success = set_locked(shard, op.key, std::move(op.entry));
+                        break;
+                    case BatchOp::Type::DELETE:
+                        op.success = del_locked(shard, op.key);
+                        break;
+                    case BatchOp::Type::CAS:
+                        op.cas = cas_locked(shard, op.key, op.expected_version,
+                                            std::move(op.entry));
+                        op.success = op.cas.success;
+                        break;
+                }
+            }
+        }
+
+        // Report this shard's operations without holding its lock
+        if (on_complete) {
+            for (size_t j = run_start; j < i; ++j) {
+                on_complete(order[j].second);
+            }
+        }
+    }
+}
+
+ShardedHashTable::IncrResult ShardedHashTable::incr_by(const std::string& key,
+                                                      int64_t delta)
+{
+    auto& shard = get_shard(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (writes_frozen_.load(std::memory_order_relaxed)) {
+        return IncrResult{false, 0, "writes are frozen"};
+    }
+
+    auto it = shard.data.find(key);
+    bool live = it != shard.data.end() && !it->second.entry.is_expired();
+
+    int64_t current = 0;
+    if (live) {
+        const auto& bytes = it->second.entry.value;
+        const char* begin = reinterpret_cast<const char*>(bytes.data());
+        const char* end = begin + bytes.size();
+        auto [ptr, ec] = std::from_chars(begin, end, current);
+        if (bytes.empty() || ec != std::errc() || ptr != end) {
+            return IncrResult{false, 0, "value is not an integer or out of range"};
+        }
+    }
+
+    int64_t updated;
+    if (__builtin_add_overflow(current, delta, &updated)) {
+        return IncrResult{false, 0, "increment or decrement would overflow"};
+    }
+
+    std::string text = std::to_string(updated);
+    std::vector<uint8_t> value(text.begin(), text.end());
+
+    if (!live) {
+        set_locked(shard, key, CacheEntry(key, std::move(value)));
+        return IncrResult{true, updated, ""};
+    }
+
+    // Update in place so the TTL and version history carry over
+    auto& entry = it->second.entry;
+    size_t old_size = entry.total_size();
+    entry.value = std::move(value);
+    entry.version += 1;
+    entry.modified_at_ms = CacheEntry::get_current_time_ms();
+    entry.last_accessed_ms.store(entry.modified_at_ms);
+    size_t new_size = entry.total_size();
+
+    shard.lru_list.splice(shard.lru_list.begin(), shard.lru_list, it->second.lru_iter);
+    shard.memory_bytes = shard.memory_bytes - old_size + new_size;
+    total_memory_bytes_.fetch_sub(old_size);
+    total_memory_bytes_.fetch_add(new_size);
+
+    metrics_.sets_total.fetch_add(1);
+    metrics_.memory_bytes.store(total_memory_bytes_.load());
+
+    if (listener_) {
+        listener_->on_set(key, entry);
+    }
+
+    return IncrResult{true, updated, ""};
+}
+
+bool ShardedHashTable::expire(const std::string& key, int32_t ttl_seconds) {
+    auto& shard = get_shard(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (writes_frozen_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    auto it = shard.data.find(key);
+    if (it == shard.data.end() || it->second.entry.is_expired()) {
+        return false;
+    }
+
+    if (ttl_seconds <= 0) {
+        return del_locked(shard, key);
+    }
+
+    auto& entry = it->second.entry;
+    entry.modified_at_ms = CacheEntry::get_current_time_ms();
+    entry.ttl_seconds = ttl_seconds;
+    entry.expires_at_ms = entry.modified_at_ms + static_cast<int64_t>(ttl_seconds) * 1000;
+
+    if (listener_) {
+        listener_->on_set(key, entry);
+    }
+    return true;
+}
+
 bool ShardedHashTable::exists(const std::string& key) {
     auto& shard = get_shard(key);
     std::shared_lock<std::shared_mutex> lock(shard.mutex);
@@ -219,11 +498,114 @@ size_t ShardedHashTable::memory_usage() const {
     return total_memory_bytes_.load();
 }
 
+void ShardedHashTable::drop_tombstones_before(int64_t before_ms) {
+    for (auto& shard : shards_) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        for (auto it = shard.tombstones.begin(); it != shard.tombstones.end();) {
+            if (it->second < before_ms) {
+                it = shard.tombstones.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+size_t ShardedHashTable::tombstone_count() const {
+    size_t count = 0;
+    for (const auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        count += shard.tombstones.size();
+    }
+    return count;
+}
+
+void ShardedHashTable::reserve(size_t expected_entries) {
+    // Keys hash evenly across shards; leave headroom for the skew
+    size_t per_shard = expected_entries / shards_.size();
+    per_shard += per_shard / 8 + 1;
+    for (auto& shard : shards_) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.data.reserve(per_shard);
+    }
+}
+
+void ShardedHashTable::begin_lazy_load(ShardLoader loader) {
+    std::lock_guard<std::mutex> lock(lazy_mutex_);
+    for (auto& shard : shards_) {
+        shard.load_state.store(kShardPending, std::memory_order_relaxed);
+    }
+    lazy_loader_ = std::move(loader);
+    lazy_pending_.store(shards_.size());
+    lazy_loading_.store(!shards_.empty(), std::memory_order_release);
+}
+
+bool ShardedHashTable::load_shard(size_t shard_index) {
+    if (!lazy_loading_.load(std::memory_order_acquire) ||
+        shards_[shard_index].load_state.load(std::memory_order_acquire) == kShardLoaded) {
+        return false;
+    }
+    return load_pending_shard(shard_index, false);
+}
+
+bool ShardedHashTable::load_pending_shard(size_t shard_index, bool on_demand) {
+    auto& shard = shards_[shard_index];
+
+    // Claim the shard, or wait for whoever is loading it
+    std::unique_lock<std::mutex> lazy_lock(lazy_mutex_);
+    lazy_cv_.wait(lazy_lock, [&] {
+        return shard.load_state.load(std::memory_order_relaxed) != kShardLoading;
+    });
+    if (shard.load_state.load(std::memory_order_relaxed) == kShardLoaded) {
+        return false;
+    }
+    shard.load_state.store(kShardLoading, std::memory_order_relaxed);
+    ShardLoader loader = lazy_loader_;
+    lazy_lock.unlock();
+
+    // Decode without holding any lock, so the shard's writes keep flowing
+    auto entries = loader(shard_index, on_demand);
+
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        for (auto& entry : entries) {
+            if (shard.superseded.count(entry.key) || entry.is_expired()) {
+                continue;
+            }
+            std::string key = entry.key;
+            set_locked(shard, key, std::move(entry), true);
+        }
+        shard.superseded = {};
+
+        // Flipped under the shard lock so no write can slip in between
+        shard.load_state.store(kShardLoaded, std::memory_order_release);
+    }
+
+    lazy_lock.lock();
+    if (lazy_pending_.fetch_sub(1) == 1) {
+        lazy_loading_.store(false, std::memory_order_release);
+        lazy_loader_ = nullptr;  // Release whatever the loader holds (e.g. mappings)
+    }
+    lazy_lock.unlock();
+    lazy_cv_.notify_all();
+    return true;
+}
+
+void ShardedHashTable::freeze_writes() {
+    writes_frozen_.store(true);
+
+    // A writer that saw the flag clear still holds its shard lock
+    for (auto& shard : shards_) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    }
+}
+
 void ShardedHashTable::clear() {
     for (auto& shard : shards_) {
         std::unique_lock<std::shared_mutex> lock(shard.mutex);
         shard.data.clear();
         shard.lru_list.clear();
+        shard.tombstones.clear();
         shard.memory_bytes = 0;
     }
     total_memory_bytes_.store(0);
@@ -234,7 +616,27 @@ size_t ShardedHashTable::get_shard_index(const std::string& key) const {
     return std::hash<std::string>{}(key) % shards_.size();
 }
 
+std::vector<std::pair<size_t, size_t>> ShardedHashTable::group_by_shard(
+    const std::vector<std::string>& keys) const
+{
+    std::vector<std::pair<size_t, size_t>> order;
+    order.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        order.emplace_back(get_shard_index(keys[i]), i);
+    }
+
+    // Sorting (shard, index) pairs keeps request order within each shard
+    std::sort(order.begin(), order.end());
+    return order;
+}
+
 ShardedHashTable::Shard& ShardedHashTable::get_shard(const std::string& key) {
+    size_t shard_index = get_shard_index(key);
+    fault_in(shard_index);
+    return shards_[shard_index];
+}
+
+ShardedHashTable::Shard& ShardedHashTable::get_write_shard(const std::string& key) {
     return shards_[get_shard_index(key)];
 }
 
@@ -0,0 +1,190 @@
+#include "distcache/pipeline_stream.h"
+
+namespace distcache {
+
+PipelineStream::PipelineStream(v1::CacheService::Stub* stub, size_t max_in_flight)
+    : max_in_flight_(max_in_flight > 0 ? max_in_flight : 1) {
+
+    stream_ = stub->Pipeline(&context_);
+    reader_ = std::thread(&PipelineStream::ReadLoop, this);
+    watchdog_ = std::thread(&PipelineStream::WatchdogLoop, this);
+}
+
+PipelineStream::~PipelineStream() {
+    {
+        std::lock_guard<std::timed_mutex> lock(write_mutex_);
+        if (!writes_done_) {
+            writes_done_ = true;
+            stream_->WritesDone();
+        }
+    }
+
+    // Anything still outstanding after half-close will not be answered
+    // quickly enough to be useful; cancel so the reader unblocks
+    if (InFlight() > 0) {
+        context_.TryCancel();
+    }
+
+    if (reader_.joinable()) {
+        reader_.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(watchdog_mutex_);
+        stopping_ = true;
+    }
+    watchdog_cv_.notify_all();
+    if (watchdog_.joinable()) {
+        watchdog_.join();
+    }
+}
+
+grpc::Status PipelineStream::Call(v1::PipelineRequest request,
+                                  v1::PipelineResponse* response,
+                                  std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    auto call = std::make_shared<PendingCall>();
+    uint64_t tag;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        // Flow control: wait for an in-flight slot
+        bool has_slot = cv_.wait_until(lock, deadline, [this] {
+            return broken_.load() || pending_.size() < max_in_flight_;
+        });
+        if (broken_.load()) {
+            return grpc::Status(grpc::UNAVAILABLE, "Pipeline stream is broken");
+        }
+        if (!has_slot) {
+            return grpc::Status(grpc::DEADLINE_EXCEEDED, "Pipeline in-flight limit reached");
+        }
+
+        tag = next_tag_++;
+        pending_[tag] = call;
+    }
+
+    request.set_tag(tag);
+
+    // Writes are serialized; one blocked by a server that stopped reading
+    // is bounded by its op's deadline, after which the watchdog cancels
+    // the stream
+    bool written = false;
+    {
+        std::unique_lock<std::timed_mutex> write_lock(write_mutex_, deadline);
+        if (write_lock.owns_lock() && !writes_done_) {
+            {
+                std::lock_guard<std::mutex> watch(watchdog_mutex_);
+                write_deadline_ = deadline;
+                write_generation_++;
+            }
+            watchdog_cv_.notify_all();
+            written = stream_->Write(request);
+            {
+                std::lock_guard<std::mutex> watch(watchdog_mutex_);
+                write_generation_++;
+            }
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!written) {
+        // Never sent, so the slot is free again
+        pending_.erase(tag);
+        cv_.notify_all();
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return grpc::Status(grpc::DEADLINE_EXCEEDED, "Pipeline write timed out");
+        }
+        return grpc::Status(grpc::UNAVAILABLE, "Pipeline stream write failed");
+    }
+
+    if (!cv_.wait_until(lock, deadline, [&call] { return call->done; })) {
+        // Give up on this op. The server is still working on it, so it
+        // keeps its slot until the response arrives and is dropped
+        call->abandoned = true;
+        return grpc::Status(grpc::DEADLINE_EXCEEDED, "Pipeline op timed out");
+    }
+
+    if (call->status.ok()) {
+        *response = std::move(call->response);
+    }
+    return call->status;
+}
+
+size_t PipelineStream::InFlight() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+}
+
+void PipelineStream::ReadLoop() {
+    v1::PipelineResponse response;
+    while (stream_->Read(&response)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = pending_.find(response.tag());
+        if (it == pending_.end()) {
+            continue;
+        }
+
+        auto call = it->second;
+        pending_.erase(it);
+        if (call->abandoned) {
+            cv_.notify_all();  // Caller already timed out; only its slot frees up
+            response.Clear();
+            continue;
+        }
+
+        if (response.status_code() != grpc::OK) {
+            call->status = grpc::Status(
+                static_cast<grpc::StatusCode>(response.status_code()),
+                response.status_message());
+        } else {
+            call->response = std::move(response);
+        }
+        call->done = true;
+        cv_.notify_all();
+
+        response.Clear();
+    }
+
+    grpc::Status status = stream_->Finish();
+    FailAll(status.ok()
+        ? grpc::Status(grpc::UNAVAILABLE, "Pipeline stream closed")
+        : status);
+}
+
+void PipelineStream::WatchdogLoop() {
+    std::unique_lock<std::mutex> lock(watchdog_mutex_);
+    while (!stopping_) {
+        if (write_generation_ % 2 == 0) {
+            watchdog_cv_.wait(lock);
+            continue;
+        }
+
+        uint64_t generation = write_generation_;
+        if (watchdog_cv_.wait_until(lock, write_deadline_, [&] {
+                return stopping_ || write_generation_ != generation;
+            })) {
+            continue;
+        }
+
+        // The write is stuck past its deadline; only cancelling the
+        // stream unblocks it, and callers move on to a new stream
+        context_.TryCancel();
+        watchdog_cv_.wait(lock, [&] { return stopping_ || write_generation_ != generation; });
+    }
+}
+
+void PipelineStream::FailAll(const grpc::Status& status) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    broken_.store(true);
+
+    for (auto& [tag, call] : pending_) {
+        call->status = status;
+        call->done = true;
+    }
+    pending_.clear();
+    cv_.notify_all();
+}
+
+} // namespace distcache
@@ -1,5 +1,7 @@
 #include "distcache/sharding_client.h"
+#include "distcache/pipeline_stream.h"
 #include <chrono>
+#include <future>
 #include <thread>
 
 namespace distcache {
@@ -55,6 +57,25 @@ ShardingClient::Connection* ShardingClient::GetConnection(const Node& node) {
     return nullptr;
 }
 
+grpc::Status ShardingClient::PipelineCall(Connection* conn,
+                                          v1::PipelineRequest request,
+                                          v1::PipelineResponse* response) {
+    std::shared_ptr<PipelineStream> pipeline;
+    {
+        std::lock_guard<std::mutex> lock(conn->pipeline_mutex);
+
+        // Open lazily, and replace a stream that has failed
+        if (!conn->pipeline || conn->pipeline->IsBroken()) {
+            conn->pipeline = std::make_shared<PipelineStream>(
+                conn->stub.get(), config_.pipeline_max_in_flight);
+        }
+        pipeline = conn->pipeline;
+    }
+
+    return pipeline->Call(std::move(request), response,
+                          std::chrono::milliseconds(config_.rpc_timeout_ms));
+}
+
 void ShardingClient::RecordRequest(const std::string& node_id) {
     std::lock_guard<std::mutex> lock(mutex_);
     request_stats_[node_id]++;
@@ -109,6 +130,270 @@ OperationResult<bool> ShardingClient::CompareAndSwap(const std::string& key,
     return ExecuteCAS(key, expected_version, new_value, ttl_seconds, replicas);
 }
 
+std::vector<OperationResult<std::string>> ShardingClient::BatchGet(
+    const std::vector<std::string>& keys) {
+
+    std::vector<OperationResult<std::string>> results(keys.size());
+    if (keys.empty()) {
+        return results;
+    }
+
+    if (ring_->node_count() == 0) {
+        for (auto& result : results) {
+            result = OperationResult<std::string>::Error("No nodes available");
+        }
+        return results;
+    }
+
+    auto groups = GroupByOwner(keys);
+
+    // One task per owning node; each fills its own slots in results
+    auto run_group = [this, &keys, &results](const Node& node,
+                                             const std::vector<size_t>& indices) {
+        std::vector<std::string> node_keys;
+        node_keys.reserve(indices.size());
+        for (size_t index : indices) {
+            node_keys.push_back(keys[index]);
+        }
+
+        std::vector<OperationResult<std::string>> node_results;
+        if (ExecuteBatchGet(node, node_keys, node_results)) {
+            for (size_t i = 0; i < indices.size(); ++i) {
+                results[indices[i]] = std::move(node_results[i]);
+            }
+            return;
+        }
+
+        // Batch failed on the primary: fall back to per-key Get with failover
+        for (size_t index : indices) {
+            results[index] = Get(keys[index]);
+        }
+    };
+
+    std::vector<std::future<void>> pending;
+    pending.reserve(groups.size());
+    for (const auto& [node_id, group] : groups) {
+        const Node& node = group.first;
+        const std::vector<size_t>& indices = group.second;
+        if (groups.size() == 1) {
+            run_group(node, indices);
+        } else {
+            pending.push_back(std::async(std::launch::async, run_group,
+                                         std::cref(node), std::cref(indices)));
+        }
+    }
+
+    for (auto& task : pending) {
+        task.get();
+    }
+
+    return results;
+}
+
+std::vector<OperationResult<bool>> ShardingClient::BatchSet(
+    const std::vector<BatchSetItem>& items) {
+
+    std::vector<OperationResult<bool>> results(items.size());
+    if (items.empty()) {
+        return results;
+    }
+
+    if (ring_->node_count() == 0) {
+        for (auto& result : results) {
+            result = OperationResult<bool>::Error("No nodes available");
+        }
+        return results;
+    }
+
+    std::vector<std::string> keys;
+    keys.reserve(items.size());
+    for (const auto& item : items) {
+        keys.push_back(item.key);
+    }
+
+    auto groups = GroupByOwner(keys);
+
+    auto run_group = [this, &items, &results](const Node& node,
+                                              const std::vector<size_t>& indices) {
+        std::vector<const BatchSetItem*> node_items;
+        node_items.reserve(indices.size());
+        for (size_t index : indices) {
+            node_items.push_back(&items[index]);
+        }
+
+        std::vector<OperationResult<bool>> node_results;
+        if (ExecuteBatchSet(node, node_items, node_results)) {
+            for (size_t i = 0; i < indices.size(); ++i) {
+                results[indices[i]] = std::move(node_results[i]);
+            }
+            return;
+        }
+
+        // Batch failed on the primary: fall back to per-key Set with failover
+        for (size_t index : indices) {
+            const auto& item = items[index];
+            results[index] = Set(item.key, item.value, item.ttl_seconds);
+        }
+    };
+
+    std::vector<std::future<void>> pending;
+    pending.reserve(groups.size());
+    for (const auto& [node_id, group] : groups) {
+        const Node& node = group.first;
+        const std::vector<size_t>& indices = group.second;
+        if (groups.size() == 1) {
+            run_group(node, indices);
+        } else {
+            pending.push_back(std::async(std::launch::async, run_group,
+                                         std::cref(node), std::cref(indices)));
+        }
+    }
+
+    for (auto& task : pending) {
+        task.get();
+    }
+
+    return results;
+}
+
+std::unordered_map<std::string, std::pair<Node, std::vector<size_t>>>
+ShardingClient::GroupByOwner(const std::vector<std::string>& keys) const {
+    std::unordered_map<std::string, std::pair<Node, std::vector<size_t>>> groups;
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto node = ring_->get_node(keys[i]);
+        if (!node) {
+            continue;
+        }
+
+        auto& group = groups[node->id];
+        if (group.second.empty()) {
+            group.first = *node;
+        }
+        group.second.push_back(i);
+    }
+
+    return groups;
+}
+
+bool ShardingClient::ExecuteBatchGet(
+    const Node& node,
+    const std::vector<std::string>& keys,
+    std::vector<OperationResult<std::string>>& results) {
+
+    Connection* conn = GetConnection(node);
+    if (!conn) {
+        return false;
+    }
+
+    v1::BatchGetRequest request;
+    for (const auto& key : keys) {
+        request.add_keys(key);
+    }
+
+    // Try multiple times on this node
+    for (size_t attempt = 0; attempt < config_.retry_attempts; ++attempt) {
+        v1::BatchGetResponse response;
+        grpc::ClientContext context;
+
+        // Set deadline
+        auto deadline = std::chrono::system_clock::now() +
+                      std::chrono::milliseconds(config_.rpc_timeout_ms);
+        context.set_deadline(deadline);
+
+        grpc::Status status = conn->stub->BatchGet(&context, request, &response);
+
+        if (status.ok() && response.entries_size() == static_cast<int>(keys.size())) {
+            RecordRequest(node.id);
+
+            results.clear();
+            results.reserve(keys.size());
+            for (const auto& entry : response.entries()) {
+                if (entry.found()) {
+                    auto result = OperationResult<std::string>::Success(entry.value(), node.id);
+                    result.version = entry.version();
+                    results.push_back(std::move(result));
+                } else if (!entry.error().empty()) {
+                    results.push_back(OperationResult<std::string>::Error(entry.error()));
+                } else {
+                    // Key not found is a valid response (not an error)
+                    results.push_back(OperationResult<std::string>::Error("Key not found"));
+                }
+            }
+            return true;
+        }
+
+        // Exponential backoff before retry
+        if (attempt < config_.retry_attempts - 1) {
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(50 * (1 << attempt))
+            );
+        }
+    }
+
+    return false;
+}
+
+bool ShardingClient::ExecuteBatchSet(
+    const Node& node,
+    const std::vector<const BatchSetItem*>& items,
+    std::vector<OperationResult<bool>>& results) {
+
+    Connection* conn = GetConnection(node);
+    if (!conn) {
+        return false;
+    }
+
+    v1::BatchSetRequest request;
+    for (const auto* item : items) {
+        auto* entry = request.add_entries();
+        entry->set_key(item->key);
+        entry->set_value(item->value);
+        if (item->ttl_seconds.has_value()) {
+            entry->set_ttl_seconds(*item->ttl_seconds);
+        }
+    }
+
+    // Try multiple times on this node
+    for (size_t attempt = 0; attempt < config_.retry_attempts; ++attempt) {
+        v1::BatchSetResponse response;
+        grpc::ClientContext context;
+
+        // Set deadline
+        auto deadline = std::chrono::system_clock::now() +
+                      std::chrono::milliseconds(config_.rpc_timeout_ms);
+        context.set_deadline(deadline);
+
+        grpc::Status status = conn->stub->BatchSet(&context, request, &response);
+
+        if (status.ok() && response.results_size() == static_cast<int>(items.size())) {
+            RecordRequest(node.id);
+
+            results.clear();
+            results.reserve(items.size());
+            for (const auto& entry : response.results()) {
+                if (entry.success()) {
+                    auto result = OperationResult<bool>::Success(true, node.id);
+                    result.version = entry.version();
+                    results.push_back(std::move(result));
+                } else {
+                    results.push_back(OperationResult<bool>::Error("Set failed: " + entry.error()));
+                }
+            }
+            return true;
+        }
+
+        // Exponential backoff before retry
+        if (attempt < config_.retry_attempts - 1) {
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(50 * (1 << attempt))
+            );
+        }
+    }
+
+    return false;
+}
+
 OperationResult<std::string> ShardingClient::ExecuteGet(
     const std::string& key,
     const std::vector<Node>& replicas) {
@@ -136,14 +421,23 @@ OperationResult<std::string> ShardingClient::ExecuteGet(
                           std::chrono::milliseconds(config_.rpc_timeout_ms);
             context.set_deadline(deadline);
 
-            grpc::Status status = conn->stub->Get(&context, request, &response);
+            grpc::Status status;
+            if (config_.enable_pipelining) {
+                v1::PipelineRequest op;
+                *op.mutable_get() = std::move(request);
+                v1::PipelineResponse result;
+                status = PipelineCall(conn, std::move(op), &result);
+                response.Swap(result.mutable_get());
+            } else {
+                status = conn->stub->Get(&context, request, &response);
+            }
 
             if (status.ok()) {
                 RecordRequest(node.id);
 
                 if (response.found()) {
-                    std::string value(response.value().begin(), response.value().end());
-                    auto result = OperationResult<std::string>::Success(value, node.id);
+                    auto result = OperationResult<std::string>::Success(
+                        std::move(*response.mutable_value()), node.id);
 
                     // Phase 2.8: Populate consistency metadata
                     result.version = response.version();
@@ -183,6 +477,15 @@ OperationResult<bool> ShardingClient::ExecuteSet(
 
     std::string last_error;
 
+    // Build the request once; retries and failover reuse it instead of
+    // copying the value again
+    v1::SetRequest request;
+    request.set_key(key);
+    request.set_value(value);
+    if (ttl_seconds.has_value()) {
+        request.set_ttl_seconds(*ttl_seconds);
+    }
+
     // Try each replica in order
     for (const auto& node : replicas) {
         Connection* conn = GetConnection(node);
@@ -193,13 +496,6 @@ OperationResult<bool> ShardingClient::ExecuteSet(
 
         // Try multiple times on this node
         for (size_t attempt = 0; attempt < config_.retry_attempts; ++attempt) {
-            v1::SetRequest request;
-            request.set_key(key);
-            request.set_value(value);
-            if (ttl_seconds.has_value()) {
-                request.set_ttl_seconds(*ttl_seconds);
-            }
-
             v1::SetResponse response;
             grpc::ClientContext context;
 
@@ -208,7 +504,16 @@ OperationResult<bool> ShardingClient::ExecuteSet(
                           std::chrono::milliseconds(config_.rpc_timeout_ms);
             context.set_deadline(deadline);
 
-            grpc::Status status = conn->stub->Set(&context, request, &response);
+            grpc::Status status;
+            if (config_.enable_pipelining) {
+                v1::PipelineRequest op;
+                *op.mutable_set() = request;
+                v1::PipelineResponse result;
+                status = PipelineCall(conn, std::move(op), &result);
+                response.Swap(result.mutable_set());
+            } else {
+                status = conn->stub->Set(&context, request, &response);
+            }
 
             if (status.ok() && response.success()) {
                 RecordRequest(node.id);
@@ -268,7 +573,16 @@ OperationResult<bool> ShardingClient::ExecuteDelete(
                           std::chrono::milliseconds(config_.rpc_timeout_ms);
             context.set_deadline(deadline);
 
-            grpc::Status status = conn->stub->Delete(&context, request, &response);
+            grpc::Status status;
+            if (config_.enable_pipelining) {
+                v1::PipelineRequest op;
+                *op.mutable_delete_() = std::move(request);
+                v1::PipelineResponse result;
+                status = PipelineCall(conn, std::move(op), &result);
+                response.Swap(result.mutable_delete_());
+            } else {
+                status = conn->stub->Delete(&context, request, &response);
+            }
 
             if (status.ok() && response.success()) {
                 RecordRequest(node.id);
@@ -330,7 +644,16 @@ OperationResult<bool> ShardingClient::ExecuteCAS(
                           std::chrono::milliseconds(config_.rpc_timeout_ms);
             context.set_deadline(deadline);
 
-            grpc::Status status = conn->stub->CompareAndSwap(&context, request, &response);
+            grpc::Status status;
+            if (config_.enable_pipelining) {
+                v1::PipelineRequest op;
+                *op.mutable_cas() = std::move(request);
+                v1::PipelineResponse result;
+                status = PipelineCall(conn, std::move(op), &result);
+                response.Swap(result.mutable_cas());
+            } else {
+                status = conn->stub->CompareAndSwap(&context, request, &response);
+            }
 
             if (status.ok() && response.success()) {
                 RecordRequest(node.id);
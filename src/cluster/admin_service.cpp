@@ -22,6 +22,11 @@ void AdminServiceImpl::set_hash_rings(const HashRing* old_ring, const HashRing*
     LOG_INFO("Hash rings configured for rebalancing");
 }
 
+void AdminServiceImpl::set_io_scheduler(std::shared_ptr<IoScheduler> scheduler) {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    io_scheduler_ = std::move(scheduler);
+}
+
 grpc::Status AdminServiceImpl::Rebalance(grpc::ServerContext* context,
                                         const distcache::v1::RebalanceRequest* request,
                                         distcache::v1::RebalanceResponse* response) {
@@ -229,6 +234,40 @@ grpc::Status AdminServiceImpl::GetMetrics(grpc::ServerContext* context,
         memory_metric->set_name("memory_bytes");
         memory_metric->set_value(metrics.memory_bytes.load());
 
+        // Add background I/O budget metrics if a scheduler is attached
+        std::shared_ptr<IoScheduler> scheduler;
+        {
+            std::lock_guard<std::mutex> lock(io_mutex_);
+            scheduler = io_scheduler_;
+        }
+        if (scheduler) {
+            auto io = scheduler->GetStats();
+
+            auto* io_rate_metric = response->add_metrics();
+            io_rate_metric->set_name("io_effective_bytes_per_second");
+            io_rate_metric->set_value(io.effective_bytes_per_second);
+
+            auto* io_granted_metric = response->add_metrics();
+            io_granted_metric->set_name("io_background_bytes_total");
+            io_granted_metric->set_value(io.bytes_granted);
+
+            auto* io_throttled_metric = response->add_metrics();
+            io_throttled_metric->set_name("io_throttled_seconds_total");
+            io_throttled_metric->set_value(io.throttled_us / 1e6);
+
+            auto* io_waits_metric = response->add_metrics();
+            io_waits_metric->set_name("io_throttled_requests_total");
+            io_waits_metric->set_value(io.throttled_requests);
+
+            auto* io_backoffs_metric = response->add_metrics();
+            io_backoffs_metric->set_name("io_backoffs_total");
+            io_backoffs_metric->set_value(io.backoffs);
+
+            auto* io_p99_metric = response->add_metrics();
+            io_p99_metric->set_name("io_foreground_p99_us");
+            io_p99_metric->set_value(io.foreground_p99_us);
+        }
+
         // Add rebalancing metrics if orchestrator exists
         if (orchestrator_) {
             auto stats = orchestrator_->get_statistics();
@@ -262,6 +301,68 @@ grpc::Status AdminServiceImpl::GetMetrics(grpc::ServerContext* context,
     }
 }
 
+grpc::Status AdminServiceImpl::GetIoThrottle(grpc::ServerContext* context,
+                                            const distcache::v1::GetIoThrottleRequest* request,
+                                            distcache::v1::IoThrottleResponse* response) {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    if (!io_scheduler_) {
+        response->set_success(false);
+        response->set_error("I/O scheduler not configured");
+        return grpc::Status::OK;
+    }
+
+    fill_io_throttle(*io_scheduler_, response);
+    response->set_success(true);
+    return grpc::Status::OK;
+}
+
+grpc::Status AdminServiceImpl::SetIoThrottle(grpc::ServerContext* context,
+                                            const distcache::v1::SetIoThrottleRequest* request,
+                                            distcache::v1::IoThrottleResponse* response) {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    if (!io_scheduler_) {
+        response->set_success(false);
+        response->set_error("I/O scheduler not configured");
+        LOG_ERROR("SetIoThrottle failed: I/O scheduler not configured");
+        return grpc::Status::OK;
+    }
+
+    if ((request->has_bytes_per_second() && request->bytes_per_second() < 0) ||
+        (request->has_burst_bytes() && request->burst_bytes() <= 0) ||
+        (request->has_foreground_p99_target_us() && request->foreground_p99_target_us() <= 0) ||
+        (request->has_min_bytes_per_second() && request->min_bytes_per_second() <= 0)) {
+        response->set_success(false);
+        response->set_error("Invalid I/O throttle settings");
+        fill_io_throttle(*io_scheduler_, response);
+        return grpc::Status::OK;
+    }
+
+    auto config = io_scheduler_->GetConfig();
+    if (request->has_bytes_per_second()) {
+        config.bytes_per_second = static_cast<uint64_t>(request->bytes_per_second());
+    }
+    if (request->has_burst_bytes()) {
+        config.burst_bytes = static_cast<uint64_t>(request->burst_bytes());
+    }
+    if (request->has_adaptive()) {
+        config.adaptive = request->adaptive();
+    }
+    if (request->has_foreground_p99_target_us()) {
+        config.foreground_p99_target_us = static_cast<uint64_t>(request->foreground_p99_target_us());
+    }
+    if (request->has_min_bytes_per_second()) {
+        config.min_bytes_per_second = static_cast<uint64_t>(request->min_bytes_per_second());
+    }
+    io_scheduler_->Reconfigure(config);
+    LOG_INFO("I/O throttle set: {} bytes/s (0 = unlimited), burst {} bytes, adaptive={}, "
+             "p99 target {}us", config.bytes_per_second, config.burst_bytes, config.adaptive,
+             config.foreground_p99_target_us);
+
+    fill_io_throttle(*io_scheduler_, response);
+    response->set_success(true);
+    return grpc::Status::OK;
+}
+
 void AdminServiceImpl::set_state(NodeState state) {
     std::lock_guard<std::mutex> lock(state_mutex_);
     state_ = state;
@@ -302,6 +403,23 @@ AdminServiceImpl::get_cluster_status() const {
     return nodes;
 }
 
+void AdminServiceImpl::fill_io_throttle(const IoScheduler& scheduler,
+                                        distcache::v1::IoThrottleResponse* response) {
+    auto config = scheduler.GetConfig();
+    auto stats = scheduler.GetStats();
+    response->set_bytes_per_second(config.bytes_per_second);
+    response->set_effective_bytes_per_second(stats.effective_bytes_per_second);
+    response->set_burst_bytes(config.burst_bytes);
+    response->set_adaptive(config.adaptive);
+    response->set_foreground_p99_target_us(config.foreground_p99_target_us);
+    response->set_min_bytes_per_second(config.min_bytes_per_second);
+    response->set_bytes_granted(stats.bytes_granted);
+    response->set_throttled_requests(stats.throttled_requests);
+    response->set_throttled_ms(stats.throttled_us / 1000);
+    response->set_backoffs(stats.backoffs);
+    response->set_foreground_p99_us(stats.foreground_p99_us);
+}
+
 // Helper functions
 
 std::string node_state_to_string(NodeState state) {
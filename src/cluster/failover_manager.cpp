@@ -1,10 +1,104 @@
 #include "distcache/failover_manager.h"
 #include "distcache/logger.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <sstream>
 #include <iomanip>
+#include <thread>
+#include <unordered_set>
 
 namespace distcache {
 
+namespace {
+
+constexpr size_t kBootstrapTailBatch = 1024;  // Log records per read
+
+// Applies shipped snapshot chunks on worker threads as they arrive. The
+// chunks of one file hold distinct keys and may land in any order;
+// Drain() is the barrier between files
+class ChunkApplier {
+public:
+    ChunkApplier(ShardedHashTable& storage, size_t threads)
+        : storage_(storage), max_queued_(2 * threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this] { Run(); });
+        }
+    }
+
+    ~ChunkApplier() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    // Queue a chunk, waiting while the workers are behind
+    void Add(std::string data, uint32_t checksum) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return queue_.size() < max_queued_; });
+        queue_.emplace_back(std::move(data), checksum);
+        cv_.notify_all();
+    }
+
+    // Wait until every queued chunk is applied; false if one was corrupt
+    bool Drain() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return queue_.empty() && active_ == 0; });
+        return !failed_;
+    }
+
+    size_t keys() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return keys_;
+    }
+
+private:
+    void Run() {
+        while (true) {
+            std::pair<std::string, uint32_t> chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    return;
+                }
+                chunk = std::move(queue_.front());
+                queue_.pop_front();
+                active_++;
+            }
+            cv_.notify_all();
+
+            size_t applied = 0;
+            bool ok = SnapshotManager::ApplyShippedChunk(storage_, chunk.first, chunk.second,
+                                                         applied);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            active_--;
+            keys_ += applied;
+            failed_ = failed_ || !ok;
+            cv_.notify_all();
+        }
+    }
+
+    ShardedHashTable& storage_;
+    const size_t max_queued_;
+    std::vector<std::thread> workers_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::pair<std::string, uint32_t>> queue_;
+    size_t active_ = 0;
+    size_t keys_ = 0;
+    bool failed_ = false;
+    bool stopping_ = false;
+};
+
+} // namespace
+
 // FailoverInfo copy constructor
 FailoverManager::FailoverInfo::FailoverInfo(const FailoverInfo& other)
     : failover_id(other.failover_id),
@@ -245,6 +339,131 @@ void FailoverManager::SetFailoverCallback(FailoverCallback callback) {
     callback_ = std::move(callback);
 }
 
+FailoverManager::BootstrapResult FailoverManager::BootstrapFromPeer(
+    const std::string& donor_address) {
+    auto start_time = std::chrono::steady_clock::now();
+    BootstrapResult result;
+
+    auto ranges = ring_->get_owned_ranges(config_.node_id, config_.replication_factor);
+    if (ranges.empty()) {
+        LOG_INFO("Node {} is not in the ring yet, bootstrapping every key", config_.node_id);
+    }
+    LOG_INFO("Bootstrapping from {} ({} ring ranges)", donor_address, ranges.size());
+
+    v1::BootstrapRequest request;
+    request.set_node_id(config_.node_id);
+    for (const auto& range : ranges) {
+        auto* proto_range = request.add_ranges();
+        proto_range->set_first(range.first);
+        proto_range->set_last(range.last);
+    }
+
+    // A chunk can be larger than gRPC's default 4MB message limit
+    grpc::ChannelArguments args;
+    args.SetMaxReceiveMessageSize(-1);
+    auto channel = grpc::CreateCustomChannel(donor_address, grpc::InsecureChannelCredentials(),
+                                             args);
+    auto stub = v1::FailoverService::NewStub(channel);
+    grpc::ClientContext context;
+    auto reader = stub->RequestSnapshotBootstrap(&context, request);
+
+    size_t threads = config_.bootstrap_apply_threads;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    ChunkApplier applier(*storage_, threads);
+
+    int32_t file_index = 0;
+    bool snapshot_done = false;
+    bool stream_done = false;
+    v1::BootstrapMessage message;
+    while (reader->Read(&message)) {
+        result.bytes_received += message.ByteSizeLong();
+
+        if (message.has_chunk()) {
+            auto* chunk = message.mutable_chunk();
+            // Every chunk of a file lands before the next file's
+            if (chunk->file_index() != file_index || chunk->is_final()) {
+                if (!applier.Drain()) {
+                    break;
+                }
+                file_index = chunk->file_index();
+            }
+            if (chunk->is_final()) {
+                result.snapshot_id = chunk->metadata().snapshot_id();
+                result.last_sequence = chunk->metadata().wal_sequence();
+                snapshot_done = true;
+                continue;
+            }
+            uint32_t checksum = chunk->checksum();
+            applier.Add(std::move(*chunk->mutable_data()), checksum);
+            result.snapshot_chunks++;
+            continue;
+        }
+
+        if (message.payload_case() == v1::BootstrapMessage::kEndSequence) {
+            result.last_sequence = message.end_sequence();
+            stream_done = true;
+            continue;
+        }
+        if (!message.has_entry()) {
+            continue;
+        }
+        const auto& entry = message.entry();
+        if (!snapshot_done) {
+            result.error = "Log entry received before the snapshot completed";
+            break;
+        }
+        if (entry.is_deleted()) {
+            storage_->del(entry.key());
+        } else {
+            CacheEntry cache_entry;
+            cache_entry.value.assign(entry.value().begin(), entry.value().end());
+            if (entry.ttl_seconds() > 0) {
+                cache_entry.ttl_seconds = entry.ttl_seconds();
+            }
+            cache_entry.version = entry.version();
+            cache_entry.created_at_ms = CacheEntry::get_current_time_ms();
+            cache_entry.modified_at_ms = cache_entry.created_at_ms;
+            cache_entry.last_accessed_ms.store(cache_entry.created_at_ms);
+            storage_->set(entry.key(), std::move(cache_entry));
+        }
+        result.tail_entries++;
+        result.last_sequence = entry.sequence();
+    }
+
+    bool applied = applier.Drain();
+    if (!applied && result.error.empty()) {
+        result.error = "Received a corrupt snapshot chunk";
+    }
+    if (!result.error.empty()) {
+        context.TryCancel();
+    }
+    grpc::Status status = reader->Finish();
+    if (result.error.empty() && !status.ok()) {
+        result.error = status.error_message();
+    }
+    if (result.error.empty() && !stream_done) {
+        result.error = "Stream ended before the bootstrap completed";
+    }
+
+    result.snapshot_keys = applier.keys();
+    result.success = result.error.empty();
+    result.duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+
+    if (result.success) {
+        LOG_INFO("Bootstrapped from {}: snapshot {} ({} chunks, {} keys), {} log entries "
+                 "to sequence {}, {} bytes in {}ms",
+                 donor_address, result.snapshot_id, result.snapshot_chunks,
+                 result.snapshot_keys, result.tail_entries, result.last_sequence,
+                 result.bytes_received, result.duration_ms);
+    } else {
+        LOG_ERROR("Bootstrap from {} failed: {}", donor_address, result.error);
+    }
+    return result;
+}
+
 FailoverManager::Stats FailoverManager::GetStats() const {
     std::lock_guard<std::mutex> lock(failovers_mutex_);
 
@@ -290,8 +509,14 @@ std::string FailoverManager::GenerateFailoverId() {
 
 FailoverServiceImpl::FailoverServiceImpl(std::shared_ptr<FailoverManager> manager,
                                           std::shared_ptr<ShardedHashTable> storage,
-                                          std::shared_ptr<Metrics> metrics)
-    : manager_(manager), storage_(storage), metrics_(metrics) {}
+                                          std::shared_ptr<Metrics> metrics,
+                                          std::shared_ptr<SnapshotManager> snapshots,
+                                          std::shared_ptr<CommitLog> commit_log)
+    : manager_(manager),
+      storage_(storage),
+      metrics_(metrics),
+      snapshots_(std::move(snapshots)),
+      commit_log_(std::move(commit_log)) {}
 
 grpc::Status FailoverServiceImpl::InitiateFailover(grpc::ServerContext* context,
                                                      const v1::FailoverRequest* request,
@@ -326,18 +551,12 @@ grpc::Status FailoverServiceImpl::RequestCatchup(grpc::ServerContext* context,
 
     // Iterate over all keys owned by this node and stream them to the requester
     size_t keys_sent = 0;
+    std::unordered_set<std::string> keys_owned(request->keys_owned().begin(),
+                                               request->keys_owned().end());
 
     storage_->for_each([&](const std::string& key, const CacheEntry& entry) {
         // Check if this key should be sent (belongs to requesting node)
-        bool should_send = false;
-        for (const auto& owned_key : request->keys_owned()) {
-            if (key == owned_key) {
-                should_send = true;
-                break;
-            }
-        }
-
-        if (should_send || request->keys_owned().empty()) {
+        if (keys_owned.empty() || keys_owned.count(key) > 0) {
             v1::CatchupEntry catchup_entry;
             catchup_entry.set_key(key);
 
@@ -365,6 +584,149 @@ grpc::Status FailoverServiceImpl::RequestCatchup(grpc::ServerContext* context,
     return grpc::Status::OK;
 }
 
+grpc::Status FailoverServiceImpl::RequestSnapshotBootstrap(
+    grpc::ServerContext* context,
+    const v1::BootstrapRequest* request,
+    grpc::ServerWriter<v1::BootstrapMessage>* writer) {
+    LOG_INFO("Snapshot bootstrap request from node: {}", request->node_id());
+
+    if (!snapshots_) {
+        return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                            "Snapshots are not enabled on this node");
+    }
+    // Without the log the writes since the snapshot cannot be sent, and
+    // the joiner would be told it is current when it is not
+    if (!commit_log_) {
+        return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                            "No commit log to send the writes after the snapshot");
+    }
+    auto snapshots = snapshots_->ListSnapshots();
+    auto latest = std::max_element(snapshots.begin(), snapshots.end(),
+                                   [](const SnapshotManager::SnapshotMetadata& a,
+                                      const SnapshotManager::SnapshotMetadata& b) {
+                                       return a.timestamp < b.timestamp;
+                                   });
+    if (latest == snapshots.end()) {
+        return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                            "No snapshot to bootstrap from");
+    }
+
+    std::vector<HashRange> ranges;
+    for (const auto& range : request->ranges()) {
+        ranges.push_back(HashRange{range.first(), range.last()});
+    }
+    std::sort(ranges.begin(), ranges.end(),
+              [](const HashRange& a, const HashRange& b) { return a.first < b.first; });
+    SnapshotManager::KeyFilter filter;
+    if (!ranges.empty()) {
+        filter = [&ranges](const std::string& key) {
+            return hash_ranges_contain(ranges, HashRing::key_position(key));
+        };
+    }
+
+    // Hold the log after the snapshot until the tail has been sent
+    const std::string consumer = "bootstrap:" + request->node_id();
+    commit_log_->Acknowledge(consumer, latest->wal_sequence);
+    auto release = [&] { commit_log_->RemoveConsumer(consumer); };
+
+    int32_t chunk_index = 0;
+    size_t bytes_sent = 0;
+    bool shipped = snapshots_->ShipSnapshot(
+        latest->snapshot_id, filter, [&](SnapshotManager::ShippedChunk& shipped_chunk) {
+            v1::BootstrapMessage message;
+            auto* chunk = message.mutable_chunk();
+            chunk->set_chunk_index(chunk_index++);
+            chunk->set_file_index(static_cast<int32_t>(shipped_chunk.file_index));
+            chunk->set_checksum(shipped_chunk.checksum);
+            bytes_sent += shipped_chunk.data.size();
+            chunk->set_data(std::move(shipped_chunk.data));
+            return writer->Write(message);
+        });
+    if (!shipped) {
+        release();
+        if (context->IsCancelled()) {
+            return grpc::Status(grpc::StatusCode::CANCELLED, "Bootstrap cancelled");
+        }
+        return grpc::Status(grpc::StatusCode::INTERNAL,
+                            "Failed to ship snapshot " + latest->snapshot_id);
+    }
+
+    // The final chunk names the snapshot and where its log tail starts
+    {
+        v1::BootstrapMessage message;
+        auto* chunk = message.mutable_chunk();
+        chunk->set_chunk_index(chunk_index);
+        chunk->set_is_final(true);
+        auto* metadata = chunk->mutable_metadata();
+        metadata->set_snapshot_id(latest->snapshot_id);
+        metadata->set_timestamp(std::chrono::duration_cast<std::chrono::milliseconds>(
+            latest->timestamp.time_since_epoch()).count());
+        metadata->set_num_keys(static_cast<int64_t>(latest->num_keys));
+        metadata->set_total_bytes(static_cast<int64_t>(latest->total_bytes));
+        metadata->set_node_id(latest->node_id);
+        metadata->set_checksum(latest->checksum);
+        metadata->set_wal_sequence(latest->wal_sequence);
+        metadata->set_base_id(latest->base_id);
+        if (!writer->Write(message)) {
+            release();
+            return grpc::Status(grpc::StatusCode::CANCELLED, "Bootstrap cancelled");
+        }
+    }
+
+    // Then every record since the snapshot, up to where the log was now
+    size_t entries_sent = 0;
+    int64_t through = latest->wal_sequence;
+    const int64_t target = commit_log_->ReadableSequence();
+    std::vector<CommitLog::RecordPtr> records;
+    while (through < target) {
+        records.clear();
+        int64_t next = commit_log_->Read(through, kBootstrapTailBatch, records);
+        if (next < 0) {
+            release();
+            return grpc::Status(grpc::StatusCode::DATA_LOSS,
+                                "Log records after the snapshot are no longer available");
+        }
+        if (next == through) {
+            break;
+        }
+        for (const auto& record : records) {
+            if (filter && !filter(record->key)) {
+                continue;
+            }
+            v1::BootstrapMessage message;
+            auto* entry = message.mutable_entry();
+            entry->set_key(record->key);
+            auto value = record->value_view();
+            entry->set_value(value.data(), value.size());
+            entry->set_ttl_seconds(record->ttl_seconds);
+            entry->set_version(record->version);
+            entry->set_timestamp(CacheEntry::get_current_time_ms());
+            entry->set_is_deleted(record->op == CommitLog::Record::Op::DELETE);
+            entry->set_sequence(record->sequence);
+            if (!writer->Write(message)) {
+                release();
+                return grpc::Status(grpc::StatusCode::CANCELLED, "Bootstrap cancelled");
+            }
+            entries_sent++;
+        }
+        through = next;
+        commit_log_->Acknowledge(consumer, through);
+    }
+    release();
+
+    v1::BootstrapMessage end;
+    end.set_end_sequence(through);
+    if (!writer->Write(end)) {
+        return grpc::Status(grpc::StatusCode::CANCELLED, "Bootstrap cancelled");
+    }
+
+    LOG_INFO("Bootstrap of {} complete: snapshot {} ({} chunks, {} bytes), "
+             "{} log entries to sequence {}",
+             request->node_id(), latest->snapshot_id, chunk_index, bytes_sent,
+             entries_sent, through);
+    return grpc::Status::OK;
+}
+
 grpc::Status FailoverServiceImpl::GetFailoverStatus(grpc::ServerContext* context,
                                                       const v1::FailoverStatusRequest* request,
                                                       v1::FailoverStatusResponse* response) {
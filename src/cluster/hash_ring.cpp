@@ -1,89 +1,15 @@
 #include "distcache/hash_ring.h"
+#include "distcache/murmur_hash3.h"
 #include <algorithm>
 #include <random>
 #include <sstream>
 #include <iomanip>
+#include <iterator>
 #include <set>
 #include <thread>
 
 namespace distcache {
 
-namespace {
-
-// MurmurHash3 64-bit finalizer
-// Based on https://github.com/aappleby/smhasher/blob/master/src/MurmurHash3.cpp
-uint64_t murmur_hash3_64(const void* key, size_t len, uint32_t seed = 0) {
-    const uint8_t* data = static_cast<const uint8_t*>(key);
-    const size_t nblocks = len / 8;
-
-    uint64_t h1 = seed;
-    uint64_t h2 = seed;
-
-    const uint64_t c1 = 0x87c37b91114253d5ULL;
-    const uint64_t c2 = 0x4cf5ad432745937fULL;
-
-    // Body
-    const uint64_t* blocks = reinterpret_cast<const uint64_t*>(data);
-    for (size_t i = 0; i < nblocks; i++) {
-        uint64_t k1 = blocks[i];
-
-        k1 *= c1;
-        k1 = (k1 << 31) | (k1 >> (64 - 31));
-        k1 *= c2;
-
-        h1 ^= k1;
-        h1 = (h1 << 27) | (h1 >> (64 - 27));
-        h1 += h2;
-        h1 = h1 * 5 + 0x52dce729;
-
-        h2 = (h2 << 31) | (h2 >> (64 - 31));
-    }
-
-    // Tail
-    const uint8_t* tail = data + nblocks * 8;
-    uint64_t k1 = 0;
-
-    switch (len & 7) {
-        case 7: k1 ^= static_cast<uint64_t>(tail[6]) << 48; [[fallthrough]];
-        case 6: k1 ^= static_cast<uint64_t>(tail[5]) << 40; [[fallthrough]];
-        case 5: k1 ^= static_cast<uint64_t>(tail[4]) << 32; [[fallthrough]];
-        case 4: k1 ^= static_cast<uint64_t>(tail[3]) << 24; [[fallthrough]];
-        case 3: k1 ^= static_cast<uint64_t>(tail[2]) << 16; [[fallthrough]];
-        case 2: k1 ^= static_cast<uint64_t>(tail[1]) << 8;  [[fallthrough]];
-        case 1: k1 ^= static_cast<uint64_t>(tail[0]);
-                k1 *= c1;
-                k1 = (k1 << 31) | (k1 >> (64 - 31));
-                k1 *= c2;
-                h1 ^= k1;
-    }
-
-    // Finalization
-    h1 ^= len;
-    h2 ^= len;
-
-    h1 += h2;
-    h2 += h1;
-
-    // Fmix64
-    auto fmix64 = [](uint64_t k) -> uint64_t {
-        k ^= k >> 33;
-        k *= 0xff51afd7ed558ccdULL;
-        k ^= k >> 33;
-        k *= 0xc4ceb9fe1a85ec53ULL;
-        k ^= k >> 33;
-        return k;
-    };
-
-    h1 = fmix64(h1);
-    h2 = fmix64(h2);
-
-    h1 += h2;
-
-    return h1;
-}
-
-} // anonymous namespace
-
 // Constructor
 HashRing::HashRing(size_t replication_factor, size_t virtual_nodes_per_node)
     : virtual_nodes_per_node_(virtual_nodes_per_node) {
@@ -304,6 +230,63 @@ uint64_t HashRing::hash(const std::string& str) const {
     return murmur_hash3_64(str.data(), str.size());
 }
 
+uint64_t HashRing::key_position(const std::string& key) {
+    return murmur_hash3_64(key.data(), key.size());
+}
+
+// Get the ring ranges a node replicates
+std::vector<HashRange> HashRing::get_owned_ranges(const std::string& node_id, size_t n) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<HashRange> ranges;
+    if (ring_.empty() || n == 0 || nodes_.find(node_id) == nodes_.end()) {
+        return ranges;
+    }
+    n = std::min(n, nodes_.size());
+
+    auto add = [&ranges](uint64_t first, uint64_t last) {
+        if (!ranges.empty() && ranges.back().last != UINT64_MAX &&
+            ranges.back().last + 1 == first) {
+            ranges.back().last = last;
+        } else {
+            ranges.push_back(HashRange{first, last});
+        }
+    };
+
+    // Keys between the previous virtual node (exclusive) and this one
+    // (inclusive) are placed on this one; keys past the last virtual
+    // node wrap around to the first
+    uint64_t previous = ring_.rbegin()->first;
+    bool owns_wrap = false;
+    for (auto iter = ring_.begin(); iter != ring_.end(); ++iter) {
+        // Replicas: the next n distinct physical nodes from here
+        std::set<std::string> seen;
+        bool owned = false;
+        auto walk = iter;
+        while (seen.size() < n && !owned) {
+            seen.insert(walk->second);
+            owned = walk->second == node_id;
+            if (++walk == ring_.end()) {
+                walk = ring_.begin();
+            }
+        }
+
+        if (iter == ring_.begin()) {
+            owns_wrap = owned;
+            if (owned) {
+                add(0, iter->first);
+            }
+        } else if (owned) {
+            add(previous + 1, iter->first);
+        }
+        previous = iter->first;
+    }
+    if (owns_wrap && previous != UINT64_MAX) {
+        add(previous + 1, UINT64_MAX);
+    }
+    return ranges;
+}
+
 // Find next node on the ring (clockwise)
 std::map<uint64_t, std::string>::const_iterator
 HashRing::find_next_node(uint64_t hash_value) const {
@@ -312,6 +295,15 @@ HashRing::find_next_node(uint64_t hash_value) const {
     return iter;
 }
 
+// Helper: Test a position against sorted ranges
+bool hash_ranges_contain(const std::vector<HashRange>& ranges, uint64_t position) {
+    auto iter = std::upper_bound(ranges.begin(), ranges.end(), position,
+                                 [](uint64_t value, const HashRange& range) {
+                                     return value < range.first;
+                                 });
+    return iter != ranges.begin() && position <= std::prev(iter)->last;
+}
+
 // Helper: Generate node ID
 std::string generate_node_id(const std::string& prefix, size_t index) {
     std::ostringstream oss;
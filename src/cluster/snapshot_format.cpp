@@ -0,0 +1,393 @@
+#include "distcache/snapshot_format.h"
+#include "distcache/crc32c.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace distcache {
+namespace snapshot_format {
+
+namespace {
+
+constexpr uint32_t kChunkMagic = 0x43534344;          // "DCSC"
+constexpr uint64_t kFooterMagic = 0x5849504E53534344;  // "DCSSNPIX"
+constexpr uint64_t kChecksummedFooterMagic = 0x3258504E53534344;  // "DCSSNPX2"
+constexpr size_t kFooterDigestOffset = 28;  // Footer bytes the digest covers
+
+void PutFixed32(std::string& out, uint32_t value) {
+    char buf[4];
+    for (int i = 0; i < 4; ++i) {
+        buf[i] = static_cast<char>(value >> (8 * i));
+    }
+    out.append(buf, sizeof(buf));
+}
+
+void PutFixed64(std::string& out, uint64_t value) {
+    char buf[8];
+    for (int i = 0; i < 8; ++i) {
+        buf[i] = static_cast<char>(value >> (8 * i));
+    }
+    out.append(buf, sizeof(buf));
+}
+
+uint32_t GetFixed32(const char* p) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t GetFixed64(const char* p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+constexpr uint64_t kTombstoneFlag = 0x100;  // Above the codec byte
+
+bool ValidCodec(uint8_t codec) {
+    return codec <= static_cast<uint8_t>(compression::Codec::kLZ4);
+}
+
+// The chunk kind is the codec in the low byte plus flags above it
+uint64_t EncodeKind(const ChunkInfo& info) {
+    return static_cast<uint64_t>(info.codec) | (info.tombstones ? kTombstoneFlag : 0);
+}
+
+bool DecodeKind(uint64_t kind, ChunkInfo& info) {
+    uint8_t codec = static_cast<uint8_t>(kind & 0xFF);
+    if ((kind & ~(kTombstoneFlag | 0xFF)) != 0 || !ValidCodec(codec)) {
+        return false;
+    }
+    info.codec = static_cast<compression::Codec>(codec);
+    info.tombstones = (kind & kTombstoneFlag) != 0;
+    return true;
+}
+
+// Point data/size at the chunk's raw payload, decompressing into scratch
+bool RawPayload(const ChunkInfo& info, const char* payload, std::string& scratch,
+                const char*& data, size_t& size) {
+    if (info.codec == compression::Codec::kNone) {
+        data = payload;
+        size = info.stored_size;
+        return true;
+    }
+    if (!compression::Decompress(info.codec, payload, info.stored_size, info.raw_size, scratch)) {
+        return false;
+    }
+    data = scratch.data();
+    size = scratch.size();
+    return true;
+}
+
+// False if p does not end in a footer magic
+bool DecodeFooter(const char* p, Footer& footer) {
+    uint64_t magic = GetFixed64(p + 32);
+    if (magic != kFooterMagic && magic != kChecksummedFooterMagic) {
+        return false;
+    }
+    footer.index_offset = GetFixed64(p);
+    footer.num_chunks = GetFixed64(p + 8);
+    footer.num_keys = GetFixed64(p + 16);
+    footer.shard_count = GetFixed32(p + 24);
+    footer.checksummed = magic == kChecksummedFooterMagic;
+    footer.digest = footer.checksummed ? GetFixed32(p + kFooterDigestOffset) : 0;
+    return true;
+}
+
+size_t IndexEntrySize(const Footer& footer) {
+    return footer.checksummed ? kChecksummedIndexEntrySize : kIndexEntrySize;
+}
+
+} // namespace
+
+void EncodeEntry(const std::string& key, const CacheEntry& entry, std::string& out) {
+    PutFixed32(out, static_cast<uint32_t>(key.size()));
+    out.append(key);
+    PutFixed32(out, static_cast<uint32_t>(entry.value.size()));
+    out.append(reinterpret_cast<const char*>(entry.value.data()), entry.value.size());
+    PutFixed32(out, static_cast<uint32_t>(entry.ttl_seconds.value_or(0)));
+    PutFixed64(out, static_cast<uint64_t>(entry.version));
+    PutFixed64(out, static_cast<uint64_t>(entry.created_at_ms));
+    PutFixed64(out, static_cast<uint64_t>(entry.expires_at_ms.value_or(0)));
+}
+
+bool DecodeEntries(const char* data, size_t size, uint32_t num_entries,
+                   std::vector<std::pair<std::string, CacheEntry>>& out) {
+    const char* p = data;
+    const char* end = data + size;
+    auto remaining = [&] { return static_cast<size_t>(end - p); };
+
+    out.reserve(out.size() + num_entries);
+    for (uint32_t i = 0; i < num_entries; ++i) {
+        if (remaining() < 4) {
+            return false;
+        }
+        uint32_t key_len = GetFixed32(p);
+        p += 4;
+        if (remaining() < static_cast<size_t>(key_len) + 4) {
+            return false;
+        }
+        std::string key(p, key_len);
+        p += key_len;
+
+        uint32_t value_len = GetFixed32(p);
+        p += 4;
+        if (remaining() < static_cast<size_t>(value_len) + 28) {
+            return false;
+        }
+
+        CacheEntry entry;
+        entry.key = key;
+        entry.value.assign(reinterpret_cast<const uint8_t*>(p),
+                           reinterpret_cast<const uint8_t*>(p) + value_len);
+        p += value_len;
+
+        int32_t ttl = static_cast<int32_t>(GetFixed32(p));
+        if (ttl > 0) {
+            entry.ttl_seconds = ttl;
+        }
+        entry.version = static_cast<int64_t>(GetFixed64(p + 4));
+        entry.created_at_ms = static_cast<int64_t>(GetFixed64(p + 12));
+        entry.modified_at_ms = entry.created_at_ms;
+        entry.last_accessed_ms.store(entry.created_at_ms);
+        int64_t expires_at = static_cast<int64_t>(GetFixed64(p + 20));
+        if (expires_at > 0) {
+            entry.expires_at_ms = expires_at;
+        }
+        p += 28;
+
+        out.emplace_back(std::move(key), std::move(entry));
+    }
+    return p == end;
+}
+
+void EncodeTombstone(const std::string& key, int64_t deleted_at_ms, std::string& out) {
+    PutFixed32(out, static_cast<uint32_t>(key.size()));
+    out.append(key);
+    PutFixed64(out, static_cast<uint64_t>(deleted_at_ms));
+}
+
+bool DecodeTombstones(const char* data, size_t size, uint32_t num_entries,
+                      std::vector<std::string>& out) {
+    const char* p = data;
+    const char* end = data + size;
+
+    out.reserve(out.size() + num_entries);
+    for (uint32_t i = 0; i < num_entries; ++i) {
+        if (static_cast<size_t>(end - p) < 4) {
+            return false;
+        }
+        uint32_t key_len = GetFixed32(p);
+        p += 4;
+        if (static_cast<size_t>(end - p) < static_cast<size_t>(key_len) + 8) {
+            return false;
+        }
+        out.emplace_back(p, key_len);
+        p += key_len + 8;
+    }
+    return p == end;
+}
+
+bool DecodeChunk(const ChunkInfo& info, const char* payload, std::string& scratch,
+                 std::vector<std::pair<std::string, CacheEntry>>& out) {
+    const char* data;
+    size_t size;
+    return !info.tombstones && RawPayload(info, payload, scratch, data, size) &&
+           DecodeEntries(data, size, info.num_entries, out);
+}
+
+bool DecodeTombstoneChunk(const ChunkInfo& info, const char* payload, std::string& scratch,
+                          std::vector<std::string>& out) {
+    const char* data;
+    size_t size;
+    return info.tombstones && RawPayload(info, payload, scratch, data, size) &&
+           DecodeTombstones(data, size, info.num_entries, out);
+}
+
+void CompressChunk(compression::Codec codec, std::string& payload, ChunkInfo& info) {
+    info.raw_size = payload.size();
+    info.stored_size = payload.size();
+    info.codec = compression::Codec::kNone;
+    if (codec == compression::Codec::kNone) {
+        return;
+    }
+
+    std::string compressed;
+    if (compression::Compress(codec, payload.data(), payload.size(), compressed) &&
+        compressed.size() < payload.size()) {
+        payload.swap(compressed);
+        info.stored_size = payload.size();
+        info.codec = codec;
+    }
+}
+
+void EncodeChunkHeader(const ChunkInfo& info, std::string& out) {
+    PutFixed32(out, kChunkMagic);
+    PutFixed32(out, static_cast<uint32_t>(EncodeKind(info)));
+    PutFixed32(out, info.num_entries);
+    PutFixed32(out, info.shard);
+    PutFixed64(out, info.raw_size);
+    PutFixed64(out, info.stored_size);
+}
+
+bool DecodeChunkHeader(const char* data, size_t size, ChunkInfo& info) {
+    if (size < kChunkHeaderSize || GetFixed32(data) != kChunkMagic) {
+        return false;
+    }
+    if (!DecodeKind(GetFixed32(data + 4), info)) {
+        return false;
+    }
+    info.num_entries = GetFixed32(data + 8);
+    info.shard = GetFixed32(data + 12);
+    info.raw_size = GetFixed64(data + 16);
+    info.stored_size = GetFixed64(data + 24);
+    return true;
+}
+
+uint32_t ChunkChecksum(const ChunkInfo& info, const char* payload) {
+    std::string header;
+    EncodeChunkHeader(info, header);
+    uint32_t crc = crc32c::Value(header.data(), header.size());
+    return crc32c::Extend(crc, payload, info.stored_size);
+}
+
+bool VerifyChunk(const ChunkInfo& info, const char* chunk) {
+    return crc32c::Value(chunk, kChunkHeaderSize + info.stored_size) == info.checksum;
+}
+
+void EncodeIndex(const std::vector<ChunkInfo>& chunks, Footer& footer, uint32_t header_crc,
+                 std::string& out) {
+    size_t start = out.size();
+    for (const auto& chunk : chunks) {
+        PutFixed64(out, chunk.offset);
+        PutFixed64(out, chunk.stored_size);
+        PutFixed64(out, chunk.raw_size);
+        PutFixed32(out, chunk.num_entries);
+        PutFixed32(out, chunk.shard);
+        PutFixed64(out, EncodeKind(chunk));
+        if (footer.checksummed) {
+            PutFixed32(out, chunk.checksum);
+            PutFixed32(out, 0);  // Reserved
+        }
+    }
+    PutFixed64(out, footer.index_offset);
+    PutFixed64(out, footer.num_chunks);
+    PutFixed64(out, footer.num_keys);
+    PutFixed32(out, footer.shard_count);
+    if (footer.checksummed) {
+        footer.digest = crc32c::Extend(header_crc, out.data() + start, out.size() - start);
+        PutFixed32(out, footer.digest);
+        PutFixed64(out, kChecksummedFooterMagic);
+    } else {
+        PutFixed32(out, 0);  // Reserved
+        PutFixed64(out, kFooterMagic);
+    }
+}
+
+namespace {
+
+// Parse the index and footer from a buffer holding exactly the bytes
+// from index_offset to the end of a file of file_size bytes
+bool ParseIndexBlock(const char* block, size_t block_size, uint64_t file_size,
+                     Footer& footer, std::vector<ChunkInfo>& chunks) {
+    if (block_size < kFooterSize || block_size > file_size) {
+        return false;
+    }
+    const char* tail = block + block_size - kFooterSize;
+    if (!DecodeFooter(tail, footer)) {
+        return false;
+    }
+    const size_t entry_size = IndexEntrySize(footer);
+    if (footer.index_offset != file_size - block_size ||
+        footer.num_chunks != (block_size - kFooterSize) / entry_size ||
+        (block_size - kFooterSize) % entry_size != 0) {
+        return false;
+    }
+
+    chunks.clear();
+    chunks.reserve(footer.num_chunks);
+    const char* p = block;
+    for (uint64_t i = 0; i < footer.num_chunks; ++i, p += entry_size) {
+        ChunkInfo info;
+        info.offset = GetFixed64(p);
+        info.stored_size = GetFixed64(p + 8);
+        info.raw_size = GetFixed64(p + 16);
+        info.num_entries = GetFixed32(p + 24);
+        info.shard = GetFixed32(p + 28);
+        if (!DecodeKind(GetFixed64(p + 32), info)) {
+            return false;
+        }
+        if (footer.checksummed) {
+            info.checksum = GetFixed32(p + 40);
+        }
+        uint64_t chunk_end = info.offset + kChunkHeaderSize + info.stored_size;
+        if (chunk_end < info.offset || chunk_end > footer.index_offset) {
+            return false;
+        }
+        chunks.push_back(info);
+    }
+    return true;
+}
+
+} // namespace
+
+bool DecodeIndex(const char* data, size_t size, Footer& footer, std::vector<ChunkInfo>& chunks) {
+    if (size < kFooterSize) {
+        return false;
+    }
+    Footer peek;
+    if (!DecodeFooter(data + size - kFooterSize, peek) ||
+        peek.index_offset > size - kFooterSize) {
+        return false;
+    }
+    if (!ParseIndexBlock(data + peek.index_offset, size - peek.index_offset, size,
+                         footer, chunks)) {
+        return false;
+    }
+    if (!footer.checksummed) {
+        return true;
+    }
+
+    // The header lines run up to the first chunk (or the index)
+    uint64_t header_size = chunks.empty() ? footer.index_offset : chunks.front().offset;
+    uint32_t crc = crc32c::Value(data, header_size);
+    size_t covered = size - kFooterSize + kFooterDigestOffset - footer.index_offset;
+    return crc32c::Extend(crc, data + footer.index_offset, covered) == footer.digest;
+}
+
+bool ReadIndex(const std::filesystem::path& path, Footer& footer,
+               std::vector<ChunkInfo>* chunks) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool ok = false;
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= kFooterSize) {
+        uint64_t size = static_cast<uint64_t>(st.st_size);
+        char tail[kFooterSize];
+        if (::pread(fd, tail, kFooterSize, static_cast<off_t>(size - kFooterSize)) ==
+                static_cast<ssize_t>(kFooterSize) &&
+            DecodeFooter(tail, footer)) {
+            ok = footer.index_offset <= size - kFooterSize;
+            if (ok && chunks) {
+                size_t block_size = static_cast<size_t>(size - footer.index_offset);
+                std::string block(block_size, '\0');
+                ok = ::pread(fd, &block[0], block_size, static_cast<off_t>(footer.index_offset)) ==
+                         static_cast<ssize_t>(block_size) &&
+                     ParseIndexBlock(block.data(), block.size(), size, footer, *chunks);
+            }
+        }
+    }
+    ::close(fd);
+    return ok;
+}
+
+} // namespace snapshot_format
+} // namespace distcache
@@ -1,12 +1,134 @@
 #include "distcache/snapshot_manager.h"
+#include "distcache/crc32c.h"
+#include "distcache/io_ring.h"
 #include "distcache/logger.h"
+#include "distcache/snapshot_format.h"
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace distcache {
 
+namespace {
+
+constexpr const char* kSnapshotHeaderV1 = "DISTCACHE_SNAPSHOT_V1";
+constexpr const char* kSnapshotHeaderV2 = "DISTCACHE_SNAPSHOT_V2";  // Adds the WAL sequence
+constexpr size_t kSnapshotWriteChunk = 4 * 1024 * 1024;  // Sequential write size
+
+// A delta starts this long before its parent's scan, so small wall
+// clock adjustments cannot drop a change; repeating one is harmless
+constexpr int64_t kDeltaClockSlackMs = 1000;
+
+// Creation time at the end of an ID (see GenerateSnapshotId), or 0
+int64_t IdTimestampMs(const std::string& snapshot_id) {
+    auto dash = snapshot_id.rfind('-');
+    if (dash == std::string::npos) {
+        return 0;
+    }
+    try {
+        return std::stoll(snapshot_id.substr(dash + 1));
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+// Flush a file (or directory) to stable storage
+bool SyncPath(const std::filesystem::path& path, bool directory) {
+    int fd = ::open(path.c_str(), (directory ? O_RDONLY | O_DIRECTORY : O_RDONLY) | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// Read-only stream over a buffer already in memory
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(char* data, size_t size) { setg(data, data, data + size); }
+};
+
+// Read-only mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() {
+        if (data_) {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::filesystem::path& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            size_ = 0;
+            return false;
+        }
+        // Chunks are decoded out of order by several threads
+        ::madvise(mapped, size_, MADV_WILLNEED);
+        data_ = static_cast<const char*>(mapped);
+        return true;
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Locate a chunk's payload in a mapped file, checking its header
+// against the index entry and, if verify, its checksum; nullptr if
+// either does not match
+const char* ChunkPayload(const MappedFile& file, const snapshot_format::Footer& footer,
+                         const snapshot_format::ChunkInfo& chunk, bool verify) {
+    snapshot_format::ChunkInfo stored;
+    const char* p = file.data() + chunk.offset;
+    if (!snapshot_format::DecodeChunkHeader(p, file.size() - chunk.offset, stored) ||
+        stored.stored_size != chunk.stored_size || stored.num_entries != chunk.num_entries ||
+        stored.tombstones != chunk.tombstones) {
+        return nullptr;
+    }
+    if (verify && footer.checksummed && !snapshot_format::VerifyChunk(chunk, p)) {
+        return nullptr;
+    }
+    return p + snapshot_format::kChunkHeaderSize;
+}
+
+std::string DigestHex(const snapshot_format::Footer& footer) {
+    if (!footer.checksummed) {
+        return "";
+    }
+    std::ostringstream hex;
+    hex << std::hex << std::setfill('0') << std::setw(8) << footer.digest;
+    return hex.str();
+}
+
+} // namespace
+
 // SnapshotMetadata copy constructor
 SnapshotManager::SnapshotMetadata::SnapshotMetadata(const SnapshotMetadata& other)
     : snapshot_id(other.snapshot_id),
@@ -15,7 +137,10 @@ SnapshotManager::SnapshotMetadata::SnapshotMetadata(const SnapshotMetadata& othe
       total_bytes(other.total_bytes),
       node_id(other.node_id),
       checksum(other.checksum),
-      file_path(other.file_path) {}
+      file_path(other.file_path),
+      wal_sequence(other.wal_sequence),
+      covered_ms(other.covered_ms),
+      base_id(other.base_id) {}
 
 // SnapshotMetadata assignment operator
 SnapshotManager::SnapshotMetadata& SnapshotManager::SnapshotMetadata::operator=(
@@ -28,6 +153,9 @@ SnapshotManager::SnapshotMetadata& SnapshotManager::SnapshotMetadata::operator=(
         node_id = other.node_id;
         checksum = other.checksum;
         file_path = other.file_path;
+        wal_sequence = other.wal_sequence;
+        covered_ms = other.covered_ms;
+        base_id = other.base_id;
     }
     return *this;
 }
@@ -41,11 +169,85 @@ SnapshotManager::SnapshotManager(const Config& config,
         std::filesystem::create_directories(config_.snapshot_dir);
     }
 
+    // Deltas need to know which keys were deleted since the last snapshot
+    if (config_.delta_interval_seconds > 0) {
+        storage_->set_tombstone_tracking(true);
+    }
+
+    // Pick up snapshots written before a restart so they can be restored
+    LoadExistingSnapshots();
+
     LOG_INFO("SnapshotManager initialized with directory: {}", config_.snapshot_dir.string());
 }
 
+void SnapshotManager::LoadExistingSnapshots() {
+    std::lock_guard<std::mutex> lock(snapshots_mutex_);
+
+    for (const auto& file : std::filesystem::directory_iterator(config_.snapshot_dir)) {
+        if (!file.is_regular_file() || file.path().extension() != ".snapshot") {
+            continue;
+        }
+
+        // Unreadable files are remembered, so recovery knows a newer
+        // snapshot than the readable ones may have been lost
+        auto unreadable = [this, &file] {
+            SnapshotMetadata metadata;
+            metadata.snapshot_id = file.path().stem().string();
+            metadata.timestamp = std::chrono::system_clock::time_point(
+                std::chrono::milliseconds(IdTimestampMs(metadata.snapshot_id)));
+            metadata.file_path = file.path();
+            unreadable_snapshots_.push_back(metadata);
+        };
+
+        SnapshotHeader header;
+        if (!ReadSnapshotHeader(file.path(), header)) {
+            LOG_WARN("Ignoring unreadable snapshot file: {}", file.path().string());
+            unreadable();
+            continue;
+        }
+        size_t num_keys = header.num_keys;
+        std::string checksum;
+        if (header.version >= 3) {
+            snapshot_format::Footer footer;
+            if (!snapshot_format::ReadIndex(file.path(), footer)) {
+                LOG_WARN("Ignoring snapshot file without a valid index: {}",
+                         file.path().string());
+                unreadable();
+                continue;
+            }
+            num_keys = footer.num_keys;
+            checksum = DigestHex(footer);
+        }
+
+        const std::string& snapshot_id = header.snapshot_id;
+        int64_t timestamp_ms = IdTimestampMs(snapshot_id);
+
+        SnapshotMetadata metadata;
+        metadata.snapshot_id = snapshot_id;
+        metadata.timestamp = std::chrono::system_clock::time_point(
+            std::chrono::milliseconds(timestamp_ms));
+        metadata.num_keys = num_keys;
+        metadata.total_bytes = file.file_size();
+        metadata.node_id = config_.node_id;
+        metadata.checksum = checksum;
+        metadata.file_path = file.path();
+        metadata.wal_sequence = header.wal_sequence;
+        // Older formats did not record the scan start; the ID's time is
+        // taken just before it
+        metadata.covered_ms = header.covered_ms > 0 ? header.covered_ms : timestamp_ms;
+        metadata.base_id = header.base_id;
+        snapshots_.push_back(metadata);
+        last_id_timestamp_ = std::max(last_id_timestamp_, timestamp_ms);
+    }
+
+    if (!snapshots_.empty()) {
+        LOG_INFO("Found {} existing snapshots", snapshots_.size());
+    }
+}
+
 SnapshotManager::~SnapshotManager() {
     Stop();
+    StopLazyRestore();
 }
 
 void SnapshotManager::Start() {
@@ -70,27 +272,35 @@ void SnapshotManager::Stop() {
 }
 
 void SnapshotManager::SnapshotWorker() {
-    while (running_.load()) {
-        // Sleep for snapshot interval
-        auto sleep_duration = std::chrono::seconds(config_.snapshot_interval_seconds);
-        auto start = std::chrono::steady_clock::now();
-
-        while (running_.load()) {
-            auto elapsed = std::chrono::steady_clock::now() - start;
-            if (elapsed >= sleep_duration) {
-                break;
-            }
-
-            // Sleep in small chunks to allow quick shutdown
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
+    const auto full_interval = std::chrono::seconds(config_.snapshot_interval_seconds);
+    const auto delta_interval = std::chrono::seconds(config_.delta_interval_seconds);
+    auto last_full = std::chrono::steady_clock::now();
+    auto last_snapshot = last_full;
 
+    while (running_.load()) {
+        // Sleep in small chunks to allow quick shutdown
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
         if (!running_.load()) {
             break;
         }
 
-        // Create periodic snapshot
-        CreateSnapshot();
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_full >= full_interval) {
+            // Create periodic snapshot
+            CreateSnapshot();
+            last_full = last_snapshot = std::chrono::steady_clock::now();
+        } else if (config_.delta_interval_seconds > 0 && now - last_snapshot >= delta_interval) {
+            CreateDeltaSnapshot();
+            last_snapshot = std::chrono::steady_clock::now();
+
+            // Keep restores short: fold a long chain into a new base
+            auto latest = LatestSnapshot();
+            if (latest && ResolveChain(latest->snapshot_id).size() > config_.max_delta_chain) {
+                MergeDeltaChain();
+            }
+        } else {
+            continue;
+        }
 
         // Prune old snapshots
         PruneOldSnapshots();
@@ -98,58 +308,105 @@ void SnapshotManager::SnapshotWorker() {
 }
 
 std::string SnapshotManager::CreateSnapshot() {
+    return CreateSnapshotFrom(nullptr);
+}
+
+std::string SnapshotManager::CreateDeltaSnapshot() {
+    auto parent = LatestSnapshot();
+    if (!parent) {
+        LOG_INFO("No snapshot to build a delta on, creating a full snapshot");
+    }
+    return CreateSnapshotFrom(parent ? &*parent : nullptr);
+}
+
+std::string SnapshotManager::CreateSnapshotFrom(const SnapshotMetadata* parent) {
     auto start_time = std::chrono::steady_clock::now();
+    const bool delta = parent != nullptr;
 
-    LOG_INFO("Creating snapshot...");
+    if (delta) {
+        LOG_INFO("Creating delta snapshot on {}...", parent->snapshot_id);
+    } else {
+        LOG_INFO("Creating snapshot...");
+    }
 
     // Generate snapshot ID
-    std::string snapshot_id = GenerateSnapshotId();
+    SnapshotHeader header;
+    header.snapshot_id = GenerateSnapshotId(delta ? "delta" : "snapshot");
 
-    // Collect all entries
-    std::vector<std::pair<std::string, CacheEntry>> entries;
-    storage_->for_each([&](const std::string& key, const CacheEntry& entry) {
-        entries.push_back({key, entry});
-    });
+    // Changes are stamped with the wall clock: anything modified from
+    // here on may be missed by the scan and is left to the next delta
+    header.covered_ms = CacheEntry::get_current_time_ms();
+
+    // Sample the watermark before scanning: records up to it were applied
+    // under their shard lock, so the scan is guaranteed to see them.
+    // Later records may be included too; replaying them is harmless.
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        if (sequence_source_) {
+            header.wal_sequence = sequence_source_();
+        }
+    }
 
-    // Write to file
-    if (!WriteSnapshotToFile(snapshot_id, entries)) {
-        LOG_ERROR("Failed to write snapshot: {}", snapshot_id);
+    ShardSource source;
+    if (delta) {
+        header.base_id = parent->snapshot_id;
+        header.since_ms = parent->covered_ms - kDeltaClockSlackMs;
+        source = [this, since = header.since_ms](size_t shard, const EntrySink& on_entry,
+                                                 const TombstoneSink& on_tombstone) {
+            storage_->for_each_changed_in_shard(shard, since, on_entry, on_tombstone);
+            return true;
+        };
+    } else {
+        source = [this](size_t shard, const EntrySink& on_entry, const TombstoneSink&) {
+            storage_->for_each_in_shard(shard, on_entry);
+            return true;
+        };
+    }
+
+    // Stream the table to disk shard by shard
+    WriteResult written;
+    if (!WriteSnapshotToFile(header, storage_->shard_count(), source, written)) {
+        LOG_ERROR("Failed to write snapshot: {}", header.snapshot_id);
         total_snapshots_failed_++;
         return "";
     }
 
     // Create metadata
     SnapshotMetadata metadata;
-    metadata.snapshot_id = snapshot_id;
+    metadata.snapshot_id = header.snapshot_id;
     metadata.timestamp = std::chrono::system_clock::now();
-    metadata.num_keys = entries.size();
+    metadata.num_keys = written.num_keys;
     metadata.node_id = config_.node_id;
-    metadata.checksum = CalculateChecksum(entries);
-    metadata.file_path = config_.snapshot_dir / (snapshot_id + ".snapshot");
-
-    // Calculate file size
-    if (std::filesystem::exists(metadata.file_path)) {
-        metadata.total_bytes = std::filesystem::file_size(metadata.file_path);
-    }
-
-    // Store metadata
-    {
-        std::lock_guard<std::mutex> lock(snapshots_mutex_);
-        snapshots_.push_back(metadata);
+    metadata.checksum = written.checksum;
+    metadata.file_path = config_.snapshot_dir / (header.snapshot_id + ".snapshot");
+    metadata.wal_sequence = header.wal_sequence;
+    metadata.covered_ms = header.covered_ms;
+    metadata.base_id = header.base_id;
+    AddSnapshot(metadata);
+
+    // Later deltas start from this scan, so older deletes are not needed
+    if (config_.delta_interval_seconds > 0) {
+        storage_->drop_tombstones_before(header.covered_ms - kDeltaClockSlackMs);
     }
 
     // Update stats
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - start_time);
     total_snapshots_created_++;
+    if (delta) {
+        total_deltas_created_++;
+    }
     last_snapshot_timestamp_.store(
         std::chrono::duration_cast<std::chrono::milliseconds>(
             metadata.timestamp.time_since_epoch()).count());
     last_snapshot_duration_ms_.store(duration.count());
     last_snapshot_size_bytes_.store(metadata.total_bytes);
 
-    LOG_INFO("Snapshot created: {} ({} keys, {} bytes, {}ms)",
-             snapshot_id, metadata.num_keys, metadata.total_bytes, duration.count());
+    LOG_INFO("{} created: {} ({} keys, {} tombstones in {} chunks, {} bytes from {} raw, "
+             "WAL sequence {}, {}ms)",
+             delta ? "Delta snapshot" : "Snapshot", header.snapshot_id, metadata.num_keys,
+             written.num_tombstones, written.num_chunks, metadata.total_bytes,
+             written.raw_bytes, header.wal_sequence, duration.count());
 
     // Trigger callback
     {
@@ -159,94 +416,549 @@ std::string SnapshotManager::CreateSnapshot() {
         }
     }
 
-    return snapshot_id;
+    return header.snapshot_id;
 }
 
-bool SnapshotManager::WriteSnapshotToFile(
-    const std::string& snapshot_id,
-    const std::vector<std::pair<std::string, CacheEntry>>& entries) {
+std::string SnapshotManager::MergeDeltaChain() {
+    auto head = LatestSnapshot();
+    if (!head || !head->is_delta()) {
+        return "";
+    }
+    auto chain = ResolveChain(head->snapshot_id);
+    if (chain.empty()) {
+        LOG_ERROR("Cannot merge deltas up to {}: a snapshot in the chain is missing",
+                  head->snapshot_id);
+        return "";
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    // Map every file in the chain and group its chunks by shard. Chunks
+    // hold a single shard, so each shard can be folded on its own
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<snapshot_format::Footer> footers;
+    std::vector<std::vector<std::vector<snapshot_format::ChunkInfo>>> shard_chunks;
+    uint32_t shard_count = 0;
+    for (const auto& link : chain) {
+        auto file = std::make_unique<MappedFile>();
+        snapshot_format::Footer footer;
+        std::vector<snapshot_format::ChunkInfo> chunks;
+        if (!file->Open(link.file_path) ||
+            !snapshot_format::DecodeIndex(file->data(), file->size(), footer, chunks)) {
+            LOG_ERROR("Cannot merge {}: not a readable chunked snapshot", link.snapshot_id);
+            return "";
+        }
+        if (files.empty()) {
+            shard_count = footer.shard_count;
+        }
+        if (footer.shard_count != shard_count) {
+            LOG_ERROR("Cannot merge {}: taken with {} shards, base has {}",
+                      link.snapshot_id, footer.shard_count, shard_count);
+            return "";
+        }
+
+        std::vector<std::vector<snapshot_format::ChunkInfo>> by_shard(shard_count);
+        for (const auto& chunk : chunks) {
+            if (chunk.shard >= shard_count) {
+                LOG_ERROR("Cannot merge {}: chunk for shard {} of {}",
+                          link.snapshot_id, chunk.shard, shard_count);
+                return "";
+            }
+            by_shard[chunk.shard].push_back(chunk);
+        }
+        files.push_back(std::move(file));
+        footers.push_back(footer);
+        shard_chunks.push_back(std::move(by_shard));
+    }
+
+    // Replay the chain one shard at a time: later files win and
+    // tombstones remove, so only one shard's keys are held at once. A
+    // corrupt chunk fails the merge rather than baking a gap into a base
+    auto io = IoBudget();
+    ShardSource source = [&](size_t shard, const EntrySink& on_entry, const TombstoneSink&) {
+        std::unordered_map<std::string, CacheEntry> state;
+        std::string scratch;
+        std::vector<std::pair<std::string, CacheEntry>> decoded;
+        std::vector<std::string> deleted;
+        for (size_t f = 0; f < files.size(); ++f) {
+            for (const auto& chunk : shard_chunks[f][shard]) {
+                ThrottleIo(io.get(), snapshot_format::kChunkHeaderSize + chunk.stored_size);
+                const char* payload = ChunkPayload(*files[f], footers[f], chunk, true);
+                if (!payload) {
+                    LOG_ERROR("Corrupt snapshot chunk at offset {}: {}", chunk.offset,
+                              chain[f].file_path.string());
+                    return false;
+                }
+                if (chunk.tombstones) {
+                    deleted.clear();
+                    if (!snapshot_format::DecodeTombstoneChunk(chunk, payload, scratch, deleted)) {
+                        return false;
+                    }
+                    for (const auto& key : deleted) {
+                        state.erase(key);
+                    }
+                } else {
+                    decoded.clear();
+                    if (!snapshot_format::DecodeChunk(chunk, payload, scratch, decoded)) {
+                        return false;
+                    }
+                    for (auto& [key, entry] : decoded) {
+                        state.insert_or_assign(std::move(key), std::move(entry));
+                    }
+                }
+            }
+        }
+        for (const auto& [key, entry] : state) {
+            if (!entry.is_expired()) {
+                on_entry(key, entry);
+            }
+        }
+        return true;
+    };
+
+    // The new base stands in for the whole chain
+    SnapshotHeader header;
+    header.snapshot_id = GenerateSnapshotId("snapshot");
+    header.wal_sequence = head->wal_sequence;
+    header.covered_ms = head->covered_ms;
+
+    WriteResult written;
+    if (!WriteSnapshotToFile(header, shard_count, source, written)) {
+        LOG_ERROR("Failed to merge deltas up to {}", head->snapshot_id);
+        return "";
+    }
+
+    SnapshotMetadata metadata;
+    metadata.snapshot_id = header.snapshot_id;
+    metadata.timestamp = std::chrono::system_clock::now();
+    metadata.num_keys = written.num_keys;
+    metadata.node_id = config_.node_id;
+    metadata.checksum = written.checksum;
+    metadata.file_path = config_.snapshot_dir / (header.snapshot_id + ".snapshot");
+    metadata.wal_sequence = header.wal_sequence;
+    metadata.covered_ms = header.covered_ms;
+    AddSnapshot(metadata);
+    total_merges_++;
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time);
+    LOG_INFO("Merged {} deltas onto {} into {} ({} keys, {} bytes, {}ms)",
+             chain.size() - 1, chain.front().snapshot_id, header.snapshot_id,
+             metadata.num_keys, metadata.total_bytes, duration.count());
+
+    return header.snapshot_id;
+}
+
+void SnapshotManager::AddSnapshot(SnapshotMetadata& metadata) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(metadata.file_path, ec);
+    if (!ec) {
+        metadata.total_bytes = size;
+    }
+
+    std::lock_guard<std::mutex> lock(snapshots_mutex_);
+    snapshots_.push_back(metadata);
+}
+
+std::optional<SnapshotManager::SnapshotMetadata> SnapshotManager::LatestSnapshot() const {
+    std::lock_guard<std::mutex> lock(snapshots_mutex_);
+    auto latest = std::max_element(snapshots_.begin(), snapshots_.end(),
+                                   [](const SnapshotMetadata& a, const SnapshotMetadata& b) {
+                                       return a.timestamp < b.timestamp;
+                                   });
+    if (latest == snapshots_.end()) {
+        return std::nullopt;
+    }
+    return *latest;
+}
+
+std::vector<SnapshotManager::SnapshotMetadata>
+SnapshotManager::ResolveChain(const std::string& snapshot_id) const {
+    std::lock_guard<std::mutex> lock(snapshots_mutex_);
+    std::vector<SnapshotMetadata> chain;
+    std::string id = snapshot_id;
+
+    // Bounded by the number of snapshots, in case of a cycle
+    while (chain.size() <= snapshots_.size()) {
+        auto it = std::find_if(snapshots_.begin(), snapshots_.end(),
+                               [&id](const SnapshotMetadata& meta) {
+                                   return meta.snapshot_id == id;
+                               });
+        if (it == snapshots_.end()) {
+            return {};
+        }
+        chain.push_back(*it);
+        if (!it->is_delta()) {
+            std::reverse(chain.begin(), chain.end());
+            return chain;
+        }
+        id = it->base_id;
+    }
+    return {};
+}
+
+bool SnapshotManager::WriteSnapshotToFile(const SnapshotHeader& snapshot, size_t shard_count,
+                                          const ShardSource& source, WriteResult& result) {
+    const std::string& snapshot_id = snapshot.snapshot_id;
     std::filesystem::path file_path = config_.snapshot_dir / (snapshot_id + ".snapshot");
     std::filesystem::path temp_path = config_.snapshot_dir / (snapshot_id + ".tmp");
 
+    // One shard's chunks, encoded and compressed by a worker
+    struct EncodedShard {
+        std::vector<std::pair<snapshot_format::ChunkInfo, std::string>> chunks;
+        bool ready = false;
+    };
+
+    size_t num_threads = config_.snapshot_threads;
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::max<size_t>(1, std::min(num_threads, shard_count));
+
+    // Workers stay at most this many shards ahead of the writer, which
+    // bounds memory to a few shards' worth of encoded chunks
+    const size_t window = 2 * num_threads;
+    const size_t chunk_keys = std::max<size_t>(1, config_.chunk_size);
+    const auto codec = config_.enable_compression ? compression::DefaultCodec()
+                                                  : compression::Codec::kNone;
+
+    std::vector<EncodedShard> shards(shard_count);
+    auto io = IoBudget();
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t next_shard = 0;
+    size_t shards_written = 0;
+    bool abort = false;
+
+    auto encode_shard = [&](size_t index, EncodedShard& out) {
+        // Entries and tombstones fill separate chunks side by side
+        std::string payloads[2];
+        snapshot_format::ChunkInfo infos[2];
+        for (auto& info : infos) {
+            info.shard = static_cast<uint32_t>(index);
+        }
+        infos[1].tombstones = true;
+        auto close_chunk = [&](int kind) {
+            out.chunks.emplace_back(infos[kind], std::move(payloads[kind]));
+            payloads[kind] = std::string();
+            infos[kind].num_entries = 0;
+        };
+        auto added = [&](int kind) {
+            if (++infos[kind].num_entries >= chunk_keys ||
+                payloads[kind].size() >= config_.chunk_max_bytes) {
+                close_chunk(kind);
+            }
+        };
+
+        // Only encoding runs under the shard lock; compression runs after
+        bool ok = source(
+            index,
+            [&](const std::string& key, const CacheEntry& entry) {
+                snapshot_format::EncodeEntry(key, entry, payloads[0]);
+                added(0);
+            },
+            [&](const std::string& key, int64_t deleted_at_ms) {
+                snapshot_format::EncodeTombstone(key, deleted_at_ms, payloads[1]);
+                added(1);
+            });
+        for (int kind = 0; kind < 2; ++kind) {
+            if (infos[kind].num_entries > 0) {
+                close_chunk(kind);
+            }
+        }
+
+        // Checksums are taken here too, off the writer's sequential path
+        for (auto& [chunk, data] : out.chunks) {
+            snapshot_format::CompressChunk(codec, data, chunk);
+            if (config_.enable_checksums) {
+                chunk.checksum = snapshot_format::ChunkChecksum(chunk, data.data());
+            }
+        }
+        return ok;
+    };
+
+    auto worker = [&] {
+        while (true) {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] {
+                    return abort || next_shard >= shard_count ||
+                           next_shard < shards_written + window;
+                });
+                if (abort || next_shard >= shard_count) {
+                    return;
+                }
+                index = next_shard++;
+            }
+
+            EncodedShard encoded;
+            bool encoded_ok = false;
+            try {
+                encoded_ok = encode_shard(index, encoded);
+                if (!encoded_ok) {
+                    LOG_ERROR("Failed to read snapshot shard {}", index);
+                }
+            } catch (const std::exception& e) {
+                LOG_ERROR("Failed to encode snapshot shard {}: {}", index, e.what());
+            }
+            if (!encoded_ok) {
+                std::lock_guard<std::mutex> lock(mutex);
+                abort = true;
+                cv.notify_all();
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            shards[index] = std::move(encoded);
+            shards[index].ready = true;
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    auto stop_workers = [&] {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            abort = true;
+        }
+        cv.notify_all();
+        for (auto& thread : workers) {
+            thread.join();
+        }
+        workers.clear();
+    };
+
     try {
-        // Write to temporary file
-        std::ofstream out(temp_path, std::ios::binary);
-        if (!out.is_open()) {
+        FileWriter out(config_.use_io_uring, kSnapshotWriteChunk);
+        if (!out.Open(temp_path)) {
             LOG_ERROR("Failed to open snapshot file for writing: {}", temp_path.string());
             return false;
         }
 
-        // Write header
-        out << "DISTCACHE_SNAPSHOT_V1\n";
-        out << snapshot_id << "\n";
-        out << entries.size() << "\n";
+        for (size_t i = 0; i < num_threads; ++i) {
+            workers.emplace_back(worker);
+        }
 
-        // Write entries
-        for (const auto& [key, entry] : entries) {
-            // Write key length and key
-            size_t key_len = key.size();
-            out.write(reinterpret_cast<const char*>(&key_len), sizeof(key_len));
-            out.write(key.data(), key_len);
+        std::ostringstream header;
+        header << snapshot_format::kHeaderV4 << "\n";
+        header << snapshot_id << "\n";
+        header << snapshot.wal_sequence << "\n";
+        header << snapshot.covered_ms << "\n";
+        header << (snapshot.base_id.empty() ? "-" : snapshot.base_id) << "\n";
+        header << snapshot.since_ms << "\n";
+        std::string header_str = header.str();
+        out.Append(header_str.data(), header_str.size());
+        uint64_t offset = header_str.size();
+
+        // Write shards in order as they become ready, so the file is one
+        // sequential stream regardless of which worker finishes first
+        std::vector<snapshot_format::ChunkInfo> index;
+        std::string chunk_header;
+        for (size_t s = 0; s < shard_count; ++s) {
+            EncodedShard encoded;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return abort || shards[s].ready; });
+                if (abort) {
+                    break;
+                }
+                encoded = std::move(shards[s]);
+            }
 
-            // Write value length and value
-            size_t value_len = entry.value.size();
-            out.write(reinterpret_cast<const char*>(&value_len), sizeof(value_len));
-            // Cast uint8_t* to char* for writing
-            out.write(reinterpret_cast<const char*>(entry.value.data()), value_len);
+            for (auto& [info, data] : encoded.chunks) {
+                // Holding the writer back also holds back the shard scans,
+                // which stay at most a window of shards ahead
+                ThrottleIo(io.get(), snapshot_format::kChunkHeaderSize + data.size());
+                info.offset = offset;
+                chunk_header.clear();
+                snapshot_format::EncodeChunkHeader(info, chunk_header);
+                out.Append(chunk_header.data(), chunk_header.size());
+                out.Append(data.data(), data.size());
+                offset += chunk_header.size() + data.size();
+
+                (info.tombstones ? result.num_tombstones : result.num_keys) += info.num_entries;
+                result.raw_bytes += info.raw_size;
+                index.push_back(info);
+            }
 
-            // Write metadata
-            int32_t ttl = entry.ttl_seconds.value_or(0);
-            out.write(reinterpret_cast<const char*>(&ttl), sizeof(ttl));
-            out.write(reinterpret_cast<const char*>(&entry.version), sizeof(entry.version));
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                shards_written = s + 1;
+            }
+            cv.notify_all();
+        }
 
-            // Write timestamps
-            out.write(reinterpret_cast<const char*>(&entry.created_at_ms), sizeof(entry.created_at_ms));
+        bool aborted;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            aborted = abort;
+        }
+        stop_workers();
+        if (aborted) {
+            out.Finish(false);
+            std::filesystem::remove(temp_path);
+            return false;
+        }
 
-            // Write expires_at_ms
-            int64_t expires_at = entry.expires_at_ms.value_or(0);
-            out.write(reinterpret_cast<const char*>(&expires_at), sizeof(expires_at));
+        snapshot_format::Footer footer;
+        footer.index_offset = offset;
+        footer.num_chunks = index.size();
+        footer.num_keys = result.num_keys;
+        footer.shard_count = static_cast<uint32_t>(shard_count);
+        footer.checksummed = config_.enable_checksums;
+        std::string trailer;
+        snapshot_format::EncodeIndex(index, footer,
+                                     crc32c::Value(header_str.data(), header_str.size()),
+                                     trailer);
+        out.Append(trailer.data(), trailer.size());
+        result.num_chunks = index.size();
+        result.checksum = DigestHex(footer);
+
+        if (!out.Finish(false)) {
+            LOG_ERROR("Failed to write snapshot file: {}", temp_path.string());
+            std::filesystem::remove(temp_path);
+            return false;
         }
 
-        out.close();
+        // The WAL may be truncated up to this snapshot as soon as it
+        // exists, so it must be on disk before it becomes visible
+        if (!SyncPath(temp_path, false)) {
+            LOG_ERROR("Failed to sync snapshot file: {}", temp_path.string());
+            std::filesystem::remove(temp_path);
+            return false;
+        }
 
         // Atomically rename to final location
         std::filesystem::rename(temp_path, file_path);
+        SyncPath(config_.snapshot_dir, true);
 
         return true;
     } catch (const std::exception& e) {
         LOG_ERROR("Failed to write snapshot: {}", e.what());
+        stop_workers();
         // Clean up temporary file
         std::filesystem::remove(temp_path);
         return false;
     }
 }
 
+bool SnapshotManager::RestoreChunkedSnapshot(const std::filesystem::path& file_path,
+                                             bool verify, size_t& restored, size_t& corrupt) {
+    MappedFile file;
+    if (!file.Open(file_path)) {
+        LOG_ERROR("Failed to map snapshot file: {}", file_path.string());
+        return false;
+    }
+
+    snapshot_format::Footer footer;
+    std::vector<snapshot_format::ChunkInfo> chunks;
+    if (!snapshot_format::DecodeIndex(file.data(), file.size(), footer, chunks)) {
+        LOG_ERROR("Missing or corrupt snapshot index: {}", file_path.string());
+        return false;
+    }
+
+    // Size the shards once up front instead of rehashing as they fill
+    storage_->reserve(storage_->size() + footer.num_keys);
+    auto io = IoBudget();
+
+    size_t num_threads = config_.restore_threads;
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::max<size_t>(1, std::min(num_threads, chunks.size()));
+
+    // Workers claim chunks in index order; each chunk holds one shard's
+    // entries, so its batch takes a single shard lock when the table has
+    // the same shard count as the one the snapshot was taken from. A key
+    // is in at most one chunk of a file, so chunk order does not matter
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<size_t> inserted{0};
+    std::atomic<size_t> skipped{0};
+    auto worker = [&] {
+        std::string scratch;
+        std::vector<std::pair<std::string, CacheEntry>> decoded;
+        std::vector<std::string> deleted;
+        std::vector<CacheEntry> batch;
+        while (true) {
+            size_t i = next_chunk.fetch_add(1);
+            if (i >= chunks.size()) {
+                return;
+            }
+            const auto& chunk = chunks[i];
+            ThrottleIo(io.get(), snapshot_format::kChunkHeaderSize + chunk.stored_size);
+            const char* payload = ChunkPayload(file, footer, chunk, verify);
+
+            decoded.clear();
+            deleted.clear();
+            bool ok = payload != nullptr &&
+                      (chunk.tombstones
+                           ? snapshot_format::DecodeTombstoneChunk(chunk, payload, scratch, deleted)
+                           : snapshot_format::DecodeChunk(chunk, payload, scratch, decoded));
+            if (!ok) {
+                // Lose this chunk's keys rather than the whole snapshot
+                LOG_ERROR("Skipping corrupt snapshot chunk at offset {} (shard {}, {} {}): {}",
+                          chunk.offset, chunk.shard, chunk.num_entries,
+                          chunk.tombstones ? "tombstones" : "keys", file_path.string());
+                skipped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            for (const auto& key : deleted) {
+                storage_->del(key);
+            }
+
+            batch.clear();
+            batch.reserve(decoded.size());
+            for (auto& [key, entry] : decoded) {
+                batch.push_back(std::move(entry));
+            }
+            auto results = storage_->multi_set(std::move(batch));
+            inserted.fetch_add(std::count(results.begin(), results.end(), true),
+                               std::memory_order_relaxed);
+        }
+    };
+
+    if (num_threads == 1) {
+        worker();
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < num_threads; ++i) {
+            threads.emplace_back(worker);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    restored = inserted.load();
+    corrupt = skipped.load();
+    return true;
+}
+
 bool SnapshotManager::ReadSnapshotFromFile(
     const std::filesystem::path& file_path,
     std::vector<std::pair<std::string, CacheEntry>>& entries) {
     try {
-        std::ifstream in(file_path, std::ios::binary);
-        if (!in.is_open()) {
+        // The file is read up front in large sequential (or, with
+        // io_uring, parallel) reads and parsed from memory
+        std::string contents;
+        if (!ReadWholeFile(file_path, contents, config_.use_io_uring)) {
             LOG_ERROR("Failed to open snapshot file for reading: {}", file_path.string());
             return false;
         }
+        MemoryStreamBuf memory(contents.data(), contents.size());
+        std::istream in(&memory);
 
         // Read header
-        std::string header;
-        std::getline(in, header);
-        if (header != "DISTCACHE_SNAPSHOT_V1") {
-            LOG_ERROR("Invalid snapshot header: {}", header);
+        SnapshotHeader header;
+        if (!ReadSnapshotHeader(in, header) || header.version >= 3) {
+            LOG_ERROR("Invalid snapshot header: {}", file_path.string());
             return false;
         }
+        size_t num_entries = header.num_keys;
 
-        std::string snapshot_id;
-        std::getline(in, snapshot_id);
-
-        size_t num_entries;
-        in >> num_entries;
-        in.ignore();  // Skip newline
-
-        // Read entries
+        // V1/V2: host-endian size_t lengths, kept readable for old files
         for (size_t i = 0; i < num_entries; ++i) {
             // Read key
             size_t key_len;
@@ -285,7 +997,10 @@ bool SnapshotManager::ReadSnapshotFromFile(
             entries.push_back({key, entry});
         }
 
-        in.close();
+        if (!in) {
+            LOG_ERROR("Truncated snapshot file: {}", file_path.string());
+            return false;
+        }
         return true;
     } catch (const std::exception& e) {
         LOG_ERROR("Failed to read snapshot: {}", e.what());
@@ -293,57 +1008,522 @@ bool SnapshotManager::ReadSnapshotFromFile(
     }
 }
 
-bool SnapshotManager::RestoreFromLatest() {
-    std::lock_guard<std::mutex> lock(snapshots_mutex_);
+bool SnapshotManager::ReadSnapshotHeader(std::istream& in, SnapshotHeader& header) {
+    std::string magic;
+    std::getline(in, magic);
+    if (magic == kSnapshotHeaderV1) {
+        header.version = 1;
+    } else if (magic == kSnapshotHeaderV2) {
+        header.version = 2;
+    } else if (magic == snapshot_format::kHeaderV3) {
+        header.version = 3;
+    } else if (magic == snapshot_format::kHeaderV4) {
+        header.version = 4;
+    } else {
+        return false;
+    }
+
+    std::getline(in, header.snapshot_id);
+    if (header.version >= 2) {
+        in >> header.wal_sequence;
+    }
+    if (header.version < 3) {
+        in >> header.num_keys;
+    }
+    if (header.version >= 4) {
+        in >> header.covered_ms >> header.base_id >> header.since_ms;
+        if (header.base_id == "-") {
+            header.base_id.clear();
+        }
+    }
+    in.ignore();  // Skip newline
+    return static_cast<bool>(in);
+}
 
-    if (snapshots_.empty()) {
+bool SnapshotManager::ReadSnapshotHeader(const std::filesystem::path& path,
+                                         SnapshotHeader& header) {
+    std::ifstream in(path, std::ios::binary);
+    return in.is_open() && ReadSnapshotHeader(in, header);
+}
+
+bool SnapshotManager::RestoreFromLatest() {
+    // Not under snapshots_mutex_: restoring looks snapshots up again
+    auto latest = LatestSnapshot();
+    if (!latest) {
         LOG_WARN("No snapshots available for restore");
         return false;
     }
 
-    // Sort by timestamp (latest first)
-    std::sort(snapshots_.begin(), snapshots_.end(),
-              [](const SnapshotMetadata& a, const SnapshotMetadata& b) {
-                  return a.timestamp > b.timestamp;
-              });
-
-    return RestoreFromSnapshot(snapshots_[0].snapshot_id);
+    return RestoreFromSnapshot(latest->snapshot_id);
 }
 
-bool SnapshotManager::RestoreFromSnapshot(const std::string& snapshot_id) {
+bool SnapshotManager::RestoreFromSnapshot(const std::string& snapshot_id,
+                                          bool verify_checksums) {
     LOG_INFO("Restoring from snapshot: {}", snapshot_id);
 
-    auto metadata = GetSnapshotMetadata(snapshot_id);
-    if (!metadata) {
+    if (!GetSnapshotMetadata(snapshot_id)) {
         LOG_ERROR("Snapshot not found: {}", snapshot_id);
         total_restores_failed_++;
         return false;
     }
 
-    // Read entries from snapshot
-    std::vector<std::pair<std::string, CacheEntry>> entries;
-    if (!ReadSnapshotFromFile(metadata->file_path, entries)) {
-        LOG_ERROR("Failed to read snapshot file");
+    // A delta is applied on top of everything it builds on
+    auto chain = ResolveChain(snapshot_id);
+    if (chain.empty()) {
+        LOG_ERROR("Snapshot chain of {} is incomplete", snapshot_id);
         total_restores_failed_++;
         return false;
     }
 
-    // Restore entries to storage
-    for (const auto& [key, entry] : entries) {
-        storage_->set(key, entry);
+    auto start_time = std::chrono::steady_clock::now();
+    size_t restored = 0;
+    size_t corrupt = 0;
+
+    for (const auto& link : chain) {
+        SnapshotHeader header;
+        if (!ReadSnapshotHeader(link.file_path, header)) {
+            LOG_ERROR("Invalid snapshot header: {}", link.file_path.string());
+            total_restores_failed_++;
+            return false;
+        }
+
+        if (header.version >= 3) {
+            size_t link_restored = 0;
+            size_t link_corrupt = 0;
+            if (!RestoreChunkedSnapshot(link.file_path, verify_checksums, link_restored,
+                                        link_corrupt)) {
+                LOG_ERROR("Failed to restore snapshot file");
+                total_restores_failed_++;
+                return false;
+            }
+            restored += link_restored;
+            corrupt += link_corrupt;
+            continue;
+        }
+
+        // Read entries from snapshot
+        std::error_code size_ec;
+        auto file_size = std::filesystem::file_size(link.file_path, size_ec);
+        ThrottleIo(IoBudget().get(), size_ec ? 0 : static_cast<size_t>(file_size));
+        std::vector<std::pair<std::string, CacheEntry>> entries;
+        if (!ReadSnapshotFromFile(link.file_path, entries)) {
+            LOG_ERROR("Failed to read snapshot file");
+            total_restores_failed_++;
+            return false;
+        }
+
+        // Restore entries to storage
+        storage_->reserve(storage_->size() + entries.size());
+        for (const auto& [key, entry] : entries) {
+            storage_->set(key, entry);
+        }
+        restored += entries.size();
     }
 
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time);
     total_restores_++;
-    LOG_INFO("Restored {} keys from snapshot: {}", entries.size(), snapshot_id);
+    last_restore_duration_ms_.store(duration.count());
+    last_restore_keys_.store(restored);
+    last_restore_corrupt_chunks_.store(corrupt);
+    total_corrupt_chunks_ += corrupt;
+    LOG_INFO("Restored {} keys from snapshot: {} ({} files, {}ms)", restored, snapshot_id,
+             chain.size(), duration.count());
+    if (corrupt > 0) {
+        LOG_WARN("Snapshot {} restored without {} corrupt chunks", snapshot_id, corrupt);
+    }
 
     return true;
 }
 
+struct SnapshotManager::LazyRestore {
+    std::string snapshot_id;
+    bool verify = true;
+    std::vector<std::filesystem::path> paths;
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<snapshot_format::Footer> footers;
+    std::vector<std::vector<std::vector<snapshot_format::ChunkInfo>>> shard_chunks;  // [file][shard]
+    std::chrono::steady_clock::time_point started;
+
+    std::atomic<size_t> keys{0};
+    std::atomic<size_t> corrupt{0};
+    std::atomic<uint64_t> faulted{0};
+    std::atomic<uint64_t> background{0};
+    std::atomic<int64_t> duration_ms{0};
+
+    // Fold one shard across the chain: later files win and tombstones
+    // remove. Corrupt chunks lose their keys, as in an eager restore
+    std::vector<CacheEntry> LoadShard(size_t shard, bool on_demand) {
+        if (on_demand) {
+            faulted.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::unordered_map<std::string, CacheEntry> state;
+        std::string scratch;
+        std::vector<std::pair<std::string, CacheEntry>> decoded;
+        std::vector<std::string> deleted;
+        for (size_t f = 0; f < files.size(); ++f) {
+            for (const auto& chunk : shard_chunks[f][shard]) {
+                const char* payload = ChunkPayload(*files[f], footers[f], chunk, verify);
+                decoded.clear();
+                deleted.clear();
+                bool ok = payload != nullptr &&
+                          (chunk.tombstones
+                               ? snapshot_format::DecodeTombstoneChunk(chunk, payload, scratch, deleted)
+                               : snapshot_format::DecodeChunk(chunk, payload, scratch, decoded));
+                if (!ok) {
+                    LOG_ERROR("Skipping corrupt snapshot chunk at offset {} (shard {}): {}",
+                              chunk.offset, chunk.shard, paths[f].string());
+                    corrupt.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                for (const auto& key : deleted) {
+                    state.erase(key);
+                }
+                for (auto& [key, entry] : decoded) {
+                    state.insert_or_assign(std::move(key), std::move(entry));
+                }
+            }
+        }
+
+        std::vector<CacheEntry> entries;
+        entries.reserve(state.size());
+        for (auto& [key, entry] : state) {
+            entries.push_back(std::move(entry));
+        }
+        keys.fetch_add(entries.size(), std::memory_order_relaxed);
+        return entries;
+    }
+};
+
+bool SnapshotManager::BeginLazyRestore(const std::string& snapshot_id, bool verify_checksums) {
+    if (storage_->shards_pending_load() > 0) {
+        LOG_ERROR("Cannot restore {} lazily: a lazy restore is still loading", snapshot_id);
+        return false;
+    }
+    auto chain = ResolveChain(snapshot_id);
+    if (chain.empty()) {
+        LOG_ERROR("Snapshot {} or a snapshot it builds on is missing", snapshot_id);
+        return false;
+    }
+
+    // Only the indexes are read now; chunks stay in the mappings until
+    // their shard is loaded
+    auto restore = std::make_shared<LazyRestore>();
+    restore->snapshot_id = snapshot_id;
+    restore->verify = verify_checksums;
+    const size_t shard_count = storage_->shard_count();
+    std::vector<uint64_t> delta_keys(shard_count, 0);
+    std::vector<uint64_t> stored_bytes(shard_count, 0);
+    size_t base_keys = 0;
+    for (size_t f = 0; f < chain.size(); ++f) {
+        const auto& link = chain[f];
+        auto file = std::make_unique<MappedFile>();
+        snapshot_format::Footer footer;
+        std::vector<snapshot_format::ChunkInfo> chunks;
+        if (!file->Open(link.file_path) ||
+            !snapshot_format::DecodeIndex(file->data(), file->size(), footer, chunks)) {
+            LOG_WARN("Cannot restore {} lazily: {} is not a readable chunked snapshot",
+                     snapshot_id, link.snapshot_id);
+            return false;
+        }
+        // Chunks are loaded into the shard they were taken from
+        if (footer.shard_count != shard_count) {
+            LOG_WARN("Cannot restore {} lazily: {} was taken with {} shards, table has {}",
+                     snapshot_id, link.snapshot_id, footer.shard_count, shard_count);
+            return false;
+        }
+
+        std::vector<std::vector<snapshot_format::ChunkInfo>> by_shard(shard_count);
+        for (const auto& chunk : chunks) {
+            if (chunk.shard >= shard_count) {
+                LOG_ERROR("Cannot restore {}: chunk for shard {} of {}",
+                          link.snapshot_id, chunk.shard, shard_count);
+                return false;
+            }
+            if (f > 0) {
+                delta_keys[chunk.shard] += chunk.num_entries;
+            }
+            stored_bytes[chunk.shard] += snapshot_format::kChunkHeaderSize + chunk.stored_size;
+            by_shard[chunk.shard].push_back(chunk);
+        }
+        if (f == 0) {
+            base_keys = footer.num_keys;
+        }
+        restore->paths.push_back(link.file_path);
+        restore->files.push_back(std::move(file));
+        restore->footers.push_back(footer);
+        restore->shard_chunks.push_back(std::move(by_shard));
+    }
+
+    // Recently written keys are the likeliest to be read soon, and large
+    // shards stall a faulting request the longest
+    std::vector<size_t> order(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (delta_keys[a] != delta_keys[b]) {
+            return delta_keys[a] > delta_keys[b];
+        }
+        return stored_bytes[a] > stored_bytes[b];
+    });
+
+    storage_->reserve(storage_->size() + base_keys);
+    restore->started = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(lazy_mutex_);
+    if (lazy_thread_.joinable()) {
+        lazy_thread_.join();  // The previous lazy restore has finished loading
+    }
+    lazy_restore_ = restore;
+    lazy_stop_.store(false);
+    storage_->begin_lazy_load([restore](size_t shard, bool on_demand) {
+        return restore->LoadShard(shard, on_demand);
+    });
+    lazy_thread_ = std::thread(&SnapshotManager::LazyRestoreWorker, this, restore,
+                               std::move(order));
+
+    LOG_INFO("Restoring snapshot {} lazily ({} files, {} shards pending)", snapshot_id,
+             chain.size(), shard_count);
+    return true;
+}
+
+void SnapshotManager::LazyRestoreWorker(std::shared_ptr<LazyRestore> restore,
+                                        std::vector<size_t> order) {
+    for (size_t shard : order) {
+        if (lazy_stop_.load()) {
+            LOG_INFO("Lazy restore of {} stopped with {} shards pending",
+                     restore->snapshot_id, storage_->shards_pending_load());
+            return;
+        }
+        if (!storage_->load_shard(shard)) {
+            continue;  // A request got there first
+        }
+        restore->background.fetch_add(1, std::memory_order_relaxed);
+
+        size_t bytes = 0;
+        for (const auto& file_chunks : restore->shard_chunks) {
+            for (const auto& chunk : file_chunks[shard]) {
+                bytes += snapshot_format::kChunkHeaderSize + chunk.stored_size;
+            }
+        }
+        ThrottleIo(IoBudget().get(), bytes);  // Usually attached after recovery
+    }
+
+    // load_shard waited for any shard a request was still loading
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - restore->started);
+    restore->duration_ms.store(std::max<int64_t>(1, duration.count()));  // 0 reads as loading
+    size_t corrupt = restore->corrupt.load();
+    total_restores_++;
+    last_restore_duration_ms_.store(duration.count());
+    last_restore_keys_.store(restore->keys.load());
+    last_restore_corrupt_chunks_.store(corrupt);
+    total_corrupt_chunks_ += corrupt;
+    LOG_INFO("Lazy restore of {} complete: {} keys in {}ms ({} shards faulted in by requests, "
+             "{} loaded in the background)", restore->snapshot_id, restore->keys.load(),
+             duration.count(), restore->faulted.load(), restore->background.load());
+    if (corrupt > 0) {
+        LOG_WARN("Snapshot {} restored without {} corrupt chunks", restore->snapshot_id, corrupt);
+    }
+}
+
+void SnapshotManager::WaitForLazyRestore() {
+    std::lock_guard<std::mutex> lock(lazy_mutex_);
+    if (lazy_thread_.joinable()) {
+        lazy_thread_.join();
+    }
+}
+
+void SnapshotManager::StopLazyRestore() {
+    lazy_stop_.store(true);
+    WaitForLazyRestore();
+}
+
+bool SnapshotManager::ShipSnapshot(const std::string& snapshot_id, const KeyFilter& filter,
+                                   const ChunkSink& sink) {
+    auto chain = ResolveChain(snapshot_id);
+    if (chain.empty()) {
+        LOG_ERROR("Cannot ship snapshot {}: it or a snapshot it builds on is missing",
+                  snapshot_id);
+        return false;
+    }
+
+    // Map the whole chain first; retention may delete files meanwhile
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<snapshot_format::Footer> footers;
+    std::vector<std::vector<snapshot_format::ChunkInfo>> file_chunks;
+    for (const auto& link : chain) {
+        auto file = std::make_unique<MappedFile>();
+        snapshot_format::Footer footer;
+        std::vector<snapshot_format::ChunkInfo> chunks;
+        if (!file->Open(link.file_path) ||
+            !snapshot_format::DecodeIndex(file->data(), file->size(), footer, chunks)) {
+            LOG_ERROR("Cannot ship {}: not a readable chunked snapshot", link.snapshot_id);
+            return false;
+        }
+        files.push_back(std::move(file));
+        footers.push_back(footer);
+        file_chunks.push_back(std::move(chunks));
+    }
+
+    size_t num_threads = config_.snapshot_threads;
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const auto codec = config_.enable_compression ? compression::DefaultCodec()
+                                                  : compression::Codec::kNone;
+
+    auto io = IoBudget();
+    std::mutex sink_mutex;
+    std::atomic<bool> failed{false};
+    for (size_t f = 0; f < files.size() && !failed.load(); ++f) {
+        const auto& chunks = file_chunks[f];
+        std::atomic<size_t> next_chunk{0};
+
+        // Workers prepare chunks in any order; only the sink is serial
+        auto worker = [&] {
+            std::string scratch;
+            std::vector<std::pair<std::string, CacheEntry>> decoded;
+            std::vector<std::string> deleted;
+            while (!failed.load(std::memory_order_relaxed)) {
+                size_t i = next_chunk.fetch_add(1);
+                if (i >= chunks.size()) {
+                    return;
+                }
+                const auto& chunk = chunks[i];
+                ThrottleIo(io.get(), snapshot_format::kChunkHeaderSize + chunk.stored_size);
+                const char* payload = ChunkPayload(*files[f], footers[f], chunk, true);
+                if (!payload) {
+                    LOG_ERROR("Not shipping corrupt snapshot chunk at offset {}: {}",
+                              chunk.offset, chain[f].file_path.string());
+                    failed.store(true);
+                    return;
+                }
+
+                ShippedChunk shipped;
+                shipped.file_index = f;
+                if (!filter) {
+                    shipped.data.assign(payload - snapshot_format::kChunkHeaderSize,
+                                        snapshot_format::kChunkHeaderSize + chunk.stored_size);
+                    shipped.num_entries = chunk.num_entries;
+                } else {
+                    // Re-encode only the entries the receiver asked for
+                    std::string raw;
+                    snapshot_format::ChunkInfo info;
+                    info.shard = chunk.shard;
+                    info.tombstones = chunk.tombstones;
+                    bool ok;
+                    if (chunk.tombstones) {
+                        deleted.clear();
+                        ok = snapshot_format::DecodeTombstoneChunk(chunk, payload, scratch, deleted);
+                        for (const auto& key : deleted) {
+                            if (filter(key)) {
+                                // Restores never read the deletion time
+                                snapshot_format::EncodeTombstone(key, 0, raw);
+                                info.num_entries++;
+                            }
+                        }
+                    } else {
+                        decoded.clear();
+                        ok = snapshot_format::DecodeChunk(chunk, payload, scratch, decoded);
+                        for (const auto& [key, entry] : decoded) {
+                            if (filter(key)) {
+                                snapshot_format::EncodeEntry(key, entry, raw);
+                                info.num_entries++;
+                            }
+                        }
+                    }
+                    if (!ok) {
+                        LOG_ERROR("Not shipping undecodable snapshot chunk at offset {}: {}",
+                                  chunk.offset, chain[f].file_path.string());
+                        failed.store(true);
+                        return;
+                    }
+                    if (info.num_entries == 0) {
+                        continue;
+                    }
+                    snapshot_format::CompressChunk(codec, raw, info);
+                    snapshot_format::EncodeChunkHeader(info, shipped.data);
+                    shipped.data.append(raw);
+                    shipped.num_entries = info.num_entries;
+                }
+                // Verbatim chunks of checksummed files already carry it
+                shipped.checksum = !filter && footers[f].checksummed
+                                       ? chunk.checksum
+                                       : crc32c::Value(shipped.data.data(), shipped.data.size());
+
+                std::lock_guard<std::mutex> lock(sink_mutex);
+                if (failed.load() || !sink(shipped)) {
+                    failed.store(true);
+                    return;
+                }
+            }
+        };
+
+        size_t threads = std::max<size_t>(1, std::min(num_threads, chunks.size()));
+        if (threads == 1) {
+            worker();
+        } else {
+            std::vector<std::thread> workers;
+            for (size_t i = 0; i < threads; ++i) {
+                workers.emplace_back(worker);
+            }
+            for (auto& thread : workers) {
+                thread.join();
+            }
+        }
+    }
+    return !failed.load();
+}
+
+bool SnapshotManager::ApplyShippedChunk(ShardedHashTable& storage, const std::string& data,
+                                        uint32_t checksum, size_t& applied) {
+    applied = 0;
+    snapshot_format::ChunkInfo info;
+    if (!snapshot_format::DecodeChunkHeader(data.data(), data.size(), info) ||
+        data.size() != snapshot_format::kChunkHeaderSize + info.stored_size ||
+        crc32c::Value(data.data(), data.size()) != checksum) {
+        return false;
+    }
+
+    std::string scratch;
+    const char* payload = data.data() + snapshot_format::kChunkHeaderSize;
+    if (info.tombstones) {
+        std::vector<std::string> deleted;
+        if (!snapshot_format::DecodeTombstoneChunk(info, payload, scratch, deleted)) {
+            return false;
+        }
+        for (const auto& key : deleted) {
+            storage.del(key);
+        }
+        applied = deleted.size();
+        return true;
+    }
+
+    std::vector<std::pair<std::string, CacheEntry>> decoded;
+    if (!snapshot_format::DecodeChunk(info, payload, scratch, decoded)) {
+        return false;
+    }
+    std::vector<CacheEntry> batch;
+    batch.reserve(decoded.size());
+    for (auto& [key, entry] : decoded) {
+        batch.push_back(std::move(entry));
+    }
+    auto results = storage.multi_set(std::move(batch));
+    applied = std::count(results.begin(), results.end(), true);
+    return true;
+}
+
 std::vector<SnapshotManager::SnapshotMetadata> SnapshotManager::ListSnapshots() const {
     std::lock_guard<std::mutex> lock(snapshots_mutex_);
     return snapshots_;
 }
 
+std::vector<SnapshotManager::SnapshotMetadata> SnapshotManager::ListUnreadableSnapshots() const {
+    std::lock_guard<std::mutex> lock(snapshots_mutex_);
+    return unreadable_snapshots_;
+}
+
 std::optional<SnapshotManager::SnapshotMetadata>
 SnapshotManager::GetSnapshotMetadata(const std::string& snapshot_id) const {
     std::lock_guard<std::mutex> lock(snapshots_mutex_);
@@ -360,29 +1540,46 @@ SnapshotManager::GetSnapshotMetadata(const std::string& snapshot_id) const {
 void SnapshotManager::PruneOldSnapshots() {
     std::lock_guard<std::mutex> lock(snapshots_mutex_);
 
-    if (snapshots_.size() <= config_.max_snapshots_retained) {
-        return;  // Nothing to prune
-    }
-
-    // Sort by timestamp (oldest first)
+    // Sort by timestamp (oldest first), so a base comes before its deltas
     std::sort(snapshots_.begin(), snapshots_.end(),
               [](const SnapshotMetadata& a, const SnapshotMetadata& b) {
                   return a.timestamp < b.timestamp;
               });
 
-    // Delete old snapshots
-    size_t to_delete = snapshots_.size() - config_.max_snapshots_retained;
-    for (size_t i = 0; i < to_delete; ++i) {
+    // Retention counts full snapshots; deltas go with their base, and
+    // a delta whose base is gone can never be restored
+    size_t full = std::count_if(snapshots_.begin(), snapshots_.end(),
+                                [](const SnapshotMetadata& meta) { return !meta.is_delta(); });
+    size_t to_delete = full > config_.max_snapshots_retained
+                           ? full - config_.max_snapshots_retained
+                           : 0;
+
+    std::vector<SnapshotMetadata> kept;
+    std::unordered_set<std::string> kept_ids;
+    for (const auto& snapshot : snapshots_) {
+        bool remove;
+        if (snapshot.is_delta()) {
+            remove = kept_ids.count(snapshot.base_id) == 0;
+        } else {
+            remove = to_delete > 0;
+            to_delete -= remove ? 1 : 0;
+        }
+
+        if (!remove) {
+            kept_ids.insert(snapshot.snapshot_id);
+            kept.push_back(snapshot);
+            continue;
+        }
         try {
-            std::filesystem::remove(snapshots_[i].file_path);
-            LOG_INFO("Deleted old snapshot: {}", snapshots_[i].snapshot_id);
+            std::filesystem::remove(snapshot.file_path);
+            LOG_INFO("Deleted old snapshot: {}", snapshot.snapshot_id);
         } catch (const std::exception& e) {
             LOG_ERROR("Failed to delete snapshot file: {}", e.what());
         }
     }
 
     // Remove from metadata list
-    snapshots_.erase(snapshots_.begin(), snapshots_.begin() + to_delete);
+    snapshots_ = std::move(kept);
 }
 
 void SnapshotManager::SetSnapshotCallback(SnapshotCallback callback) {
@@ -390,6 +1587,27 @@ void SnapshotManager::SetSnapshotCallback(SnapshotCallback callback) {
     callback_ = std::move(callback);
 }
 
+void SnapshotManager::SetSequenceSource(SequenceSource source) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    sequence_source_ = std::move(source);
+}
+
+void SnapshotManager::SetIoScheduler(std::shared_ptr<IoScheduler> scheduler) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    io_scheduler_ = std::move(scheduler);
+}
+
+std::shared_ptr<IoScheduler> SnapshotManager::IoBudget() {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    return io_scheduler_;
+}
+
+void SnapshotManager::ThrottleIo(IoScheduler* scheduler, size_t bytes) {
+    if (scheduler) {
+        io_throttled_us_ += static_cast<uint64_t>(scheduler->Acquire(bytes).count());
+    }
+}
+
 SnapshotManager::Stats SnapshotManager::GetStats() const {
     Stats stats;
     stats.total_snapshots_created = total_snapshots_created_.load();
@@ -399,33 +1617,40 @@ SnapshotManager::Stats SnapshotManager::GetStats() const {
     stats.last_snapshot_timestamp = last_snapshot_timestamp_.load();
     stats.last_snapshot_duration_ms = last_snapshot_duration_ms_.load();
     stats.last_snapshot_size_bytes = last_snapshot_size_bytes_.load();
+    stats.last_restore_duration_ms = last_restore_duration_ms_.load();
+    stats.last_restore_keys = last_restore_keys_.load();
+    stats.last_restore_corrupt_chunks = last_restore_corrupt_chunks_.load();
+    stats.total_corrupt_chunks = total_corrupt_chunks_.load();
+    stats.total_deltas_created = total_deltas_created_.load();
+    stats.total_merges = total_merges_.load();
+    stats.io_throttled_ms = io_throttled_us_.load() / 1000;
+    {
+        std::lock_guard<std::mutex> lock(lazy_mutex_);
+        if (lazy_restore_) {
+            stats.lazy_shards_pending = storage_->shards_pending_load();
+            stats.lazy_shards_faulted = lazy_restore_->faulted.load();
+            stats.lazy_shards_background = lazy_restore_->background.load();
+            stats.lazy_restore_ms = lazy_restore_->duration_ms.load();
+        }
+    }
     return stats;
 }
 
-std::string SnapshotManager::GenerateSnapshotId() {
+std::string SnapshotManager::GenerateSnapshotId(const char* prefix) {
     auto now = std::chrono::system_clock::now();
     auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
         now.time_since_epoch()).count();
 
-    std::ostringstream oss;
-    oss << "snapshot-" << config_.node_id << "-" << timestamp;
-    return oss.str();
-}
-
-std::string SnapshotManager::CalculateChecksum(
-    const std::vector<std::pair<std::string, CacheEntry>>& entries) {
-    // Simple checksum: hash of all keys and values concatenated
-    // In production, use SHA256 or similar
-    std::hash<std::string> hasher;
-    size_t checksum = 0;
-
-    for (const auto& [key, entry] : entries) {
-        std::string value_str(entry.value.begin(), entry.value.end());
-        checksum ^= hasher(key) + hasher(value_str) + 0x9e3779b9 + (checksum << 6) + (checksum >> 2);
+    // Never reuse an ID: two snapshots in the same millisecond would
+    // otherwise share a file and metadata entry
+    {
+        std::lock_guard<std::mutex> lock(snapshots_mutex_);
+        timestamp = std::max<int64_t>(timestamp, last_id_timestamp_ + 1);
+        last_id_timestamp_ = timestamp;
     }
 
     std::ostringstream oss;
-    oss << std::hex << std::setfill('0') << std::setw(16) << checksum;
+    oss << prefix << "-" << config_.node_id << "-" << timestamp;
     return oss.str();
 }
 
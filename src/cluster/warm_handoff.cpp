@@ -0,0 +1,345 @@
+#include "distcache/warm_handoff.h"
+#include "distcache/logger.h"
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace distcache {
+
+namespace {
+
+constexpr size_t kMaxLineBytes = 4096;
+
+bool FillAddress(const std::filesystem::path& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    const std::string& native = path.native();
+    if (native.empty() || native.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    std::memcpy(addr.sun_path, native.c_str(), native.size() + 1);
+    return true;
+}
+
+bool WriteLine(int fd, const std::string& line) {
+    std::string data = line + "\n";
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Read one line, byte by byte so nothing past it is consumed; false on
+// timeout, hangup or an overlong line
+bool ReadLine(int fd, uint32_t timeout_ms, std::string& line) {
+    line.clear();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (line.size() < kMaxLineBytes) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            return false;
+        }
+        pollfd pfd{fd, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, static_cast<int>(remaining));
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            return false;
+        }
+        char c;
+        ssize_t n = ::recv(fd, &c, 1, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        if (c == '\n') {
+            return true;
+        }
+        line.push_back(c);
+    }
+    return false;
+}
+
+void RemoveSegment(const handoff::Config& config) {
+    std::error_code ec;
+    std::filesystem::remove_all(handoff::SegmentPath(config), ec);
+}
+
+// Segments are written once and read from memory: skip compression
+SnapshotManager::Config SegmentConfig(const handoff::Config& config) {
+    SnapshotManager::Config segment;
+    segment.node_id = config.node_id;
+    segment.snapshot_dir = handoff::SegmentPath(config);
+    segment.snapshot_interval_seconds = 0;
+    segment.max_snapshots_retained = 1;
+    segment.enable_compression = false;
+    return segment;
+}
+
+} // namespace
+
+std::filesystem::path handoff::SegmentPath(const Config& config) {
+    return config.segment_dir / ("distcache-handoff-" + config.node_id);
+}
+
+// ====================
+// HandoffServer
+// ====================
+
+HandoffServer::HandoffServer(const handoff::Config& config,
+                             std::shared_ptr<ShardedHashTable> storage,
+                             Callbacks callbacks)
+    : config_(config), storage_(std::move(storage)), callbacks_(std::move(callbacks)) {}
+
+HandoffServer::~HandoffServer() {
+    Stop();
+}
+
+bool HandoffServer::Start() {
+    sockaddr_un addr;
+    if (!FillAddress(config_.socket_path, addr)) {
+        LOG_ERROR("Invalid handoff socket path: {}", config_.socket_path.string());
+        return false;
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("Failed to create handoff socket: {}", std::strerror(errno));
+        return false;
+    }
+
+    // A socket left at the path belongs to a process this one replaced
+    ::unlink(config_.socket_path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(fd, 1) != 0) {
+        LOG_ERROR("Failed to listen on handoff socket {}: {}", config_.socket_path.string(),
+                  std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    listen_fd_ = fd;
+    running_.store(true);
+    accept_thread_ = std::thread(&HandoffServer::AcceptLoop, this);
+    LOG_INFO("Accepting warm handoffs on {}", config_.socket_path.string());
+    return true;
+}
+
+void HandoffServer::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (accept_thread_.joinable()) {
+        accept_thread_.join();
+    }
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+
+    // After a handoff the path is the new process's socket
+    if (!handed_off_.load()) {
+        ::unlink(config_.socket_path.c_str());
+    }
+}
+
+void HandoffServer::AcceptLoop() {
+    while (running_.load() && !handed_off_.load()) {
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        Serve(fd);
+        ::close(fd);
+    }
+}
+
+bool HandoffServer::Serve(int fd) {
+    std::string line;
+    if (!ReadLine(fd, config_.timeout_ms, line)) {
+        return false;
+    }
+    std::istringstream request(line);
+    std::string command;
+    uint32_t protocol = 0;
+    uint32_t layout = 0;
+    request >> command >> protocol >> layout;
+    if (command != "TAKEOVER" || protocol != handoff::kProtocolVersion ||
+        layout != handoff::kLayoutVersion) {
+        LOG_WARN("Rejecting handoff request: {}", line);
+        WriteLine(fd, "ERROR unsupported protocol or layout version");
+        return false;
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    LOG_INFO("Handing off to a new process: freezing writes");
+
+    // No write may land after the WAL is released or miss the segment
+    storage_->freeze_writes();
+    int64_t wal_sequence = callbacks_.release ? callbacks_.release() : 0;
+
+    auto give_back = [&](const std::string& reason) {
+        LOG_WARN("Warm handoff aborted ({}), resuming service", reason);
+        RemoveSegment(config_);
+        if (callbacks_.reclaim) {
+            callbacks_.reclaim();
+        }
+        storage_->thaw_writes();
+        return false;
+    };
+
+    RemoveSegment(config_);
+    std::string segment_id;
+    size_t keys = 0;
+    {
+        SnapshotManager segment(SegmentConfig(config_), storage_, std::make_shared<Metrics>());
+        segment.SetSequenceSource([wal_sequence] { return wal_sequence; });
+        segment_id = segment.CreateSnapshot();
+        if (!segment_id.empty()) {
+            keys = segment.GetSnapshotMetadata(segment_id)->num_keys;
+        }
+    }
+    if (segment_id.empty()) {
+        WriteLine(fd, "ERROR failed to write the segment");
+        return give_back("segment write failed");
+    }
+
+    std::ostringstream ready;
+    ready << "READY " << segment_id << " " << wal_sequence << " " << keys;
+    if (!WriteLine(fd, ready.str())) {
+        return give_back("new process hung up");
+    }
+    auto export_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    LOG_INFO("Handoff segment {} ready: {} keys in {}ms", segment_id, keys, export_ms);
+
+    if (!ReadLine(fd, config_.timeout_ms, line) || line != "TAKEN") {
+        return give_back("no confirmation from the new process");
+    }
+
+    // A failed send never reached the new process, which will not open
+    // the WAL without it; once sent, the table is gone for good
+    if (!WriteLine(fd, "RELEASED")) {
+        return give_back("new process hung up before the release");
+    }
+
+    handed_off_.store(true);
+    LOG_INFO("Warm handoff complete, the new process owns the table");
+    if (callbacks_.handed_off) {
+        callbacks_.handed_off();
+    }
+    return true;
+}
+
+// ====================
+// HandoffClient
+// ====================
+
+HandoffClient::HandoffClient(const handoff::Config& config,
+                             std::shared_ptr<ShardedHashTable> storage)
+    : config_(config), storage_(std::move(storage)) {}
+
+HandoffClient::~HandoffClient() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+HandoffClient::Result HandoffClient::Attach() {
+    Result result;
+    auto start_time = std::chrono::steady_clock::now();
+    auto fail = [&](const std::string& error) {
+        result.error = error;
+        LOG_ERROR("Warm handoff failed: {}", error);
+        Abort();
+        return result;
+    };
+
+    sockaddr_un addr;
+    if (!FillAddress(config_.socket_path, addr)) {
+        return fail("invalid socket path " + config_.socket_path.string());
+    }
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0 || ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        return fail("cannot connect to " + config_.socket_path.string() + ": " +
+                    std::strerror(errno));
+    }
+
+    std::ostringstream request;
+    request << "TAKEOVER " << handoff::kProtocolVersion << " " << handoff::kLayoutVersion;
+    std::string line;
+    if (!WriteLine(fd_, request.str()) || !ReadLine(fd_, config_.timeout_ms, line)) {
+        return fail("no reply from the running process");
+    }
+
+    std::istringstream reply(line);
+    std::string status;
+    reply >> status >> result.segment_id >> result.wal_sequence >> result.keys;
+    if (status != "READY" || !reply) {
+        return fail("running process refused: " + line);
+    }
+
+    // Map the segment in place when the shard layout matches, else copy
+    segment_ = std::make_shared<SnapshotManager>(SegmentConfig(config_), storage_,
+                                                 std::make_shared<Metrics>());
+    if (segment_->BeginLazyRestore(result.segment_id)) {
+        result.lazy = true;
+    } else if (!segment_->RestoreFromSnapshot(result.segment_id)) {
+        return fail("cannot attach segment " + result.segment_id);
+    }
+
+    result.success = true;
+    result.duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    LOG_INFO("Attached handoff segment {} ({} keys, {}) in {}ms", result.segment_id,
+             result.keys, result.lazy ? "loading lazily" : "copied", result.duration_ms);
+    return result;
+}
+
+bool HandoffClient::Confirm() {
+    std::string line;
+    if (fd_ < 0 || !WriteLine(fd_, "TAKEN") || !ReadLine(fd_, config_.timeout_ms, line) ||
+        line != "RELEASED") {
+        Abort();
+        return false;
+    }
+    ::close(fd_);
+    fd_ = -1;
+
+    // Loaded shards no longer need it and the rest are mapped
+    RemoveSegment(config_);
+    return true;
+}
+
+void HandoffClient::Abort() {
+    if (fd_ >= 0) {
+        ::close(fd_);  // The old process sees the hangup and resumes
+        fd_ = -1;
+    }
+}
+
+void HandoffClient::WaitForLoad() {
+    if (segment_) {
+        segment_->WaitForLazyRestore();
+    }
+}
+
+} // namespace distcache
@@ -0,0 +1,116 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "distcache/logger.h"
+#include "distcache/static_dataset.h"
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]\n"
+              << "Build a read-only dataset file for DistCacheLayer (see --dataset on the server)\n\n"
+              << "Options:\n"
+              << "  --input PATH         Tab-separated records, one \"key<TAB>value\" per line\n"
+              << "                       (default: - for stdin)\n"
+              << "  --output PATH        Dataset file to write, replaced atomically\n"
+              << "  --verify PATH        Check an existing dataset file instead of building one\n"
+              << "  --help, -h           Show this help message\n\n"
+              << "Examples:\n"
+              << "  # Build tonight's version; a server mounting it swaps it in\n"
+              << "  " << program_name << " --input countries.tsv --output /data/geo.dataset\n\n"
+              << "  # Check a file end to end\n"
+              << "  " << program_name << " --verify /data/geo.dataset\n";
+}
+
+int verify(const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+    auto dataset = distcache::StaticDataset::Open(path, /*verify=*/true);
+    if (!dataset) {
+        return 1;
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Dataset:      " << path << "\n"
+              << "Keys:         " << dataset->size() << "\n"
+              << "File bytes:   " << dataset->file_bytes() << "\n"
+              << "Index bytes:  " << dataset->index_bytes() << "\n"
+              << "Built at ms:  " << dataset->built_at_ms() << "\n"
+              << "Checksum OK in " << ms << "ms\n";
+    return 0;
+}
+
+int build(const std::string& input, const std::string& output) {
+    std::ifstream file;
+    if (input != "-") {
+        file.open(input);
+        if (!file) {
+            std::cerr << "Error: cannot open " << input << "\n";
+            return 1;
+        }
+    }
+    std::istream& in = input == "-" ? std::cin : file;
+
+    distcache::StaticDatasetBuilder builder;
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(in, line)) {
+        ++line_number;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos) {
+            std::cerr << "Error: line " << line_number << " has no tab separator\n";
+            return 1;
+        }
+        builder.Add(std::string_view(line).substr(0, tab),
+                    std::string_view(line).substr(tab + 1));
+    }
+
+    if (!builder.Write(output)) {
+        return 1;
+    }
+    return verify(output);
+}
+
+int main(int argc, char** argv) {
+    std::string input = "-";
+    std::string output;
+    std::string verify_path;
+
+    // Parse command line arguments
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (arg == "--input" && i + 1 < argc) {
+            input = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--verify" && i + 1 < argc) {
+            verify_path = argv[++i];
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n\n";
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (output.empty() && verify_path.empty()) {
+        std::cerr << "Error: --output or --verify is required\n\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    distcache::Logger::init("dataset_builder", "info", "");
+
+    if (!verify_path.empty()) {
+        return verify(verify_path);
+    }
+    return build(input, output);
+}
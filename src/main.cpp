@@ -1,9 +1,17 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <optional>
+#include <thread>
+#include <vector>
 
 #include <grpc++/grpc++.h>
+#include <google/protobuf/arena.h>
 #include "cache_service.grpc.pb.h"
 #include "distcache/storage_engine.h"
 #include "distcache/logger.h"
@@ -12,10 +20,20 @@
 #include "distcache/auth_token.h"
 #include "distcache/validator.h"
 #include "distcache/rate_limiter.h"
+#include "distcache/request_pipeline.h"
+#include "distcache/resp_server.h"
+#include "distcache/wal.h"
+#include "distcache/snapshot_manager.h"
+#include "distcache/recovery_manager.h"
+#include "distcache/io_scheduler.h"
+#include "distcache/admin_service.h"
+#include "distcache/warm_handoff.h"
+#include "distcache/static_dataset.h"
 
 using grpc::Server;
 using grpc::ServerBuilder;
 using grpc::ServerContext;
+using grpc::ServerReaderWriter;
 using grpc::Status;
 using distcache::v1::CacheService;
 using distcache::v1::GetRequest;
@@ -30,61 +48,112 @@ using distcache::v1::GetMetricsRequest;
 using distcache::v1::GetMetricsResponse;
 using distcache::v1::CompareAndSwapRequest;
 using distcache::v1::CompareAndSwapResponse;
-
-// Global security components (initialized in main)
-std::shared_ptr<distcache::AuthManager> g_auth_manager = nullptr;
-std::shared_ptr<distcache::Validator> g_validator = nullptr;
-std::shared_ptr<distcache::RateLimiter> g_rate_limiter = nullptr;
-bool g_require_auth = false;
+using distcache::v1::BatchGetRequest;
+using distcache::v1::BatchGetResponse;
+using distcache::v1::BatchSetRequest;
+using distcache::v1::BatchSetResponse;
+using distcache::v1::PipelineRequest;
+using distcache::v1::PipelineResponse;
 
 namespace distcache {
 
+/**
+ * On-disk persistence settings. When enabled, the server recovers from
+ * data_dir at startup and logs every write to the WAL.
+ */
+struct PersistenceConfig {
+    std::filesystem::path data_dir;
+    std::string node_id = "node1";
+    WAL::Config wal;
+    uint32_t snapshot_interval_seconds = 3600;
+    uint32_t snapshot_delta_interval_seconds = 0;  // 0 = full snapshots only
+    IoScheduler::Config io;  // Budget for snapshots, restores and WAL compaction
+    bool lazy_restore = false;  // Serve while the snapshot loads
+};
+
+/**
+ * Warm restarts (see warm_handoff.h): listen for a new process taking
+ * over, and/or start by taking over the process on the socket.
+ */
+struct HandoffOptions {
+    handoff::Config config;
+    bool takeover = false;
+};
+
+/**
+ * Read-only datasets mounted as key namespaces (see static_dataset.h).
+ */
+struct DatasetOptions {
+    std::vector<std::pair<std::string, std::filesystem::path>> mounts;  // name, file
+    StaticDatasets::Config config;
+};
+
+/**
+ * CacheService implementation, specialized at startup for the enabled
+ * request pipeline stages (see MakeRequestPipeline).
+ */
+template<typename RequestPipelineT>
 class CacheServiceImpl final : public CacheService::Service {
 public:
-    CacheServiceImpl() : storage_(256, 1024 * 1024 * 1024) {}
+    CacheServiceImpl(std::shared_ptr<ShardedHashTable> storage,
+                     RequestPipelineT request_pipeline,
+                     std::shared_ptr<WAL> wal = nullptr,
+                     std::shared_ptr<IoScheduler> io_scheduler = nullptr,
+                     std::shared_ptr<StaticDatasets> datasets = nullptr)
+        : storage_(std::move(storage))
+        , request_pipeline_(std::move(request_pipeline))
+        , wal_(std::move(wal))
+        , io_scheduler_(std::move(io_scheduler))
+        , datasets_(std::move(datasets)) {}
 
     Status Get(ServerContext* context, const GetRequest* request,
                GetResponse* response) override {
-        // Check rate limiting
-        CHECK_RATE_LIMIT(context, g_rate_limiter.get());
+        [[maybe_unused]] auto allocs = request_pipeline_.track_allocations(&storage_->metrics());
+        ForegroundTimer latency(io_scheduler_.get());
 
-        // Check authentication if required
-        if (g_require_auth) {
-            REQUIRE_AUTH(context, *g_auth_manager, distcache::Operation::READ);
-        }
+        // Rate limiting and authentication
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.admit(context, Operation::READ, "Get"));
 
         // Validate input
-        if (g_validator) {
-            VALIDATE_OR_RETURN(*g_validator, g_validator->validate_key(request->key()), "GET");
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.validate("GET", [&](const Validator& v) {
+            return v.validate_key(request->key());
+        }));
+
+        request_pipeline_.log([&] { LOG_DEBUG("GET key={}", request->key()); });
+
+        // Copy the value straight from its dataset or storage into the response
+        bool found = false;
+        if (!GetFromDataset(request->key(), found, response)) {
+            found = storage_->get_with(request->key(), [response](const CacheEntry& entry) {
+                response->set_value(entry.value.data(), entry.value.size());
+                response->set_version(entry.version);
+            });
         }
 
-        LOG_DEBUG("GET key={}", request->key());
-
-        auto entry = storage_.get(request->key());
-
-        if (entry.has_value()) {
-            response->set_found(true);
-            response->set_value(entry->value.data(), entry->value.size());
-            response->set_version(entry->version);
-            LOG_TRACE("GET key={} found, size={}", request->key(), entry->value.size());
-        } else {
-            response->set_found(false);
-            LOG_TRACE("GET key={} not found", request->key());
-        }
+        response->set_found(found);
+        request_pipeline_.log([&] {
+            if (found) {
+                LOG_TRACE("GET key={} found, size={}", request->key(), response->value().size());
+            } else {
+                LOG_TRACE("GET key={} not found", request->key());
+            }
+        });
 
         return Status::OK;
     }
 
     Status Set(ServerContext* context, const SetRequest* request,
                SetResponse* response) override {
-        // Check rate limiting
-        CHECK_RATE_LIMIT(context, g_rate_limiter.get());
+        [[maybe_unused]] auto allocs = request_pipeline_.track_allocations(&storage_->metrics());
+        ForegroundTimer latency(io_scheduler_.get());
 
-        // Check authentication if required
-        if (g_require_auth) {
-            REQUIRE_AUTH(context, *g_auth_manager, distcache::Operation::WRITE);
-        }
+        // Rate limiting and authentication
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.admit(context, Operation::WRITE, "Set"));
+        PIPELINE_RETURN_IF_ERROR(CheckWritable());
+        PIPELINE_RETURN_IF_ERROR(CheckMutable(request->key()));
 
+        // The only copy of the value on the write path: wire bytes into the
+        // buffer the stored entry will own
         std::vector<uint8_t> value(request->value().begin(), request->value().end());
 
         std::optional<int32_t> ttl;
@@ -93,18 +162,23 @@ public:
         }
 
         // Validate input
-        if (g_validator) {
-            VALIDATE_OR_RETURN(*g_validator,
-                             g_validator->validate_set_operation(request->key(), value, ttl),
-                             "SET");
-        }
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.validate("SET", [&](const Validator& v) {
+            return v.validate_set_operation(request->key(), value, ttl);
+        }));
 
-        LOG_DEBUG("SET key={} size={} ttl={}", request->key(), value.size(),
-                 ttl.has_value() ? std::to_string(ttl.value()) : "none");
+        request_pipeline_.log([&] {
+            LOG_DEBUG("SET key={} size={} ttl={}", request->key(), value.size(),
+                     ttl.has_value() ? std::to_string(ttl.value()) : "none");
+        });
 
         CacheEntry entry(request->key(), std::move(value), ttl);
 
-        bool success = storage_.set(request->key(), std::move(entry));
+        bool success = storage_->set(request->key(), std::move(entry));
+        if (success) {
+            PIPELINE_RETURN_IF_ERROR(AwaitDurable(&latency));
+        } else {
+            PIPELINE_RETURN_IF_ERROR(CheckWritable());  // Frozen since the first check
+        }
         response->set_success(success);
         response->set_version(1);  // TODO: Proper versioning
 
@@ -117,31 +191,185 @@ public:
 
     Status Delete(ServerContext* context, const DeleteRequest* request,
                   DeleteResponse* response) override {
-        // Check rate limiting
-        CHECK_RATE_LIMIT(context, g_rate_limiter.get());
+        [[maybe_unused]] auto allocs = request_pipeline_.track_allocations(&storage_->metrics());
+        ForegroundTimer latency(io_scheduler_.get());
 
-        // Check authentication if required
-        if (g_require_auth) {
-            REQUIRE_AUTH(context, *g_auth_manager, distcache::Operation::WRITE);
-        }
+        // Rate limiting and authentication
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.admit(context, Operation::WRITE, "Delete"));
+        PIPELINE_RETURN_IF_ERROR(CheckWritable());
+        PIPELINE_RETURN_IF_ERROR(CheckMutable(request->key()));
 
         // Validate input
-        if (g_validator) {
-            VALIDATE_OR_RETURN(*g_validator, g_validator->validate_key(request->key()), "DELETE");
-        }
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.validate("DELETE", [&](const Validator& v) {
+            return v.validate_key(request->key());
+        }));
 
-        LOG_DEBUG("DELETE key={}", request->key());
+        request_pipeline_.log([&] { LOG_DEBUG("DELETE key={}", request->key()); });
 
-        bool success = storage_.del(request->key());
+        bool success = storage_->del(request->key());
+        if (success) {
+            PIPELINE_RETURN_IF_ERROR(AwaitDurable(&latency));
+        } else {
+            PIPELINE_RETURN_IF_ERROR(CheckWritable());  // Frozen since the first check
+        }
         response->set_success(success);
 
         if (!success) {
-            LOG_TRACE("DELETE key={} not found", request->key());
+            request_pipeline_.log([&] { LOG_TRACE("DELETE key={} not found", request->key()); });
+        }
+
+        return Status::OK;
+    }
+
+    Status BatchGet(ServerContext* context, const BatchGetRequest* request,
+                    BatchGetResponse* response) override {
+        [[maybe_unused]] auto allocs = request_pipeline_.track_allocations(&storage_->metrics());
+        ForegroundTimer latency(io_scheduler_.get());
+
+        // Rate limiting and authentication
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.admit(context, Operation::READ, "BatchGet"));
+
+        // Validate batch size; individual keys are validated per entry below
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.validate("BATCH_GET", [&](const Validator& v) {
+            return v.validate_batch_size(request->keys_size());
+        }));
+
+        request_pipeline_.log([&] { LOG_DEBUG("BATCH_GET keys={}", request->keys_size()); });
+
+        // Keys that fail validation are reported per entry and not looked up
+        std::vector<std::string> keys;
+        std::vector<int> key_slots(request->keys_size(), -1);
+        keys.reserve(request->keys_size());
+
+        for (int i = 0; i < request->keys_size(); ++i) {
+            auto* entry = response->add_entries();
+            entry->set_key(request->keys(i));
+            entry->set_found(false);
+
+            if constexpr (RequestPipelineT::kValidated) {
+                auto result = request_pipeline_.validator()->validate_key(request->keys(i));
+                if (!result.valid) {
+                    entry->set_error(result.error_message);
+                    continue;
+                }
+            }
+
+            bool found = false;
+            if (GetFromDataset(request->keys(i), found, entry)) {
+                entry->set_found(found);
+                continue;
+            }
+
+            key_slots[i] = static_cast<int>(keys.size());
+            keys.push_back(request->keys(i));
+        }
+
+        auto results = storage_->multi_get(keys);
+
+        for (int i = 0; i < request->keys_size(); ++i) {
+            if (key_slots[i] < 0) {
+                continue;
+            }
+
+            const auto& result = results[key_slots[i]];
+            if (result.has_value()) {
+                auto* entry = response->mutable_entries(i);
+                entry->set_found(true);
+                entry->set_value(result->value.data(), result->value.size());
+                entry->set_version(result->version);
+            }
         }
 
         return Status::OK;
     }
 
+    Status BatchSet(ServerContext* context, const BatchSetRequest* request,
+                    BatchSetResponse* response) override {
+        [[maybe_unused]] auto allocs = request_pipeline_.track_allocations(&storage_->metrics());
+        ForegroundTimer latency(io_scheduler_.get());
+
+        // Rate limiting and authentication
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.admit(context, Operation::WRITE, "BatchSet"));
+        PIPELINE_RETURN_IF_ERROR(CheckWritable());
+
+        // Validate batch size; individual entries are validated below
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.validate("BATCH_SET", [&](const Validator& v) {
+            return v.validate_batch_size(request->entries_size());
+        }));
+
+        request_pipeline_.log([&] { LOG_DEBUG("BATCH_SET entries={}", request->entries_size()); });
+
+        std::vector<CacheEntry> entries;
+        std::vector<int> entry_slots(request->entries_size(), -1);
+        entries.reserve(request->entries_size());
+
+        for (int i = 0; i < request->entries_size(); ++i) {
+            const auto& req_entry = request->entries(i);
+            auto* result = response->add_results();
+            result->set_key(req_entry.key());
+            result->set_success(false);
+
+            std::vector<uint8_t> value(req_entry.value().begin(), req_entry.value().end());
+
+            std::optional<int32_t> ttl;
+            if (req_entry.has_ttl_seconds()) {
+                ttl = req_entry.ttl_seconds();
+            }
+
+            if constexpr (RequestPipelineT::kValidated) {
+                auto validation = request_pipeline_.validator()->validate_set_operation(
+                    req_entry.key(), value, ttl);
+                if (!validation.valid) {
+                    result->set_error(validation.error_message);
+                    continue;
+                }
+            }
+
+            if (Status mutable_key = CheckMutable(req_entry.key()); !mutable_key.ok()) {
+                result->set_error(mutable_key.error_message());
+                continue;
+            }
+
+            entry_slots[i] = static_cast<int>(entries.size());
+            entries.emplace_back(req_entry.key(), std::move(value), ttl);
+        }
+
+        bool entries_empty = entries.empty();
+        std::vector<int64_t> versions;
+        versions.reserve(entries.size());
+        for (const auto& entry : entries) {
+            versions.push_back(entry.version);
+        }
+
+        auto results = storage_->multi_set(std::move(entries));
+        if (!entries_empty) {
+            PIPELINE_RETURN_IF_ERROR(AwaitDurable(&latency));
+        }
+
+        // Entries rejected by a freeze that began mid-batch
+        if (std::find(results.begin(), results.end(), false) != results.end()) {
+            PIPELINE_RETURN_IF_ERROR(CheckWritable());
+        }
+
+        int32_t succeeded = 0;
+        for (int i = 0; i < request->entries_size(); ++i) {
+            auto* result = response->mutable_results(i);
+            if (entry_slots[i] >= 0 && results[entry_slots[i]]) {
+                result->set_success(true);
+                result->set_version(versions[entry_slots[i]]);
+                succeeded++;
+            } else if (entry_slots[i] >= 0) {
+                result->set_error("Set failed");
+                LOG_WARN("BATCH_SET key={} failed", result->key());
+            }
+        }
+
+        response->set_succeeded(succeeded);
+        response->set_failed(request->entries_size() - succeeded);
+
+        return Status::OK;
+    }
+
     Status HealthCheck(ServerContext* context, const HealthCheckRequest* request,
                        HealthCheckResponse* response) override {
         response->set_status(HealthCheckResponse::SERVING);
@@ -151,15 +379,10 @@ public:
 
     Status GetMetrics(ServerContext* context, const GetMetricsRequest* request,
                      GetMetricsResponse* response) override {
-        // Check rate limiting
-        CHECK_RATE_LIMIT(context, g_rate_limiter.get());
-
-        // Check authentication if required
-        if (g_require_auth) {
-            REQUIRE_AUTH(context, *g_auth_manager, distcache::Operation::METRICS);
-        }
+        // Rate limiting and authentication
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.admit(context, Operation::METRICS, "GetMetrics"));
 
-        const auto& metrics = storage_.metrics();
+        const auto& metrics = storage_->metrics();
 
         // Fill structured metrics fields
         response->set_cache_hits(metrics.cache_hits.load());
@@ -170,6 +393,8 @@ public:
         response->set_evictions_total(metrics.evictions_total.load());
         response->set_entries_count(metrics.entries_count.load());
         response->set_memory_bytes(metrics.memory_bytes.load());
+        response->set_allocations_per_request(metrics.allocations_per_request());
+        response->set_request_allocations_max(metrics.request_allocations_max.load());
 
         // Fill formatted metrics string
         if (request->format() == GetMetricsRequest::PROMETHEUS) {
@@ -184,13 +409,13 @@ public:
     Status CompareAndSwap(ServerContext* context,
                          const CompareAndSwapRequest* request,
                          CompareAndSwapResponse* response) override {
-        // Check rate limiting
-        CHECK_RATE_LIMIT(context, g_rate_limiter.get());
+        [[maybe_unused]] auto allocs = request_pipeline_.track_allocations(&storage_->metrics());
+        ForegroundTimer latency(io_scheduler_.get());
 
-        // Check authentication if required
-        if (g_require_auth) {
-            REQUIRE_AUTH(context, *g_auth_manager, distcache::Operation::WRITE);
-        }
+        // Rate limiting and authentication
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.admit(context, Operation::WRITE, "CompareAndSwap"));
+        PIPELINE_RETURN_IF_ERROR(CheckWritable());
+        PIPELINE_RETURN_IF_ERROR(CheckMutable(request->key()));
 
         const std::string& key = request->key();
         int64_t expected_version = request->expected_version();
@@ -205,43 +430,606 @@ public:
         }
 
         // Validate input
-        if (g_validator) {
-            VALIDATE_OR_RETURN(*g_validator,
-                             g_validator->validate_set_operation(key, new_value, ttl),
-                             "CAS");
-        }
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.validate("CAS", [&](const Validator& v) {
+            return v.validate_set_operation(key, new_value, ttl);
+        }));
 
-        LOG_DEBUG("CAS key={} expected_version={}", key, expected_version);
+        request_pipeline_.log([&] {
+            LOG_DEBUG("CAS key={} expected_version={}", key, expected_version);
+        });
 
         // Create new entry
         CacheEntry new_entry(key, std::move(new_value), ttl);
 
         // Perform atomic CAS
-        auto result = storage_.compare_and_swap(key, expected_version, std::move(new_entry));
+        auto result = storage_->compare_and_swap(key, expected_version, std::move(new_entry));
+        if (result.success) {
+            PIPELINE_RETURN_IF_ERROR(AwaitDurable(&latency));
+        } else {
+            PIPELINE_RETURN_IF_ERROR(CheckWritable());  // Frozen since the first check
+        }
 
         // Map result to response
         response->set_success(result.success);
         if (result.success) {
             response->set_new_version(result.new_version);
-            LOG_DEBUG("CAS succeeded: key={} new_version={}", key, result.new_version);
+            request_pipeline_.log([&] {
+                LOG_DEBUG("CAS succeeded: key={} new_version={}", key, result.new_version);
+            });
         } else {
             response->set_actual_version(result.actual_version);
             response->set_error(result.error);
-            LOG_DEBUG("CAS failed: key={} error={}", key, result.error);
+            request_pipeline_.log([&] {
+                LOG_DEBUG("CAS failed: key={} error={}", key, result.error);
+            });
         }
 
         return Status::OK;
     }
 
+    Status Pipeline(ServerContext* context,
+                    ServerReaderWriter<PipelineResponse, PipelineRequest>* stream) override {
+        // Opening the stream counts against the rate limit like a unary call
+        PIPELINE_RETURN_IF_ERROR(request_pipeline_.rate_limit().admit(context));
+
+        // Credentials are fixed for the life of the stream, so resolve
+        // permissions once; individual ops are rejected if not allowed
+        PipelineContext pipeline;
+        pipeline.stream = stream;
+        PIPELINE_RETURN_IF_ERROR(
+            request_pipeline_.auth().resolve(context, pipeline.can_read, pipeline.can_write));
+        if constexpr (RequestPipelineT::kRateLimited) {
+            pipeline.client_id = extract_client_id(context);
+        }
+
+        request_pipeline_.log([] { LOG_DEBUG("PIPELINE stream opened"); });
+
+        // Reader thread: pulls requests off the stream into a bounded queue.
+        // When the queue is full it stops reading, so HTTP/2 flow control
+        // pushes back on the client.
+        std::mutex queue_mutex;
+        std::condition_variable queue_cv;
+        std::deque<PipelineRequest> queue;
+        bool reads_done = false;
+        bool stopped = false;
+
+        std::thread reader([&]() {
+            PipelineRequest request;
+            while (stream->Read(&request)) {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_cv.wait(lock, [&] {
+                    return queue.size() < kPipelineMaxQueued || stopped;
+                });
+                if (stopped) {
+                    break;
+                }
+                queue.push_back(std::move(request));
+                queue_cv.notify_all();
+            }
+
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            reads_done = true;
+            queue_cv.notify_all();
+        });
+
+        // Processing loop: drain whatever has arrived as one burst so each
+        // shard lock is taken once per burst rather than once per op
+        std::vector<PipelineRequest> burst;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_cv.wait(lock, [&] { return !queue.empty() || reads_done; });
+                if (queue.empty()) {
+                    break;
+                }
+
+                size_t count = std::min(queue.size(), kPipelineMaxBurst);
+                burst.assign(std::make_move_iterator(queue.begin()),
+                             std::make_move_iterator(queue.begin() + count));
+                queue.erase(queue.begin(), queue.begin() + count);
+                queue_cv.notify_all();
+            }
+
+            if (!ProcessPipelineBurst(pipeline, burst)) {
+                LOG_WARN("PIPELINE write failed, closing stream");
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                stopped = true;
+                queue_cv.notify_all();
+                break;
+            }
+            burst.clear();
+        }
+
+        reader.join();
+
+        request_pipeline_.log([&] {
+            LOG_DEBUG("PIPELINE stream closed after {} ops", pipeline.ops_processed);
+        });
+        return Status::OK;
+    }
+
 private:
-    ShardedHashTable storage_;
+    // Max requests buffered per pipeline stream before reads pause
+    static constexpr size_t kPipelineMaxQueued = 1024;
+
+    // Max requests executed together as one burst
+    static constexpr size_t kPipelineMaxBurst = 256;
+
+    /**
+     * Per-stream state shared by the pipeline processing helpers.
+     */
+    struct PipelineContext {
+        ServerReaderWriter<PipelineResponse, PipelineRequest>* stream = nullptr;
+        std::string client_id;
+        bool can_read = true;
+        bool can_write = true;
+        size_t ops_processed = 0;
+    };
+
+    /**
+     * Block until the WAL has committed this thread's writes, so they are
+     * durable before being acknowledged. Storage queues each mutation to
+     * the WAL under its shard lock; this waits, on each stream the thread
+     * wrote to, for the group commit holding its last record there.
+     * @param latency Stopped first: the fdatasync wait is not request work
+     *                and would feed the I/O throttle its own latency
+     * @return OK, or UNAVAILABLE if the write could not be persisted
+     */
+    Status AwaitDurable(ForegroundTimer* latency = nullptr) {
+        if (latency) {
+            latency->Stop();
+        }
+        if (wal_ && !wal_->WaitForOwnCommits()) {
+            LOG_ERROR("WAL commit failed; write applied in memory only");
+            return Status(grpc::UNAVAILABLE, "Write could not be persisted");
+        }
+        return Status::OK;
+    }
+
+    /**
+     * Writes are frozen while the table is handed to a new process;
+     * clients retry and reach whichever process owns it.
+     */
+    Status CheckWritable() const {
+        if (storage_->writes_frozen()) {
+            return Status(grpc::UNAVAILABLE, "Handing off to a new server process");
+        }
+        return Status::OK;
+    }
+
+    /**
+     * Keys in a mounted dataset's namespace are served from it alone.
+     * @return False if the key is outside every mounted namespace
+     */
+    template<typename ResponseT>
+    bool GetFromDataset(const std::string& key, bool& found, ResponseT* response) const {
+        if (!datasets_) {
+            return false;
+        }
+        auto lookup = datasets_->lookup(key);
+        if (!lookup.dataset) {
+            return false;
+        }
+        found = lookup.value.has_value();
+        if (found) {
+            response->set_value(lookup.value->data(), lookup.value->size());
+            response->set_version(lookup.dataset->built_at_ms());  // Changes with each build
+        }
+        return true;
+    }
+
+    /**
+     * Mounted datasets are read-only.
+     */
+    Status CheckMutable(const std::string& key) const {
+        if (datasets_ && datasets_->is_read_only(key)) {
+            return Status(grpc::FAILED_PRECONDITION, "Key belongs to a read-only dataset");
+        }
+        return Status::OK;
+    }
+
+    /**
+     * Check rate limit, permissions and input for one pipelined op.
+     * @return OK if the op may be executed, otherwise the status to report
+     */
+    Status CheckPipelineOp(const PipelineContext& pipeline, const PipelineRequest& request) {
+        if (!request_pipeline_.rate_limit().allow(pipeline.client_id)) {
+            return Status(grpc::RESOURCE_EXHAUSTED,
+                          "Rate limit exceeded. Please try again later.");
+        }
+
+        bool is_read = request.op_case() == PipelineRequest::kGet;
+        if (!(is_read ? pipeline.can_read : pipeline.can_write)) {
+            return Status(grpc::PERMISSION_DENIED, "Insufficient permissions");
+        }
+        if (!is_read && request.op_case() != PipelineRequest::OP_NOT_SET) {
+            PIPELINE_RETURN_IF_ERROR(CheckWritable());
+        }
+        switch (request.op_case()) {
+            case PipelineRequest::kSet:
+                PIPELINE_RETURN_IF_ERROR(CheckMutable(request.set().key()));
+                break;
+            case PipelineRequest::kDelete:
+                PIPELINE_RETURN_IF_ERROR(CheckMutable(request.delete_().key()));
+                break;
+            case PipelineRequest::kCas:
+                PIPELINE_RETURN_IF_ERROR(CheckMutable(request.cas().key()));
+                break;
+            default:
+                break;
+        }
+
+        if constexpr (!RequestPipelineT::kValidated) {
+            return Status::OK;
+        }
+
+        const Validator* validator = request_pipeline_.validator();
+        ValidationResult result = ValidationResult::ok();
+        switch (request.op_case()) {
+            case PipelineRequest::kGet:
+                result = validator->validate_key(request.get().key());
+                break;
+            case PipelineRequest::kDelete:
+                result = validator->validate_key(request.delete_().key());
+                break;
+            case PipelineRequest::kSet: {
+                const auto& set = request.set();
+                std::vector<uint8_t> value(set.value().begin(), set.value().end());
+                std::optional<int32_t> ttl;
+                if (set.has_ttl_seconds()) {
+                    ttl = set.ttl_seconds();
+                }
+                result = validator->validate_set_operation(set.key(), value, ttl);
+                break;
+            }
+            case PipelineRequest::kCas: {
+                const auto& cas = request.cas();
+                std::vector<uint8_t> value(cas.new_value().begin(), cas.new_value().end());
+                std::optional<int32_t> ttl;
+                if (cas.has_ttl_seconds()) {
+                    ttl = cas.ttl_seconds();
+                }
+                result = validator->validate_set_operation(cas.key(), value, ttl);
+                break;
+            }
+            default:
+                break;
+        }
+
+        if (!result.valid) {
+            LOG_WARN("Validation failed: PIPELINE - {}", result.error_message);
+            return Status(grpc::INVALID_ARGUMENT, result.error_message);
+        }
+        return Status::OK;
+    }
+
+    /**
+     * Execute one burst of pipelined requests and stream back responses
+     * as each shard's operations complete. With a WAL, bursts containing
+     * writes hold their responses until the burst is committed.
+     * @return False if the stream could not be written to
+     */
+    bool ProcessPipelineBurst(PipelineContext& pipeline,
+                              std::vector<PipelineRequest>& burst) {
+        std::vector<ShardedHashTable::BatchOp> ops;
+        std::vector<uint64_t> op_tags;
+        ops.reserve(burst.size());
+        op_tags.reserve(burst.size());
+
+        // Responses live on a per-burst arena and are released together
+        google::protobuf::Arena arena;
+
+        size_t remaining = burst.size();
+        bool write_ok = true;
+        bool has_writes = false;
+
+        // Coalesce writes within a burst; only the last response flushes
+        auto write = [&](const PipelineResponse& response) {
+            --remaining;
+            grpc::WriteOptions options;
+            if (remaining > 0) {
+                options.set_buffer_hint();
+            }
+            if (write_ok && !pipeline.stream->Write(response, options)) {
+                write_ok = false;
+            }
+        };
+
+        for (auto& request : burst) {
+            Status check = CheckPipelineOp(pipeline, request);
+            if (check.ok() && request.op_case() == PipelineRequest::OP_NOT_SET) {
+                check = Status(grpc::INVALID_ARGUMENT, "Pipeline request has no operation");
+            }
+
+            if (!check.ok()) {
+                auto* response = google::protobuf::Arena::Create<PipelineResponse>(&arena);
+                response->set_tag(request.tag());
+                response->set_status_code(check.error_code());
+                response->set_status_message(check.error_message());
+                write(*response);
+                continue;
+            }
+
+            if (datasets_ && request.op_case() == PipelineRequest::kGet) {
+                auto* response = google::protobuf::Arena::Create<PipelineResponse>(&arena);
+                bool found = false;
+                if (GetFromDataset(request.get().key(), found, response->mutable_get())) {
+                    response->set_tag(request.tag());
+                    response->mutable_get()->set_found(found);
+                    write(*response);
+                    continue;
+                }
+            }
+
+            ShardedHashTable::BatchOp op;
+            switch (request.op_case()) {
+                case PipelineRequest::kGet:
+                    op.type = ShardedHashTable::BatchOp::Type::GET;
+                    op.key = std::move(*request.mutable_get()->mutable_key());
+                    break;
+                case PipelineRequest::kSet: {
+                    auto* set = request.mutable_set();
+                    std::optional<int32_t> ttl;
+                    if (set->has_ttl_seconds()) {
+                        ttl = set->ttl_seconds();
+                    }
+                    op.type = ShardedHashTable::BatchOp::Type::SET;
+                    op.key = std::move(*set->mutable_key());
+                    op.entry = CacheEntry(op.key,
+                                          std::vector<uint8_t>(set->value().begin(),
+                                                               set->value().end()),
+                                          ttl);
+                    break;
+                }
+                case PipelineRequest::kDelete:
+                    op.type = ShardedHashTable::BatchOp::Type::DELETE;
+                    op.key = std::move(*request.mutable_delete_()->mutable_key());
+                    break;
+                case PipelineRequest::kCas: {
+                    auto* cas = request.mutable_cas();
+                    std::optional<int32_t> ttl;
+                    if (cas->has_ttl_seconds()) {
+                        ttl = cas->ttl_seconds();
+                    }
+                    op.type = ShardedHashTable::BatchOp::Type::CAS;
+                    op.key = std::move(*cas->mutable_key());
+                    op.expected_version = cas->expected_version();
+                    op.entry = CacheEntry(op.key,
+                                          std::vector<uint8_t>(cas->new_value().begin(),
+                                                               cas->new_value().end()),
+                                          ttl);
+                    break;
+                }
+                default:
+                    break;
+            }
+
+            has_writes |= op.type != ShardedHashTable::BatchOp::Type::GET;
+            ops.push_back(std::move(op));
+            op_tags.push_back(request.tag());
+        }
+
+        bool defer_responses = wal_ && has_writes;
+        std::vector<PipelineResponse*> deferred;
+
+        storage_->execute_batch(ops, [&](size_t index) {
+            const auto& op = ops[index];
+            auto* response = google::protobuf::Arena::Create<PipelineResponse>(&arena);
+            response->set_tag(op_tags[index]);
+
+            switch (op.type) {
+                case ShardedHashTable::BatchOp::Type::GET: {
+                    auto* get = response->mutable_get();
+                    get->set_found(op.found.has_value());
+                    if (op.found.has_value()) {
+                        get->set_value(op.found->value.data(), op.found->value.size());
+                        get->set_version(op.found->version);
+                    }
+                    break;
+                }
+                case ShardedHashTable::BatchOp::Type::SET:
+                    response->mutable_set()->set_success(op.success);
+                    response->mutable_set()->set_version(1);  // Matches unary Set
+                    break;
+                case ShardedHashTable::BatchOp::Type::DELETE:
+                    response->mutable_delete_()->set_success(op.success);
+                    break;
+                case ShardedHashTable::BatchOp::Type::CAS: {
+                    auto* cas = response->mutable_cas();
+                    cas->set_success(op.cas.success);
+                    if (op.cas.success) {
+                        cas->set_new_version(op.cas.new_version);
+                    } else {
+                        cas->set_actual_version(op.cas.actual_version);
+                        cas->set_error(op.cas.error);
+                    }
+                    break;
+                }
+            }
+
+            // A write refused because a freeze began after CheckPipelineOp
+            bool rejected = op.type == ShardedHashTable::BatchOp::Type::CAS ? !op.cas.success
+                          : op.type != ShardedHashTable::BatchOp::Type::GET && !op.success;
+            if (rejected) {
+                if (Status writable = CheckWritable(); !writable.ok()) {
+                    response->set_status_code(writable.error_code());
+                    response->set_status_message(writable.error_message());
+                }
+            }
+
+            if (defer_responses) {
+                deferred.push_back(response);
+            } else {
+                write(*response);
+            }
+        });
+
+        if (defer_responses) {
+            Status durable = AwaitDurable();
+            for (auto* response : deferred) {
+                if (!durable.ok() && !response->has_get()) {
+                    response->set_status_code(durable.error_code());
+                    response->set_status_message(durable.error_message());
+                }
+                write(*response);
+            }
+        }
+
+        pipeline.ops_processed += burst.size();
+        return write_ok;
+    }
+
+    std::shared_ptr<ShardedHashTable> storage_;
+    RequestPipelineT request_pipeline_;
+    std::shared_ptr<WAL> wal_;  // Null when persistence is disabled
+    std::shared_ptr<IoScheduler> io_scheduler_;  // Fed foreground latencies, if set
+    std::shared_ptr<StaticDatasets> datasets_;   // Read-only namespaces, if any
 };
 
 } // namespace distcache
 
-void RunServer(const std::optional<distcache::TLSConfig>& tls_config) {
+void RunServer(const std::optional<distcache::TLSConfig>& tls_config,
+               const std::optional<distcache::RespServer::Config>& resp_config,
+               const distcache::RequestPipelineOptions& pipeline_options,
+               const std::optional<distcache::PersistenceConfig>& persistence,
+               const std::optional<distcache::HandoffOptions>& handoff,
+               const std::optional<distcache::DatasetOptions>& dataset_options) {
     std::string server_address("0.0.0.0:50051");
-    distcache::CacheServiceImpl service;
+
+    // One storage instance shared by the gRPC service and the RESP listener
+    auto storage = std::make_shared<distcache::ShardedHashTable>(256, 1024 * 1024 * 1024);
+
+    // A takeover attaches the running process's table instead of
+    // recovering. Its WAL is opened here only once that process has
+    // acknowledged the release, after which it never takes it back
+    std::unique_ptr<distcache::HandoffClient> takeover;
+    int64_t takeover_sequence = 0;
+    if (handoff.has_value() && handoff->takeover) {
+        takeover = std::make_unique<distcache::HandoffClient>(handoff->config, storage);
+        auto attached = takeover->Attach();
+        if (!attached.success) {
+            LOG_ERROR("Takeover failed: {}", attached.error);
+            return;
+        }
+        takeover_sequence = attached.wal_sequence;
+
+        if (!takeover->Confirm()) {
+            LOG_ERROR("Takeover failed: the running process did not release its table");
+            return;
+        }
+    }
+
+    // Recover persisted state before any listener accepts traffic, then
+    // log every further mutation through the WAL
+    std::shared_ptr<distcache::WAL> wal;
+    std::shared_ptr<distcache::SnapshotManager> snapshot_manager;
+    std::shared_ptr<distcache::IoScheduler> io_scheduler;
+    if (persistence.has_value()) {
+        distcache::WAL::Config wal_config = persistence->wal;
+        wal_config.wal_dir = persistence->data_dir / "wal";
+        wal_config.node_id = persistence->node_id;
+        wal = std::make_shared<distcache::WAL>(wal_config);
+
+        distcache::SnapshotManager::Config snapshot_config;
+        snapshot_config.node_id = persistence->node_id;
+        snapshot_config.snapshot_dir = persistence->data_dir / "snapshots";
+        snapshot_config.snapshot_interval_seconds = persistence->snapshot_interval_seconds;
+        snapshot_config.delta_interval_seconds = persistence->snapshot_delta_interval_seconds;
+        snapshot_config.use_io_uring = persistence->wal.use_io_uring;
+        snapshot_manager = std::make_shared<distcache::SnapshotManager>(
+            snapshot_config, storage, std::make_shared<distcache::Metrics>());
+
+        distcache::RecoveryManager::Config recovery_config;
+        recovery_config.node_id = persistence->node_id;
+        recovery_config.snapshot_dir = snapshot_config.snapshot_dir;
+        recovery_config.wal_dir = wal_config.wal_dir;
+        recovery_config.lazy_restore = persistence->lazy_restore;
+
+        distcache::RecoveryManager recovery(recovery_config, storage, snapshot_manager, wal);
+        distcache::RecoveryManager::RecoveryResult result;
+        if (takeover) {
+            result.success = true;
+            result.last_sequence_number = takeover_sequence;  // Handed over with the WAL
+        } else {
+            result = recovery.Recover();
+        }
+        if (!result.success) {
+            LOG_ERROR("Recovery failed: {}", result.error_message);
+            return;
+        }
+
+        // Recovery runs before any traffic and unthrottled; from here on
+        // background disk work shares one budget with foreground latency
+        io_scheduler = std::make_shared<distcache::IoScheduler>(persistence->io);
+        wal->AttachIoScheduler(io_scheduler);
+        snapshot_manager->SetIoScheduler(io_scheduler);
+
+        recovery.LinkSnapshotsToWAL();
+        wal->ResumeFromSequence(result.last_sequence_number);
+        wal->Open();
+        if (!wal->IsOpen()) {
+            LOG_ERROR("Failed to open WAL in {}", wal_config.wal_dir.string());
+            return;
+        }
+        storage->set_mutation_listener(wal.get());
+        snapshot_manager->Start();
+
+        if (takeover) {
+            LOG_INFO("Persistence enabled in {} (WAL taken over after sequence {})",
+                     persistence->data_dir.string(), takeover_sequence);
+        } else {
+            LOG_INFO("Persistence enabled in {} ({} keys recovered in {}ms: "
+                     "snapshot {}ms, WAL {}ms)",
+                     persistence->data_dir.string(), storage->size(),
+                     result.recovery_duration_ms, result.snapshot_restore_ms,
+                     result.wal_replay_ms);
+        }
+        if (result.snapshot_lazy) {
+            LOG_INFO("Snapshot {} is still loading ({} shards pending)", result.snapshot_id,
+                     storage->shards_pending_load());
+        }
+    }
+
+    // Mapped, not loaded: mounting costs the same whatever the dataset size
+    std::shared_ptr<distcache::StaticDatasets> datasets;
+    if (dataset_options.has_value()) {
+        datasets = std::make_shared<distcache::StaticDatasets>(dataset_options->config);
+        for (const auto& [name, path] : dataset_options->mounts) {
+            if (!datasets->Mount(name, path)) {
+                LOG_ERROR("Failed to mount dataset {} from {}", name, path.string());
+                return;
+            }
+        }
+        datasets->Start();
+    }
+
+    // Pick the handler set compiled for exactly the enabled stages
+    std::unique_ptr<grpc::Service> service = distcache::MakeRequestPipeline(
+        pipeline_options,
+        [&storage, &wal, &io_scheduler, &datasets](auto request_pipeline)
+            -> std::unique_ptr<grpc::Service> {
+            using Pipeline = decltype(request_pipeline);
+            return std::make_unique<distcache::CacheServiceImpl<Pipeline>>(
+                storage, std::move(request_pipeline), wal, io_scheduler, datasets);
+        });
+
+    // Admin service, so the I/O budget can be retuned while serving
+    std::unique_ptr<distcache::AdminServiceImpl> admin_service;
+    if (io_scheduler) {
+        admin_service = std::make_unique<distcache::AdminServiceImpl>(
+            storage.get(), nullptr, persistence->node_id);
+        admin_service->set_io_scheduler(io_scheduler);
+    }
+
+    std::unique_ptr<distcache::RespServer> resp_server;
+    if (resp_config.has_value()) {
+        resp_server = std::make_unique<distcache::RespServer>(*resp_config, storage, wal,
+                                                              datasets);
+        if (!resp_server->Start()) {
+            LOG_ERROR("Failed to start RESP listener on port {}", resp_config->port);
+            return;
+        }
+    }
 
     ServerBuilder builder;
 
@@ -255,10 +1043,39 @@ void RunServer(const std::optional<distcache::TLSConfig>& tls_config) {
         builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
     }
 
-    builder.RegisterService(&service);
+    builder.RegisterService(service.get());
+    if (admin_service) {
+        builder.RegisterService(admin_service.get());
+    }
 
     std::unique_ptr<Server> server(builder.BuildAndStart());
 
+    // Listen for the next process; once it owns the table, stop serving
+    std::unique_ptr<distcache::HandoffServer> handoff_server;
+    if (handoff.has_value()) {
+        distcache::HandoffServer::Callbacks callbacks;
+        callbacks.release = [&wal, &snapshot_manager]() -> int64_t {
+            if (!wal) {
+                return 0;
+            }
+            snapshot_manager->Stop();
+            wal->Close();  // Commits whatever is queued
+            return wal->GetLastSequenceNumber();
+        };
+        callbacks.reclaim = [&wal, &snapshot_manager] {
+            if (wal) {
+                wal->Open();
+                snapshot_manager->Start();
+            }
+        };
+        callbacks.handed_off = [&server] { server->Shutdown(); };
+        handoff_server = std::make_unique<distcache::HandoffServer>(handoff->config, storage,
+                                                                    std::move(callbacks));
+        if (!handoff_server->Start()) {
+            handoff_server.reset();
+        }
+    }
+
     LOG_INFO("DistCache server listening on {}", server_address);
     LOG_INFO("Ready to serve cache requests!");
 
@@ -269,8 +1086,26 @@ void RunServer(const std::optional<distcache::TLSConfig>& tls_config) {
     } else {
         std::cout << "TLS: DISABLED (insecure mode)" << std::endl;
     }
+    if (resp_server) {
+        std::cout << "RESP listener on port " << resp_server->port() << std::endl;
+    }
 
     server->Wait();
+
+    if (handoff_server) {
+        handoff_server->Stop();
+    }
+    if (resp_server) {
+        resp_server->Stop();
+    }
+    if (datasets) {
+        datasets->Stop();
+    }
+    if (wal) {
+        snapshot_manager->Stop();
+        storage->set_mutation_listener(nullptr);
+        wal->Close();
+    }
 }
 
 int main(int argc, char** argv) {
@@ -283,6 +1118,11 @@ int main(int argc, char** argv) {
     std::string auth_secret = "distcache_test_secret_change_me_in_production";
     bool enable_validation = false;
     bool enable_rate_limiting = false;
+    std::optional<distcache::RespServer::Config> resp_config;
+    std::optional<distcache::PersistenceConfig> persistence;
+    std::optional<distcache::HandoffOptions> handoff;
+    std::optional<distcache::DatasetOptions> datasets;
+    distcache::RequestPipelineOptions pipeline_options;
 
     // Parse simple command line args
     for (int i = 1; i < argc; i++) {
@@ -308,6 +1148,78 @@ int main(int argc, char** argv) {
             enable_validation = true;
         } else if (arg == "--enable-rate-limiting") {
             enable_rate_limiting = true;
+        } else if (arg == "--resp-port" && i + 1 < argc) {
+            if (!resp_config) resp_config.emplace();
+            resp_config->port = static_cast<uint16_t>(std::stoi(argv[++i]));
+        } else if (arg == "--resp-reactors" && i + 1 < argc) {
+            if (!resp_config) resp_config.emplace();
+            resp_config->num_reactors = std::stoul(argv[++i]);
+        } else if (arg == "--data-dir" && i + 1 < argc) {
+            if (!persistence) persistence.emplace();
+            persistence->data_dir = argv[++i];
+        } else if (arg == "--node-id" && i + 1 < argc) {
+            if (!persistence) persistence.emplace();
+            persistence->node_id = argv[++i];
+        } else if (arg == "--wal-commit-interval-us" && i + 1 < argc) {
+            if (!persistence) persistence.emplace();
+            persistence->wal.group_commit_interval_us = std::stoul(argv[++i]);
+        } else if (arg == "--wal-commit-max-records" && i + 1 < argc) {
+            if (!persistence) persistence.emplace();
+            persistence->wal.group_commit_max_records = std::stoul(argv[++i]);
+        } else if (arg == "--wal-no-sync") {
+            if (!persistence) persistence.emplace();
+            persistence->wal.sync_on_write = false;
+        } else if (arg == "--wal-compression") {
+            if (!persistence) persistence.emplace();
+            persistence->wal.enable_compression = true;
+        } else if (arg == "--wal-streams" && i + 1 < argc) {
+            if (!persistence) persistence.emplace();
+            persistence->wal.num_streams = std::stoul(argv[++i]);
+        } else if (arg == "--wal-compaction-interval-ms" && i + 1 < argc) {
+            if (!persistence) persistence.emplace();
+            persistence->wal.compaction_interval_ms = std::stoul(argv[++i]);
+        } else if (arg == "--io-uring") {
+            if (!persistence) persistence.emplace();
+            persistence->wal.use_io_uring = true;
+        } else if (arg == "--snapshot-interval" && i + 1 < argc) {
+            if (!persistence) persistence.emplace();
+            persistence->snapshot_interval_seconds = std::stoul(argv[++i]);
+        } else if (arg == "--snapshot-delta-interval" && i + 1 < argc) {
+            if (!persistence) persistence.emplace();
+            persistence->snapshot_delta_interval_seconds = std::stoul(argv[++i]);
+        } else if (arg == "--lazy-restore") {
+            if (!persistence) persistence.emplace();
+            persistence->lazy_restore = true;
+        } else if (arg == "--handoff-socket" && i + 1 < argc) {
+            if (!handoff) handoff.emplace();
+            handoff->config.socket_path = argv[++i];
+        } else if (arg == "--handoff-segment-dir" && i + 1 < argc) {
+            if (!handoff) handoff.emplace();
+            handoff->config.segment_dir = argv[++i];
+        } else if (arg == "--takeover") {
+            if (!handoff) handoff.emplace();
+            handoff->takeover = true;
+        } else if (arg == "--dataset" && i + 1 < argc) {
+            if (!datasets) datasets.emplace();
+            std::string mount = argv[++i];
+            size_t equals = mount.find('=');
+            if (equals == std::string::npos) {
+                std::cerr << "--dataset expects NAME=PATH, got " << mount << std::endl;
+                return 1;
+            }
+            datasets->mounts.emplace_back(mount.substr(0, equals), mount.substr(equals + 1));
+        } else if (arg == "--dataset-check-interval" && i + 1 < argc) {
+            if (!datasets) datasets.emplace();
+            datasets->config.check_interval_seconds = std::stoul(argv[++i]);
+        } else if (arg == "--io-rate-mb" && i + 1 < argc) {
+            if (!persistence) persistence.emplace();
+            persistence->io.bytes_per_second = std::stoull(argv[++i]) * 1024 * 1024;
+        } else if (arg == "--io-p99-target-us" && i + 1 < argc) {
+            if (!persistence) persistence.emplace();
+            persistence->io.foreground_p99_target_us = std::stoull(argv[++i]);
+        } else if (arg == "--io-no-adaptive") {
+            if (!persistence) persistence.emplace();
+            persistence->io.adaptive = false;
         } else if (arg == "--help" || arg == "-h") {
             std::cout << "Usage: " << argv[0] << " [options]\n"
                       << "Options:\n"
@@ -319,6 +1231,28 @@ int main(int argc, char** argv) {
                       << "  --auth-secret SEC       Authentication secret (default: test secret)\n"
                       << "  --enable-validation     Enable input validation\n"
                       << "  --enable-rate-limiting  Enable rate limiting\n"
+                      << "  --resp-port PORT        Also serve the Redis protocol on PORT\n"
+                      << "  --resp-reactors N       RESP reactor threads (default: one per core)\n"
+                      << "  --data-dir DIR          Persist to DIR (WAL + snapshots), recover on start\n"
+                      << "  --node-id ID            Node ID used in WAL/snapshot names (default: node1)\n"
+                      << "  --wal-commit-interval-us N  Max wait for a WAL group commit (default: 200)\n"
+                      << "  --wal-commit-max-records N  Commit a WAL batch early at N records (default: 1024)\n"
+                      << "  --wal-no-sync           Skip fdatasync on WAL commits\n"
+                      << "  --wal-compression       Compress each WAL group commit as one block\n"
+                      << "  --wal-streams N         Independent WAL streams, split by key (default: 1)\n"
+                      << "  --wal-compaction-interval-ms N  Compact closed WAL segments every N ms (default: off)\n"
+                      << "  --io-uring              Use io_uring for WAL commits and snapshot files\n"
+                      << "  --snapshot-interval S   Seconds between snapshots (default: 3600)\n"
+                      << "  --snapshot-delta-interval S  Seconds between delta snapshots (default: off)\n"
+                      << "  --lazy-restore          Serve while the snapshot loads, faulting shards in on demand\n"
+                      << "  --handoff-socket PATH   Hand the table to a new process connecting here\n"
+                      << "  --takeover              Start by taking over the process on --handoff-socket\n"
+                      << "  --handoff-segment-dir DIR  tmpfs directory for the handoff segment (default: /dev/shm)\n"
+                      << "  --dataset NAME=PATH     Serve keys NAME:<key> read-only from a dataset_builder file\n"
+                      << "  --dataset-check-interval S  Swap in a replaced dataset file within S seconds (default: 10)\n"
+                      << "  --io-rate-mb N          Background disk I/O budget in MB/s (default: unlimited)\n"
+                      << "  --io-p99-target-us N    Back background I/O off above this request p99 (default: 2000)\n"
+                      << "  --io-no-adaptive        Keep the I/O budget fixed regardless of latency\n"
                       << "  --help, -h              Show this help message\n";
             return 0;
         }
@@ -358,8 +1292,7 @@ int main(int argc, char** argv) {
     // Initialize authentication if enabled
     if (enable_auth) {
         auto validator = std::make_shared<distcache::TokenValidator>(auth_secret);
-        g_auth_manager = std::make_shared<distcache::AuthManager>(validator);
-        g_require_auth = true;
+        pipeline_options.auth_manager = std::make_shared<distcache::AuthManager>(validator);
         LOG_INFO("Authentication enabled");
     } else {
         LOG_WARN("Authentication disabled - all requests allowed");
@@ -372,7 +1305,7 @@ int main(int argc, char** argv) {
         validator_config.max_value_size = 1024 * 1024;  // 1MB
         validator_config.max_ttl_seconds = 30 * 24 * 3600;  // 30 days
 
-        g_validator = std::make_shared<distcache::Validator>(validator_config);
+        pipeline_options.validator = std::make_shared<distcache::Validator>(validator_config);
         LOG_INFO("Input validation enabled (max_key=256B, max_value=1MB, max_ttl=30d)");
     } else {
         LOG_WARN("Input validation disabled");
@@ -386,13 +1319,38 @@ int main(int argc, char** argv) {
         limiter_config.global_capacity = 10000;    // 10000 requests burst
         limiter_config.global_refill_rate = 1000.0; // 1000 req/s globally
 
-        g_rate_limiter = std::make_shared<distcache::RateLimiter>(limiter_config);
+        pipeline_options.rate_limiter = std::make_shared<distcache::RateLimiter>(limiter_config);
         LOG_INFO("Rate limiting enabled (per-client: 10 req/s, global: 1000 req/s)");
     } else {
         LOG_WARN("Rate limiting disabled");
     }
 
-    RunServer(tls_config);
+    // Per-request debug/trace logging is only compiled into the handlers
+    // when the log level could actually emit it
+    pipeline_options.request_logging =
+        distcache::Logger::get()->should_log(spdlog::level::debug);
+
+    if (persistence.has_value() && persistence->data_dir.empty()) {
+        LOG_ERROR("WAL options require --data-dir");
+        return 1;
+    }
+
+    if (handoff.has_value()) {
+        if (handoff->config.socket_path.empty()) {
+            LOG_ERROR("Handoff options require --handoff-socket");
+            return 1;
+        }
+        if (persistence.has_value()) {
+            handoff->config.node_id = persistence->node_id;
+        }
+    }
+
+    if (datasets.has_value() && datasets->mounts.empty()) {
+        LOG_ERROR("Dataset options require --dataset");
+        return 1;
+    }
+
+    RunServer(tls_config, resp_config, pipeline_options, persistence, handoff, datasets);
 
     return 0;
 }
@@ -0,0 +1,956 @@
+#include "distcache/resp_server.h"
+#include "distcache/logger.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace distcache {
+
+namespace {
+
+// Longest inline command accepted before the line terminator arrives
+constexpr size_t kMaxInlineLength = 64 * 1024;
+
+// Most arguments accepted in one multibulk request
+constexpr int64_t kMaxMultibulkLength = 1024 * 1024;
+
+// Bytes read from a socket per recv() call
+constexpr size_t kReadChunk = 16 * 1024;
+
+// Reply to writes refused while the table is handed to a new process
+constexpr std::string_view kHandoffError = "ERR handing off to a new server process";
+
+// Reply to writes into a mounted dataset's namespace
+constexpr std::string_view kReadOnlyError = "ERR key belongs to a read-only dataset";
+
+bool ParseInt64(std::string_view text, int64_t& value) {
+    if (text.empty()) {
+        return false;
+    }
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+// Read a CRLF-terminated integer line starting after a type byte at pos.
+// Returns INCOMPLETE if the line has not fully arrived.
+RespParser::Result ReadLength(const std::string& buffer, size_t& pos, int64_t& value) {
+    size_t crlf = buffer.find("\r\n", pos + 1);
+    if (crlf == std::string::npos) {
+        return RespParser::Result::INCOMPLETE;
+    }
+    if (!ParseInt64(std::string_view(buffer).substr(pos + 1, crlf - pos - 1), value)) {
+        return RespParser::Result::ERROR;
+    }
+    pos = crlf + 2;
+    return RespParser::Result::OK;
+}
+
+// Reply encoders
+
+void AppendSimple(std::string& out, std::string_view text) {
+    out += '+';
+    out += text;
+    out += "\r\n";
+}
+
+void AppendError(std::string& out, std::string_view text) {
+    out += '-';
+    out += text;
+    out += "\r\n";
+}
+
+void AppendInteger(std::string& out, int64_t value) {
+    out += ':';
+    out += std::to_string(value);
+    out += "\r\n";
+}
+
+void AppendBulk(std::string& out, const char* data, size_t size) {
+    out += '$';
+    out += std::to_string(size);
+    out += "\r\n";
+    out.append(data, size);
+    out += "\r\n";
+}
+
+void AppendBulk(std::string& out, std::string_view text) {
+    AppendBulk(out, text.data(), text.size());
+}
+
+void AppendNull(std::string& out, int protocol) {
+    out += protocol >= 3 ? "_\r\n" : "$-1\r\n";
+}
+
+void AppendArrayHeader(std::string& out, size_t count) {
+    out += '*';
+    out += std::to_string(count);
+    out += "\r\n";
+}
+
+void AppendMapHeader(std::string& out, size_t pairs, int protocol) {
+    if (protocol >= 3) {
+        out += '%';
+        out += std::to_string(pairs);
+        out += "\r\n";
+    } else {
+        AppendArrayHeader(out, pairs * 2);
+    }
+}
+
+void AppendWrongArity(std::string& out, const std::string& command) {
+    std::string lower = command;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    AppendError(out, "ERR wrong number of arguments for '" + lower + "' command");
+}
+
+} // namespace
+
+RespParser::Result RespParser::Parse(const std::string& buffer,
+                                     size_t& offset,
+                                     std::vector<std::string>& args,
+                                     std::string& error,
+                                     size_t max_bulk_length) {
+    args.clear();
+    if (offset >= buffer.size()) {
+        return Result::INCOMPLETE;
+    }
+
+    if (buffer[offset] != '*') {
+        // Inline command: whitespace-separated words up to the newline
+        size_t newline = buffer.find('\n', offset);
+        if (newline == std::string::npos) {
+            if (buffer.size() - offset > kMaxInlineLength) {
+                error = "Protocol error: too big inline request";
+                return Result::ERROR;
+            }
+            return Result::INCOMPLETE;
+        }
+
+        size_t end = newline;
+        if (end > offset && buffer[end - 1] == '\r') {
+            --end;
+        }
+
+        size_t pos = offset;
+        while (pos < end) {
+            while (pos < end && (buffer[pos] == ' ' || buffer[pos] == '\t')) {
+                ++pos;
+            }
+            size_t start = pos;
+            while (pos < end && buffer[pos] != ' ' && buffer[pos] != '\t') {
+                ++pos;
+            }
+            if (pos > start) {
+                args.emplace_back(buffer, start, pos - start);
+            }
+        }
+
+        offset = newline + 1;
+        return Result::OK;
+    }
+
+    size_t pos = offset;
+    int64_t count = 0;
+    Result result = ReadLength(buffer, pos, count);
+    if (result == Result::ERROR || count > kMaxMultibulkLength) {
+        error = "Protocol error: invalid multibulk length";
+        return Result::ERROR;
+    }
+    if (result == Result::INCOMPLETE) {
+        return result;
+    }
+
+    args.reserve(count > 0 ? static_cast<size_t>(count) : 0);
+    for (int64_t i = 0; i < count; ++i) {
+        if (pos >= buffer.size()) {
+            return Result::INCOMPLETE;
+        }
+        if (buffer[pos] != '$') {
+            error = std::string("Protocol error: expected '$', got '") + buffer[pos] + "'";
+            return Result::ERROR;
+        }
+
+        int64_t length = 0;
+        result = ReadLength(buffer, pos, length);
+        if (result == Result::ERROR || length < 0 ||
+            static_cast<uint64_t>(length) > max_bulk_length) {
+            error = "Protocol error: invalid bulk length";
+            return Result::ERROR;
+        }
+        if (result == Result::INCOMPLETE) {
+            return result;
+        }
+
+        if (buffer.size() - pos < static_cast<size_t>(length) + 2) {
+            return Result::INCOMPLETE;
+        }
+        if (buffer[pos + length] != '\r' || buffer[pos + length + 1] != '\n') {
+            error = "Protocol error: bulk string not terminated by CRLF";
+            return Result::ERROR;
+        }
+
+        args.emplace_back(buffer, pos, static_cast<size_t>(length));
+        pos += static_cast<size_t>(length) + 2;
+    }
+
+    offset = pos;
+    return Result::OK;
+}
+
+RespServer::RespServer(const Config& config, std::shared_ptr<ShardedHashTable> storage,
+                       std::shared_ptr<WAL> wal,
+                       std::shared_ptr<StaticDatasets> datasets)
+    : config_(config)
+    , storage_(std::move(storage))
+    , wal_(std::move(wal))
+    , datasets_(std::move(datasets))
+    , port_(config.port) {}
+
+RespServer::~RespServer() {
+    Stop();
+}
+
+RespServer::Stats RespServer::GetStats() const {
+    Stats stats;
+    stats.connections_accepted = connections_accepted_.load();
+    stats.active_connections = active_connections_.load();
+    stats.commands_processed = commands_processed_.load();
+    stats.protocol_errors = protocol_errors_.load();
+    return stats;
+}
+
+bool RespServer::IsReadOnly(const std::string& key) const {
+    return datasets_ && datasets_->is_read_only(key);
+}
+
+void RespServer::ExecuteCommand(Connection& conn, std::vector<std::string>& args) {
+    std::string& out = conn.out;
+    std::string command = args[0];
+    std::transform(command.begin(), command.end(), command.begin(),
+                   [](unsigned char c) { return std::toupper(c); });
+
+    commands_processed_.fetch_add(1, std::memory_order_relaxed);
+
+    if (command == "GET") {
+        if (args.size() != 2) {
+            return AppendWrongArity(out, command);
+        }
+
+        // Keys in a mounted dataset's namespace are served from it alone
+        if (datasets_) {
+            auto lookup = datasets_->lookup(args[1]);
+            if (lookup.dataset) {
+                if (lookup.value.has_value()) {
+                    AppendBulk(out, *lookup.value);
+                } else {
+                    AppendNull(out, conn.protocol);
+                }
+                return;
+            }
+        }
+
+        auto entry = storage_->get(args[1]);
+        if (entry.has_value()) {
+            AppendBulk(out, reinterpret_cast<const char*>(entry->value.data()),
+                       entry->value.size());
+        } else {
+            AppendNull(out, conn.protocol);
+        }
+    } else if (command == "SET") {
+        if (args.size() < 3) {
+            return AppendWrongArity(out, command);
+        }
+        if (IsReadOnly(args[1])) {
+            return AppendError(out, kReadOnlyError);
+        }
+
+        // Optional EX seconds / PX milliseconds
+        std::optional<int64_t> expire_ms;
+        for (size_t i = 3; i < args.size(); ++i) {
+            std::string option = args[i];
+            std::transform(option.begin(), option.end(), option.begin(),
+                           [](unsigned char c) { return std::toupper(c); });
+            int64_t amount = 0;
+            if ((option == "EX" || option == "PX") && i + 1 < args.size() && !expire_ms) {
+                if (!ParseInt64(args[++i], amount) || amount <= 0 ||
+                    amount > (option == "EX" ? INT32_MAX : INT64_MAX / 2)) {
+                    return AppendError(out, "ERR invalid expire time in 'set' command");
+                }
+                expire_ms = option == "EX" ? amount * 1000 : amount;
+            } else {
+                return AppendError(out, "ERR syntax error");
+            }
+        }
+
+        std::optional<int32_t> ttl;
+        if (expire_ms) {
+            // TTLs are tracked in whole seconds; keep the exact deadline
+            ttl = static_cast<int32_t>(std::min<int64_t>((*expire_ms + 999) / 1000, INT32_MAX));
+        }
+
+        std::vector<uint8_t> value(args[2].begin(), args[2].end());
+        CacheEntry entry(args[1], std::move(value), ttl);
+        if (expire_ms) {
+            entry.expires_at_ms = entry.created_at_ms + *expire_ms;
+        }
+
+        if (storage_->set(args[1], std::move(entry))) {
+            conn.wrote = true;
+            AppendSimple(out, "OK");
+        } else if (storage_->writes_frozen()) {
+            AppendError(out, kHandoffError);
+        } else {
+            AppendError(out, "ERR write failed");
+        }
+    } else if (command == "DEL") {
+        if (args.size() < 2) {
+            return AppendWrongArity(out, command);
+        }
+        for (size_t i = 1; i < args.size(); ++i) {
+            if (IsReadOnly(args[i])) {
+                return AppendError(out, kReadOnlyError);
+            }
+        }
+        int64_t removed = 0;
+        for (size_t i = 1; i < args.size(); ++i) {
+            if (storage_->del(args[i])) {
+                ++removed;
+            }
+        }
+        conn.wrote = removed > 0;
+
+        // A missing key and a frozen table both fail del()
+        if (removed < static_cast<int64_t>(args.size() - 1) && storage_->writes_frozen()) {
+            return AppendError(out, kHandoffError);
+        }
+        AppendInteger(out, removed);
+    } else if (command == "MGET") {
+        if (args.size() < 2) {
+            return AppendWrongArity(out, command);
+        }
+
+        // Dataset keys are answered from their dataset; the rest from storage
+        std::vector<StaticDatasets::Lookup> lookups(args.size() - 1);
+        std::vector<std::string> keys;
+        keys.reserve(args.size() - 1);
+        for (size_t i = 1; i < args.size(); ++i) {
+            if (datasets_) {
+                lookups[i - 1] = datasets_->lookup(args[i]);
+            }
+            if (!lookups[i - 1].dataset) {
+                keys.push_back(std::move(args[i]));
+            }
+        }
+
+        auto entries = storage_->multi_get(keys);
+        AppendArrayHeader(out, lookups.size());
+        size_t next = 0;
+        for (const auto& lookup : lookups) {
+            if (lookup.dataset) {
+                if (lookup.value.has_value()) {
+                    AppendBulk(out, *lookup.value);
+                } else {
+                    AppendNull(out, conn.protocol);
+                }
+                continue;
+            }
+
+            const auto& entry = entries[next++];
+            if (entry.has_value()) {
+                AppendBulk(out, reinterpret_cast<const char*>(entry->value.data()),
+                           entry->value.size());
+            } else {
+                AppendNull(out, conn.protocol);
+            }
+        }
+    } else if (command == "MSET") {
+        if (args.size() < 3 || args.size() % 2 == 0) {
+            return AppendWrongArity(out, command);
+        }
+        for (size_t i = 1; i < args.size(); i += 2) {
+            if (IsReadOnly(args[i])) {
+                return AppendError(out, kReadOnlyError);
+            }
+        }
+        std::vector<CacheEntry> entries;
+        entries.reserve(args.size() / 2);
+        for (size_t i = 1; i + 1 < args.size(); i += 2) {
+            std::vector<uint8_t> value(args[i + 1].begin(), args[i + 1].end());
+            entries.emplace_back(std::move(args[i]), std::move(value));
+        }
+        auto results = storage_->multi_set(std::move(entries));
+        size_t applied = static_cast<size_t>(std::count(results.begin(), results.end(), true));
+        conn.wrote = applied > 0;
+        if (applied == results.size()) {
+            AppendSimple(out, "OK");
+        } else if (storage_->writes_frozen()) {
+            AppendError(out, kHandoffError);
+        } else {
+            AppendError(out, "ERR write failed");
+        }
+    } else if (command == "EXPIRE") {
+        if (args.size() != 3) {
+            return AppendWrongArity(out, command);
+        }
+        if (IsReadOnly(args[1])) {
+            return AppendError(out, kReadOnlyError);
+        }
+        int64_t seconds = 0;
+        if (!ParseInt64(args[2], seconds)) {
+            return AppendError(out, "ERR value is not an integer or out of range");
+        }
+        seconds = std::clamp<int64_t>(seconds, INT32_MIN, INT32_MAX);
+        conn.wrote = storage_->expire(args[1], static_cast<int32_t>(seconds));
+        if (!conn.wrote && storage_->writes_frozen()) {
+            return AppendError(out, kHandoffError);
+        }
+        AppendInteger(out, conn.wrote ? 1 : 0);
+    } else if (command == "INCR" || command == "DECR" ||
+               command == "INCRBY" || command == "DECRBY") {
+        bool by = command == "INCRBY" || command == "DECRBY";
+        if (args.size() != (by ? 3u : 2u)) {
+            return AppendWrongArity(out, command);
+        }
+        if (IsReadOnly(args[1])) {
+            return AppendError(out, kReadOnlyError);
+        }
+        int64_t delta = 1;
+        if (by && (!ParseInt64(args[2], delta) || delta == INT64_MIN)) {
+            return AppendError(out, "ERR value is not an integer or out of range");
+        }
+        if (command[0] == 'D') {
+            delta = -delta;
+        }
+        auto result = storage_->incr_by(args[1], delta);
+        if (result.success) {
+            conn.wrote = true;
+            AppendInteger(out, result.value);
+        } else if (storage_->writes_frozen()) {
+            AppendError(out, kHandoffError);
+        } else {
+            AppendError(out, "ERR " + result.error);
+        }
+    } else if (command == "PING") {
+        if (args.size() > 2) {
+            return AppendWrongArity(out, command);
+        }
+        if (args.size() == 2) {
+            AppendBulk(out, args[1]);
+        } else {
+            AppendSimple(out, "PONG");
+        }
+    } else if (command == "ECHO") {
+        if (args.size() != 2) {
+            return AppendWrongArity(out, command);
+        }
+        AppendBulk(out, args[1]);
+    } else if (command == "HELLO") {
+        if (args.size() >= 2) {
+            int64_t version = 0;
+            if (!ParseInt64(args[1], version)) {
+                return AppendError(out, "ERR Protocol version is not an integer or out of range");
+            }
+            if (version != 2 && version != 3) {
+                return AppendError(out, "NOPROTO unsupported protocol version");
+            }
+            conn.protocol = static_cast<int>(version);
+        }
+
+        AppendMapHeader(out, 6, conn.protocol);
+        AppendBulk(out, "server");
+        AppendBulk(out, "distcache");
+        AppendBulk(out, "version");
+        AppendBulk(out, "0.1");
+        AppendBulk(out, "proto");
+        AppendInteger(out, conn.protocol);
+        AppendBulk(out, "id");
+        AppendInteger(out, conn.fd);
+        AppendBulk(out, "mode");
+        AppendBulk(out, "standalone");
+        AppendBulk(out, "role");
+        AppendBulk(out, "master");
+    } else if (command == "COMMAND") {
+        // Clients such as redis-cli probe this on connect
+        AppendArrayHeader(out, 0);
+    } else if (command == "QUIT") {
+        AppendSimple(out, "OK");
+        conn.close_after_write = true;
+    } else {
+        std::string message = "ERR unknown command '" + args[0] + "'";
+        AppendError(out, message);
+    }
+}
+
+#ifdef __linux__
+
+bool RespServer::Start() {
+    if (running_.exchange(true)) {
+        return true;  // Already running
+    }
+
+    size_t num_reactors = config_.num_reactors;
+    if (num_reactors == 0) {
+        num_reactors = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Bind every listener before starting any thread so a bind failure
+    // leaves nothing running
+    for (size_t i = 0; i < num_reactors; ++i) {
+        auto reactor = std::make_unique<Reactor>();
+        reactor->listen_fd = OpenListener();
+        reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        reactor->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        bool ok = reactor->listen_fd >= 0 && reactor->epoll_fd >= 0 && reactor->wake_fd >= 0;
+        if (ok) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = reactor->listen_fd;
+            ok = epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->listen_fd, &event) == 0;
+            event.data.fd = reactor->wake_fd;
+            ok = ok && epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wake_fd, &event) == 0;
+        }
+
+        reactors_.push_back(std::move(reactor));
+        if (!ok) {
+            LOG_ERROR("Failed to start RESP listener on {}:{}: {}",
+                      config_.bind_address, port_, std::strerror(errno));
+            running_.store(false);
+            Stop();
+            return false;
+        }
+    }
+
+    // Wake reactors with parked connections after every WAL commit
+    if (wal_) {
+        wal_->SetCommitListener([this] {
+            for (auto& reactor : reactors_) {
+                if (reactor->parked_count.load() > 0) {
+                    uint64_t one = 1;
+                    ssize_t written = write(reactor->wake_fd, &one, sizeof(one));
+                    (void)written;
+                }
+            }
+        });
+    }
+
+    for (size_t i = 0; i < reactors_.size(); ++i) {
+        Reactor& reactor = *reactors_[i];
+        reactor.thread = std::thread(&RespServer::RunReactor, this, std::ref(reactor), i);
+    }
+
+    LOG_INFO("RESP listener on {}:{} with {} reactors",
+             config_.bind_address, port_, reactors_.size());
+    return true;
+}
+
+void RespServer::Stop() {
+    running_.store(false);
+    if (wal_) {
+        wal_->SetCommitListener(nullptr);
+    }
+
+    for (auto& reactor : reactors_) {
+        if (reactor->wake_fd >= 0) {
+            uint64_t one = 1;
+            ssize_t written = write(reactor->wake_fd, &one, sizeof(one));
+            (void)written;
+        }
+    }
+
+    for (auto& reactor : reactors_) {
+        if (reactor->thread.joinable()) {
+            reactor->thread.join();
+        }
+        for (auto& [fd, conn] : reactor->connections) {
+            close(fd);
+            active_connections_.fetch_sub(1);
+        }
+        reactor->connections.clear();
+
+        for (int fd : {reactor->listen_fd, reactor->epoll_fd, reactor->wake_fd}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+    reactors_.clear();
+}
+
+int RespServer::OpenListener() {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    if (inet_pton(AF_INET, config_.bind_address.c_str(), &addr.sin_addr) != 1 ||
+        bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    // With port 0 the first listener picks the port; the rest share it
+    if (port_ == 0) {
+        socklen_t len = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+    }
+
+    return fd;
+}
+
+void RespServer::RunReactor(Reactor& reactor, size_t index) {
+    if (config_.pin_reactors) {
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(index % cores, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    std::vector<epoll_event> events(256);
+    while (running_.load()) {
+        int ready = epoll_wait(reactor.epoll_fd, events.data(),
+                               static_cast<int>(events.size()), -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("RESP reactor {} epoll_wait failed: {}", index, std::strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t flags = events[i].events;
+
+            if (fd == reactor.listen_fd) {
+                AcceptConnections(reactor);
+                continue;
+            }
+            if (fd == reactor.wake_fd) {
+                // A WAL commit or Stop(); the loop condition handles the latter
+                uint64_t count = 0;
+                ssize_t drained = read(reactor.wake_fd, &count, sizeof(count));
+                (void)drained;
+                ResumeParked(reactor);
+                continue;
+            }
+
+            auto it = reactor.connections.find(fd);
+            if (it == reactor.connections.end()) {
+                continue;
+            }
+            Connection& conn = *it->second;
+
+            bool alive = !(flags & (EPOLLERR | EPOLLHUP));
+            if (alive && (flags & EPOLLIN)) {
+                alive = HandleReadable(reactor, conn);
+            }
+            if (alive && (flags & EPOLLOUT)) {
+                alive = FlushOutput(conn);
+
+                // Resume commands that were held back while output was full
+                if (alive && conn.in_offset < conn.in.size()) {
+                    ProcessInput(reactor, conn);
+                    alive = FlushOutput(conn);
+                }
+            }
+            if (alive && conn.close_after_write && conn.out_offset == conn.out.size()) {
+                alive = false;
+            }
+
+            if (alive) {
+                UpdateInterest(reactor, conn);
+            } else {
+                CloseConnection(reactor, fd);
+            }
+        }
+    }
+}
+
+void RespServer::ResumeParked(Reactor& reactor) {
+    std::vector<int> parked;
+    parked.swap(reactor.parked);
+
+    for (int fd : parked) {
+        auto it = reactor.connections.find(fd);
+        if (it == reactor.connections.end() || !it->second->parked) {
+            continue;  // Closed, or released when it parked
+        }
+        Connection& conn = *it->second;
+
+        WAL::CommitState state = wal_->PollCommit(conn.commit);
+        if (state == WAL::CommitState::PENDING) {
+            reactor.parked.push_back(fd);
+            continue;
+        }
+        ReleaseHeld(conn, state == WAL::CommitState::COMMITTED);
+
+        // Send the released replies and pick up input read before parking
+        bool alive = FlushOutput(conn);
+        if (alive && conn.in_offset < conn.in.size()) {
+            ProcessInput(reactor, conn);
+            alive = FlushOutput(conn);
+        }
+        if (alive && conn.close_after_write && conn.out_offset == conn.out.size()) {
+            alive = false;
+        }
+
+        if (alive) {
+            UpdateInterest(reactor, conn);
+        } else {
+            CloseConnection(reactor, fd);
+        }
+    }
+    reactor.parked_count.store(reactor.parked.size());
+}
+
+void RespServer::ReleaseHeld(Connection& conn, bool committed) {
+    if (!committed) {
+        LOG_ERROR("WAL commit failed; RESP writes applied in memory only");
+        std::string replies;
+        size_t copied = 0;
+        for (const auto& [start, end] : conn.held_writes) {
+            replies.append(conn.out, copied, start - copied);
+            AppendError(replies, "ERR write could not be persisted");
+            copied = end;
+        }
+        replies.append(conn.out, copied, std::string::npos);
+        conn.out = std::move(replies);
+    }
+
+    conn.parked = false;
+    conn.held_from = 0;
+    conn.held_writes.clear();
+    conn.commit = WAL::CommitTicket{};
+}
+
+void RespServer::AcceptConnections(Reactor& reactor) {
+    while (true) {
+        int fd = accept4(reactor.listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_WARN("RESP accept failed: {}", std::strerror(errno));
+            }
+            return;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto conn = std::make_unique<Connection>();
+        conn->fd = fd;
+        conn->events = EPOLLIN;
+
+        epoll_event event{};
+        event.events = conn->events;
+        event.data.fd = fd;
+        if (epoll_ctl(reactor.epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            continue;
+        }
+
+        reactor.connections[fd] = std::move(conn);
+        connections_accepted_.fetch_add(1, std::memory_order_relaxed);
+        active_connections_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool RespServer::HandleReadable(Reactor& reactor, Connection& conn) {
+    // Read everything currently available
+    while (true) {
+        size_t used = conn.in.size();
+        conn.in.resize(used + kReadChunk);
+        ssize_t received = recv(conn.fd, conn.in.data() + used, kReadChunk, 0);
+        if (received > 0) {
+            conn.in.resize(used + static_cast<size_t>(received));
+            if (static_cast<size_t>(received) < kReadChunk) {
+                break;
+            }
+            continue;
+        }
+
+        conn.in.resize(used);
+        if (received == 0) {
+            return false;  // Peer closed
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+
+    ProcessInput(reactor, conn);
+    return FlushOutput(conn);
+}
+
+void RespServer::ProcessInput(Reactor& reactor, Connection& conn) {
+    if (conn.parked) {
+        return;  // Resumed once the WAL commits the held writes
+    }
+
+    // Execute every complete command; replies accumulate in conn.out and
+    // go out together in one write
+    std::vector<std::string> args;
+    std::string error;
+
+    // Reply ranges of commands that changed storage; they are not sent
+    // until the WAL has committed the burst's writes
+    std::vector<std::pair<size_t, size_t>> write_replies;
+
+    while (!conn.close_after_write &&
+           conn.out.size() - conn.out_offset < config_.max_output_buffer) {
+        auto result = RespParser::Parse(conn.in, conn.in_offset, args, error,
+                                        config_.max_bulk_length);
+        if (result == RespParser::Result::INCOMPLETE) {
+            break;
+        }
+        if (result == RespParser::Result::ERROR) {
+            protocol_errors_.fetch_add(1, std::memory_order_relaxed);
+            AppendError(conn.out, "ERR " + error);
+            conn.close_after_write = true;
+            break;
+        }
+        if (!args.empty()) {
+            size_t reply_start = conn.out.size();
+            conn.wrote = false;
+            ExecuteCommand(conn, args);
+            if (conn.wrote) {
+                write_replies.emplace_back(reply_start, conn.out.size());
+            }
+        }
+    }
+
+    // Storage queued each write to the WAL on this thread, so one ticket
+    // covers the whole burst. Park rather than wait, so the reactor keeps
+    // serving its other connections; the commit listener resumes this one
+    if (wal_ && !write_replies.empty()) {
+        conn.commit = wal_->TakeOwnCommits();
+        conn.held_from = write_replies.front().first;
+        conn.held_writes = std::move(write_replies);
+        conn.parked = true;
+        reactor.parked.push_back(conn.fd);
+        reactor.parked_count.store(reactor.parked.size());
+
+        // Counted as parked first, so a commit landing after this poll
+        // still wakes the reactor
+        WAL::CommitState state = wal_->PollCommit(conn.commit);
+        if (state != WAL::CommitState::PENDING) {
+            ReleaseHeld(conn, state == WAL::CommitState::COMMITTED);
+        }
+    }
+
+    // Drop consumed input
+    if (conn.in_offset == conn.in.size()) {
+        conn.in.clear();
+        conn.in_offset = 0;
+    } else if (conn.in_offset > conn.in.size() / 2) {
+        conn.in.erase(0, conn.in_offset);
+        conn.in_offset = 0;
+    }
+}
+
+bool RespServer::FlushOutput(Connection& conn) {
+    // Replies from a parked burst's first write on stay buffered
+    size_t limit = conn.parked ? conn.held_from : conn.out.size();
+    while (conn.out_offset < limit) {
+        ssize_t sent = send(conn.fd, conn.out.data() + conn.out_offset,
+                            limit - conn.out_offset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn.out_offset += static_cast<size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;  // Wait for EPOLLOUT
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        return false;
+    }
+
+    if (!conn.parked) {
+        conn.out.clear();
+        conn.out_offset = 0;
+    }
+    return true;
+}
+
+void RespServer::UpdateInterest(Reactor& reactor, Connection& conn) {
+    size_t limit = conn.parked ? conn.held_from : conn.out.size();
+    size_t pending = limit - conn.out_offset;
+
+    uint32_t events = 0;
+    if (!conn.parked && !conn.close_after_write &&
+        conn.out.size() - conn.out_offset < config_.max_output_buffer) {
+        events |= EPOLLIN;
+    }
+    if (pending > 0) {
+        events |= EPOLLOUT;
+    }
+
+    if (events != conn.events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = conn.fd;
+        epoll_ctl(reactor.epoll_fd, EPOLL_CTL_MOD, conn.fd, &event);
+        conn.events = events;
+    }
+}
+
+void RespServer::CloseConnection(Reactor& reactor, int fd) {
+    epoll_ctl(reactor.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    reactor.connections.erase(fd);
+    active_connections_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+#else  // !__linux__
+
+bool RespServer::Start() {
+    LOG_ERROR("RESP listener requires Linux (epoll)");
+    return false;
+}
+
+void RespServer::Stop() {}
+
+int RespServer::OpenListener() { return -1; }
+void RespServer::RunReactor(Reactor&, size_t) {}
+void RespServer::AcceptConnections(Reactor&) {}
+bool RespServer::HandleReadable(Reactor&, Connection&) { return false; }
+void RespServer::ProcessInput(Reactor&, Connection&) {}
+void RespServer::ResumeParked(Reactor&) {}
+void RespServer::ReleaseHeld(Connection&, bool) {}
+bool RespServer::FlushOutput(Connection&) { return false; }
+void RespServer::UpdateInterest(Reactor&, Connection&) {}
+void RespServer::CloseConnection(Reactor&, int) {}
+
+#endif  // __linux__
+
+} // namespace distcache
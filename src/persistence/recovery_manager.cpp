@@ -2,10 +2,134 @@
 #include "distcache/logger.h"
 #include "distcache/cache_entry.h"
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <thread>
 
 namespace distcache {
 
+namespace {
+
+/**
+ * Applies replayed entries on one worker thread per partition. Each
+ * partition is fed in log order through a bounded queue of batches,
+ * which caps memory and pushes back on the merge when workers lag.
+ */
+class PartitionedApplier {
+public:
+    using ApplyFn = std::function<bool(const WAL::WALEntry&)>;
+
+    static constexpr size_t kBatchSize = 256;
+    static constexpr size_t kMaxQueuedBatches = 8;
+
+    PartitionedApplier(size_t partitions, ApplyFn apply) : apply_(std::move(apply)) {
+        for (size_t i = 0; i < partitions; ++i) {
+            partitions_.push_back(std::make_unique<Partition>());
+        }
+        for (auto& partition : partitions_) {
+            partition->worker = std::thread(&PartitionedApplier::Run, this, partition.get());
+        }
+    }
+
+    ~PartitionedApplier() {
+        Finish();
+    }
+
+    size_t size() const { return partitions_.size(); }
+
+    void Submit(size_t partition_index, WAL::WALEntry&& entry) {
+        auto& partition = *partitions_[partition_index];
+        partition.staging.push_back(std::move(entry));
+        if (partition.staging.size() >= kBatchSize) {
+            Flush(partition);
+        }
+    }
+
+    /**
+     * Hand over partial batches and wait for every worker to drain.
+     */
+    void Finish() {
+        for (auto& partition : partitions_) {
+            if (!partition->staging.empty()) {
+                Flush(*partition);
+            }
+            {
+                std::lock_guard<std::mutex> lock(partition->mutex);
+                partition->closed = true;
+            }
+            partition->cv.notify_all();
+        }
+        for (auto& partition : partitions_) {
+            if (partition->worker.joinable()) {
+                partition->worker.join();
+            }
+        }
+    }
+
+    size_t applied() const { return applied_.load(std::memory_order_relaxed); }
+
+private:
+    struct Partition {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::vector<WAL::WALEntry>> queue;
+        bool closed = false;
+        std::vector<WAL::WALEntry> staging;  // Filled by the merging thread
+        std::thread worker;
+    };
+
+    void Flush(Partition& partition) {
+        std::unique_lock<std::mutex> lock(partition.mutex);
+        partition.cv.wait(lock, [&] { return partition.queue.size() < kMaxQueuedBatches; });
+        partition.queue.push_back(std::move(partition.staging));
+        lock.unlock();
+        partition.cv.notify_all();
+
+        partition.staging.clear();
+        partition.staging.reserve(kBatchSize);
+    }
+
+    void Run(Partition* partition) {
+        while (true) {
+            std::vector<WAL::WALEntry> batch;
+            {
+                std::unique_lock<std::mutex> lock(partition->mutex);
+                partition->cv.wait(lock, [&] {
+                    return partition->closed || !partition->queue.empty();
+                });
+                if (partition->queue.empty()) {
+                    return;  // Closed and drained
+                }
+                batch = std::move(partition->queue.front());
+                partition->queue.pop_front();
+            }
+            partition->cv.notify_all();
+
+            size_t applied = 0;
+            for (const auto& entry : batch) {
+                if (apply_(entry)) {
+                    applied++;
+                } else {
+                    LOG_WARN("Failed to apply WAL entry at sequence: {}", entry.sequence_number);
+                }
+            }
+            applied_.fetch_add(applied, std::memory_order_relaxed);
+        }
+    }
+
+    ApplyFn apply_;
+    std::vector<std::unique_ptr<Partition>> partitions_;
+    std::atomic<size_t> applied_{0};
+};
+
+} // namespace
+
 RecoveryManager::RecoveryManager(
     const Config& config,
     std::shared_ptr<ShardedHashTable> storage,
@@ -28,27 +152,31 @@ RecoveryManager::RecoveryResult RecoveryManager::Recover() {
 
     // Step 1: Restore from snapshot
     if (!RestoreSnapshot(result)) {
-        LOG_WARN("No snapshot found or snapshot restore failed, starting from empty state");
-        // Not fatal - we can start from empty state
-        result.snapshot_restored = false;
+        LOG_ERROR("Snapshot restore failed: {}", result.error_message);
+        return result;
     }
-
-    // Step 2: Replay WAL entries since snapshot
-    int64_t snapshot_sequence = 0;  // If no snapshot, start from 0
-    if (result.snapshot_restored) {
-        // In a real implementation, we'd track the sequence number in the snapshot
-        // For now, we'll replay all WAL entries
-        snapshot_sequence = 0;
+    if (!result.snapshot_restored) {
+        LOG_WARN("No snapshot restored, starting from empty state");
     }
+    auto snapshot_done = std::chrono::steady_clock::now();
+    result.snapshot_restore_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        snapshot_done - start_time).count();
+
+    // Step 2: Replay WAL entries newer than the snapshot
+    int64_t snapshot_sequence = result.snapshot_restored ? result.snapshot_sequence : 0;
 
     if (!ReplayWAL(result, snapshot_sequence)) {
         LOG_ERROR("WAL replay failed");
-        result.error_message = "Failed to replay WAL";
+        if (result.error_message.empty()) {
+            result.error_message = "Failed to replay WAL";
+        }
         return result;
     }
 
     // Calculate duration
     auto end_time = std::chrono::steady_clock::now();
+    result.wal_replay_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        end_time - snapshot_done).count();
     result.recovery_duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
         end_time - start_time
     ).count();
@@ -62,9 +190,20 @@ RecoveryManager::RecoveryResult RecoveryManager::Recover() {
     if (result.snapshot_restored) {
         LOG_INFO("  Snapshot ID: {}", result.snapshot_id);
         LOG_INFO("  Snapshot keys: {}", result.snapshot_keys_count);
+        LOG_INFO("  Snapshot WAL sequence: {}", result.snapshot_sequence);
+        LOG_INFO("  Snapshot restore: {}ms{}", result.snapshot_restore_ms,
+                 result.snapshot_lazy ? " (lazy, loading in the background)" : "");
+        if (result.snapshot_corrupt_chunks > 0) {
+            LOG_WARN("  Snapshot chunks skipped as corrupt: {}", result.snapshot_corrupt_chunks);
+        }
     }
     LOG_INFO("  WAL files processed: {}", result.wal_files_count);
     LOG_INFO("  WAL entries replayed: {}", result.wal_entries_replayed);
+    LOG_INFO("  WAL replay: {}ms", result.wal_replay_ms);
+    if (result.wal_corrupt_files > 0) {
+        LOG_INFO("  WAL files truncated: {} ({} bytes discarded)",
+                 result.wal_corrupt_files, result.wal_bytes_discarded);
+    }
     LOG_INFO("  Last sequence number: {}", result.last_sequence_number);
     LOG_INFO("  Recovery duration: {}ms", result.recovery_duration_ms);
 
@@ -72,12 +211,18 @@ RecoveryManager::RecoveryResult RecoveryManager::Recover() {
 }
 
 bool RecoveryManager::RestoreSnapshot(RecoveryResult& result) {
-    // Get list of available snapshots
+    // Get list of available snapshots; unreadable ones count as failed
     auto snapshots = snapshot_manager_->ListSnapshots();
+    auto unreadable = snapshot_manager_->ListUnreadableSnapshots();
+    std::set<std::string> unreadable_ids;
+    for (auto& snapshot : unreadable) {
+        unreadable_ids.insert(snapshot.snapshot_id);
+        snapshots.push_back(std::move(snapshot));
+    }
 
     if (snapshots.empty()) {
         LOG_INFO("No snapshots available");
-        return false;
+        return true;
     }
 
     // Sort by timestamp (latest first)
@@ -87,29 +232,89 @@ bool RecoveryManager::RestoreSnapshot(RecoveryResult& result) {
                   return a.timestamp > b.timestamp;
               });
 
-    // Try to restore from latest snapshot
-    const auto& latest = snapshots[0];
-
-    LOG_INFO("Restoring from snapshot: {} ({} keys)",
-             latest.snapshot_id, latest.num_keys);
+    // Snapshots retire the WAL they hold, so an older snapshot, or the
+    // empty state, is only complete if the log still reaches back to it
+    int64_t wal_first = -1;
+    auto wal_covers = [&](int64_t sequence) {
+        if (wal_first < 0) {
+            wal_first = wal_->GetFirstSequenceNumber();
+        }
+        return wal_first > 0 && wal_first <= sequence + 1;
+    };
+
+    for (size_t i = 0; i < snapshots.size(); ++i) {
+        const auto& snapshot = snapshots[i];
+        if (i > 0 && !wal_covers(snapshot.wal_sequence)) {
+            LOG_WARN("Not falling back to snapshot {}: the WAL starts after its sequence {}",
+                     snapshot.snapshot_id, snapshot.wal_sequence);
+            continue;
+        }
+        if (unreadable_ids.count(snapshot.snapshot_id)) {
+            LOG_ERROR("Cannot restore unreadable snapshot: {}", snapshot.snapshot_id);
+            continue;
+        }
+        if (RestoreSnapshot(snapshot, result)) {
+            return true;
+        }
+        storage_->clear();  // Drop whatever part of it was loaded
+    }
 
-    if (!snapshot_manager_->RestoreFromSnapshot(latest.snapshot_id)) {
-        LOG_ERROR("Failed to restore from snapshot: {}", latest.snapshot_id);
+    if (!wal_covers(0)) {
+        result.error_message = "Failed to restore a snapshot, and the WAL no longer starts at "
+                               "sequence 1 (first record: " + std::to_string(wal_first) + ")";
         return false;
     }
+    LOG_WARN("Failed to restore any snapshot; the WAL holds every write");
+    return true;
+}
+
+bool RecoveryManager::RestoreSnapshot(const SnapshotManager::SnapshotMetadata& snapshot,
+                                      RecoveryResult& result) {
+    LOG_INFO("Restoring from snapshot: {} ({} keys)",
+             snapshot.snapshot_id, snapshot.num_keys);
+
+    // Snapshots a lazy restore cannot map shard for shard load eagerly
+    if (config_.lazy_restore &&
+        snapshot_manager_->BeginLazyRestore(snapshot.snapshot_id, config_.verify_checksums)) {
+        result.snapshot_lazy = true;
+    } else {
+        if (!snapshot_manager_->RestoreFromSnapshot(snapshot.snapshot_id, config_.verify_checksums)) {
+            LOG_ERROR("Failed to restore from snapshot: {}", snapshot.snapshot_id);
+            return false;
+        }
+        result.snapshot_corrupt_chunks = snapshot_manager_->GetStats().last_restore_corrupt_chunks;
+    }
 
     result.snapshot_restored = true;
-    result.snapshot_id = latest.snapshot_id;
-    result.snapshot_keys_count = latest.num_keys;
+    result.snapshot_id = snapshot.snapshot_id;
+    result.snapshot_keys_count = snapshot.num_keys;
+    result.snapshot_sequence = snapshot.wal_sequence;
 
     return true;
 }
 
+void RecoveryManager::LinkSnapshotsToWAL() {
+    std::weak_ptr<WAL> weak_wal = wal_;
+
+    snapshot_manager_->SetSequenceSource([weak_wal]() -> int64_t {
+        auto wal = weak_wal.lock();
+        return wal ? wal->GetLastSequenceNumber() : 0;
+    });
+
+    snapshot_manager_->SetSnapshotCallback(
+        [weak_wal](const SnapshotManager::SnapshotMetadata& metadata) {
+            auto wal = weak_wal.lock();
+            if (wal && metadata.wal_sequence > 0) {
+                wal->TruncateBeforeSequence(metadata.wal_sequence + 1);
+            }
+        });
+}
+
 bool RecoveryManager::ReplayWAL(RecoveryResult& result, int64_t snapshot_sequence) {
     LOG_INFO("Replaying WAL entries after sequence: {}", snapshot_sequence);
 
-    // Get all WAL files
     auto wal_files = wal_->ListWALFiles();
+    result.last_sequence_number = snapshot_sequence;
 
     if (wal_files.empty()) {
         LOG_INFO("No WAL files to replay");
@@ -122,61 +327,179 @@ bool RecoveryManager::ReplayWAL(RecoveryResult& result, int64_t snapshot_sequenc
 
     LOG_INFO("Found {} WAL files to process", wal_files.size());
 
-    // Collect all entries from all WAL files
-    std::vector<WAL::WALEntry> all_entries;
-
+    // Only a stream's newest segment may end in a torn or corrupt record
+    // (the write a crash interrupted). Damage in an older one is a hole
+    // in the log: replaying that stream's later segments would skip it.
+    std::map<std::filesystem::path, std::filesystem::path> stream_tails;
     for (const auto& wal_file_id : wal_files) {
-        std::filesystem::path wal_path = config_.wal_dir / (wal_file_id + ".wal");
+        auto path = config_.wal_dir / (wal_file_id + ".wal");
+        stream_tails[path.parent_path()] = path;
+    }
+    std::filesystem::path damaged;
+    auto check_finished = [&](const std::filesystem::path& path, const WAL::ReadReport& report) {
+        if (report.corrupted && damaged.empty() && stream_tails[path.parent_path()] != path) {
+            damaged = path;
+        }
+    };
+
+    // Each file is already in sequence order; merge them by the sequence
+    // of their next entry so at most one entry per file is held here
+    struct Cursor {
+        std::unique_ptr<WAL::Reader> reader;
+        WAL::WALEntry head;
+    };
+    std::vector<Cursor> cursors;
+    std::vector<std::pair<std::filesystem::path, WAL::ReadReport>> finished;
+
+    auto by_sequence = [&cursors](size_t a, size_t b) {
+        return cursors[a].head.sequence_number > cursors[b].head.sequence_number;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(by_sequence)> heap(by_sequence);
 
-        std::vector<WAL::WALEntry> entries;
-        if (!wal_->ReadWALFile(wal_path, entries)) {
+    for (const auto& wal_file_id : wal_files) {
+        auto reader = std::make_unique<WAL::Reader>(config_.wal_dir / (wal_file_id + ".wal"));
+        if (!reader->Open()) {
             LOG_ERROR("Failed to read WAL file: {}", wal_file_id);
+            WAL::ReadReport unreadable;
+            unreadable.corrupted = true;
+            check_finished(reader->path(), unreadable);
             continue;
         }
 
-        LOG_DEBUG("Read {} entries from WAL file: {}", entries.size(), wal_file_id);
+        Cursor cursor{std::move(reader), {}};
+        if (cursor.reader->Next(cursor.head)) {
+            cursors.push_back(std::move(cursor));
+            heap.push(cursors.size() - 1);
+        } else {
+            finished.emplace_back(cursor.reader->path(), cursor.reader->report());
+            check_finished(cursor.reader->path(), cursor.reader->report());
+        }
+    }
 
-        // Filter entries after snapshot sequence
-        for (const auto& entry : entries) {
-            if (entry.sequence_number > snapshot_sequence) {
-                all_entries.push_back(entry);
+    size_t workers = config_.replay_threads > 0
+        ? config_.replay_threads
+        : std::max<size_t>(1, std::thread::hardware_concurrency());
+    workers = std::min(workers, storage_->shard_count());
+
+    PartitionedApplier applier(workers, [this](const WAL::WALEntry& entry) {
+        return ApplyWALEntry(entry);
+    });
+
+    // Progress reporting
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto interval = std::chrono::milliseconds(config_.progress_interval_ms);
+    auto next_report = start_time + interval;
+    size_t entries_read = 0;
+
+    auto progress = [&]() {
+        ReplayProgress p;
+        p.files_total = wal_files.size();
+        p.files_done = finished.size();
+        for (const auto& [path, report] : finished) {
+            p.bytes_read += report.valid_bytes;
+        }
+        for (const auto& cursor : cursors) {
+            if (cursor.reader) {
+                p.bytes_read += cursor.reader->bytes_consumed();
             }
         }
-    }
+        p.entries_read = entries_read;
+        p.entries_applied = applier.applied();
+        p.elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+        return p;
+    };
+
+    auto report_progress = [&](const ReplayProgress& p) {
+        LOG_INFO("WAL replay: {}/{} files, {} MB read, {} entries read, {} applied",
+                 p.files_done, p.files_total, p.bytes_read / (1024 * 1024),
+                 p.entries_read, p.entries_applied);
+        if (config_.progress_callback) {
+            config_.progress_callback(p);
+        }
+    };
 
-    if (all_entries.empty()) {
-        LOG_INFO("No WAL entries to replay");
-        result.wal_replayed = false;
-        return true;
+    int64_t max_sequence = snapshot_sequence;
+    while (!heap.empty() && damaged.empty()) {
+        size_t index = heap.top();
+        heap.pop();
+        Cursor& cursor = cursors[index];
+
+        WAL::WALEntry entry = std::move(cursor.head);
+        max_sequence = std::max(max_sequence, entry.sequence_number);
+        entries_read++;
+
+        if (entry.sequence_number > snapshot_sequence) {
+            size_t partition = storage_->get_shard_index(entry.key) % applier.size();
+            applier.Submit(partition, std::move(entry));
+        }
+
+        if (cursor.reader->Next(cursor.head)) {
+            heap.push(index);
+        } else {
+            // A stream's later segments only hold later sequences, so none
+            // of them has been applied if this one stops the replay
+            finished.emplace_back(cursor.reader->path(), cursor.reader->report());
+            check_finished(cursor.reader->path(), cursor.reader->report());
+            cursor.reader.reset();
+        }
+
+        if ((entries_read & 4095) == 0 && std::chrono::steady_clock::now() >= next_report) {
+            report_progress(progress());
+            next_report = std::chrono::steady_clock::now() + interval;
+        }
     }
 
-    // Sort entries by sequence number
-    std::sort(all_entries.begin(), all_entries.end(),
-              [](const WAL::WALEntry& a, const WAL::WALEntry& b) {
-                  return a.sequence_number < b.sequence_number;
-              });
+    applier.Finish();
+    cursors.clear();
 
-    LOG_INFO("Replaying {} WAL entries", all_entries.size());
+    // Left as found for the operator; nothing is truncated
+    if (!damaged.empty()) {
+        LOG_ERROR("WAL file {} is damaged before the end of its stream; refusing to "
+                  "replay past the hole", damaged.string());
+        result.wal_corrupt_files++;
+        result.error_message = "WAL file " + damaged.string() +
+                               " is damaged before later segments of its stream";
+        return false;
+    }
 
-    // Replay entries
-    size_t replayed = 0;
-    int64_t last_sequence = 0;
+    // Cut off torn or corrupt tails so they are never read again; the
+    // files are unmapped by now
+    for (const auto& [path, report] : finished) {
+        if (!report.corrupted) {
+            continue;
+        }
+        result.wal_corrupt_files++;
+        result.wal_bytes_discarded += report.discarded_bytes;
 
-    for (const auto& entry : all_entries) {
-        if (ApplyWALEntry(entry)) {
-            replayed++;
-            last_sequence = entry.sequence_number;
+        std::error_code ec;
+        std::filesystem::resize_file(path, report.valid_bytes, ec);
+        if (ec) {
+            LOG_ERROR("Failed to truncate WAL file {}: {}", path.string(), ec.message());
         } else {
-            LOG_WARN("Failed to apply WAL entry at sequence: {}", entry.sequence_number);
+            LOG_WARN("Truncated WAL file {} at offset {} ({} bytes discarded)",
+                     path.string(), report.valid_bytes, report.discarded_bytes);
         }
     }
 
-    result.wal_replayed = true;
+    // New records must be numbered after everything already on disk
+    result.last_sequence_number = max_sequence;
     result.wal_files_count = wal_files.size();
-    result.wal_entries_replayed = replayed;
-    result.last_sequence_number = last_sequence;
 
-    LOG_INFO("Successfully replayed {} WAL entries", replayed);
+    auto final_progress = progress();
+    report_progress(final_progress);
+
+    if (final_progress.entries_applied == 0) {
+        LOG_INFO("No WAL entries to replay");
+        result.wal_replayed = false;
+        return true;
+    }
+
+    result.wal_replayed = true;
+    result.wal_entries_replayed = final_progress.entries_applied;
+
+    LOG_INFO("Successfully replayed {} WAL entries with {} workers in {}ms",
+             final_progress.entries_applied, applier.size(), final_progress.elapsed_ms);
 
     return true;
 }
@@ -190,6 +513,7 @@ bool RecoveryManager::ApplyWALEntry(const WAL::WALEntry& entry) {
             cache_entry.version = entry.version;
             cache_entry.ttl_seconds = entry.ttl_seconds;
             cache_entry.created_at_ms = entry.timestamp_ms;
+            cache_entry.modified_at_ms = entry.timestamp_ms;
 
             // Calculate expiration if TTL is set
             if (entry.ttl_seconds.has_value()) {
@@ -203,7 +527,7 @@ bool RecoveryManager::ApplyWALEntry(const WAL::WALEntry& entry) {
         }
 
         case WAL::WALEntry::DELETE: {
-            storage_->del(entry.key);
+            storage_->discard(entry.key);
             LOG_TRACE("Replayed DELETE: key={}", entry.key);
             return true;
         }
@@ -217,6 +541,7 @@ bool RecoveryManager::ApplyWALEntry(const WAL::WALEntry& entry) {
             cache_entry.version = entry.version;
             cache_entry.ttl_seconds = entry.ttl_seconds;
             cache_entry.created_at_ms = entry.timestamp_ms;
+            cache_entry.modified_at_ms = entry.timestamp_ms;
 
             if (entry.ttl_seconds.has_value()) {
                 cache_entry.expires_at_ms = entry.timestamp_ms +
@@ -1,459 +1,2023 @@
 #include "distcache/wal.h"
 #include "distcache/cache_entry.h"
+#include "distcache/crc32c.h"
 #include "distcache/logger.h"
 #include "wal.pb.h"
+#include <google/protobuf/io/coded_stream.h>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_map>
 #include <chrono>
+#include <cerrno>
+#include <functional>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace distcache {
 
-WAL::WAL(const Config& config) : config_(config) {
+namespace {
+
+constexpr const char* kRecycledExtension = ".free";
+constexpr const char* kCompactingExtension = ".compacting";
+constexpr size_t kPacedWriteSize = 1024 * 1024;  // Throttled writes go out in 1MB pieces
+
+// Format 2 frames every record as
+//   crc32c (4) | length (4) | type (1) | payload (length)
+// where the checksum covers length, type and payload. Format 1 files
+// (length + payload only) are still readable.
+constexpr uint32_t kWALFormatVersion = 2;
+constexpr size_t kFrameHeaderSize = 9;
+
+enum RecordType : uint8_t {
+    kZeroType = 0,   // Zero padding after the last record
+    kEntryType = 1,  // One v1::WALEntry
+    kBlockType = 2,  // Compressed run of kEntryType frames
+};
+
+// A block payload is codec (1) | uncompressed size (4) | compressed data
+constexpr size_t kBlockHeaderSize = 5;
+
+// Sequence of the last record the calling thread submitted
+thread_local int64_t t_last_submitted = 0;
+
+// Per WAL the calling thread submitted to, its last sequence on each
+// stream (0 = nothing left to wait for)
+struct ThreadSubmissions {
+    uint64_t wal_id;
+    std::vector<int64_t> streams;
+};
+thread_local std::vector<ThreadSubmissions> t_submissions;
+
+std::atomic<uint64_t> g_next_wal_id{1};
+
+std::vector<int64_t>* FindThreadSubmissions(uint64_t wal_id) {
+    for (auto& submissions : t_submissions) {
+        if (submissions.wal_id == wal_id) {
+            return &submissions.streams;
+        }
+    }
+    return nullptr;
+}
+
+uint32_t FrameChecksum(const char* frame, const char* payload, size_t size) {
+    uint32_t crc = crc32c::Value(frame + 4, kFrameHeaderSize - 4);
+    return crc32c::Extend(crc, payload, size);
+}
+
+// Decompress a block and parse the entry frames inside it, verifying
+// each one. Any damage invalidates the whole block.
+bool ParseBlock(const char* payload, size_t size, std::string& scratch,
+                std::vector<v1::WALEntry>& out) {
+    if (size < kBlockHeaderSize) {
+        return false;
+    }
+
+    auto codec = static_cast<compression::Codec>(payload[0]);
+    uint32_t raw_size = 0;
+    std::memcpy(&raw_size, payload + 1, sizeof(raw_size));
+    if (!compression::Decompress(codec, payload + kBlockHeaderSize,
+                                 size - kBlockHeaderSize, raw_size, scratch)) {
+        return false;
+    }
+
+    size_t position = 0;
+    while (position < scratch.size()) {
+        if (scratch.size() - position < kFrameHeaderSize) {
+            return false;
+        }
+        const char* frame = scratch.data() + position;
+        uint32_t crc = 0;
+        uint32_t length = 0;
+        std::memcpy(&crc, frame, sizeof(crc));
+        std::memcpy(&length, frame + 4, sizeof(length));
+        if (static_cast<uint8_t>(frame[8]) != kEntryType ||
+            length > scratch.size() - position - kFrameHeaderSize ||
+            FrameChecksum(frame, frame + kFrameHeaderSize, length) != crc) {
+            return false;
+        }
+
+        v1::WALEntry entry;
+        if (!entry.ParseFromArray(frame + kFrameHeaderSize, static_cast<int>(length))) {
+            return false;
+        }
+        out.push_back(std::move(entry));
+        position += kFrameHeaderSize + length;
+    }
+    return !out.empty();
+}
+
+bool ConvertEntry(v1::WALEntry& pb_entry, WAL::WALEntry& entry) {
+    switch (pb_entry.type()) {
+        case v1::WAL_ENTRY_SET:
+            entry.type = WAL::WALEntry::SET;
+            break;
+        case v1::WAL_ENTRY_DELETE:
+            entry.type = WAL::WALEntry::DELETE;
+            break;
+        case v1::WAL_ENTRY_CAS:
+            entry.type = WAL::WALEntry::CAS;
+            break;
+        default:
+            return false;
+    }
+
+    entry.sequence_number = pb_entry.sequence_number();
+    entry.timestamp_ms = pb_entry.timestamp_ms();
+    entry.key = std::move(*pb_entry.mutable_key());
+    entry.value.assign(pb_entry.value().begin(), pb_entry.value().end());
+    entry.version = pb_entry.version();
+
+    if (pb_entry.has_ttl_seconds()) {
+        entry.ttl_seconds = pb_entry.ttl_seconds();
+    }
+    if (pb_entry.has_expected_version()) {
+        entry.expected_version = pb_entry.expected_version();
+    }
+    entry.replicated = pb_entry.replicated();
+    return true;
+}
+
+size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Write a whole file and fdatasync it, calling pace (if set) before each
+// kPacedWriteSize piece
+bool WriteFileDurably(const std::filesystem::path& path, const std::string& data,
+                      const std::function<void(size_t)>& pace = nullptr) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t done = 0;
+    while (done < data.size()) {
+        size_t length = data.size() - done;
+        if (pace) {
+            length = std::min(length, kPacedWriteSize);
+            pace(length);
+        }
+        ssize_t written = ::write(fd, data.data() + done, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ::close(fd);
+            return false;
+        }
+        done += static_cast<size_t>(written);
+    }
+    bool synced = ::fdatasync(fd) == 0;
+    return ::close(fd) == 0 && synced;
+}
+
+// Make a newly created log file's directory entry durable
+void SyncDirectory(const std::filesystem::path& dir) {
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        return;
+    }
+    ::fsync(dir_fd);
+    ::close(dir_fd);
+}
+
+} // namespace
+
+void WAL::FreeDeleter::operator()(char* p) const {
+    std::free(p);
+}
+
+WAL::WAL(const Config& config) : config_(config), instance_id_(g_next_wal_id.fetch_add(1)) {
     // Create WAL directory if it doesn't exist
     if (!std::filesystem::exists(config_.wal_dir)) {
         std::filesystem::create_directories(config_.wal_dir);
         LOG_INFO("Created WAL directory: {}", config_.wal_dir.string());
     }
+
+    if (config_.enable_compression) {
+        codec_ = compression::DefaultCodec();
+        LOG_INFO("WAL block compression enabled ({})", compression::CodecName(codec_));
+    }
+}
+
+WAL::~WAL() {
+    Close();
+    if (commit_log_) {
+        commit_log_->SetBackfill(nullptr);
+    }
+}
+
+void WAL::Open() {
+    if (is_open_.load()) {
+        LOG_WARN("WAL already open");
+        return;
+    }
+
+    size_t count = std::max<size_t>(1, config_.num_streams);
+    std::vector<std::unique_ptr<Stream>> streams;
+    for (size_t i = 0; i < count; ++i) {
+        auto stream = std::make_unique<Stream>();
+        stream->index = i;
+        stream->dir = count == 1 ? config_.wal_dir
+                                 : config_.wal_dir / ("stream-" + std::to_string(i));
+        std::error_code ec;
+        std::filesystem::create_directories(stream->dir, ec);
+
+        // A compaction interrupted before publishing leaves its output behind
+        for (const auto& entry : std::filesystem::directory_iterator(stream->dir, ec)) {
+            if (entry.path().extension() == kCompactingExtension) {
+                std::filesystem::remove(entry.path(), ec);
+            }
+        }
+
+        if (config_.use_io_uring && IORing::IsSupported()) {
+            stream->ring = std::make_unique<IORing>();
+            if (!stream->ring->Init(2 * std::max(1u, config_.io_uring_depth) + 2)) {
+                stream->ring.reset();
+            }
+        }
+        if (config_.use_io_uring && !stream->ring && i == 0) {
+            LOG_WARN("io_uring unavailable, WAL uses pwrite/fdatasync");
+        }
+        io_uring_.store(stream->ring != nullptr);
+
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (!OpenLogFile(*stream)) {
+            for (auto& opened : streams) {
+                ::close(opened->fd);
+            }
+            return;
+        }
+        streams.push_back(std::move(stream));
+    }
+
+    streams_ = std::move(streams);
+    for (auto& stream : streams_) {
+        std::lock_guard<std::mutex> commit_lock(stream->commit_mutex);
+        stream->submitted_sequence = last_sequence_.load();
+        stream->committed_sequence = stream->submitted_sequence;
+        stream->ring_durable_sequence.store(stream->submitted_sequence);
+        stream->writer_running = true;
+    }
+    is_open_.store(true);
+    for (auto& stream : streams_) {
+        stream->writer_thread = std::thread(&WAL::GroupCommitWriter, this, stream.get());
+    }
+    if (config_.compaction_interval_ms > 0) {
+        {
+            std::lock_guard<std::mutex> lock(compaction_mutex_);
+            stop_compaction_ = false;
+        }
+        compaction_thread_ = std::thread(&WAL::CompactionLoop, this);
+    }
+
+    if (streams_.size() == 1) {
+        LOG_INFO("WAL opened: {}", streams_[0]->current_log_id);
+    } else {
+        LOG_INFO("WAL opened with {} streams in {}", streams_.size(), config_.wal_dir.string());
+    }
+}
+
+void WAL::Close() {
+    if (!is_open_.exchange(false)) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(compaction_mutex_);
+        stop_compaction_ = true;
+    }
+    compaction_cv_.notify_all();
+    if (compaction_thread_.joinable()) {
+        compaction_thread_.join();
+    }
+
+    // Reject new records; each writer commits whatever is queued
+    for (auto& stream : streams_) {
+        {
+            std::lock_guard<std::mutex> commit_lock(stream->commit_mutex);
+            stream->stop_writer = true;
+        }
+        stream->commit_cv.notify_one();
+    }
+
+    for (auto& stream : streams_) {
+        if (stream->writer_thread.joinable()) {
+            stream->writer_thread.join();
+        }
+
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (stream->fd >= 0) {
+            if (config_.sync_on_write) {
+                SyncLocked(*stream);
+            }
+            ::close(stream->fd);
+            stream->fd = -1;
+        }
+    }
+
+    LOG_INFO("WAL closed");
+}
+
+void WAL::ResumeFromSequence(int64_t sequence) {
+    if (is_open_.load()) {
+        LOG_WARN("Cannot resume WAL sequence while open");
+        return;
+    }
+    last_sequence_.store(sequence);
+}
+
+void WAL::AttachCommitLog(std::shared_ptr<CommitLog> log) {
+    if (is_open_.load()) {
+        LOG_WARN("Cannot attach a commit log while the WAL is open");
+        return;
+    }
+    commit_log_ = std::move(log);
+    if (!commit_log_) {
+        return;
+    }
+    commit_log_->StartAfter(last_sequence_.load());
+    commit_log_->SetBackfill([this](int64_t after, int64_t up_to, size_t max_records,
+                                    std::vector<CommitLog::Record>& out) {
+        std::vector<WALEntry> entries;
+        if (!ReadEntriesAfter(after, up_to, max_records, entries)) {
+            return false;
+        }
+        for (auto& entry : entries) {
+            CommitLog::Record record;
+            record.op = entry.type == WALEntry::DELETE ? CommitLog::Record::Op::DELETE
+                                                       : CommitLog::Record::Op::SET;
+            record.sequence = entry.sequence_number;
+            record.key = std::move(entry.key);
+            record.value.assign(entry.value.begin(), entry.value.end());
+            record.ttl_seconds = entry.ttl_seconds.value_or(0);
+            record.version = entry.version;
+            record.replicated = entry.replicated;
+            out.push_back(std::move(record));
+        }
+        return true;
+    });
+}
+
+void WAL::AttachIoScheduler(std::shared_ptr<IoScheduler> scheduler) {
+    io_scheduler_ = std::move(scheduler);
+}
+
+void WAL::ThrottleIo(size_t bytes) const {
+    if (io_scheduler_) {
+        io_throttled_us_ += static_cast<uint64_t>(io_scheduler_->Acquire(bytes).count());
+    }
+}
+
+void WAL::DescribeEntry(RecordView& record, const CacheEntry& entry) {
+    record.value = &entry.value;
+    record.version = entry.version;
+    record.ttl_seconds = entry.ttl_seconds;
+
+    // Replay computes expiry as timestamp + TTL, so log the time the
+    // current TTL counts from; after an EXPIRE that is not created_at
+    record.timestamp_ms = entry.created_at_ms;
+    if (entry.ttl_seconds.has_value() && entry.expires_at_ms.has_value()) {
+        record.timestamp_ms = *entry.expires_at_ms -
+                              static_cast<int64_t>(*entry.ttl_seconds) * 1000;
+    }
+}
+
+bool WAL::AppendSet(const std::string& key, const CacheEntry& entry) {
+    RecordView record(WALEntry::SET, key);
+    DescribeEntry(record, entry);
+
+    return AppendRecord(record);
+}
+
+bool WAL::AppendDelete(const std::string& key) {
+    RecordView record(WALEntry::DELETE, key);
+    record.timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+
+    return AppendRecord(record);
+}
+
+bool WAL::AppendCAS(const std::string& key, const CacheEntry& entry, int64_t expected_version) {
+    RecordView record(WALEntry::CAS, key);
+    DescribeEntry(record, entry);
+    record.expected_version = expected_version;
+
+    return AppendRecord(record);
+}
+
+void WAL::on_set(const std::string& key, const CacheEntry& entry) {
+    if (!is_open_.load()) {
+        LOG_ERROR("WAL not open");
+        return;
+    }
+    RecordView record(WALEntry::SET, key);
+    DescribeEntry(record, entry);
+
+    SubmitRecord(StreamFor(key), record);
+}
+
+void WAL::on_delete(const std::string& key) {
+    if (!is_open_.load()) {
+        LOG_ERROR("WAL not open");
+        return;
+    }
+    RecordView record(WALEntry::DELETE, key);
+    record.timestamp_ms = CacheEntry::get_current_time_ms();
+
+    SubmitRecord(StreamFor(key), record);
+}
+
+WAL::Stream& WAL::StreamFor(const std::string& key) {
+    if (streams_.size() == 1) {
+        return *streams_[0];
+    }
+    return *streams_[std::hash<std::string>{}(key) % streams_.size()];
+}
+
+bool WAL::AppendRecord(RecordView& record) {
+    if (!is_open_.load()) {
+        LOG_ERROR("WAL not open");
+        return false;
+    }
+    Stream& stream = StreamFor(record.key);
+    int64_t sequence = SubmitRecord(stream, record);
+    return sequence > 0 && WaitForCommit(stream, sequence);
+}
+
+int64_t WAL::SubmitRecord(Stream& stream, RecordView& record) {
+    bool wake_writer = false;
+    {
+        std::lock_guard<std::mutex> lock(stream.commit_mutex);
+
+        if (!is_open_.load() || stream.commit_failed) {
+            LOG_ERROR("WAL not open");
+            return 0;
+        }
+
+        // Sequence numbers are WAL-wide but assigned under the stream's
+        // queue lock, so each stream's records land in sequence order
+        record.sequence_number = last_sequence_.fetch_add(1) + 1;
+        record.replicated = record.replicated || ReplicatedApplyScope::active();
+        stream.submitted_sequence = record.sequence_number;
+        t_last_submitted = record.sequence_number;
+
+        std::vector<int64_t>* mine = FindThreadSubmissions(instance_id_);
+        if (!mine) {
+            t_submissions.push_back({instance_id_, {}});
+            mine = &t_submissions.back().streams;
+        }
+        if (mine->size() <= stream.index) {
+            mine->resize(stream.index + 1, 0);
+        }
+        (*mine)[stream.index] = record.sequence_number;
+
+        // The commit log's record is built from the encoded batch once the
+        // writer takes it; only where it lies is noted here
+        LogSpan* span = nullptr;
+        if (commit_log_) {
+            span = &stream.pending_spans.emplace_back();
+            span->op = record.type == WALEntry::DELETE ? CommitLog::Record::Op::DELETE
+                                                       : CommitLog::Record::Op::SET;
+            span->sequence = record.sequence_number;
+            span->ttl_seconds = record.ttl_seconds.value_or(0);
+            span->version = record.version;
+            span->replicated = record.replicated;
+        }
+        EncodeRecord(record, stream.pending_buffer, span);
+        stream.pending_records++;
+
+        // Wake the writer for the first record of a batch, and again once
+        // the batch is full so it stops waiting for more
+        wake_writer = stream.pending_records == 1 || BatchFull(stream);
+    }
+
+    if (wake_writer) {
+        stream.commit_cv.notify_one();
+    }
+    return record.sequence_number;
+}
+
+int64_t WAL::LastSubmittedSequence() {
+    return t_last_submitted;
+}
+
+bool WAL::WaitForCommit(int64_t sequence) {
+    // A sequence covers records of every stream; each stream only needs
+    // to commit as far as the records it was actually given
+    bool ok = true;
+    for (auto& stream : streams_) {
+        int64_t target = 0;
+        {
+            std::lock_guard<std::mutex> lock(stream->commit_mutex);
+            target = std::min(sequence, stream->submitted_sequence);
+        }
+        ok = WaitForCommit(*stream, target) && ok;
+    }
+    return ok;
+}
+
+bool WAL::WaitForOwnCommits() {
+    CommitTicket ticket = TakeOwnCommits();
+    bool ok = true;
+    for (size_t i = 0; i < ticket.streams.size() && i < streams_.size(); ++i) {
+        if (ticket.streams[i] > 0) {
+            ok = WaitForCommit(*streams_[i], ticket.streams[i]) && ok;
+        }
+    }
+    return ok;
+}
+
+WAL::CommitTicket WAL::TakeOwnCommits() {
+    CommitTicket ticket;
+    std::vector<int64_t>* mine = FindThreadSubmissions(instance_id_);
+    if (mine) {
+        ticket.streams = *mine;
+        std::fill(mine->begin(), mine->end(), 0);
+    }
+    return ticket;
+}
+
+WAL::CommitState WAL::PollCommit(const CommitTicket& ticket) {
+    CommitState state = CommitState::COMMITTED;
+    for (size_t i = 0; i < ticket.streams.size() && i < streams_.size(); ++i) {
+        if (ticket.streams[i] <= 0) {
+            continue;
+        }
+        Stream& stream = *streams_[i];
+        std::lock_guard<std::mutex> lock(stream.commit_mutex);
+        if (stream.committed_sequence >= ticket.streams[i]) {
+            continue;
+        }
+        if (stream.commit_failed || !stream.writer_running) {
+            return CommitState::FAILED;
+        }
+        state = CommitState::PENDING;
+    }
+    return state;
+}
+
+void WAL::SetCommitListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(commit_listener_mutex_);
+    commit_listener_ = std::move(listener);
+}
+
+void WAL::NotifyDurable(Stream& stream) {
+    stream.durable_cv.notify_all();
+    std::lock_guard<std::mutex> lock(commit_listener_mutex_);
+    if (commit_listener_) {
+        commit_listener_();
+    }
+}
+
+bool WAL::WaitForCommit(Stream& stream, int64_t sequence) {
+    std::unique_lock<std::mutex> lock(stream.commit_mutex);
+    stream.durable_cv.wait(lock, [&] {
+        return stream.committed_sequence >= sequence || stream.commit_failed ||
+               !stream.writer_running;
+    });
+    return stream.committed_sequence >= sequence;
+}
+
+void WAL::PublishDurable() {
+    // Everything below the first record a stream has yet to commit is
+    // durable. Reading last_sequence_ first means any record at or below
+    // it is already visible in its stream's submitted_sequence
+    int64_t durable = last_sequence_.load();
+    for (auto& stream : streams_) {
+        std::lock_guard<std::mutex> lock(stream->commit_mutex);
+        if (stream->submitted_sequence > stream->committed_sequence) {
+            durable = std::min(durable, stream->committed_sequence);
+        }
+    }
+    commit_log_->MarkDurable(durable);
+}
+
+bool WAL::BatchFull(const Stream& stream) const {
+    return stream.pending_records >= config_.group_commit_max_records ||
+           stream.pending_buffer.size() >= config_.group_commit_max_bytes;
+}
+
+const std::string& WAL::TakeBatch(Stream& s, size_t& records, int64_t& sequence) {
+    records = s.pending_records;
+    sequence = s.submitted_sequence;
+    s.pending_records = 0;
+
+    if (!commit_log_) {
+        // Appenders keep queueing into the other buffer
+        s.write_buffer.swap(s.pending_buffer);
+        s.pending_buffer.clear();
+        return s.write_buffer;
+    }
+
+    // The commit log's records will point into the batch, so it is handed
+    // over whole rather than reused
+    size_t capacity = s.pending_buffer.capacity();
+    s.log_batch = std::make_shared<const std::string>(std::move(s.pending_buffer));
+    s.pending_buffer = std::string();
+    s.pending_buffer.reserve(capacity);
+    s.log_spans.swap(s.pending_spans);
+    s.pending_spans.clear();
+    return *s.log_batch;
+}
+
+void WAL::AppendToCommitLog(Stream& s) {
+    // Called without commit_mutex; streams append concurrently and the
+    // log orders their records by sequence
+    const char* data = s.log_batch->data();
+    for (const auto& span : s.log_spans) {
+        CommitLog::Record record;
+        record.op = span.op;
+        record.sequence = span.sequence;
+        record.key.assign(data + span.key_offset, span.key_size);
+        record.ttl_seconds = span.ttl_seconds;
+        record.version = span.version;
+        record.replicated = span.replicated;
+        record.buffer = s.log_batch;
+        record.shared_value = std::string_view(data + span.value_offset, span.value_size);
+        commit_log_->Append(std::move(record));
+    }
+    s.log_spans.clear();
+}
+
+void WAL::GroupCommitWriter(Stream* stream) {
+    if (stream->ring) {
+        RingCommitWriter(*stream);
+        return;
+    }
+
+    const auto interval = std::chrono::microseconds(config_.group_commit_interval_us);
+    Stream& s = *stream;
+
+    std::unique_lock<std::mutex> lock(s.commit_mutex);
+    while (true) {
+        s.commit_cv.wait(lock, [&] { return s.stop_writer || s.pending_records > 0; });
+        if (s.pending_records == 0) {
+            break;  // Stopping with nothing left to commit
+        }
+
+        // Give concurrent appenders up to one commit interval to join
+        if (interval.count() > 0 && !s.stop_writer && !BatchFull(s)) {
+            s.commit_cv.wait_for(lock, interval, [&] { return s.stop_writer || BatchFull(s); });
+        }
+
+        // Take the whole batch
+        size_t records = 0;
+        int64_t batch_sequence = 0;
+        const std::string& batch = TakeBatch(s, records, batch_sequence);
+
+        lock.unlock();
+        if (commit_log_) {
+            AppendToCommitLog(s);
+        }
+        bool ok = CommitBatch(s, batch, records, batch_sequence);
+        lock.lock();
+
+        if (ok) {
+            s.committed_sequence = batch_sequence;
+        } else {
+            // A failed write or fdatasync leaves the file in an unknown
+            // state; refuse further records rather than retry
+            LOG_ERROR("WAL group commit failed at sequence {}", batch_sequence);
+            s.commit_failed = true;
+        }
+
+        // Publish to the commit log before waking the callers, so their
+        // writes are normally visible to consumers once acknowledged
+        if (ok && commit_log_) {
+            lock.unlock();
+            PublishDurable();
+            lock.lock();
+        }
+        NotifyDurable(s);
+    }
+
+    s.writer_running = false;
+    NotifyDurable(s);
+}
+
+void WAL::RingCommitWriter(Stream& s) {
+    const auto interval = std::chrono::microseconds(config_.group_commit_interval_us);
+    const size_t depth = std::max(1u, config_.io_uring_depth);
+
+    std::unique_lock<std::mutex> lock(s.commit_mutex);
+    while (true) {
+        // Read before the durable sequence: a rotation draining the ring
+        // meanwhile then still gets its commits published below
+        bool in_flight = s.ring_in_flight.load() > 0;
+
+        // Release callers whose commits' fdatasyncs have completed
+        int64_t durable = s.ring_durable_sequence.load();
+        if (durable > s.committed_sequence) {
+            s.committed_sequence = durable;
+            if (commit_log_) {
+                lock.unlock();
+                PublishDurable();
+                lock.lock();
+            }
+            NotifyDurable(s);
+        }
+        if (s.ring_failed.load() && !s.commit_failed) {
+            LOG_ERROR("WAL group commit failed after sequence {}", s.committed_sequence);
+            s.commit_failed = true;
+            NotifyDurable(s);
+        }
+        if (s.commit_failed) {
+            s.pending_buffer.clear();  // Never written; their callers see the failure
+            s.pending_spans.clear();
+            s.pending_records = 0;
+        }
+
+        if (s.pending_records == 0 && !in_flight) {
+            if (s.stop_writer) {
+                break;
+            }
+            s.commit_cv.wait(lock, [&] { return s.stop_writer || s.pending_records > 0; });
+            continue;
+        }
+
+        if (s.pending_records > 0 && s.ring_in_flight.load() < depth) {
+            // With commits still in flight the next one goes out at once;
+            // otherwise give concurrent appenders one interval to join
+            if (!in_flight && interval.count() > 0 && !s.stop_writer && !BatchFull(s)) {
+                s.commit_cv.wait_for(lock, interval, [&] { return s.stop_writer || BatchFull(s); });
+            }
+
+            size_t records = 0;
+            int64_t batch_sequence = 0;
+            const std::string& batch = TakeBatch(s, records, batch_sequence);
+
+            lock.unlock();
+            if (commit_log_) {
+                AppendToCommitLog(s);
+            }
+            bool ok = CommitBatch(s, batch, records, batch_sequence);
+            lock.lock();
+
+            if (!ok) {
+                s.ring_failed.store(true);
+            }
+            continue;
+        }
+
+        // Wait for a completion, checking for new records once per interval
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> file_lock(s.mutex);
+            ReapRing(s, std::max(interval, std::chrono::microseconds(50)));
+        }
+        lock.lock();
+    }
+
+    s.writer_running = false;
+    NotifyDurable(s);
+}
+
+bool WAL::CommitBatch(Stream& stream, const std::string& batch, size_t records,
+                      int64_t sequence) {
+    // Compress outside the file lock; only the writer thread gets here
+    const std::string* data = &batch;
+    if (codec_ != compression::Codec::kNone &&
+        batch.size() >= config_.compression_min_bytes &&
+        EncodeBlock(batch, stream.block_buffer)) {
+        data = &stream.block_buffer;
+    }
+
+    std::lock_guard<std::mutex> lock(stream.mutex);
+
+    if (stream.fd < 0) {
+        LOG_ERROR("Log file not open");
+        return false;
+    }
+
+    // Batches never span files, so rotate before writing
+    if (ShouldRotate(stream, data->size()) && !RotateLocked(stream)) {
+        LOG_ERROR("Failed to rotate WAL");
+        return false;
+    }
+
+    bool written = stream.ring ? SubmitRingWrite(stream, data->data(), data->size(), sequence)
+                               : WriteBlocks(stream, data->data(), data->size());
+    if (!written) {
+        return false;
+    }
+
+    if (data != &batch) {
+        total_compressed_blocks_++;
+    }
+    total_record_bytes_.fetch_add(batch.size());
+    total_written_bytes_.fetch_add(data->size());
+    total_entries_written_.fetch_add(records);
+    total_group_commits_++;
+
+    uint64_t largest = max_group_commit_records_.load();
+    while (records > largest &&
+           !max_group_commit_records_.compare_exchange_weak(largest, records)) {
+    }
+
+    // With io_uring the fdatasync was linked to the write
+    if (config_.sync_on_write && !stream.ring) {
+        return SyncLocked(stream);
+    }
+    return true;
+}
+
+bool WAL::EncodeBlock(const std::string& batch, std::string& out) const {
+    // Leave room for the frame and block headers, then compress after them
+    out.assign(kFrameHeaderSize + kBlockHeaderSize, '\0');
+    if (!compression::Compress(codec_, batch.data(), batch.size(), out)) {
+        LOG_WARN("WAL block compression failed; writing batch uncompressed");
+        return false;
+    }
+    if (out.size() >= batch.size()) {
+        return false;  // Incompressible: not worth the decode cost
+    }
+
+    char* frame = &out[0];
+    uint32_t length = static_cast<uint32_t>(out.size() - kFrameHeaderSize);
+    uint32_t raw_size = static_cast<uint32_t>(batch.size());
+    std::memcpy(frame + 4, &length, sizeof(length));
+    frame[8] = static_cast<char>(kBlockType);
+    frame[kFrameHeaderSize] = static_cast<char>(codec_);
+    std::memcpy(frame + kFrameHeaderSize + 1, &raw_size, sizeof(raw_size));
+
+    uint32_t crc = crc32c::Value(frame + 4, out.size() - 4);
+    std::memcpy(frame, &crc, sizeof(crc));
+    return true;
+}
+
+void WAL::EncodeRecord(const RecordView& record, std::string& out, LogSpan* span) {
+    using google::protobuf::io::CodedOutputStream;
+
+    // Encode the v1::WALEntry wire format directly from the caller's key
+    // and value instead of populating a message, which would copy both.
+    // Fields follow proto3 rules: zero scalars and empty bytes are omitted,
+    // optional fields are written whenever present.
+    constexpr uint32_t kVarint = 0;
+    constexpr uint32_t kLengthDelimited = 2;
+    auto tag = [](uint32_t field, uint32_t wire_type) { return (field << 3) | wire_type; };
+
+    v1::WALEntryType type = v1::WAL_ENTRY_UNKNOWN;
+    switch (record.type) {
+        case WALEntry::SET:
+            type = v1::WAL_ENTRY_SET;
+            break;
+        case WALEntry::DELETE:
+            type = v1::WAL_ENTRY_DELETE;
+            break;
+        case WALEntry::CAS:
+            type = v1::WAL_ENTRY_CAS;
+            break;
+    }
+
+    size_t value_size = record.value ? record.value->size() : 0;
+    const uint64_t seq = static_cast<uint64_t>(record.sequence_number);
+    const uint64_t ts = static_cast<uint64_t>(record.timestamp_ms);
+    const uint64_t version = static_cast<uint64_t>(record.version);
+
+    // Compute the encoded size so the record is built in one pass
+    size_t body_size = 1 + CodedOutputStream::VarintSize32SignExtended(type);
+    if (seq != 0) body_size += 1 + CodedOutputStream::VarintSize64(seq);
+    if (ts != 0) body_size += 1 + CodedOutputStream::VarintSize64(ts);
+    if (!record.key.empty()) {
+        body_size += 1 + CodedOutputStream::VarintSize32(record.key.size()) + record.key.size();
+    }
+    if (value_size > 0) {
+        body_size += 1 + CodedOutputStream::VarintSize32(value_size) + value_size;
+    }
+    if (version != 0) body_size += 1 + CodedOutputStream::VarintSize64(version);
+    if (record.ttl_seconds.has_value()) {
+        body_size += 1 + CodedOutputStream::VarintSize32SignExtended(*record.ttl_seconds);
+    }
+    if (record.expected_version.has_value()) {
+        body_size += 1 + CodedOutputStream::VarintSize64(
+            static_cast<uint64_t>(*record.expected_version));
+    }
+    if (record.replicated) body_size += 2;
+
+    // Frame header followed by the entry, appended to the batch
+    uint32_t length = static_cast<uint32_t>(body_size);
+    size_t offset = out.size();
+    out.resize(offset + kFrameHeaderSize + body_size);
+    char* frame = &out[offset];
+    std::memcpy(frame + 4, &length, sizeof(length));
+    frame[8] = static_cast<char>(kEntryType);
+    auto* p = reinterpret_cast<uint8_t*>(frame + kFrameHeaderSize);
+
+    p = CodedOutputStream::WriteTagToArray(tag(1, kVarint), p);
+    p = CodedOutputStream::WriteVarint32SignExtendedToArray(type, p);
+    if (seq != 0) {
+        p = CodedOutputStream::WriteTagToArray(tag(2, kVarint), p);
+        p = CodedOutputStream::WriteVarint64ToArray(seq, p);
+    }
+    if (ts != 0) {
+        p = CodedOutputStream::WriteTagToArray(tag(3, kVarint), p);
+        p = CodedOutputStream::WriteVarint64ToArray(ts, p);
+    }
+    if (!record.key.empty()) {
+        p = CodedOutputStream::WriteTagToArray(tag(4, kLengthDelimited), p);
+        p = CodedOutputStream::WriteVarint32ToArray(record.key.size(), p);
+        if (span) {
+            span->key_offset = static_cast<size_t>(reinterpret_cast<char*>(p) - out.data());
+            span->key_size = record.key.size();
+        }
+        p = CodedOutputStream::WriteRawToArray(record.key.data(), record.key.size(), p);
+    }
+    if (value_size > 0) {
+        p = CodedOutputStream::WriteTagToArray(tag(5, kLengthDelimited), p);
+        p = CodedOutputStream::WriteVarint32ToArray(value_size, p);
+        if (span) {
+            span->value_offset = static_cast<size_t>(reinterpret_cast<char*>(p) - out.data());
+            span->value_size = value_size;
+        }
+        p = CodedOutputStream::WriteRawToArray(record.value->data(), value_size, p);
+    }
+    if (version != 0) {
+        p = CodedOutputStream::WriteTagToArray(tag(6, kVarint), p);
+        p = CodedOutputStream::WriteVarint64ToArray(version, p);
+    }
+    if (record.ttl_seconds.has_value()) {
+        p = CodedOutputStream::WriteTagToArray(tag(7, kVarint), p);
+        p = CodedOutputStream::WriteVarint32SignExtendedToArray(*record.ttl_seconds, p);
+    }
+    if (record.expected_version.has_value()) {
+        p = CodedOutputStream::WriteTagToArray(tag(8, kVarint), p);
+        p = CodedOutputStream::WriteVarint64ToArray(
+            static_cast<uint64_t>(*record.expected_version), p);
+    }
+    if (record.replicated) {
+        p = CodedOutputStream::WriteTagToArray(tag(9, kVarint), p);
+        CodedOutputStream::WriteVarint32ToArray(1, p);
+    }
+
+    // Checksum everything after the checksum field itself
+    uint32_t crc = crc32c::Value(frame + 4, kFrameHeaderSize - 4 + body_size);
+    std::memcpy(frame, &crc, sizeof(crc));
+}
+
+bool WAL::Sync() {
+    // Anything already queued goes out with the next group commit
+    if (streams_.empty() || !WaitForCommit(last_sequence_.load())) {
+        return false;
+    }
+
+    bool ok = true;
+    for (auto& stream : streams_) {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (stream->fd < 0) {
+            return false;
+        }
+        ok = SyncLocked(*stream) && ok;
+    }
+    return ok;
+}
+
+bool WAL::SyncLocked(Stream& stream) {
+    auto started = std::chrono::steady_clock::now();
+#ifdef __linux__
+    int rc = ::fdatasync(stream.fd);
+#else
+    int rc = ::fsync(stream.fd);
+#endif
+    fsync_latency_.record(std::chrono::steady_clock::now() - started);
+    if (rc != 0) {
+        LOG_ERROR("WAL fdatasync failed: {}", std::strerror(errno));
+        return false;
+    }
+
+    total_syncs_++;
+    return true;
+}
+
+char* WAL::StageBlocks(Stream& stream, const char* data, size_t size,
+                       size_t& start, size_t& length) {
+    const size_t block = config_.io_block_size;
+
+    // Rewrite the partially filled last block together with the new data,
+    // so every write starts and ends on a block boundary
+    size_t end = stream.current_file_size.load();
+    start = end - stream.tail.size();
+    size_t new_end = end + size;
+
+    // Pad with at least one zeroed frame header: readers stop there
+    // instead of running into stale records of a recycled segment
+    size_t padded_end = AlignUp(new_end + kFrameHeaderSize, block);
+    length = padded_end - start;
+
+    char* buffer = ReserveIOBuffer(stream, length);
+    if (!buffer) {
+        LOG_ERROR("Failed to allocate WAL I/O buffer of {} bytes", length);
+        return nullptr;
+    }
+    std::memcpy(buffer, stream.tail.data(), stream.tail.size());
+    std::memcpy(buffer + stream.tail.size(), data, size);
+    std::memset(buffer + stream.tail.size() + size, 0, padded_end - new_end);
+    return buffer;
+}
+
+bool WAL::WriteBlocks(Stream& stream, const char* data, size_t size) {
+    size_t start = 0;
+    size_t length = 0;
+    char* buffer = StageBlocks(stream, data, size, start, length);
+    if (!buffer) {
+        return false;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    size_t done = 0;
+    while (done < length) {
+        ssize_t written = ::pwrite(stream.fd, buffer + done, length - done,
+                                   static_cast<off_t>(start + done));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("Failed to write WAL blocks: {}", std::strerror(errno));
+            return false;
+        }
+        done += static_cast<size_t>(written);
+    }
+    write_latency_.record(std::chrono::steady_clock::now() - started);
+
+    size_t new_end = stream.current_file_size.load() + size;
+    size_t tail_start = new_end / config_.io_block_size * config_.io_block_size;
+    stream.tail.assign(buffer + (tail_start - start), new_end - tail_start);
+    stream.current_file_size.store(new_end);
+    return true;
+}
+
+bool WAL::SubmitRingWrite(Stream& stream, const char* data, size_t size, int64_t sequence) {
+    size_t start = 0;
+    size_t length = 0;
+    char* buffer = StageBlocks(stream, data, size, start, length);
+    if (!buffer) {
+        return false;
+    }
+
+    Stream::RingCommit commit;
+    commit.id = ++stream.ring_next_id;
+    commit.sequence = sequence;
+    commit.length = length;
+    commit.synced = !config_.sync_on_write;
+
+    bool queued = stream.ring->PrepareWrite(stream.fd, buffer, length, start, commit.id << 1,
+                                            stream.ring_buffer_registered ? 0 : -1,
+                                            config_.sync_on_write);
+    if (queued && config_.sync_on_write) {
+        queued = stream.ring->PrepareFsync(stream.fd, (commit.id << 1) | 1);
+    }
+    int submitted = queued ? stream.ring->Submit() : -EAGAIN;
+    if (submitted < 0) {
+        LOG_ERROR("Failed to submit WAL commit to io_uring: {}", std::strerror(-submitted));
+        return false;
+    }
+    stream.ring_commits.push_back(commit);
+    stream.ring_in_flight.fetch_add(config_.sync_on_write ? 2 : 1);
+
+    // The next commit rewrites this one's last block, so it must land first
+    auto started = std::chrono::steady_clock::now();
+    auto written = [&stream, id = commit.id] {
+        return std::none_of(stream.ring_commits.begin(), stream.ring_commits.end(),
+                            [id](const Stream::RingCommit& c) { return c.id == id && !c.written; });
+    };
+    while (!written()) {
+        if (!ReapRing(stream, std::chrono::microseconds(-1))) {
+            return false;
+        }
+    }
+    write_latency_.record(std::chrono::steady_clock::now() - started);
+    if (stream.ring_failed.load()) {
+        return false;
+    }
+
+    size_t new_end = stream.current_file_size.load() + size;
+    size_t tail_start = new_end / config_.io_block_size * config_.io_block_size;
+    stream.tail.assign(buffer + (tail_start - start), new_end - tail_start);
+    stream.current_file_size.store(new_end);
+    return true;
+}
+
+bool WAL::ReapRing(Stream& stream, std::chrono::microseconds timeout) {
+    if (stream.ring_in_flight.load() == 0) {
+        return false;
+    }
+    IORing::Completion completion;
+    if (!stream.ring->WaitCompletion(completion, timeout)) {
+        return false;
+    }
+
+    uint64_t id = completion.user_data >> 1;
+    bool is_sync = (completion.user_data & 1) != 0;
+    auto it = std::find_if(stream.ring_commits.begin(), stream.ring_commits.end(),
+                           [id](const Stream::RingCommit& c) { return c.id == id; });
+    if (it == stream.ring_commits.end()) {
+        stream.ring_in_flight.fetch_sub(1);
+        return true;
+    }
+
+    if (is_sync) {
+        fsync_latency_.record(std::chrono::steady_clock::now() - it->written_at);
+        if (completion.result != 0) {
+            LOG_ERROR("WAL fdatasync failed: {}", std::strerror(-completion.result));
+            stream.ring_failed.store(true);
+        } else {
+            total_syncs_++;
+        }
+        it->synced = true;
+    } else {
+        // A failed or short write also cancels its linked fdatasync
+        if (completion.result < 0 || static_cast<size_t>(completion.result) != it->length) {
+            LOG_ERROR("Failed to write WAL blocks: {}",
+                      completion.result < 0 ? std::strerror(-completion.result) : "short write");
+            stream.ring_failed.store(true);
+        }
+        it->written = true;
+        it->written_at = std::chrono::steady_clock::now();
+    }
+
+    // Commits become durable strictly in order
+    while (!stream.ring_commits.empty() && !stream.ring_failed.load() &&
+           stream.ring_commits.front().written && stream.ring_commits.front().synced) {
+        stream.ring_durable_sequence.store(stream.ring_commits.front().sequence);
+        stream.ring_commits.pop_front();
+    }
+
+    // Counted down last, so the writer never sees nothing in flight
+    // without also seeing the durable sequence it led to
+    stream.ring_in_flight.fetch_sub(1);
+    return true;
+}
+
+bool WAL::DrainRing(Stream& stream) {
+    while (stream.ring_in_flight.load() > 0) {
+        if (!ReapRing(stream, std::chrono::microseconds(-1))) {
+            return false;
+        }
+    }
+    if (stream.ring_failed.load()) {
+        return false;
+    }
+    stream.ring_commits.clear();
+    return true;
+}
+
+char* WAL::ReserveIOBuffer(Stream& stream, size_t size) {
+    if (size > stream.io_buffer_capacity) {
+        size_t capacity = AlignUp(std::max(size, stream.io_buffer_capacity * 2),
+                                  config_.io_block_size);
+        void* memory = nullptr;
+        if (::posix_memalign(&memory, config_.io_block_size, capacity) != 0) {
+            return nullptr;
+        }
+        stream.io_buffer.reset(static_cast<char*>(memory));
+        stream.io_buffer_capacity = capacity;
+
+        // Registered once per allocation; nothing is writing from the old
+        // buffer, since each ring write completes before the next is staged
+        if (stream.ring) {
+            iovec buffer{stream.io_buffer.get(), capacity};
+            stream.ring_buffer_registered = stream.ring->RegisterBuffers({buffer});
+        }
+    }
+    return stream.io_buffer.get();
+}
+
+bool WAL::OpenLogFile(Stream& stream) {
+    stream.current_log_id = GenerateLogId(stream);
+    auto log_path = GetLogFilePath(stream.current_log_id);
+
+    // Reuse a retired segment when one is available; its blocks are
+    // already allocated, so the first pass over it needs no allocation
+    auto recycled = TakeRecycledSegment(stream);
+    if (!recycled.empty()) {
+        std::error_code ec;
+        std::filesystem::rename(recycled, log_path, ec);
+        if (!ec) {
+            total_segments_recycled_++;
+            LOG_DEBUG("Recycled WAL segment {} as {}", recycled.string(), stream.current_log_id);
+        }
+    }
+
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+    bool direct = false;
+#ifdef __linux__
+    if (config_.use_direct_io) {
+        stream.fd = ::open(log_path.c_str(), flags | O_DIRECT, 0644);
+        direct = stream.fd >= 0;
+        if (!direct) {
+            LOG_WARN("O_DIRECT unavailable for {} ({}), using buffered I/O",
+                     log_path.string(), std::strerror(errno));
+        }
+    }
+#endif
+    if (!direct) {
+        stream.fd = ::open(log_path.c_str(), flags, 0644);
+    }
+    if (stream.fd < 0) {
+        LOG_ERROR("Failed to open WAL file: {} ({})", log_path.string(), std::strerror(errno));
+        return false;
+    }
+    direct_io_.store(direct);
+
+    // Preallocate the whole segment so commits overwrite allocated blocks
+    // and fdatasync never has to persist a size change
+#ifdef __linux__
+    if (::fallocate(stream.fd, 0, 0, static_cast<off_t>(config_.max_file_size_bytes)) != 0) {
+        LOG_DEBUG("fallocate unsupported for {}: {}", log_path.string(), std::strerror(errno));
+    }
+#else
+    struct stat st;
+    if (::fstat(stream.fd, &st) == 0 &&
+        static_cast<size_t>(st.st_size) < config_.max_file_size_bytes) {
+        ::ftruncate(stream.fd, static_cast<off_t>(config_.max_file_size_bytes));
+    }
+#endif
+
+    // Header size and header, written as the segment's first block
+    std::string buffer;
+    if (!EncodeHeader(log_path.stem().string(), buffer)) {
+        ::close(stream.fd);
+        stream.fd = -1;
+        return false;
+    }
+
+    stream.tail.clear();
+    stream.current_file_size.store(0);
+    if (!WriteBlocks(stream, buffer.data(), buffer.size())) {
+        ::close(stream.fd);
+        stream.fd = -1;
+        return false;
+    }
+    stream.segment_data_start = stream.current_file_size.load();
+
+    if (config_.sync_on_write) {
+        SyncLocked(stream);
+        SyncDirectory(stream.dir);
+    }
+
+    return true;
+}
+
+bool WAL::EncodeHeader(const std::string& wal_id, std::string& out) const {
+    v1::WALHeader header;
+    header.set_wal_id(wal_id);
+    header.set_created_at_ms(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count()
+    );
+    header.set_node_id(config_.node_id);
+    header.set_wal_version(kWALFormatVersion);
+
+    std::string header_str;
+    if (!header.SerializeToString(&header_str)) {
+        LOG_ERROR("Failed to serialize WAL header");
+        return false;
+    }
+
+    uint32_t header_size = header_str.size();
+    out.append(reinterpret_cast<const char*>(&header_size), sizeof(header_size));
+    out += header_str;
+    return true;
+}
+
+std::filesystem::path WAL::TakeRecycledSegment(const Stream& stream) {
+    std::vector<std::filesystem::path> segments;
+    for (const auto& entry : std::filesystem::directory_iterator(stream.dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == kRecycledExtension) {
+            segments.push_back(entry.path());
+        }
+    }
+    if (segments.empty()) {
+        return {};
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments.front();
+}
+
+void WAL::RetireSegment(const std::filesystem::path& path) {
+    {
+        std::lock_guard<std::mutex> lock(segment_starts_mutex_);
+        segment_starts_.erase(path);
+        segment_starts_epoch_++;
+    }
+
+    // Segments are recycled within their own stream's directory
+    size_t recycled = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(path.parent_path())) {
+        if (entry.is_regular_file() && entry.path().extension() == kRecycledExtension) {
+            recycled++;
+        }
+    }
+
+    std::error_code ec;
+    if (recycled < config_.max_recycled_segments) {
+        auto target = path;
+        target.replace_extension(kRecycledExtension);
+        std::filesystem::rename(path, target, ec);
+        if (!ec) {
+            return;
+        }
+    }
+    std::filesystem::remove(path, ec);
 }
 
-WAL::~WAL() {
-    Close();
+bool WAL::RotateLog() {
+    bool ok = !streams_.empty();
+    for (auto& stream : streams_) {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        ok = RotateLocked(*stream) && ok;
+    }
+    return ok;
 }
 
-void WAL::Open() {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool WAL::RotateLocked(Stream& stream) {
+    LOG_INFO("Rotating WAL log");
 
-    if (is_open_.load()) {
-        LOG_WARN("WAL already open");
-        return;
+    // Close current log, once fdatasyncs still running on it are done
+    if (stream.ring && !DrainRing(stream)) {
+        LOG_ERROR("WAL commit failed before rotation");
+        return false;
+    }
+    if (stream.fd >= 0) {
+        if (config_.sync_on_write) {
+            SyncLocked(stream);
+        }
+        ::close(stream.fd);
+        stream.fd = -1;
     }
 
-    // Generate new log ID
-    current_log_id_ = GenerateLogId();
-    auto log_path = GetLogFilePath(current_log_id_);
+    if (!OpenLogFile(stream)) {
+        LOG_ERROR("Failed to open new WAL file");
+        return false;
+    }
 
-    // Open log file for append
-    log_file_ = std::make_unique<std::ofstream>(
-        log_path,
-        std::ios::binary | std::ios::app
-    );
+    total_rotations_++;
 
-    if (!log_file_->is_open()) {
-        LOG_ERROR("Failed to open WAL file: {}", log_path.string());
-        return;
-    }
+    LOG_INFO("WAL rotated to: {}", stream.current_log_id);
 
-    // Write header if new file
-    if (std::filesystem::file_size(log_path) == 0) {
-        v1::WALHeader header;
-        header.set_wal_id(current_log_id_);
-        header.set_created_at_ms(
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::system_clock::now().time_since_epoch()
-            ).count()
-        );
-        header.set_node_id(config_.node_id);
-        header.set_wal_version(1);
-
-        std::string header_str;
-        if (!header.SerializeToString(&header_str)) {
-            LOG_ERROR("Failed to serialize WAL header");
-            return;
+    // Clean up old logs of this stream if exceeding max
+    std::vector<std::filesystem::path> wal_files;
+    for (const auto& entry : std::filesystem::directory_iterator(stream.dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".wal") {
+            wal_files.push_back(entry.path());
+        }
+    }
+    if (wal_files.size() > config_.max_log_files) {
+        std::sort(wal_files.begin(), wal_files.end());
+        size_t to_delete = wal_files.size() - config_.max_log_files;
+        for (size_t i = 0; i < to_delete; ++i) {
+            // Its records all sort below the next segment's first one
+            int64_t next = SegmentFirstSequence(wal_files[i + 1]);
+            if (next > 0) {
+                MarkLost(next - 1);
+            } else {
+                Reader reader(wal_files[i]);
+                WALEntry entry;
+                while (reader.Open() && reader.Next(entry)) {
+                    MarkLost(entry.sequence_number);
+                }
+            }
+            RetireSegment(wal_files[i]);
+            LOG_INFO("Retired old WAL file: {}", wal_files[i].string());
         }
+    }
 
-        // Write header size and header
-        uint32_t header_size = header_str.size();
-        log_file_->write(reinterpret_cast<const char*>(&header_size), sizeof(header_size));
-        log_file_->write(header_str.data(), header_str.size());
+    return true;
+}
 
-        current_file_size_.store(sizeof(header_size) + header_str.size());
-    } else {
-        current_file_size_.store(std::filesystem::file_size(log_path));
+std::string WAL::GetCurrentLogId() const {
+    if (streams_.empty()) {
+        return {};
     }
+    std::lock_guard<std::mutex> lock(streams_[0]->mutex);
+    return streams_[0]->current_log_id;
+}
 
-    is_open_.store(true);
-    LOG_INFO("WAL opened: {}", current_log_id_);
+size_t WAL::GetCurrentLogSize() const {
+    return streams_.empty() ? 0 : streams_[0]->current_file_size.load();
 }
 
-void WAL::Close() {
-    std::lock_guard<std::mutex> lock(mutex_);
+std::vector<std::string> WAL::ListWALFiles() const {
+    std::vector<std::string> files;
 
-    if (!is_open_.load()) {
-        return;
+    if (!std::filesystem::exists(config_.wal_dir)) {
+        return files;
     }
 
-    if (log_file_ && log_file_->is_open()) {
-        // Flush any pending writes
-        if (!pending_entries_.empty()) {
-            for (const auto& entry : pending_entries_) {
-                WriteEntryToFile(entry);
+    // Streams keep their segments in stream-<i> subdirectories; the root
+    // holds the single-stream log. Both are listed so logs written with a
+    // different stream count are still found.
+    auto collect = [&files](const std::filesystem::path& dir, const std::string& prefix) {
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".wal") {
+                files.push_back(prefix + entry.path().stem().string());
             }
-            pending_entries_.clear();
-            pending_batch_size_ = 0;
         }
+    };
 
-        log_file_->flush();
-        log_file_->close();
+    collect(config_.wal_dir, "");
+    for (const auto& entry : std::filesystem::directory_iterator(config_.wal_dir)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_directory() && name.rfind("stream-", 0) == 0) {
+            collect(entry.path(), name + "/");
+        }
     }
 
-    is_open_.store(false);
-    LOG_INFO("WAL closed");
-}
-
-bool WAL::AppendSet(const std::string& key, const CacheEntry& entry) {
-    WALEntry wal_entry;
-    wal_entry.type = WALEntry::SET;
-    wal_entry.key = key;
-    wal_entry.value = entry.value;
-    wal_entry.version = entry.version;
-    wal_entry.ttl_seconds = entry.ttl_seconds;
-    wal_entry.timestamp_ms = entry.created_at_ms;
-
-    return AppendEntry(wal_entry);
-}
-
-bool WAL::AppendDelete(const std::string& key) {
-    WALEntry wal_entry;
-    wal_entry.type = WALEntry::DELETE;
-    wal_entry.key = key;
-    wal_entry.timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count();
-
-    return AppendEntry(wal_entry);
+    std::sort(files.begin(), files.end());
+    return files;
 }
 
-bool WAL::AppendCAS(const std::string& key, const CacheEntry& entry, int64_t expected_version) {
-    WALEntry wal_entry;
-    wal_entry.type = WALEntry::CAS;
-    wal_entry.key = key;
-    wal_entry.value = entry.value;
-    wal_entry.version = entry.version;
-    wal_entry.ttl_seconds = entry.ttl_seconds;
-    wal_entry.expected_version = expected_version;
-    wal_entry.timestamp_ms = entry.created_at_ms;
+WAL::Reader::Reader(const std::filesystem::path& file_path) : path_(file_path) {}
 
-    return AppendEntry(wal_entry);
+WAL::Reader::~Reader() {
+    if (data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
 }
 
-bool WAL::AppendEntry(const WALEntry& entry) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    if (!is_open_.load()) {
-        LOG_ERROR("WAL not open");
+bool WAL::Reader::Open() {
+    int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open WAL file for reading: {}", path_.string());
         return false;
     }
 
-    // Assign sequence number
-    WALEntry numbered_entry = entry;
-    numbered_entry.sequence_number = last_sequence_.fetch_add(1) + 1;
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        LOG_ERROR("Failed to stat WAL file {}: {}", path_.string(), std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
 
-    // Check if rotation is needed
-    if (ShouldRotate()) {
-        if (!RotateLog()) {
-            LOG_ERROR("Failed to rotate WAL");
+    if (st.st_size > 0) {
+        size_ = static_cast<size_t>(st.st_size);
+        void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            LOG_ERROR("Failed to map WAL file {}: {}", path_.string(), std::strerror(errno));
+            size_ = 0;
+            ::close(fd);
             return false;
         }
+        ::madvise(mapped, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(mapped);
     }
+    ::close(fd);
 
-    // Write entry
-    if (!WriteEntryToFile(numbered_entry)) {
+    // Read header
+    uint32_t header_size = 0;
+    if (size_ >= sizeof(header_size)) {
+        std::memcpy(&header_size, data_, sizeof(header_size));
+    }
+    if (size_ < sizeof(header_size) || header_size + sizeof(header_size) > size_) {
+        LOG_ERROR("Truncated WAL header: {}", path_.string());
         return false;
     }
 
-    total_entries_written_++;
-
-    // Sync if configured
-    if (config_.sync_on_write) {
-        return Sync();
+    v1::WALHeader header;
+    if (!header.ParseFromArray(data_ + sizeof(header_size), static_cast<int>(header_size))) {
+        LOG_ERROR("Failed to parse WAL header");
+        return false;
     }
 
+    LOG_DEBUG("Reading WAL file: {}, version: {}", header.wal_id(), header.wal_version());
+
+    framed_ = header.wal_version() >= 2;
+    offset_ = sizeof(header_size) + header_size;
+    report_.valid_bytes = offset_;
     return true;
 }
 
-bool WAL::WriteEntryToFile(const WALEntry& entry) {
-    if (!log_file_ || !log_file_->is_open()) {
-        LOG_ERROR("Log file not open");
-        return false;
+bool WAL::Reader::Next(WALEntry& entry) {
+    while (decoded_index_ >= decoded_.size()) {
+        if (done_ || !DecodeNextRecord()) {
+            done_ = true;
+            return false;
+        }
     }
+    entry = std::move(decoded_[decoded_index_++]);
+    return true;
+}
 
-    // Convert to protobuf
-    v1::WALEntry pb_entry;
-
-    switch (entry.type) {
-        case WALEntry::SET:
-            pb_entry.set_type(v1::WAL_ENTRY_SET);
-            break;
-        case WALEntry::DELETE:
-            pb_entry.set_type(v1::WAL_ENTRY_DELETE);
-            break;
-        case WALEntry::CAS:
-            pb_entry.set_type(v1::WAL_ENTRY_CAS);
-            break;
+bool WAL::Reader::DecodeNextRecord() {
+    decoded_.clear();
+    decoded_index_ = 0;
+
+    // Segments are preallocated and may be recycled, so the log ends at
+    // the first zeroed frame header rather than at end of file
+    const size_t frame_size = framed_ ? kFrameHeaderSize : sizeof(uint32_t);
+    const size_t remaining = size_ - offset_;
+    const char* frame = data_ + offset_;
+    if (remaining < frame_size) {
+        if (std::any_of(frame, frame + remaining, [](char c) { return c != 0; })) {
+            return Fail("torn record header");
+        }
+        return false;
     }
 
-    pb_entry.set_sequence_number(entry.sequence_number);
-    pb_entry.set_timestamp_ms(entry.timestamp_ms);
-    pb_entry.set_key(entry.key);
-
-    if (!entry.value.empty()) {
-        pb_entry.set_value(entry.value.data(), entry.value.size());
+    uint32_t crc = 0;
+    uint32_t length = 0;
+    uint8_t type = kEntryType;
+    if (framed_) {
+        std::memcpy(&crc, frame, sizeof(crc));
+        std::memcpy(&length, frame + 4, sizeof(length));
+        type = static_cast<uint8_t>(frame[8]);
+    } else {
+        std::memcpy(&length, frame, sizeof(length));
     }
 
-    pb_entry.set_version(entry.version);
+    if (length == 0 && crc == 0 && (!framed_ || type == kZeroType)) {
+        return false;  // Zero padding: end of log
+    }
+    if (type != kEntryType && (!framed_ || type != kBlockType)) {
+        return Fail("unknown record type");
+    }
+    if (length > remaining - frame_size) {
+        return Fail("record extends past end of file");
+    }
 
-    if (entry.ttl_seconds.has_value()) {
-        pb_entry.set_ttl_seconds(entry.ttl_seconds.value());
+    const char* payload = frame + frame_size;
+    if (framed_ && FrameChecksum(frame, payload, length) != crc) {
+        return Fail("checksum mismatch");
     }
 
-    if (entry.expected_version.has_value()) {
-        pb_entry.set_expected_version(entry.expected_version.value());
+    std::vector<v1::WALEntry> records;
+    if (type == kBlockType) {
+        if (!ParseBlock(payload, length, block_, records)) {
+            return Fail("undecodable block");
+        }
+    } else {
+        records.emplace_back();
+        if (!records.back().ParseFromArray(payload, static_cast<int>(length))) {
+            return Fail("unparsable entry");
+        }
     }
 
-    // Serialize to string
-    std::string entry_str;
-    if (!pb_entry.SerializeToString(&entry_str)) {
-        LOG_ERROR("Failed to serialize WAL entry");
+    // An intact record that does not advance the sequence is left over
+    // from the segment's previous use
+    if (records.front().sequence_number() <= previous_sequence_) {
         return false;
     }
+    previous_sequence_ = records.back().sequence_number();
+    offset_ += frame_size + length;
+    report_.valid_bytes = offset_;
 
-    // Write entry size and entry
-    uint32_t entry_size = entry_str.size();
-    log_file_->write(reinterpret_cast<const char*>(&entry_size), sizeof(entry_size));
-    log_file_->write(entry_str.data(), entry_str.size());
-
-    current_file_size_.fetch_add(sizeof(entry_size) + entry_str.size());
-
+    decoded_.reserve(records.size());
+    for (auto& pb_entry : records) {
+        WALEntry entry;
+        if (!ConvertEntry(pb_entry, entry)) {
+            LOG_ERROR("Unknown WAL entry type: {}", static_cast<int>(pb_entry.type()));
+            continue;
+        }
+        decoded_.push_back(std::move(entry));
+    }
     return true;
 }
 
-bool WAL::Sync() {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool WAL::Reader::Fail(const char* reason) {
+    // Everything up to the last non-zero byte is damaged log data; the
+    // zeros after it are preallocated space
+    size_t end = size_;
+    while (end > offset_ && data_[end - 1] == 0) {
+        --end;
+    }
+
+    report_.corrupted = true;
+    report_.discarded_bytes = end - offset_;
+    LOG_WARN("WAL file {} damaged at offset {} ({}); discarding {} bytes",
+             path_.string(), offset_, reason, report_.discarded_bytes);
+    return false;
+}
 
-    if (!log_file_ || !log_file_->is_open()) {
+bool WAL::ReadWALFile(const std::filesystem::path& file_path,
+                      std::vector<WALEntry>& entries,
+                      ReadReport* report) {
+    Reader reader(file_path);
+    if (!reader.Open()) {
         return false;
     }
 
-    log_file_->flush();
+    size_t read_count = 0;
+    WALEntry entry;
+    while (reader.Next(entry)) {
+        entries.push_back(std::move(entry));
+        read_count++;
+    }
 
-    // Note: std::ofstream doesn't provide direct access to file descriptor
-    // For true fsync, would need platform-specific file handling
-    // For now, flush() provides buffer sync to OS
-    // TODO: Implement platform-specific fsync if strict durability needed
+    if (report) {
+        *report = reader.report();
+    }
 
-    total_syncs_++;
+    LOG_INFO("Read {} entries from WAL file", read_count);
     return true;
 }
 
-bool WAL::RotateLog() {
-    LOG_INFO("Rotating WAL log");
-
-    // Close current log
-    if (log_file_ && log_file_->is_open()) {
-        log_file_->flush();
-        log_file_->close();
+bool WAL::ReadEntriesAfter(int64_t after, int64_t up_to, size_t max_entries,
+                           std::vector<WALEntry>& entries) const {
+    std::error_code ec;
+    if (!std::filesystem::exists(config_.wal_dir, ec)) {
+        return false;
     }
 
-    // Generate new log ID
-    current_log_id_ = GenerateLogId();
-    auto log_path = GetLogFilePath(current_log_id_);
-
-    // Open new log file
-    log_file_ = std::make_unique<std::ofstream>(
-        log_path,
-        std::ios::binary | std::ios::app
-    );
-
-    if (!log_file_->is_open()) {
-        LOG_ERROR("Failed to open new WAL file: {}", log_path.string());
-        is_open_.store(false);
+    // Records just after `after` that are gone cannot be skipped silently;
+    // the caller has to fall back to a snapshot
+    if (after < lost_sequence_.load()) {
         return false;
     }
 
-    // Write header
-    v1::WALHeader header;
-    header.set_wal_id(current_log_id_);
-    header.set_created_at_ms(
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()
-        ).count()
-    );
-    header.set_node_id(config_.node_id);
-    header.set_wal_version(1);
+    auto by_sequence = [](const WALEntry& a, const WALEntry& b) {
+        return a.sequence_number < b.sequence_number;
+    };
 
-    std::string header_str;
-    if (!header.SerializeToString(&header_str)) {
-        LOG_ERROR("Failed to serialize WAL header");
-        return false;
+    // Segments per directory, oldest first, with the sequence each starts at
+    std::map<std::filesystem::path, std::vector<std::pair<std::filesystem::path, int64_t>>> dirs;
+    for (const auto& log_id : ListWALFiles()) {
+        auto path = GetLogFilePath(log_id);
+        dirs[path.parent_path()].emplace_back(path, SegmentFirstSequence(path));
     }
 
-    uint32_t header_size = header_str.size();
-    log_file_->write(reinterpret_cast<const char*>(&header_size), sizeof(header_size));
-    log_file_->write(header_str.data(), header_str.size());
+    // Streams interleave sequences, so each directory is searched; the
+    // candidates are cut back to the lowest max_entries as they grow
+    std::vector<WALEntry> found;
+    for (const auto& [dir, segments] : dirs) {
+        for (size_t i = 0; i < segments.size(); ++i) {
+            int64_t first = segments[i].second;
+            if (first == 0) {
+                continue;  // No records yet, or retired meanwhile
+            }
+            if (first > up_to) {
+                break;  // Later segments start later still
+            }
+            if (i + 1 < segments.size() && segments[i + 1].second != 0 &&
+                segments[i + 1].second <= after + 1) {
+                continue;  // Ends before the range
+            }
 
-    current_file_size_.store(sizeof(header_size) + header_str.size());
-    total_rotations_++;
+            Reader reader(segments[i].first);
+            if (!reader.Open()) {
+                continue;  // Retired meanwhile
+            }
+            WALEntry entry;
+            while (reader.Next(entry)) {
+                if (entry.sequence_number > up_to) {
+                    break;
+                }
+                if (entry.sequence_number > after) {
+                    found.push_back(std::move(entry));
+                }
+            }
+            ThrottleIo(reader.bytes_consumed());
+            if (found.size() > 2 * max_entries) {
+                std::nth_element(found.begin(), found.begin() + max_entries, found.end(),
+                                 by_sequence);
+                found.resize(max_entries);
+            }
+        }
+    }
+
+    // Retired while being read; what was found may have holes
+    if (after < lost_sequence_.load()) {
+        return false;
+    }
 
-    LOG_INFO("WAL rotated to: {}", current_log_id_);
+    std::sort(found.begin(), found.end(), by_sequence);
+    if (found.size() > max_entries) {
+        found.resize(max_entries);
+    }
+    for (auto& entry : found) {
+        entries.push_back(std::move(entry));
+    }
+    return true;
+}
 
-    // Clean up old logs if exceeding max
-    auto wal_files = ListWALFiles();
-    if (wal_files.size() > config_.max_log_files) {
-        std::sort(wal_files.begin(), wal_files.end());
-        size_t to_delete = wal_files.size() - config_.max_log_files;
-        for (size_t i = 0; i < to_delete; ++i) {
-            auto file_path = GetLogFilePath(wal_files[i]);
-            std::filesystem::remove(file_path);
-            LOG_INFO("Deleted old WAL file: {}", wal_files[i]);
+int64_t WAL::SegmentFirstSequence(const std::filesystem::path& path) const {
+    uint64_t epoch = 0;
+    {
+        std::lock_guard<std::mutex> lock(segment_starts_mutex_);
+        auto it = segment_starts_.find(path);
+        if (it != segment_starts_.end()) {
+            return it->second;
         }
+        epoch = segment_starts_epoch_;
     }
 
-    return true;
+    Reader reader(path);
+    WALEntry entry;
+    if (!reader.Open() || !reader.Next(entry)) {
+        return 0;  // Checked again once it has records
+    }
+
+    // Not cached if the segment may have been replaced while being read
+    std::lock_guard<std::mutex> lock(segment_starts_mutex_);
+    if (segment_starts_epoch_ == epoch) {
+        segment_starts_[path] = entry.sequence_number;
+    }
+    return entry.sequence_number;
 }
 
-std::string WAL::GetCurrentLogId() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return current_log_id_;
+void WAL::MarkLost(int64_t sequence) {
+    int64_t lost = lost_sequence_.load();
+    while (sequence > lost && !lost_sequence_.compare_exchange_weak(lost, sequence)) {
+    }
 }
 
-size_t WAL::GetCurrentLogSize() const {
-    return current_file_size_.load();
+int64_t WAL::GetFirstSequenceNumber() const {
+    // Each segment starts with its lowest record; streams interleave, so
+    // every segment's first record is checked
+    int64_t first = 0;
+    for (const auto& log_id : ListWALFiles()) {
+        Reader reader(GetLogFilePath(log_id));
+        WALEntry entry;
+        if (reader.Open() && reader.Next(entry) &&
+            (first == 0 || entry.sequence_number < first)) {
+            first = entry.sequence_number;
+        }
+    }
+    return first;
 }
 
-std::vector<std::string> WAL::ListWALFiles() const {
-    std::vector<std::string> files;
+void WAL::TruncateBeforeSequence(int64_t sequence) {
+    std::lock_guard<std::mutex> maintenance(maintenance_mutex_);
 
-    if (!std::filesystem::exists(config_.wal_dir)) {
-        return files;
+    // Compaction may drop anything the snapshot holds from now on
+    int64_t covered = covered_sequence_.load();
+    while (sequence - 1 > covered &&
+           !covered_sequence_.compare_exchange_weak(covered, sequence - 1)) {
     }
 
-    for (const auto& entry : std::filesystem::directory_iterator(config_.wal_dir)) {
-        if (entry.is_regular_file() && entry.path().extension() == ".wal") {
-            files.push_back(entry.path().stem().string());
+    std::vector<std::string> current_log_ids;
+    for (auto& stream : streams_) {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (stream->fd >= 0) {
+            current_log_ids.push_back(stream->current_log_id);
         }
     }
 
-    return files;
-}
+    // Within a directory files are named in creation order and sequences
+    // only grow, so stop at the first file still holding a needed record.
+    // Reading happens without the file lock so commits are not held up.
+    auto wal_files = ListWALFiles();
 
-bool WAL::ReadWALFile(const std::filesystem::path& file_path,
-                      std::vector<WALEntry>& entries) {
-    std::ifstream in(file_path, std::ios::binary);
-    if (!in.is_open()) {
-        LOG_ERROR("Failed to open WAL file for reading: {}", file_path.string());
-        return false;
-    }
+    size_t retired = 0;
+    std::set<std::filesystem::path> done_dirs;
+    for (const auto& file_id : wal_files) {
+        auto file_path = GetLogFilePath(file_id);
+        auto dir = file_path.parent_path();
+        if (done_dirs.count(dir)) {
+            continue;
+        }
+        if (std::find(current_log_ids.begin(), current_log_ids.end(), file_id) !=
+            current_log_ids.end()) {
+            done_dirs.insert(dir);  // Never retire a segment being written
+            continue;
+        }
 
-    // Read header
-    uint32_t header_size;
-    in.read(reinterpret_cast<char*>(&header_size), sizeof(header_size));
+        int64_t max_seq = 0;
+        {
+            Reader reader(file_path);
+            if (!reader.Open()) {
+                done_dirs.insert(dir);
+                continue;
+            }
+            WALEntry entry;
+            while (reader.Next(entry)) {
+                max_seq = entry.sequence_number;
+            }
+        }
 
-    std::string header_str(header_size, '\0');
-    in.read(&header_str[0], header_size);
+        if (max_seq >= sequence) {
+            done_dirs.insert(dir);
+            continue;
+        }
 
-    v1::WALHeader header;
-    if (!header.ParseFromString(header_str)) {
-        LOG_ERROR("Failed to parse WAL header");
-        return false;
+        MarkLost(max_seq);
+        RetireSegment(file_path);
+        retired++;
+        LOG_INFO("Truncated WAL file: {} (max_seq: {})", file_id, max_seq);
     }
 
-    LOG_DEBUG("Reading WAL file: {}, version: {}", header.wal_id(), header.wal_version());
+    if (retired > 0) {
+        LOG_INFO("Retired {} WAL files before sequence {}", retired, sequence);
+    }
+}
 
-    // Read entries
-    while (in.peek() != EOF) {
-        uint32_t entry_size;
-        in.read(reinterpret_cast<char*>(&entry_size), sizeof(entry_size));
+WAL::CompactionResult WAL::CompactSegments(size_t min_segments) {
+    std::lock_guard<std::mutex> maintenance(maintenance_mutex_);
+    if (min_segments == 0) {
+        min_segments = std::max<size_t>(1, config_.compaction_min_segments);
+    }
 
-        if (in.eof()) break;
+    std::vector<std::string> current_log_ids;
+    for (auto& stream : streams_) {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (stream->fd >= 0) {
+            current_log_ids.push_back(stream->current_log_id);
+        }
+    }
 
-        std::string entry_str(entry_size, '\0');
-        in.read(&entry_str[0], entry_size);
+    // Closed segments per directory, oldest first. The segment a stream
+    // is writing is always the newest in its directory.
+    std::map<std::filesystem::path, std::vector<std::filesystem::path>> closed;
+    for (const auto& file_id : ListWALFiles()) {
+        if (std::find(current_log_ids.begin(), current_log_ids.end(), file_id) ==
+            current_log_ids.end()) {
+            auto path = GetLogFilePath(file_id);
+            closed[path.parent_path()].push_back(path);
+        }
+    }
 
-        v1::WALEntry pb_entry;
-        if (!pb_entry.ParseFromString(entry_str)) {
-            LOG_ERROR("Failed to parse WAL entry");
+    CompactionResult result;
+    for (const auto& [dir, segments] : closed) {
+        if (segments.size() < min_segments) {
             continue;
         }
+        if (CompactDirectory(segments, result)) {
+            total_compactions_++;
+        }
+    }
+
+    if (result.segments_compacted > 0) {
+        total_segments_compacted_.fetch_add(result.segments_compacted);
+        total_records_compacted_away_.fetch_add(result.records_read - result.records_kept);
+        LOG_INFO("Compacted {} WAL segments: {} of {} records kept, {} -> {} bytes",
+                 result.segments_compacted, result.records_kept, result.records_read,
+                 result.bytes_read, result.bytes_written);
+    }
+    return result;
+}
 
-        // Convert to WALEntry
+bool WAL::CompactDirectory(const std::vector<std::filesystem::path>& segments,
+                           CompactionResult& result) {
+    const int64_t covered = covered_sequence_.load();
+
+    // Later segments hold later sequences, so the last record read for a
+    // key is its latest. Stop taking segments once the input budget is used.
+    std::unordered_map<std::string, WALEntry> latest;
+    std::vector<std::filesystem::path> inputs;
+    int64_t dropped = 0;  // Highest record left to the snapshot
+    size_t records_read = 0;
+    size_t bytes_read = 0;
+    for (const auto& path : segments) {
+        if (!inputs.empty() && bytes_read >= config_.compaction_max_input_bytes) {
+            break;
+        }
+        Reader reader(path);
+        if (!reader.Open()) {
+            break;
+        }
         WALEntry entry;
+        while (reader.Next(entry)) {
+            records_read++;
+            if (entry.sequence_number <= covered) {
+                dropped = std::max(dropped, entry.sequence_number);
+                continue;  // A snapshot already holds this (or a later) state
+            }
+            latest[entry.key] = std::move(entry);
+        }
+        bytes_read += reader.bytes_consumed();
+        ThrottleIo(reader.bytes_consumed());
+        inputs.push_back(path);
+    }
+    if (inputs.empty() || (inputs.size() == 1 && latest.size() == records_read)) {
+        return false;  // Nothing to gain
+    }
 
-        switch (pb_entry.type()) {
-            case v1::WAL_ENTRY_SET:
-                entry.type = WALEntry::SET;
-                break;
-            case v1::WAL_ENTRY_DELETE:
-                entry.type = WALEntry::DELETE;
-                break;
-            case v1::WAL_ENTRY_CAS:
-                entry.type = WALEntry::CAS;
-                break;
-            default:
-                LOG_ERROR("Unknown WAL entry type: {}", static_cast<int>(pb_entry.type()));
-                continue;
+    std::vector<const WALEntry*> kept;
+    kept.reserve(latest.size());
+    for (const auto& [key, entry] : latest) {
+        kept.push_back(&entry);
+    }
+    std::sort(kept.begin(), kept.end(), [](const WALEntry* a, const WALEntry* b) {
+        return a->sequence_number < b->sequence_number;
+    });
+
+    // The compacted segment takes the newest input's name, so it sorts
+    // exactly where its records came from
+    const auto& newest = inputs.back();
+    auto temp_path = newest;
+    temp_path.replace_extension(kCompactingExtension);
+
+    std::string data;
+    if (!kept.empty()) {
+        if (!EncodeHeader(newest.stem().string(), data)) {
+            return false;
         }
 
-        entry.sequence_number = pb_entry.sequence_number();
-        entry.timestamp_ms = pb_entry.timestamp_ms();
-        entry.key = pb_entry.key();
+        // Records go out in group-commit-sized runs, compressed as blocks
+        // when compression is enabled
+        std::string batch;
+        std::string block;
+        auto flush = [&] {
+            if (codec_ != compression::Codec::kNone &&
+                batch.size() >= config_.compression_min_bytes &&
+                EncodeBlock(batch, block)) {
+                data += block;
+            } else {
+                data += batch;
+            }
+            batch.clear();
+        };
+        for (const WALEntry* entry : kept) {
+            RecordView record(entry->type, entry->key);
+            record.sequence_number = entry->sequence_number;
+            record.timestamp_ms = entry->timestamp_ms;
+            record.value = &entry->value;
+            record.version = entry->version;
+            record.ttl_seconds = entry->ttl_seconds;
+            record.expected_version = entry->expected_version;
+            record.replicated = entry->replicated;
+            EncodeRecord(record, batch);
+            if (batch.size() >= config_.group_commit_max_bytes) {
+                flush();
+            }
+        }
+        if (!batch.empty()) {
+            flush();
+        }
+        data.append(kFrameHeaderSize, '\0');  // End of log
 
-        // In proto3, optional fields check by looking at the value
-        if (!pb_entry.value().empty()) {
-            const std::string& value_str = pb_entry.value();
-            entry.value.assign(value_str.begin(), value_str.end());
+        if (!WriteFileDurably(temp_path, data, [this](size_t bytes) { ThrottleIo(bytes); })) {
+            LOG_ERROR("Failed to write compacted WAL segment {}", temp_path.string());
+            std::error_code ec;
+            std::filesystem::remove(temp_path, ec);
+            return false;
         }
+    }
 
-        entry.version = pb_entry.version();
+    // Readers racing the swap must already see the dropped records as lost
+    MarkLost(dropped);
 
-        if (pb_entry.has_ttl_seconds()) {
-            entry.ttl_seconds = pb_entry.ttl_seconds();
+    // Publish under the owning stream's file lock, so rotation cleanup
+    // cannot retire an input in the meantime
+    std::unique_lock<std::mutex> lock;
+    for (auto& stream : streams_) {
+        if (stream->dir == newest.parent_path()) {
+            lock = std::unique_lock<std::mutex>(stream->mutex);
         }
+    }
+    for (const auto& path : inputs) {
+        if (!std::filesystem::exists(path)) {
+            std::error_code ec;
+            std::filesystem::remove(temp_path, ec);
+            return false;
+        }
+    }
 
-        if (pb_entry.has_expected_version()) {
-            entry.expected_version = pb_entry.expected_version();
+    if (!kept.empty()) {
+        std::error_code ec;
+        std::filesystem::rename(temp_path, newest, ec);
+        if (ec) {
+            LOG_ERROR("Failed to publish compacted WAL segment {}: {}",
+                      newest.string(), ec.message());
+            std::filesystem::remove(temp_path, ec);
+            return false;
         }
+        SyncDirectory(newest.parent_path());
 
-        entries.push_back(entry);
+        // It now starts with the oldest kept record
+        std::lock_guard<std::mutex> starts(segment_starts_mutex_);
+        segment_starts_.erase(newest);
+        segment_starts_epoch_++;
+    }
+    for (const auto& path : inputs) {
+        if (kept.empty() || path != newest) {
+            RetireSegment(path);
+        }
     }
 
-    in.close();
-    LOG_INFO("Read {} entries from WAL file", entries.size());
-
+    result.segments_compacted += inputs.size();
+    result.records_read += records_read;
+    result.records_kept += kept.size();
+    result.bytes_read += bytes_read;
+    result.bytes_written += data.size();
     return true;
 }
 
-void WAL::TruncateBeforeSequence(int64_t sequence) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    auto wal_files = ListWALFiles();
-
-    for (const auto& file_id : wal_files) {
-        auto file_path = GetLogFilePath(file_id);
-
-        // Read file to check max sequence
-        std::vector<WALEntry> entries;
-        if (!ReadWALFile(file_path, entries)) {
-            continue;
-        }
-
-        // Find max sequence in this file
-        int64_t max_seq = 0;
-        for (const auto& entry : entries) {
-            max_seq = std::max(max_seq, entry.sequence_number);
-        }
+void WAL::CompactionLoop() {
+    const auto interval = std::chrono::milliseconds(config_.compaction_interval_ms);
 
-        // Delete if all entries are before the sequence
-        if (max_seq < sequence) {
-            std::filesystem::remove(file_path);
-            LOG_INFO("Truncated WAL file: {} (max_seq: {})", file_id, max_seq);
-        }
+    std::unique_lock<std::mutex> lock(compaction_mutex_);
+    while (!compaction_cv_.wait_for(lock, interval, [this] { return stop_compaction_; })) {
+        lock.unlock();
+        CompactSegments();
+        lock.lock();
     }
 }
 
 void WAL::DeleteAllLogs() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    MarkLost(last_sequence_.load());
+    {
+        std::lock_guard<std::mutex> lock(segment_starts_mutex_);
+        segment_starts_.clear();
+        segment_starts_epoch_++;
+    }
 
     auto wal_files = ListWALFiles();
     for (const auto& file_id : wal_files) {
@@ -468,27 +2032,68 @@ WAL::Stats WAL::GetStats() const {
     stats.total_entries_written = total_entries_written_.load();
     stats.total_syncs = total_syncs_.load();
     stats.total_rotations = total_rotations_.load();
+    stats.total_group_commits = total_group_commits_.load();
+    stats.max_group_commit_records = max_group_commit_records_.load();
+    stats.total_segments_recycled = total_segments_recycled_.load();
+    stats.direct_io = direct_io_.load();
+    stats.io_uring = io_uring_.load();
+    stats.total_compressed_blocks = total_compressed_blocks_.load();
+    stats.total_record_bytes = total_record_bytes_.load();
+    stats.total_written_bytes = total_written_bytes_.load();
+    if (stats.total_written_bytes > 0) {
+        stats.compression_ratio = static_cast<double>(stats.total_record_bytes) /
+                                  static_cast<double>(stats.total_written_bytes);
+    }
+    stats.total_compactions = total_compactions_.load();
+    stats.total_segments_compacted = total_segments_compacted_.load();
+    stats.io_throttled_ms = io_throttled_us_.load() / 1000;
+    stats.total_records_compacted_away = total_records_compacted_away_.load();
+    stats.write_latency = write_latency_.snapshot();
+    stats.fsync_latency = fsync_latency_.snapshot();
     stats.last_sequence_number = last_sequence_.load();
-    stats.current_file_size = current_file_size_.load();
+    for (const auto& stream : streams_) {
+        stats.current_file_size += stream->current_file_size.load();
+    }
+    stats.num_streams = streams_.size();
     return stats;
 }
 
-std::string WAL::GenerateLogId() {
+std::string WAL::GenerateLogId(const Stream& stream) {
     auto now = std::chrono::system_clock::now();
     auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
         now.time_since_epoch()).count();
 
     std::ostringstream oss;
-    oss << "wal-" << config_.node_id << "-" << timestamp;
-    return oss.str();
+    if (stream.dir != config_.wal_dir) {
+        oss << stream.dir.filename().string() << "/";
+    }
+    oss << "wal-" << config_.node_id << "-" << std::setfill('0') << std::setw(13) << timestamp;
+
+    // Segments are overwritten from the start, so never reuse an existing
+    // name. Retirement and compaction take name order as creation order,
+    // so the same-millisecond counter is fixed width too
+    std::string prefix = oss.str();
+    std::string log_id;
+    for (int counter = 0;; ++counter) {
+        std::ostringstream suffix;
+        suffix << "-" << std::setfill('0') << std::setw(6) << counter;
+        log_id = prefix + suffix.str();
+        if (!std::filesystem::exists(GetLogFilePath(log_id))) {
+            return log_id;
+        }
+    }
 }
 
 std::filesystem::path WAL::GetLogFilePath(const std::string& log_id) const {
     return config_.wal_dir / (log_id + ".wal");
 }
 
-bool WAL::ShouldRotate() const {
-    return current_file_size_.load() >= config_.max_file_size_bytes;
+bool WAL::ShouldRotate(const Stream& stream, size_t incoming_bytes) const {
+    // A batch larger than a whole segment goes into a fresh one and
+    // extends it rather than rotating forever
+    size_t size = stream.current_file_size.load();
+    return size > stream.segment_data_start &&
+           size + incoming_bytes + kFrameHeaderSize > config_.max_file_size_bytes;
 }
 
 } // namespace distcache
@@ -19,7 +19,32 @@ void ReplicationManager::Start() {
     }
 
     Logger::info("Starting replication manager for node: {}", config_.node_id);
-    worker_thread_ = std::thread(&ReplicationManager::ReplicationWorker, this);
+
+    // Senders kept from before a Stop pick up where they left off
+    {
+        std::lock_guard<std::mutex> lock(destinations_mutex_);
+        for (auto& [id, destination] : destinations_) {
+            StartSender(*destination);
+        }
+    }
+
+    if (commit_log_) {
+        worker_thread_ = std::thread(&ReplicationManager::LogShippingWorker, this);
+    } else {
+        worker_thread_ = std::thread(&ReplicationManager::ReplicationWorker, this);
+    }
+}
+
+void ReplicationManager::AttachCommitLog(std::shared_ptr<CommitLog> log) {
+    if (running_.load()) {
+        Logger::warn("Cannot attach a commit log while replication is running");
+        return;
+    }
+    commit_log_ = std::move(log);
+
+    // Senders kept for the queue have nothing to resume in the log
+    std::lock_guard<std::mutex> lock(destinations_mutex_);
+    destinations_.clear();
 }
 
 void ReplicationManager::Stop() {
@@ -33,23 +58,48 @@ void ReplicationManager::Stop() {
     if (worker_thread_.joinable()) {
         worker_thread_.join();
     }
+
+    // The worker is gone, so no sender is added while these stop
+    std::vector<Destination*> destinations;
+    {
+        std::lock_guard<std::mutex> lock(destinations_mutex_);
+        for (auto& [id, destination] : destinations_) {
+            destinations.push_back(destination.get());
+        }
+    }
+    for (auto* destination : destinations) {
+        StopSender(*destination);
+    }
 }
 
-bool ReplicationManager::QueueWrite(const std::string& key,
-                                    const std::string& value,
+bool ReplicationManager::QueueWrite(std::string key,
+                                    std::string value,
                                     int32_t ttl_seconds,
                                     int64_t version) {
+    if (commit_log_) {
+        CommitLog::Record record;
+        record.op = CommitLog::Record::Op::SET;
+        record.key = std::move(key);
+        record.value = std::move(value);
+        record.ttl_seconds = ttl_seconds;
+        record.version = version;
+        commit_log_->Append(std::move(record));
+        queued_ops_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
     std::lock_guard<std::mutex> lock(queue_mutex_);
 
     if (queue_.size() >= config_.max_queue_size) {
         Logger::warn("Replication queue full, dropping write for key: {}", key);
+        dropped_ops_.fetch_add(1, std::memory_order_relaxed);
         return false;
     }
 
     QueuedEntry entry;
     entry.op = v1::ReplicationEntry::SET;
-    entry.key = key;
-    entry.value = value;
+    entry.key = std::move(key);
+    entry.value = std::move(value);
     entry.ttl_seconds = ttl_seconds;
     entry.version = version;
     entry.queued_at = std::chrono::steady_clock::now();
@@ -62,10 +112,21 @@ bool ReplicationManager::QueueWrite(const std::string& key,
 }
 
 bool ReplicationManager::QueueDelete(const std::string& key, int64_t version) {
+    if (commit_log_) {
+        CommitLog::Record record;
+        record.op = CommitLog::Record::Op::DELETE;
+        record.key = key;
+        record.version = version;
+        commit_log_->Append(std::move(record));
+        queued_ops_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
     std::lock_guard<std::mutex> lock(queue_mutex_);
 
     if (queue_.size() >= config_.max_queue_size) {
         Logger::warn("Replication queue full, dropping delete for key: {}", key);
+        dropped_ops_.fetch_add(1, std::memory_order_relaxed);
         return false;
     }
 
@@ -88,10 +149,27 @@ ReplicationManager::Stats ReplicationManager::GetStats() const {
     stats.queued_ops = queued_ops_.load(std::memory_order_relaxed);
     stats.replicated_ops = replicated_ops_.load(std::memory_order_relaxed);
     stats.failed_ops = failed_ops_.load(std::memory_order_relaxed);
+    stats.dropped_ops = dropped_ops_.load(std::memory_order_relaxed);
     stats.batches_sent = batches_sent_.load(std::memory_order_relaxed);
 
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    stats.queue_depth = queue_.size();
+    if (commit_log_) {
+        stats.acked_sequence = acked_sequence_.load(std::memory_order_relaxed);
+        int64_t readable = commit_log_->ReadableSequence();
+        stats.queue_depth = readable > stats.acked_sequence
+            ? static_cast<size_t>(readable - stats.acked_sequence) : 0;
+        return stats;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stats.queue_depth = queue_.size();
+    }
+
+    std::lock_guard<std::mutex> lock(destinations_mutex_);
+    for (const auto& [id, destination] : destinations_) {
+        std::lock_guard<std::mutex> destination_lock(destination->mutex);
+        stats.queue_depth += destination->queued_entries;
+    }
 
     return stats;
 }
@@ -122,93 +200,345 @@ void ReplicationManager::ReplicationWorker() {
         }
         lock.unlock();
 
-        if (batch.empty()) {
-            continue;
+        SyncDestinations(GetPeers());
+        if (!batch.empty()) {
+            DispatchBatch(batch);
         }
+    }
 
-        // Send batch to replicas
-        if (SendBatch(batch)) {
-            replicated_ops_.fetch_add(batch.size(), std::memory_order_relaxed);
+    Logger::info("Replication worker stopped");
+}
+
+void ReplicationManager::LogShippingWorker() {
+    Logger::info("Replication log shipping started");
+
+    // Each replica's sender ships the log; this only follows the ring
+    while (running_.load(std::memory_order_relaxed)) {
+        SyncDestinations(GetPeers());
+        UpdateAckedSequence();
+
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        queue_cv_.wait_for(lock, std::chrono::milliseconds(config_.batch_interval_ms),
+                           [this] { return !running_.load(); });
+    }
+
+    Logger::info("Replication log shipping stopped");
+}
+
+void ReplicationManager::QueueSender(Destination& destination) {
+    while (true) {
+        v1::ReplicationBatch batch;
+        {
+            std::unique_lock<std::mutex> lock(destination.mutex);
+            destination.cv.wait(lock, [&destination] {
+                return !destination.batches.empty() || !destination.running.load();
+            });
+            if (!destination.running.load()) {
+                break;  // Anything still queued is sent after a restart
+            }
+
+            // What built up during the last RPC goes out in one
+            batch = std::move(destination.batches.front());
+            destination.batches.pop_front();
+            while (!destination.batches.empty() &&
+                   static_cast<size_t>(batch.entries_size() +
+                                       destination.batches.front().entries_size()) <=
+                       config_.batch_size) {
+                for (auto& entry : *destination.batches.front().mutable_entries()) {
+                    *batch.add_entries() = std::move(entry);
+                }
+                destination.batches.pop_front();
+            }
+            destination.queued_entries -= static_cast<size_t>(batch.entries_size());
+        }
+
+        batch.set_source_node_id(config_.node_id);
+        batch.set_timestamp(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+
+        auto count = static_cast<uint64_t>(batch.entries_size());
+        if (SendToReplica(destination.node, batch)) {
+            replicated_ops_.fetch_add(count, std::memory_order_relaxed);
         } else {
-            failed_ops_.fetch_add(batch.size(), std::memory_order_relaxed);
+            failed_ops_.fetch_add(count, std::memory_order_relaxed);
         }
         batches_sent_.fetch_add(1, std::memory_order_relaxed);
     }
+}
 
-    Logger::info("Replication worker stopped");
+void ReplicationManager::LogSender(Destination& destination) {
+    while (destination.running.load(std::memory_order_relaxed)) {
+        if (!ShipLogTo(destination)) {
+            // Unreachable; retry from its cursor after a pause
+            std::unique_lock<std::mutex> lock(destination.mutex);
+            destination.cv.wait_for(lock, std::chrono::milliseconds(config_.batch_interval_ms),
+                                    [&destination] { return !destination.running.load(); });
+            continue;
+        }
+        commit_log_->WaitForRecords(destination.cursor.load(std::memory_order_relaxed),
+                                    std::chrono::milliseconds(config_.batch_interval_ms));
+    }
 }
 
-bool ReplicationManager::SendBatch(const std::vector<QueuedEntry>& entries) {
-    if (entries.empty()) {
-        return true;
+void ReplicationManager::DispatchBatch(std::vector<QueuedEntry>& entries) {
+    // Bucket the entries by the replicas holding each one's key
+    std::unordered_map<std::string, std::pair<Node, std::vector<size_t>>> buckets;
+    std::vector<size_t> uses(entries.size(), 0);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto replicas = ring_->get_replicas(entries[i].key, config_.replication_factor);
+        if (replicas.empty()) {
+            Logger::warn("No replicas found for key: {}", entries[i].key);
+            failed_ops_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        for (const auto& replica : replicas) {
+            if (replica.id == config_.node_id) {
+                continue;  // The primary copy
+            }
+            auto& bucket = buckets[replica.id];
+            if (bucket.second.empty()) {
+                bucket.first = replica;
+            }
+            bucket.second.push_back(i);
+            uses[i]++;
+        }
     }
 
-    // Get replicas for first key (assuming all keys in batch are related)
-    auto replicas = ring_->get_replicas(entries[0].key, config_.replication_factor);
+    for (auto& [id, bucket] : buckets) {
+        v1::ReplicationBatch batch;
+        batch.mutable_entries()->Reserve(static_cast<int>(bucket.second.size()));
+        for (size_t i : bucket.second) {
+            auto& entry = entries[i];
+            auto* rep_entry = batch.add_entries();
+            rep_entry->set_op(entry.op);
+            rep_entry->set_version(entry.version);
+            if (entry.op == v1::ReplicationEntry::SET) {
+                rep_entry->set_ttl_seconds(entry.ttl_seconds);
+            }
 
-    if (replicas.empty()) {
-        Logger::warn("No replicas found for replication");
-        return false;
+            // The last batch to take an entry moves its buffers, the others copy
+            if (--uses[i] == 0) {
+                rep_entry->set_key(std::move(entry.key));
+                if (entry.op == v1::ReplicationEntry::SET) {
+                    rep_entry->set_value(std::move(entry.value));
+                }
+            } else {
+                rep_entry->set_key(entry.key);
+                if (entry.op == v1::ReplicationEntry::SET) {
+                    rep_entry->set_value(entry.value);
+                }
+            }
+        }
+
+        auto count = bucket.second.size();
+        std::lock_guard<std::mutex> lock(destinations_mutex_);
+        Destination& destination = GetDestination(bucket.first);
+        {
+            std::lock_guard<std::mutex> destination_lock(destination.mutex);
+            if (destination.queued_entries + count > config_.max_queue_size) {
+                Logger::warn("Replication queue for {} full, dropping {} ops", id, count);
+                dropped_ops_.fetch_add(count, std::memory_order_relaxed);
+                continue;
+            }
+            destination.queued_entries += count;
+            destination.batches.push_back(std::move(batch));
+        }
+        destination.cv.notify_one();
     }
+}
 
-    // Remove self from replicas (primary node)
-    replicas.erase(
-        std::remove_if(replicas.begin(), replicas.end(),
+std::vector<Node> ReplicationManager::GetPeers() const {
+    std::vector<Node> peers = ring_->get_all_nodes();
+    peers.erase(
+        std::remove_if(peers.begin(), peers.end(),
                       [this](const Node& n) { return n.id == config_.node_id; }),
-        replicas.end());
+        peers.end());
+    return peers;
+}
 
-    if (replicas.empty()) {
-        return true;  // No replicas to send to
+void ReplicationManager::SyncDestinations(const std::vector<Node>& peers) {
+    std::vector<std::unique_ptr<Destination>> removed;
+    {
+        std::lock_guard<std::mutex> lock(destinations_mutex_);
+        for (const auto& peer : peers) {
+            GetDestination(peer);
+        }
+        for (auto it = destinations_.begin(); it != destinations_.end();) {
+            bool present = std::any_of(peers.begin(), peers.end(),
+                                       [&](const Node& n) { return n.id == it->first; });
+            if (!present) {
+                removed.push_back(std::move(it->second));
+                it = destinations_.erase(it);
+            } else {
+                ++it;
+            }
+        }
     }
 
-    // Build replication batch
-    v1::ReplicationBatch batch;
-    batch.set_source_node_id(config_.node_id);
-    batch.set_timestamp(std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count());
-
-    for (const auto& entry : entries) {
-        auto* rep_entry = batch.add_entries();
-        rep_entry->set_op(entry.op);
-        rep_entry->set_key(entry.key);
-        if (entry.op == v1::ReplicationEntry::SET) {
-            rep_entry->set_value(entry.value);
-            rep_entry->set_ttl_seconds(entry.ttl_seconds);
+    // Stopped outside the lock, which a sender may be waiting on
+    for (auto& destination : removed) {
+        StopSender(*destination);
+        const std::string& id = destination->node.id;
+        if (commit_log_) {
+            // Stop holding log records for it
+            commit_log_->RemoveConsumer("replica:" + id);
+        } else if (destination->queued_entries > 0) {
+            Logger::warn("Dropping {} ops queued for {}, which left the ring",
+                        destination->queued_entries, id);
+            failed_ops_.fetch_add(destination->queued_entries, std::memory_order_relaxed);
         }
-        rep_entry->set_version(entry.version);
+        Logger::info("Removed replication sender for {}", id);
+    }
+}
+
+ReplicationManager::Destination& ReplicationManager::GetDestination(const Node& node) {
+    auto& destination = destinations_[node.id];
+    if (destination) {
+        return *destination;
     }
 
-    // Send to all replicas
-    bool all_succeeded = true;
-    for (const auto& replica : replicas) {
-        auto stub = GetStub(replica);
-        if (!stub) {
-            Logger::error("Failed to get stub for replica: {}", replica.id);
-            all_succeeded = false;
+    destination = std::make_unique<Destination>();
+    destination->node = node;
+    if (commit_log_) {
+        // A new replica starts from what the log still holds
+        int64_t start = commit_log_->GetStats().first_sequence - 1;
+        destination->cursor.store(start);
+        commit_log_->Acknowledge("replica:" + node.id, start);
+    }
+    if (running_.load()) {
+        StartSender(*destination);
+    }
+    Logger::info("Added replication sender for {}", node.id);
+    return *destination;
+}
+
+void ReplicationManager::StartSender(Destination& destination) {
+    destination.running.store(true);
+    if (commit_log_) {
+        destination.sender = std::thread(&ReplicationManager::LogSender, this,
+                                         std::ref(destination));
+    } else {
+        destination.sender = std::thread(&ReplicationManager::QueueSender, this,
+                                         std::ref(destination));
+    }
+}
+
+void ReplicationManager::StopSender(Destination& destination) {
+    {
+        std::lock_guard<std::mutex> lock(destination.mutex);
+        destination.running.store(false);
+    }
+    destination.cv.notify_all();
+
+    if (destination.sender.joinable()) {
+        destination.sender.join();
+    }
+}
+
+bool ReplicationManager::ShipLogTo(Destination& destination) {
+    const Node& replica = destination.node;
+    const std::string consumer = "replica:" + replica.id;
+    int64_t cursor = destination.cursor.load(std::memory_order_relaxed);
+
+    while (destination.running.load(std::memory_order_relaxed)) {
+        std::vector<CommitLog::RecordPtr> records;
+        int64_t through = commit_log_->Read(cursor, config_.batch_size, records);
+        if (through < 0) {
+            int64_t resume = commit_log_->GetStats().first_sequence - 1;
+            Logger::error("Replica {} fell behind the commit log; records {}..{} are gone",
+                         replica.id, cursor + 1, resume);
+            failed_ops_.fetch_add(static_cast<uint64_t>(resume - cursor), std::memory_order_relaxed);
+            cursor = resume;
+            destination.cursor.store(cursor, std::memory_order_relaxed);
+            commit_log_->Acknowledge(consumer, cursor);
             continue;
         }
+        if (through == cursor) {
+            return true;  // Caught up
+        }
 
-        grpc::ClientContext context;
-        context.set_deadline(std::chrono::system_clock::now() +
-                           std::chrono::milliseconds(config_.rpc_timeout_ms));
-
-        v1::ReplicationAck ack;
-        grpc::Status status = stub->Replicate(&context, batch, &ack);
-
-        if (!status.ok()) {
-            Logger::error("Replication failed to {}: {}", replica.id,
-                         status.error_message());
-            all_succeeded = false;
-        } else if (!ack.success()) {
-            Logger::error("Replication rejected by {}: {}", replica.id,
-                         ack.error());
-            all_succeeded = false;
-        } else {
-            Logger::debug("Replicated {} ops to {}", entries.size(), replica.id);
+        // Only local writes, and only those this replica holds a copy of;
+        // writes replicated to this node came from their own primary
+        v1::ReplicationBatch batch;
+        batch.set_source_node_id(config_.node_id);
+        batch.set_timestamp(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        for (const auto& record : records) {
+            if (record->replicated) {
+                continue;
+            }
+            auto owners = ring_->get_replicas(record->key, config_.replication_factor);
+            bool holds = std::any_of(owners.begin(), owners.end(),
+                                     [&](const Node& n) { return n.id == replica.id; });
+            if (!holds) {
+                continue;
+            }
+            auto* entry = batch.add_entries();
+            entry->set_key(record->key);
+            entry->set_version(record->version);
+            entry->set_sequence(record->sequence);
+            if (record->op == CommitLog::Record::Op::SET) {
+                entry->set_op(v1::ReplicationEntry::SET);
+                auto value = record->value_view();
+                entry->set_value(value.data(), value.size());
+                entry->set_ttl_seconds(record->ttl_seconds);
+            } else {
+                entry->set_op(v1::ReplicationEntry::DELETE);
+            }
+        }
+
+        if (batch.entries_size() > 0) {
+            if (!SendToReplica(replica, batch)) {
+                failed_ops_.fetch_add(batch.entries_size(), std::memory_order_relaxed);
+                return false;  // Resent from the same cursor next time
+            }
+            replicated_ops_.fetch_add(batch.entries_size(), std::memory_order_relaxed);
+            batches_sent_.fetch_add(1, std::memory_order_relaxed);
         }
+
+        cursor = through;
+        destination.cursor.store(cursor, std::memory_order_relaxed);
+        commit_log_->Acknowledge(consumer, cursor);
+        UpdateAckedSequence();
     }
+    return true;
+}
 
-    return all_succeeded;
+void ReplicationManager::UpdateAckedSequence() {
+    std::lock_guard<std::mutex> lock(destinations_mutex_);
+    int64_t slowest = commit_log_->ReadableSequence();
+    for (const auto& [id, destination] : destinations_) {
+        slowest = std::min(slowest, destination->cursor.load(std::memory_order_relaxed));
+    }
+    acked_sequence_.store(slowest, std::memory_order_relaxed);
+}
+
+bool ReplicationManager::SendToReplica(const Node& replica, const v1::ReplicationBatch& batch) {
+    auto stub = GetStub(replica);
+    if (!stub) {
+        Logger::error("Failed to get stub for replica: {}", replica.id);
+        return false;
+    }
+
+    grpc::ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() +
+                       std::chrono::milliseconds(config_.rpc_timeout_ms));
+
+    v1::ReplicationAck ack;
+    grpc::Status status = stub->Replicate(&context, batch, &ack);
+
+    if (!status.ok()) {
+        Logger::error("Replication failed to {}: {}", replica.id,
+                     status.error_message());
+        return false;
+    }
+    if (!ack.success()) {
+        Logger::error("Replication rejected by {}: {}", replica.id,
+                     ack.error());
+        return false;
+    }
+    Logger::debug("Replicated {} ops to {}", batch.entries_size(), replica.id);
+    return true;
 }
 
 std::unique_ptr<v1::ReplicationService::Stub>
@@ -254,8 +584,23 @@ grpc::Status ReplicationServiceImpl::Replicate(
 
     size_t applied = 0;
     size_t failed = 0;
+    size_t skipped = 0;
+
+    int64_t applied_sequence = GetAppliedSequence(request->source_node_id());
+    int64_t batch_sequence = applied_sequence;
+
+    // Logged locally as replicated, so this node does not ship them back
+    ReplicatedApplyScope replicated;
 
     for (const auto& entry : request->entries()) {
+        if (entry.sequence() > 0) {
+            if (entry.sequence() <= applied_sequence) {
+                skipped++;
+                continue;
+            }
+            batch_sequence = std::max(batch_sequence, entry.sequence());
+        }
+
         if (entry.op() == v1::ReplicationEntry::SET) {
             CacheEntry cache_entry;
             // Convert string to vector<uint8_t>
@@ -265,6 +610,7 @@ grpc::Status ReplicationServiceImpl::Replicate(
             }
             cache_entry.version = entry.version();
             cache_entry.created_at_ms = CacheEntry::get_current_time_ms();
+            cache_entry.modified_at_ms = cache_entry.created_at_ms;
             cache_entry.last_accessed_ms.store(cache_entry.created_at_ms);
 
             if (storage_->set(entry.key(), std::move(cache_entry))) {
@@ -285,10 +631,20 @@ grpc::Status ReplicationServiceImpl::Replicate(
 
     entries_applied_.fetch_add(applied, std::memory_order_relaxed);
     entries_failed_.fetch_add(failed, std::memory_order_relaxed);
+    entries_skipped_.fetch_add(skipped, std::memory_order_relaxed);
     last_applied_timestamp_.store(request->timestamp(), std::memory_order_relaxed);
 
+    // A failed batch is resent whole, so only advance once all of it applied
+    if (failed == 0 && batch_sequence > applied_sequence) {
+        std::lock_guard<std::mutex> lock(applied_mutex_);
+        auto& sequence = applied_sequences_[request->source_node_id()];
+        sequence = std::max(sequence, batch_sequence);
+        applied_sequence = sequence;
+    }
+
     response->set_success(failed == 0);
     response->set_last_applied_timestamp(request->timestamp());
+    response->set_last_applied_sequence(applied_sequence);
     if (failed > 0) {
         response->set_error("Failed to apply " + std::to_string(failed) + " entries");
     }
@@ -335,8 +691,15 @@ ReplicationServiceImpl::Stats ReplicationServiceImpl::GetStats() const {
     stats.batches_received = batches_received_.load(std::memory_order_relaxed);
     stats.entries_applied = entries_applied_.load(std::memory_order_relaxed);
     stats.entries_failed = entries_failed_.load(std::memory_order_relaxed);
+    stats.entries_skipped = entries_skipped_.load(std::memory_order_relaxed);
     stats.last_applied_timestamp = last_applied_timestamp_.load(std::memory_order_relaxed);
     return stats;
 }
 
+int64_t ReplicationServiceImpl::GetAppliedSequence(const std::string& source_node_id) const {
+    std::lock_guard<std::mutex> lock(applied_mutex_);
+    auto it = applied_sequences_.find(source_node_id);
+    return it == applied_sequences_.end() ? 0 : it->second;
+}
+
 } // namespace distcache
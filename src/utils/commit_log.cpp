@@ -0,0 +1,220 @@
+#include "distcache/commit_log.h"
+#include <algorithm>
+
+namespace distcache {
+
+CommitLog::CommitLog() : CommitLog(Config()) {}
+
+CommitLog::CommitLog(const Config& config) : config_(config) {}
+
+void CommitLog::StartAfter(int64_t sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!slots_.empty()) {
+        return;
+    }
+    base_ = sequence + 1;
+    contiguous_ = std::max(contiguous_, sequence);
+    highest_ = std::max(highest_, sequence);
+    durable_ = std::max(durable_, sequence);
+}
+
+int64_t CommitLog::Append(Record record) {
+    int64_t readable_before = 0;
+    int64_t readable_after = 0;
+    int64_t sequence = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (record.sequence == 0) {
+            record.sequence = highest_ + 1;
+        }
+        sequence = record.sequence;
+        if (sequence < base_) {
+            return 0;
+        }
+
+        size_t index = static_cast<size_t>(sequence - base_);
+        if (index >= slots_.size()) {
+            slots_.resize(index + 1);
+        }
+        if (slots_[index]) {
+            return 0;
+        }
+
+        readable_before = ReadableLocked();
+        retained_bytes_ += RecordBytes(record);
+        slots_[index] = std::make_shared<const Record>(std::move(record));
+        highest_ = std::max(highest_, sequence);
+        records_appended_++;
+
+        AdvanceLocked();
+        TrimLocked();
+        readable_after = ReadableLocked();
+    }
+
+    if (readable_after > readable_before) {
+        readable_cv_.notify_all();
+    }
+    return sequence;
+}
+
+void CommitLog::MarkDurable(int64_t sequence) {
+    bool advanced = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (sequence > durable_) {
+            int64_t readable_before = ReadableLocked();
+            durable_ = sequence;
+            TrimLocked();
+            advanced = ReadableLocked() > readable_before;
+        }
+    }
+    if (advanced) {
+        readable_cv_.notify_all();
+    }
+}
+
+int64_t CommitLog::ReadableSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ReadableLocked();
+}
+
+void CommitLog::SetBackfill(Backfill backfill) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    backfill_ = std::move(backfill);
+}
+
+int64_t CommitLog::Read(int64_t after, size_t max_records, std::vector<RecordPtr>& out) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    int64_t through = after;
+    size_t taken = 0;
+
+    while (taken < max_records) {
+        if (through + 1 < base_) {
+            // Evicted from memory; read the gap back from the producer.
+            // The lock is dropped meanwhile, so base_ is re-checked after
+            if (!backfill_) {
+                return -1;
+            }
+            Backfill backfill = backfill_;
+            int64_t up_to = base_ - 1;
+            size_t wanted = max_records - taken;
+            lock.unlock();
+
+            std::vector<Record> records;
+            if (!backfill(through, up_to, wanted, records)) {
+                return -1;
+            }
+            size_t added = 0;
+            for (auto& record : records) {
+                if (record.sequence <= through || record.sequence > up_to || added == wanted) {
+                    continue;
+                }
+                through = record.sequence;
+                out.push_back(std::make_shared<const Record>(std::move(record)));
+                added++;
+            }
+            if (added < wanted) {
+                through = up_to;  // The whole gap was covered
+            }
+            taken += added;
+
+            lock.lock();
+            records_backfilled_ += added;
+            continue;
+        }
+
+        int64_t readable = ReadableLocked();
+        while (through < readable && taken < max_records) {
+            out.push_back(slots_[static_cast<size_t>(through + 1 - base_)]);
+            through++;
+            taken++;
+        }
+        break;
+    }
+    return through;
+}
+
+bool CommitLog::WaitForRecords(int64_t after, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return readable_cv_.wait_for(lock, timeout, [&] { return ReadableLocked() > after; });
+}
+
+void CommitLog::Acknowledge(const std::string& consumer, int64_t sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& acked = consumers_[consumer];
+    acked = std::max(acked, sequence);
+    TrimLocked();
+}
+
+void CommitLog::RemoveConsumer(const std::string& consumer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    consumers_.erase(consumer);
+    TrimLocked();
+}
+
+CommitLog::Stats CommitLog::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.records_appended = records_appended_;
+    stats.records_evicted = records_evicted_;
+    stats.records_backfilled = records_backfilled_;
+    stats.retained_records = static_cast<size_t>(
+        std::count_if(slots_.begin(), slots_.end(), [](const RecordPtr& r) { return r != nullptr; }));
+    stats.retained_bytes = retained_bytes_;
+    stats.first_sequence = base_;
+    stats.readable_sequence = ReadableLocked();
+    stats.acknowledged_sequence = AcknowledgedLocked();
+    return stats;
+}
+
+size_t CommitLog::RecordBytes(const Record& record) {
+    return sizeof(Record) + record.key.size() + record.value_view().size();
+}
+
+void CommitLog::AdvanceLocked() {
+    while (true) {
+        size_t next = static_cast<size_t>(contiguous_ + 1 - base_);
+        if (next >= slots_.size() || !slots_[next]) {
+            break;
+        }
+        contiguous_++;
+    }
+}
+
+void CommitLog::TrimLocked() {
+    // Only the readable prefix is ever dropped: anything later is either
+    // missing its predecessors or not yet durable
+    int64_t readable = ReadableLocked();
+    int64_t acknowledged = AcknowledgedLocked();
+
+    auto pop_front = [this] {
+        retained_bytes_ -= RecordBytes(*slots_.front());
+        slots_.pop_front();
+        base_++;
+    };
+
+    while (!slots_.empty() && base_ <= std::min(readable, acknowledged)) {
+        pop_front();
+    }
+    while (!slots_.empty() && base_ <= readable && retained_bytes_ > config_.max_bytes) {
+        pop_front();
+        records_evicted_++;
+    }
+}
+
+int64_t CommitLog::ReadableLocked() const {
+    return config_.gate_on_durable ? std::min(contiguous_, durable_) : contiguous_;
+}
+
+int64_t CommitLog::AcknowledgedLocked() const {
+    if (consumers_.empty()) {
+        return base_ - 1;  // Nothing is released early without consumers
+    }
+    int64_t slowest = consumers_.begin()->second;
+    for (const auto& [name, sequence] : consumers_) {
+        slowest = std::min(slowest, sequence);
+    }
+    return slowest;
+}
+
+} // namespace distcache
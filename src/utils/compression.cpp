@@ -0,0 +1,121 @@
+#include "distcache/compression.h"
+#include <zlib.h>
+
+#ifdef DISTCACHE_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+namespace distcache {
+namespace compression {
+
+Codec DefaultCodec() {
+#ifdef DISTCACHE_HAVE_LZ4
+    return Codec::kLZ4;
+#else
+    return Codec::kZlib;
+#endif
+}
+
+bool IsAvailable(Codec codec) {
+    switch (codec) {
+        case Codec::kNone:
+        case Codec::kZlib:
+            return true;
+        case Codec::kLZ4:
+#ifdef DISTCACHE_HAVE_LZ4
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+const char* CodecName(Codec codec) {
+    switch (codec) {
+        case Codec::kNone:
+            return "none";
+        case Codec::kZlib:
+            return "zlib";
+        case Codec::kLZ4:
+            return "lz4";
+    }
+    return "unknown";
+}
+
+bool Compress(Codec codec, const char* data, size_t size, std::string& out) {
+    size_t offset = out.size();
+
+    switch (codec) {
+        case Codec::kNone:
+            out.append(data, size);
+            return true;
+
+        case Codec::kZlib: {
+            // Favour speed: these blocks sit on the commit path
+            uLongf bound = compressBound(static_cast<uLong>(size));
+            out.resize(offset + bound);
+            int rc = compress2(reinterpret_cast<Bytef*>(&out[offset]), &bound,
+                               reinterpret_cast<const Bytef*>(data),
+                               static_cast<uLong>(size), Z_BEST_SPEED);
+            if (rc != Z_OK) {
+                out.resize(offset);
+                return false;
+            }
+            out.resize(offset + bound);
+            return true;
+        }
+
+        case Codec::kLZ4: {
+#ifdef DISTCACHE_HAVE_LZ4
+            int bound = LZ4_compressBound(static_cast<int>(size));
+            out.resize(offset + static_cast<size_t>(bound));
+            int written = LZ4_compress_default(data, &out[offset], static_cast<int>(size), bound);
+            if (written <= 0) {
+                out.resize(offset);
+                return false;
+            }
+            out.resize(offset + static_cast<size_t>(written));
+            return true;
+#else
+            return false;
+#endif
+        }
+    }
+    return false;
+}
+
+bool Decompress(Codec codec, const char* data, size_t size,
+                size_t uncompressed_size, std::string& out) {
+    out.resize(uncompressed_size);
+
+    switch (codec) {
+        case Codec::kNone:
+            if (size != uncompressed_size) {
+                return false;
+            }
+            out.assign(data, size);
+            return true;
+
+        case Codec::kZlib: {
+            uLongf length = static_cast<uLongf>(uncompressed_size);
+            int rc = uncompress(reinterpret_cast<Bytef*>(&out[0]), &length,
+                                reinterpret_cast<const Bytef*>(data), static_cast<uLong>(size));
+            return rc == Z_OK && length == uncompressed_size;
+        }
+
+        case Codec::kLZ4: {
+#ifdef DISTCACHE_HAVE_LZ4
+            int length = LZ4_decompress_safe(data, &out[0], static_cast<int>(size),
+                                             static_cast<int>(uncompressed_size));
+            return length >= 0 && static_cast<size_t>(length) == uncompressed_size;
+#else
+            return false;
+#endif
+        }
+    }
+    return false;
+}
+
+} // namespace compression
+} // namespace distcache
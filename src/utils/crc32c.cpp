@@ -0,0 +1,147 @@
+#include "distcache/crc32c.h"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#if defined(__linux__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#endif
+
+namespace distcache {
+namespace crc32c {
+
+namespace {
+
+// Reflected Castagnoli polynomial
+constexpr uint32_t kPolynomial = 0x82F63B78;
+
+// Slice-by-8 lookup tables: table[k][b] is the CRC of byte b followed
+// by k zero bytes
+using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+constexpr Tables MakeTables() {
+    Tables tables{};
+    for (uint32_t b = 0; b < 256; ++b) {
+        uint32_t crc = b;
+        for (int i = 0; i < 8; ++i) {
+            crc = (crc >> 1) ^ ((crc & 1) ? kPolynomial : 0);
+        }
+        tables[0][b] = crc;
+    }
+    for (uint32_t b = 0; b < 256; ++b) {
+        for (size_t k = 1; k < 8; ++k) {
+            uint32_t prev = tables[k - 1][b];
+            tables[k][b] = (prev >> 8) ^ tables[0][prev & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr Tables kTables = MakeTables();
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2")))
+uint32_t ExtendHardware(uint32_t crc, const uint8_t* p, size_t size) {
+    uint64_t state = ~crc;
+    for (; size >= 8; size -= 8, p += 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        state = _mm_crc32_u64(state, word);
+    }
+    uint32_t state32 = static_cast<uint32_t>(state);
+    for (; size > 0; --size, ++p) {
+        state32 = _mm_crc32_u8(state32, *p);
+    }
+    return ~state32;
+}
+
+bool DetectHardware() {
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#elif defined(__aarch64__)
+
+__attribute__((target("+crc")))
+uint32_t ExtendHardware(uint32_t crc, const uint8_t* p, size_t size) {
+    uint32_t state = ~crc;
+    for (; size >= 8; size -= 8, p += 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        state = __crc32cd(state, word);
+    }
+    for (; size > 0; --size, ++p) {
+        state = __crc32cb(state, *p);
+    }
+    return ~state;
+}
+
+bool DetectHardware() {
+#if defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#elif defined(__ARM_FEATURE_CRC32)
+    return true;
+#else
+    return false;
+#endif
+}
+
+#else
+
+uint32_t ExtendHardware(uint32_t crc, const uint8_t* p, size_t size) {
+    return ExtendPortable(crc, p, size);
+}
+
+bool DetectHardware() {
+    return false;
+}
+
+#endif
+
+const bool kHardware = DetectHardware();
+
+} // namespace
+
+uint32_t ExtendPortable(uint32_t crc, const void* data, size_t size) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    uint32_t state = ~crc;
+
+    for (; size >= 8; size -= 8, p += 8) {
+        uint32_t low;
+        uint32_t high;
+        std::memcpy(&low, p, sizeof(low));
+        std::memcpy(&high, p + 4, sizeof(high));
+        low ^= state;
+        state = kTables[7][low & 0xFF] ^
+                kTables[6][(low >> 8) & 0xFF] ^
+                kTables[5][(low >> 16) & 0xFF] ^
+                kTables[4][low >> 24] ^
+                kTables[3][high & 0xFF] ^
+                kTables[2][(high >> 8) & 0xFF] ^
+                kTables[1][(high >> 16) & 0xFF] ^
+                kTables[0][high >> 24];
+    }
+    for (; size > 0; --size, ++p) {
+        state = (state >> 8) ^ kTables[0][(state ^ *p) & 0xFF];
+    }
+    return ~state;
+}
+
+uint32_t Extend(uint32_t crc, const void* data, size_t size) {
+    if (kHardware) {
+        return ExtendHardware(crc, static_cast<const uint8_t*>(data), size);
+    }
+    return ExtendPortable(crc, data, size);
+}
+
+bool IsHardwareAccelerated() {
+    return kHardware;
+}
+
+} // namespace crc32c
+} // namespace distcache
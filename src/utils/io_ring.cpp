@@ -0,0 +1,577 @@
+#include "distcache/io_ring.h"
+#include "distcache/logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define DISTCACHE_HAVE_IO_URING 1
+#endif
+
+namespace distcache {
+
+#ifdef DISTCACHE_HAVE_IO_URING
+
+namespace {
+
+int SysSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int SysEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+             const void* arg, size_t arg_size) {
+    return static_cast<int>(
+        ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+int SysRegister(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+bool ProbeSupport() {
+    IORing ring;
+    if (!ring.Init(2)) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+IORing::~IORing() {
+    if (sqes_) {
+        ::munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+        ::munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_) {
+        ::munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ >= 0) {
+        ::close(ring_fd_);
+    }
+}
+
+bool IORing::IsSupported() {
+    static const bool supported = ProbeSupport();
+    return supported;
+}
+
+bool IORing::Init(unsigned entries) {
+    if (ring_fd_ >= 0) {
+        return true;
+    }
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = SysSetup(std::max(entries, 1u), &params);
+    if (fd < 0) {
+        LOG_DEBUG("io_uring_setup failed: {}", std::strerror(errno));
+        return false;
+    }
+    ring_fd_ = fd;
+
+    // Every operation used here must be supported (IORING_OP_WRITE needs 5.6)
+    std::vector<char> probe_memory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    auto* probe = reinterpret_cast<io_uring_probe*>(probe_memory.data());
+    if (SysRegister(fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        LOG_DEBUG("io_uring probe failed: {}", std::strerror(errno));
+        return false;
+    }
+    for (int op : {IORING_OP_READ, IORING_OP_WRITE, IORING_OP_WRITE_FIXED, IORING_OP_FSYNC}) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            LOG_DEBUG("io_uring lacks operation {}", op);
+            return false;
+        }
+    }
+
+    sq_entries_ = params.sq_entries;
+#ifdef IORING_FEAT_EXT_ARG
+    ext_arg_ = (params.features & IORING_FEAT_EXT_ARG) != 0;
+#endif
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        return false;
+    }
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            return false;
+        }
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED) {
+        sqes_ = nullptr;
+        return false;
+    }
+
+    auto* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    auto* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = cq + params.cq_off.cqes;
+
+    local_tail_ = *sq_tail_;
+    return true;
+}
+
+bool IORing::RegisterBuffers(const std::vector<iovec>& buffers) {
+    UnregisterBuffers();
+    if (ring_fd_ < 0 || buffers.empty()) {
+        return false;
+    }
+    if (SysRegister(ring_fd_, IORING_REGISTER_BUFFERS, buffers.data(),
+                    static_cast<unsigned>(buffers.size())) < 0) {
+        LOG_DEBUG("io_uring buffer registration failed: {}", std::strerror(errno));
+        return false;
+    }
+    buffers_registered_ = true;
+    return true;
+}
+
+void IORing::UnregisterBuffers() {
+    if (buffers_registered_) {
+        SysRegister(ring_fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        buffers_registered_ = false;
+    }
+}
+
+void* IORing::PrepareSqe() {
+    if (ring_fd_ < 0) {
+        return nullptr;
+    }
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (local_tail_ - head >= sq_entries_) {
+        return nullptr;
+    }
+    unsigned index = local_tail_ & sq_mask_;
+    auto* sqe = static_cast<io_uring_sqe*>(sqes_) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    local_tail_++;
+    return sqe;
+}
+
+bool IORing::PrepareWrite(int fd, const void* data, size_t size, uint64_t offset,
+                          uint64_t user_data, int buffer_index, bool link) {
+    auto* sqe = static_cast<io_uring_sqe*>(PrepareSqe());
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = buffer_index >= 0 ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = static_cast<uint32_t>(size);
+    sqe->user_data = user_data;
+    if (buffer_index >= 0) {
+        sqe->buf_index = static_cast<uint16_t>(buffer_index);
+    }
+    if (link) {
+        sqe->flags |= IOSQE_IO_LINK;
+    }
+    return true;
+}
+
+bool IORing::PrepareRead(int fd, void* data, size_t size, uint64_t offset, uint64_t user_data) {
+    auto* sqe = static_cast<io_uring_sqe*>(PrepareSqe());
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = static_cast<uint32_t>(size);
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IORing::PrepareFsync(int fd, uint64_t user_data, bool datasync, bool link) {
+    auto* sqe = static_cast<io_uring_sqe*>(PrepareSqe());
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = fd;
+    sqe->fsync_flags = datasync ? IORING_FSYNC_DATASYNC : 0;
+    sqe->user_data = user_data;
+    if (link) {
+        sqe->flags |= IOSQE_IO_LINK;
+    }
+    return true;
+}
+
+int IORing::Submit() {
+    if (ring_fd_ < 0) {
+        return -EBADF;
+    }
+    unsigned to_submit = local_tail_ - *sq_tail_;
+    if (to_submit == 0) {
+        return 0;
+    }
+    __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+
+    int submitted;
+    do {
+        submitted = SysEnter(ring_fd_, to_submit, 0, 0, nullptr, 0);
+    } while (submitted < 0 && errno == EINTR);
+    return submitted < 0 ? -errno : submitted;
+}
+
+bool IORing::PeekCompletion(Completion& completion) {
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    const auto* cqe = static_cast<const io_uring_cqe*>(cqes_) + (head & cq_mask_);
+    completion.user_data = cqe->user_data;
+    completion.result = cqe->res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool IORing::WaitCompletion(Completion& completion, std::chrono::microseconds timeout) {
+    if (ring_fd_ < 0) {
+        return false;
+    }
+    if (PeekCompletion(completion)) {
+        return true;
+    }
+    if (timeout.count() == 0) {
+        return false;
+    }
+
+    if (timeout.count() < 0) {
+        while (true) {
+            int rc = SysEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (PeekCompletion(completion)) {
+                return true;
+            }
+            if (rc < 0 && errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+#ifdef IORING_ENTER_EXT_ARG
+    if (ext_arg_) {
+        __kernel_timespec ts{};
+        ts.tv_sec = timeout.count() / 1000000;
+        ts.tv_nsec = (timeout.count() % 1000000) * 1000;
+        io_uring_getevents_arg arg{};
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        SysEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+        return PeekCompletion(completion);
+    }
+#endif
+
+    // Older kernels cannot bound the wait; poll instead
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        if (PeekCompletion(completion)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#else  // !DISTCACHE_HAVE_IO_URING
+
+IORing::~IORing() = default;
+
+bool IORing::IsSupported() {
+    return false;
+}
+
+bool IORing::Init(unsigned) {
+    return false;
+}
+
+bool IORing::RegisterBuffers(const std::vector<iovec>&) {
+    return false;
+}
+
+void IORing::UnregisterBuffers() {}
+
+void* IORing::PrepareSqe() {
+    return nullptr;
+}
+
+bool IORing::PrepareWrite(int, const void*, size_t, uint64_t, uint64_t, int, bool) {
+    return false;
+}
+
+bool IORing::PrepareRead(int, void*, size_t, uint64_t, uint64_t) {
+    return false;
+}
+
+bool IORing::PrepareFsync(int, uint64_t, bool, bool) {
+    return false;
+}
+
+int IORing::Submit() {
+    return -ENOSYS;
+}
+
+bool IORing::PeekCompletion(Completion&) {
+    return false;
+}
+
+bool IORing::WaitCompletion(Completion&, std::chrono::microseconds) {
+    return false;
+}
+
+#endif  // DISTCACHE_HAVE_IO_URING
+
+FileWriter::FileWriter(bool use_io_uring, size_t chunk_size, unsigned queue_depth)
+    : chunk_size_(std::max<size_t>(chunk_size, 4096)) {
+    if (use_io_uring && IORing::IsSupported()) {
+        auto ring = std::make_unique<IORing>();
+        if (ring->Init(std::max(queue_depth, 1u))) {
+            ring_ = std::move(ring);
+        }
+    }
+    buffers_.resize(ring_ ? std::max(queue_depth, 1u) + 1 : 1);
+    in_flight_.assign(buffers_.size(), false);
+    buffers_[0].reserve(chunk_size_);
+}
+
+FileWriter::~FileWriter() {
+    if (fd_ >= 0) {
+        while (pending_ > 0 && ReapOne()) {
+        }
+        ::close(fd_);
+    }
+}
+
+bool FileWriter::Open(const std::filesystem::path& path) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        LOG_ERROR("Failed to open {} for writing: {}", path.string(), std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool FileWriter::Append(const void* data, size_t size) {
+    const auto* p = static_cast<const char*>(data);
+    while (size > 0 && !failed_) {
+        std::string& buffer = buffers_[current_];
+        size_t n = std::min(size, chunk_size_ - buffer.size());
+        buffer.append(p, n);
+        p += n;
+        size -= n;
+        if (buffer.size() >= chunk_size_ && !FlushCurrent()) {
+            failed_ = true;
+        }
+    }
+    return !failed_;
+}
+
+bool FileWriter::FlushCurrent() {
+    std::string& buffer = buffers_[current_];
+    if (buffer.empty()) {
+        return true;
+    }
+
+    if (!ring_) {
+        size_t done = 0;
+        while (done < buffer.size()) {
+            ssize_t written = ::pwrite(fd_, buffer.data() + done, buffer.size() - done,
+                                       static_cast<off_t>(offset_ + done));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOG_ERROR("File write failed: {}", std::strerror(errno));
+                return false;
+            }
+            done += static_cast<size_t>(written);
+        }
+        offset_ += buffer.size();
+        buffer.clear();
+        return true;
+    }
+
+    // Queue this chunk and move on to a buffer with no write in flight
+    if (!ring_->PrepareWrite(fd_, buffer.data(), buffer.size(), offset_, current_) ||
+        ring_->Submit() < 0) {
+        return false;
+    }
+    in_flight_[current_] = true;
+    pending_++;
+    offset_ += buffer.size();
+
+    current_ = (current_ + 1) % buffers_.size();
+    while (in_flight_[current_]) {
+        if (!ReapOne()) {
+            return false;
+        }
+    }
+    buffers_[current_].clear();
+    buffers_[current_].reserve(chunk_size_);
+    return !failed_;
+}
+
+bool FileWriter::ReapOne() {
+    IORing::Completion completion;
+    if (!ring_->WaitCompletion(completion)) {
+        return false;
+    }
+    size_t index = static_cast<size_t>(completion.user_data);
+    if (completion.result < 0 ||
+        static_cast<size_t>(completion.result) != buffers_[index].size()) {
+        // Short writes only happen when the device is full
+        LOG_ERROR("File write failed: {}",
+                  completion.result < 0 ? std::strerror(-completion.result) : "short write");
+        failed_ = true;
+    }
+    in_flight_[index] = false;
+    pending_--;
+    return true;
+}
+
+bool FileWriter::Finish(bool sync) {
+    if (fd_ < 0) {
+        return false;
+    }
+    if (!failed_ && !FlushCurrent()) {
+        failed_ = true;
+    }
+    while (pending_ > 0) {
+        if (!ReapOne()) {
+            failed_ = true;
+            break;
+        }
+    }
+    if (!failed_ && sync && ::fdatasync(fd_) != 0) {
+        LOG_ERROR("fdatasync failed: {}", std::strerror(errno));
+        failed_ = true;
+    }
+    if (::close(fd_) != 0) {
+        failed_ = true;
+    }
+    fd_ = -1;
+    return !failed_;
+}
+
+bool ReadWholeFile(const std::filesystem::path& path, std::string& out, bool use_io_uring,
+                   size_t chunk_size, unsigned queue_depth) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open {} for reading: {}", path.string(), std::strerror(errno));
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    out.resize(size);
+    chunk_size = std::max<size_t>(chunk_size, 4096);
+
+    IORing ring;
+    bool ok = true;
+    if (use_io_uring && IORing::IsSupported() && ring.Init(std::max(queue_depth, 1u))) {
+        // Chunk i covers [i * chunk_size, ...); a short read is resubmitted
+        // for its remainder, keyed by the offset it continues from
+        size_t next = 0;
+        size_t in_flight = 0;
+        auto queue = [&](size_t offset, size_t length) {
+            return ring.PrepareRead(fd, &out[offset], length, offset, offset);
+        };
+        while (ok && (next < size || in_flight > 0)) {
+            while (next < size && in_flight < ring.sq_entries()) {
+                size_t length = std::min(chunk_size, size - next);
+                if (!queue(next, length)) {
+                    break;
+                }
+                next += length;
+                in_flight++;
+            }
+            if (ring.Submit() < 0) {
+                ok = false;
+                break;
+            }
+            IORing::Completion completion;
+            if (!ring.WaitCompletion(completion)) {
+                ok = false;
+                break;
+            }
+            in_flight--;
+            size_t offset = static_cast<size_t>(completion.user_data);
+            size_t chunk_end = std::min(size, (offset / chunk_size + 1) * chunk_size);
+            if (completion.result <= 0) {
+                ok = false;
+            } else if (offset + completion.result < chunk_end) {
+                size_t resume = offset + static_cast<size_t>(completion.result);
+                ok = queue(resume, chunk_end - resume);
+                in_flight++;
+            }
+        }
+        while (in_flight > 0) {
+            IORing::Completion completion;
+            if (!ring.WaitCompletion(completion)) {
+                break;
+            }
+            in_flight--;
+        }
+    } else {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::pread(fd, &out[done], std::min(chunk_size, size - done),
+                                static_cast<off_t>(done));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                ok = false;
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+    }
+
+    ::close(fd);
+    if (!ok) {
+        LOG_ERROR("Failed to read {}", path.string());
+    }
+    return ok;
+}
+
+} // namespace distcache
@@ -0,0 +1,159 @@
+#include "distcache/io_scheduler.h"
+#include <algorithm>
+
+namespace distcache {
+
+IoScheduler::IoScheduler() : IoScheduler(Config()) {}
+
+IoScheduler::IoScheduler(const Config& config) {
+    Reconfigure(config);
+    tokens_ = static_cast<double>(config.burst_bytes);  // Start with a full bucket
+}
+
+std::chrono::microseconds IoScheduler::Acquire(size_t bytes) {
+    if (bytes == 0) {
+        return std::chrono::microseconds(0);
+    }
+    requests_.fetch_add(1, std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto started = Clock::now();
+    bool waited = false;
+    while (true) {
+        auto now = Clock::now();
+        AdjustLocked(now);
+        RefillLocked(now);
+        if (rate_ <= 0) {
+            break;
+        }
+
+        // Oversized requests only wait for a full bucket, then run it into debt
+        double needed = static_cast<double>(bytes);
+        if (config_.burst_bytes > 0) {
+            needed = std::min(needed, static_cast<double>(config_.burst_bytes));
+        }
+        if (tokens_ >= needed) {
+            tokens_ -= static_cast<double>(bytes);
+            break;
+        }
+
+        // Wake at least once per interval, so the rate can adapt mid-wait
+        waited = true;
+        interval_throttled_ = true;
+        auto wait = std::chrono::duration<double>((needed - tokens_) / rate_);
+        auto interval = std::chrono::milliseconds(std::max<uint32_t>(1, config_.adjust_interval_ms));
+        reconfigured_cv_.wait_for(lock, std::min<std::chrono::duration<double>>(wait, interval));
+    }
+    interval_bytes_ += bytes;
+    lock.unlock();
+
+    bytes_granted_.fetch_add(bytes, std::memory_order_relaxed);
+    if (!waited) {
+        return std::chrono::microseconds(0);
+    }
+    auto waited_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started);
+    throttled_requests_.fetch_add(1, std::memory_order_relaxed);
+    throttled_us_.fetch_add(static_cast<uint64_t>(waited_us.count()), std::memory_order_relaxed);
+    return waited_us;
+}
+
+void IoScheduler::RefillLocked(Clock::time_point now) {
+    double capacity = static_cast<double>(config_.burst_bytes);
+    if (rate_ <= 0) {
+        tokens_ = capacity;
+    } else {
+        double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+        tokens_ = std::min(capacity, tokens_ + elapsed * rate_);
+    }
+    last_refill_ = now;
+}
+
+void IoScheduler::AdjustLocked(Clock::time_point now) {
+    auto interval = std::chrono::milliseconds(config_.adjust_interval_ms);
+    if (now - last_adjust_ < interval) {
+        return;
+    }
+    double seconds = std::chrono::duration<double>(now - last_adjust_).count();
+
+    // Foreground p99 over just this interval
+    auto foreground = foreground_.snapshot();
+    LatencyHistogram::Snapshot window;
+    for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+        window.buckets[i] = foreground.buckets[i] - last_foreground_.buckets[i];
+    }
+    window.count = foreground.count - last_foreground_.count;
+    last_foreground_ = foreground;
+    bool measured = window.count > 0 && window.count >= config_.min_samples;
+    uint64_t p99 = measured ? window.percentile_us(99) : 0;
+    foreground_p99_us_.store(p99, std::memory_order_relaxed);
+
+    if (config_.adaptive) {
+        double ceiling = static_cast<double>(config_.bytes_per_second);
+        if (measured && p99 > config_.foreground_p99_target_us) {
+            // Unlimited so far: back off from what background work was getting
+            double base = rate_ > 0 ? rate_ : interval_bytes_ / seconds;
+            if (base > 0) {
+                rate_ = std::max(static_cast<double>(config_.min_bytes_per_second),
+                                 base * config_.backoff_factor);
+                if (ceiling > 0) {
+                    rate_ = std::min(rate_, ceiling);
+                }
+                tokens_ = std::min(tokens_, rate_ * seconds);
+                backoffs_.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else if (rate_ > 0) {
+            if (ceiling == 0 && !interval_throttled_) {
+                rate_ = 0;  // The limit has stopped binding
+            } else {
+                rate_ *= 1.0 + config_.recovery_step;
+                if (ceiling > 0) {
+                    rate_ = std::min(rate_, ceiling);
+                }
+            }
+        }
+    }
+
+    interval_bytes_ = 0;
+    interval_throttled_ = false;
+    last_adjust_ = now;
+}
+
+void IoScheduler::Reconfigure(const Config& config) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        config_ = config;
+        rate_ = static_cast<double>(config.bytes_per_second);
+        auto now = Clock::now();
+        tokens_ = std::min(tokens_, static_cast<double>(config.burst_bytes));
+        last_refill_ = now;
+        last_adjust_ = now;
+        interval_bytes_ = 0;
+        interval_throttled_ = false;
+        last_foreground_ = foreground_.snapshot();
+    }
+    reconfigured_cv_.notify_all();
+}
+
+IoScheduler::Config IoScheduler::GetConfig() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_;
+}
+
+IoScheduler::Stats IoScheduler::GetStats() const {
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.configured_bytes_per_second = config_.bytes_per_second;
+        stats.effective_bytes_per_second = static_cast<uint64_t>(rate_);
+    }
+    stats.bytes_granted = bytes_granted_.load();
+    stats.requests = requests_.load();
+    stats.throttled_requests = throttled_requests_.load();
+    stats.throttled_us = throttled_us_.load();
+    stats.backoffs = backoffs_.load();
+    stats.foreground_p99_us = foreground_p99_us_.load();
+    stats.foreground_latency = foreground_.snapshot();
+    return stats;
+}
+
+} // namespace distcache
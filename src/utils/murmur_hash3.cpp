@@ -0,0 +1,77 @@
+#include "distcache/murmur_hash3.h"
+
+namespace distcache {
+
+// MurmurHash3 64-bit finalizer
+// Based on https://github.com/aappleby/smhasher/blob/master/src/MurmurHash3.cpp
+uint64_t murmur_hash3_64(const void* key, size_t len, uint32_t seed) {
+    const uint8_t* data = static_cast<const uint8_t*>(key);
+    const size_t nblocks = len / 8;
+
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+
+    // Body
+    const uint64_t* blocks = reinterpret_cast<const uint64_t*>(data);
+    for (size_t i = 0; i < nblocks; i++) {
+        uint64_t k1 = blocks[i];
+
+        k1 *= c1;
+        k1 = (k1 << 31) | (k1 >> (64 - 31));
+        k1 *= c2;
+
+        h1 ^= k1;
+        h1 = (h1 << 27) | (h1 >> (64 - 27));
+        h1 += h2;
+        h1 = h1 * 5 + 0x52dce729;
+
+        h2 = (h2 << 31) | (h2 >> (64 - 31));
+    }
+
+    // Tail
+    const uint8_t* tail = data + nblocks * 8;
+    uint64_t k1 = 0;
+
+    switch (len & 7) {
+        case 7: k1 ^= static_cast<uint64_t>(tail[6]) << 48; [[fallthrough]];
+        case 6: k1 ^= static_cast<uint64_t>(tail[5]) << 40; [[fallthrough]];
+        case 5: k1 ^= static_cast<uint64_t>(tail[4]) << 32; [[fallthrough]];
+        case 4: k1 ^= static_cast<uint64_t>(tail[3]) << 24; [[fallthrough]];
+        case 3: k1 ^= static_cast<uint64_t>(tail[2]) << 16; [[fallthrough]];
+        case 2: k1 ^= static_cast<uint64_t>(tail[1]) << 8;  [[fallthrough]];
+        case 1: k1 ^= static_cast<uint64_t>(tail[0]);
+                k1 *= c1;
+                k1 = (k1 << 31) | (k1 >> (64 - 31));
+                k1 *= c2;
+                h1 ^= k1;
+    }
+
+    // Finalization
+    h1 ^= len;
+    h2 ^= len;
+
+    h1 += h2;
+    h2 += h1;
+
+    // Fmix64
+    auto fmix64 = [](uint64_t k) -> uint64_t {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    };
+
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+
+    h1 += h2;
+
+    return h1;
+}
+
+} // namespace distcache
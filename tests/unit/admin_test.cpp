@@ -142,6 +142,66 @@ TEST_F(AdminServiceTest, GetMetrics) {
     EXPECT_TRUE(found_sets);
 }
 
+TEST_F(AdminServiceTest, IoThrottleRequiresAScheduler) {
+    grpc::ServerContext context;
+    distcache::v1::GetIoThrottleRequest request;
+    distcache::v1::IoThrottleResponse response;
+
+    auto status = admin->GetIoThrottle(&context, &request, &response);
+
+    EXPECT_TRUE(status.ok());
+    EXPECT_FALSE(response.success());
+    EXPECT_EQ(response.error(), "I/O scheduler not configured");
+}
+
+TEST_F(AdminServiceTest, SetIoThrottleUpdatesOnlyTheGivenFields) {
+    IoScheduler::Config config;
+    config.foreground_p99_target_us = 5000;
+    auto scheduler = std::make_shared<IoScheduler>(config);
+    admin->set_io_scheduler(scheduler);
+
+    grpc::ServerContext context;
+    distcache::v1::SetIoThrottleRequest request;
+    distcache::v1::IoThrottleResponse response;
+    request.set_bytes_per_second(50 * 1024 * 1024);
+    request.set_adaptive(false);
+
+    auto status = admin->SetIoThrottle(&context, &request, &response);
+
+    EXPECT_TRUE(status.ok());
+    EXPECT_TRUE(response.success());
+    EXPECT_EQ(response.bytes_per_second(), 50 * 1024 * 1024);
+    EXPECT_EQ(response.effective_bytes_per_second(), 50 * 1024 * 1024);
+    EXPECT_FALSE(response.adaptive());
+    EXPECT_EQ(response.foreground_p99_target_us(), 5000);
+    EXPECT_EQ(scheduler->GetConfig().bytes_per_second, 50u * 1024 * 1024);
+
+    // Invalid settings leave the budget alone
+    distcache::v1::SetIoThrottleRequest invalid;
+    invalid.set_bytes_per_second(-1);
+    response.Clear();
+    status = admin->SetIoThrottle(&context, &invalid, &response);
+    EXPECT_TRUE(status.ok());
+    EXPECT_FALSE(response.success());
+    EXPECT_EQ(scheduler->GetConfig().bytes_per_second, 50u * 1024 * 1024);
+
+    // Throttled time shows up in the metrics
+    scheduler->Acquire(1024);
+    distcache::v1::MetricsRequest metrics_request;
+    distcache::v1::MetricsResponse metrics_response;
+    admin->GetMetrics(&context, &metrics_request, &metrics_response);
+    bool found_throttled = false;
+    for (const auto& metric : metrics_response.metrics()) {
+        if (metric.name() == "io_throttled_seconds_total") {
+            found_throttled = true;
+        }
+        if (metric.name() == "io_background_bytes_total") {
+            EXPECT_EQ(metric.value(), 1024.0);
+        }
+    }
+    EXPECT_TRUE(found_throttled);
+}
+
 TEST_F(AdminServiceTest, NodeStateToString) {
     EXPECT_EQ(node_state_to_string(NodeState::HEALTHY), "healthy");
     EXPECT_EQ(node_state_to_string(NodeState::DRAINING), "draining");
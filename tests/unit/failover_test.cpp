@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include "distcache/failover_manager.h"
+#include "distcache/commit_log.h"
+#include "distcache/io_scheduler.h"
 #include "distcache/snapshot_manager.h"
+#include "distcache/snapshot_format.h"
 #include "distcache/hash_ring.h"
 #include "distcache/storage_engine.h"
 #include "distcache/sharding_client.h"
@@ -9,6 +12,10 @@
 #include <thread>
 #include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <grpcpp/grpcpp.h>
 
 using namespace distcache;
 
@@ -303,6 +310,447 @@ TEST_F(SnapshotManagerTest, RestoreFromSnapshotRestoresData) {
     EXPECT_EQ(restored_entry->key, "restore_key");
 }
 
+TEST_F(SnapshotManagerTest, SnapshotRecordsWALSequence) {
+    EXPECT_EQ(manager_->GetSnapshotMetadata(manager_->CreateSnapshot())->wal_sequence, 0);
+
+    manager_->SetSequenceSource([] { return int64_t{42}; });
+    std::string snapshot_id = manager_->CreateSnapshot();
+    ASSERT_FALSE(snapshot_id.empty());
+    EXPECT_EQ(manager_->GetSnapshotMetadata(snapshot_id)->wal_sequence, 42);
+
+    // The sequence is stored in the file and survives a restart
+    SnapshotManager::Config config;
+    config.node_id = "test_node";
+    config.snapshot_dir = snapshot_dir_;
+    SnapshotManager reloaded(config, storage_, metrics_);
+    auto metadata = reloaded.GetSnapshotMetadata(snapshot_id);
+    ASSERT_TRUE(metadata.has_value());
+    EXPECT_EQ(metadata->wal_sequence, 42);
+    EXPECT_TRUE(reloaded.RestoreFromSnapshot(snapshot_id));
+}
+
+TEST_F(SnapshotManagerTest, IOUringSnapshotRoundTrip) {
+    // Falls back to POSIX I/O where io_uring is unavailable
+    SnapshotManager::Config config;
+    config.node_id = "test_node";
+    config.snapshot_dir = snapshot_dir_;
+    config.use_io_uring = true;
+    // The fixture's table is capped at 1MB; this one holds every key
+    auto storage = std::make_shared<ShardedHashTable>(16, 64 * 1024 * 1024);
+    SnapshotManager manager(config, storage, metrics_);
+
+    // Large enough to span several write and read chunks
+    for (int i = 0; i < 3000; ++i) {
+        std::string key = "ring_key_" + std::to_string(i);
+        storage->set(key, CacheEntry(key, std::vector<uint8_t>(900, static_cast<uint8_t>(i)), 600));
+    }
+    std::string snapshot_id = manager.CreateSnapshot();
+    ASSERT_FALSE(snapshot_id.empty());
+
+    storage->clear();
+    ASSERT_TRUE(manager.RestoreFromSnapshot(snapshot_id));
+    EXPECT_EQ(storage->size(), 3000u);
+    auto entry = storage->get("ring_key_2999");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->value, std::vector<uint8_t>(900, static_cast<uint8_t>(2999)));
+    EXPECT_EQ(entry->ttl_seconds, 600);
+
+    // Files written either way read back either way
+    SnapshotManager::Config posix_config = config;
+    posix_config.use_io_uring = false;
+    SnapshotManager posix(posix_config, storage, metrics_);
+    storage->clear();
+    ASSERT_TRUE(posix.RestoreFromSnapshot(snapshot_id));
+    EXPECT_EQ(storage->size(), 3000u);
+}
+
+TEST_F(SnapshotManagerTest, ChunkedSnapshotRoundTripsWithAndWithoutCompression) {
+    auto storage = std::make_shared<ShardedHashTable>(8, 64 * 1024 * 1024);
+    for (int i = 0; i < 2000; ++i) {
+        std::string key = "chunk_key_" + std::to_string(i);
+        // Repetitive values so compression has something to remove
+        storage->set(key, CacheEntry(key, std::vector<uint8_t>(200, static_cast<uint8_t>(i % 7)),
+                                     i % 2 ? std::optional<int32_t>(600) : std::nullopt));
+    }
+
+    for (bool compress : {false, true}) {
+        SnapshotManager::Config config;
+        config.node_id = compress ? "compressed" : "raw";
+        config.snapshot_dir = snapshot_dir_;
+        config.enable_compression = compress;
+        config.chunk_size = 100;  // Several chunks per shard
+        config.snapshot_threads = 3;
+        SnapshotManager manager(config, storage, metrics_);
+
+        std::string snapshot_id = manager.CreateSnapshot();
+        ASSERT_FALSE(snapshot_id.empty());
+        auto metadata = manager.GetSnapshotMetadata(snapshot_id);
+        ASSERT_TRUE(metadata.has_value());
+        EXPECT_EQ(metadata->num_keys, 2000u);
+
+        // Every shard is present and no chunk exceeds the key limit
+        snapshot_format::Footer footer;
+        std::vector<snapshot_format::ChunkInfo> chunks;
+        ASSERT_TRUE(snapshot_format::ReadIndex(metadata->file_path, footer, &chunks));
+        EXPECT_EQ(footer.num_keys, 2000u);
+        EXPECT_EQ(footer.shard_count, 8u);
+        EXPECT_GE(chunks.size(), 24u);
+        std::set<uint32_t> shards;
+        for (const auto& chunk : chunks) {
+            EXPECT_LE(chunk.num_entries, 100u);
+            shards.insert(chunk.shard);
+            if (!compress) {
+                EXPECT_EQ(chunk.codec, compression::Codec::kNone);
+            }
+        }
+        EXPECT_EQ(shards.size(), 8u);
+        if (compress && compression::DefaultCodec() != compression::Codec::kNone) {
+            EXPECT_LT(metadata->total_bytes, 2000u * 200u);
+        }
+
+        auto target = std::make_shared<ShardedHashTable>(8, 64 * 1024 * 1024);
+        SnapshotManager restorer(config, target, metrics_);
+        ASSERT_TRUE(restorer.RestoreFromSnapshot(snapshot_id));
+        EXPECT_EQ(target->size(), 2000u);
+        auto entry = target->get("chunk_key_1999");
+        ASSERT_TRUE(entry.has_value());
+        EXPECT_EQ(entry->value, std::vector<uint8_t>(200, static_cast<uint8_t>(1999 % 7)));
+        EXPECT_EQ(entry->ttl_seconds, 600);
+        EXPECT_FALSE(target->get("chunk_key_1998")->ttl_seconds.has_value());
+    }
+}
+
+TEST_F(SnapshotManagerTest, ParallelRestoreLoadsEveryChunk) {
+    auto source = std::make_shared<ShardedHashTable>(16, 64 * 1024 * 1024);
+    for (int i = 0; i < 5000; ++i) {
+        std::string key = "parallel_" + std::to_string(i);
+        source->set(key, CacheEntry(key, std::vector<uint8_t>(64, static_cast<uint8_t>(i))));
+    }
+
+    SnapshotManager::Config config;
+    config.node_id = "test_node";
+    config.snapshot_dir = snapshot_dir_;
+    config.chunk_size = 50;
+    config.restore_threads = 4;
+    SnapshotManager writer(config, source, metrics_);
+    std::string snapshot_id = writer.CreateSnapshot();
+    ASSERT_FALSE(snapshot_id.empty());
+
+    // A different shard count spreads each chunk over several shards
+    for (size_t shards : {16u, 5u}) {
+        auto target = std::make_shared<ShardedHashTable>(shards, 64 * 1024 * 1024);
+        SnapshotManager restorer(config, target, metrics_);
+        ASSERT_TRUE(restorer.RestoreFromSnapshot(snapshot_id));
+        EXPECT_EQ(target->size(), 5000u);
+        EXPECT_EQ(restorer.GetStats().last_restore_keys, 5000u);
+        for (int i : {0, 2500, 4999}) {
+            auto entry = target->get("parallel_" + std::to_string(i));
+            ASSERT_TRUE(entry.has_value());
+            EXPECT_EQ(entry->value, std::vector<uint8_t>(64, static_cast<uint8_t>(i)));
+        }
+    }
+}
+
+TEST_F(SnapshotManagerTest, SnapshotIoIsChargedToTheIoScheduler) {
+    auto source = std::make_shared<ShardedHashTable>(16, 64 * 1024 * 1024);
+    for (int i = 0; i < 5000; ++i) {
+        std::string key = "throttled_" + std::to_string(i);
+        source->set(key, CacheEntry(key, std::vector<uint8_t>(64, static_cast<uint8_t>(i))));
+    }
+
+    SnapshotManager::Config config;
+    config.node_id = "test_node";
+    config.snapshot_dir = snapshot_dir_;
+    config.chunk_size = 50;
+    config.enable_compression = false;
+    auto scheduler = std::make_shared<IoScheduler>();
+    SnapshotManager writer(config, source, metrics_);
+    writer.SetIoScheduler(scheduler);
+
+    // Every chunk is charged; only the header lines and index are not
+    auto first_id = writer.CreateSnapshot();
+    ASSERT_FALSE(first_id.empty());
+    uint64_t charged = scheduler->GetStats().bytes_granted;
+    auto file_size = std::filesystem::file_size(writer.GetSnapshotMetadata(first_id)->file_path);
+    EXPECT_GT(charged, file_size * 9 / 10);
+    EXPECT_LT(charged, file_size);
+    EXPECT_EQ(writer.GetStats().io_throttled_ms, 0u);
+
+    // At a quarter of the snapshot per second, the next one waits
+    IoScheduler::Config io;
+    io.bytes_per_second = charged * 4;
+    io.burst_bytes = charged / 8;
+    io.adaptive = false;
+    scheduler->Reconfigure(io);
+    auto snapshot_id = writer.CreateSnapshot();
+    ASSERT_FALSE(snapshot_id.empty());
+    EXPECT_GE(writer.GetStats().io_throttled_ms, 100u);
+
+    // Restores read through the same budget
+    auto target = std::make_shared<ShardedHashTable>(16, 64 * 1024 * 1024);
+    SnapshotManager restorer(config, target, metrics_);
+    restorer.SetIoScheduler(scheduler);
+    ASSERT_TRUE(restorer.RestoreFromSnapshot(snapshot_id));
+    EXPECT_EQ(target->size(), 5000u);
+    EXPECT_GE(restorer.GetStats().io_throttled_ms, 100u);
+    EXPECT_EQ(scheduler->GetStats().bytes_granted, 3 * charged);
+}
+
+TEST_F(SnapshotManagerTest, SnapshotWithCorruptIndexIsRejected) {
+    for (int i = 0; i < 100; ++i) {
+        storage_->set("key" + std::to_string(i), CacheEntry("key" + std::to_string(i), {1, 2, 3}));
+    }
+    std::string snapshot_id = manager_->CreateSnapshot();
+    ASSERT_FALSE(snapshot_id.empty());
+    auto path = manager_->GetSnapshotMetadata(snapshot_id)->file_path;
+
+    // Cut into the footer, as a crash mid-write would
+    auto size = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, size - 8);
+
+    storage_->clear();
+    EXPECT_FALSE(manager_->RestoreFromSnapshot(snapshot_id));
+    EXPECT_EQ(storage_->size(), 0u);
+
+    // A restarted manager does not offer it for restore
+    manager_.reset();
+    SnapshotManager::Config config;
+    config.node_id = "test_node";
+    config.snapshot_dir = snapshot_dir_;
+    SnapshotManager reloaded(config, storage_, metrics_);
+    EXPECT_FALSE(reloaded.GetSnapshotMetadata(snapshot_id).has_value());
+}
+
+TEST_F(SnapshotManagerTest, CorruptChunksAreSkippedAndReported) {
+    SnapshotManager::Config config;
+    config.node_id = "test_node";
+    config.snapshot_dir = snapshot_dir_;
+    config.chunk_size = 50;
+    config.enable_compression = false;
+    auto source = std::make_shared<ShardedHashTable>(4, 64 * 1024 * 1024);
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = "key" + std::to_string(i);
+        source->set(key, CacheEntry(key, std::vector<uint8_t>(32, 7)));
+    }
+    SnapshotManager writer(config, source, metrics_);
+    std::string snapshot_id = writer.CreateSnapshot();
+    ASSERT_FALSE(snapshot_id.empty());
+    auto metadata = writer.GetSnapshotMetadata(snapshot_id);
+    EXPECT_EQ(metadata->checksum.size(), 8u);
+
+    snapshot_format::Footer footer;
+    std::vector<snapshot_format::ChunkInfo> chunks;
+    ASSERT_TRUE(snapshot_format::ReadIndex(metadata->file_path, footer, &chunks));
+    ASSERT_TRUE(footer.checksummed);
+    ASSERT_GT(chunks.size(), 3u);
+
+    // Flip the last payload byte of one chunk; it still decodes
+    const auto& damaged = chunks[3];
+    {
+        std::fstream file(metadata->file_path, std::ios::in | std::ios::out | std::ios::binary);
+        auto pos = static_cast<std::streamoff>(damaged.offset + snapshot_format::kChunkHeaderSize +
+                                               damaged.stored_size - 1);
+        file.seekg(pos);
+        char byte = static_cast<char>(file.get());
+        file.seekp(pos);
+        file.put(static_cast<char>(byte ^ 0x01));
+    }
+
+    // The restore goes on without the damaged chunk and reports it
+    auto target = std::make_shared<ShardedHashTable>(4, 64 * 1024 * 1024);
+    SnapshotManager restorer(config, target, metrics_);
+    EXPECT_EQ(restorer.GetSnapshotMetadata(snapshot_id)->checksum, metadata->checksum);
+    ASSERT_TRUE(restorer.RestoreFromSnapshot(snapshot_id));
+    EXPECT_EQ(target->size(), 1000u - damaged.num_entries);
+    EXPECT_EQ(restorer.GetStats().last_restore_corrupt_chunks, 1u);
+
+    // Without verification it goes undetected
+    target->clear();
+    ASSERT_TRUE(restorer.RestoreFromSnapshot(snapshot_id, false));
+    EXPECT_EQ(target->size(), 1000u);
+    EXPECT_EQ(restorer.GetStats().last_restore_corrupt_chunks, 0u);
+    EXPECT_EQ(restorer.GetStats().total_corrupt_chunks, 1u);
+}
+
+TEST_F(SnapshotManagerTest, DigestCoversTheHeaderLines) {
+    storage_->set("key", CacheEntry("key", {1, 2, 3}));
+    manager_->SetSequenceSource([] { return int64_t{5}; });
+    std::string snapshot_id = manager_->CreateSnapshot();
+    ASSERT_FALSE(snapshot_id.empty());
+    auto path = manager_->GetSnapshotMetadata(snapshot_id)->file_path;
+
+    // Rewrite the WAL sequence, which no chunk checksum covers
+    std::string contents;
+    {
+        std::ifstream in(path, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    auto pos = contents.find("\n5\n");
+    ASSERT_NE(pos, std::string::npos);
+    contents[pos + 1] = '9';
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+
+    storage_->clear();
+    EXPECT_FALSE(manager_->RestoreFromSnapshot(snapshot_id));
+    EXPECT_EQ(storage_->size(), 0u);
+}
+
+TEST_F(SnapshotManagerTest, DeltaSnapshotsChainOntoTheirBase) {
+    SnapshotManager::Config config;
+    config.node_id = "test_node";
+    config.snapshot_dir = snapshot_dir_;
+    config.delta_interval_seconds = 3600;  // Tracks deletes; the worker is not started
+    auto storage = std::make_shared<ShardedHashTable>(8, 64 * 1024 * 1024);
+    SnapshotManager manager(config, storage, metrics_);
+
+    // Written well before the base, so deltas leave them out
+    int64_t a_minute_ago = CacheEntry::get_current_time_ms() - 60000;
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = "key_" + std::to_string(i);
+        CacheEntry entry(key, {1});
+        entry.modified_at_ms = a_minute_ago;
+        storage->set(key, std::move(entry));
+    }
+    std::string base_id = manager.CreateSnapshot();
+    ASSERT_FALSE(base_id.empty());
+
+    for (int i = 0; i < 10; ++i) {
+        storage->set("key_" + std::to_string(i), CacheEntry("key_" + std::to_string(i), {2}));
+    }
+    for (int i = 10; i < 15; ++i) {
+        storage->del("key_" + std::to_string(i));
+    }
+    storage->set("new_a", CacheEntry("new_a", {3}));
+    storage->set("new_b", CacheEntry("new_b", {3}));
+
+    std::string first_id = manager.CreateDeltaSnapshot();
+    ASSERT_FALSE(first_id.empty());
+    auto first = manager.GetSnapshotMetadata(first_id);
+    ASSERT_TRUE(first->is_delta());
+    EXPECT_EQ(first->base_id, base_id);
+    EXPECT_EQ(first->num_keys, 12u);
+
+    snapshot_format::Footer footer;
+    std::vector<snapshot_format::ChunkInfo> chunks;
+    ASSERT_TRUE(snapshot_format::ReadIndex(first->file_path, footer, &chunks));
+    size_t tombstones = 0;
+    for (const auto& chunk : chunks) {
+        tombstones += chunk.tombstones ? chunk.num_entries : 0;
+    }
+    EXPECT_EQ(tombstones, 5u);
+
+    // A second delta deletes a key the first one added
+    storage->del("new_a");
+    std::string second_id = manager.CreateDeltaSnapshot();
+    ASSERT_FALSE(second_id.empty());
+    EXPECT_EQ(manager.GetSnapshotMetadata(second_id)->base_id, first_id);
+    EXPECT_EQ(manager.GetStats().total_deltas_created, 2u);
+
+    auto check = [](ShardedHashTable& table) {
+        EXPECT_EQ(table.size(), 996u);
+        EXPECT_EQ(table.get("key_0")->value, std::vector<uint8_t>({2}));
+        EXPECT_EQ(table.get("key_999")->value, std::vector<uint8_t>({1}));
+        EXPECT_FALSE(table.get("key_12").has_value());
+        EXPECT_FALSE(table.get("new_a").has_value());
+        EXPECT_TRUE(table.get("new_b").has_value());
+    };
+
+    // Restoring the head restores the whole chain, also after a restart
+    auto target = std::make_shared<ShardedHashTable>(8, 64 * 1024 * 1024);
+    SnapshotManager reloaded(config, target, metrics_);
+    ASSERT_TRUE(reloaded.RestoreFromLatest());
+    check(*target);
+
+    // Folding the chain gives a base that restores on its own
+    std::string merged_id = reloaded.MergeDeltaChain();
+    ASSERT_FALSE(merged_id.empty());
+    auto merged = reloaded.GetSnapshotMetadata(merged_id);
+    EXPECT_FALSE(merged->is_delta());
+    EXPECT_EQ(merged->num_keys, 996u);
+    EXPECT_EQ(reloaded.MergeDeltaChain(), "");  // Nothing left to fold
+
+    auto from_merged = std::make_shared<ShardedHashTable>(8, 64 * 1024 * 1024);
+    SnapshotManager restorer(config, from_merged, metrics_);
+    ASSERT_TRUE(restorer.RestoreFromSnapshot(merged_id));
+    check(*from_merged);
+
+    // Retention drops the old base together with its deltas
+    SnapshotManager::Config keep_one = config;
+    keep_one.max_snapshots_retained = 1;
+    SnapshotManager pruner(keep_one, from_merged, metrics_);
+    pruner.PruneOldSnapshots();
+    auto remaining = pruner.ListSnapshots();
+    ASSERT_EQ(remaining.size(), 1u);
+    EXPECT_EQ(remaining[0].snapshot_id, merged_id);
+    EXPECT_FALSE(std::filesystem::exists(first->file_path));
+}
+
+TEST_F(SnapshotManagerTest, LazyRestoreServesWhileTheChainLoads) {
+    SnapshotManager::Config config;
+    config.node_id = "test_node";
+    config.snapshot_dir = snapshot_dir_;
+    config.delta_interval_seconds = 3600;
+    auto storage = std::make_shared<ShardedHashTable>(8, 64 * 1024 * 1024);
+    SnapshotManager manager(config, storage, metrics_);
+
+    int64_t a_minute_ago = CacheEntry::get_current_time_ms() - 60000;
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = "key_" + std::to_string(i);
+        CacheEntry entry(key, {1});
+        entry.modified_at_ms = a_minute_ago;
+        storage->set(key, std::move(entry));
+    }
+    ASSERT_FALSE(manager.CreateSnapshot().empty());
+    storage->set("key_0", CacheEntry("key_0", {2}));
+    storage->del("key_1");
+    std::string head_id = manager.CreateDeltaSnapshot();
+    ASSERT_FALSE(head_id.empty());
+
+    // Serving starts before any shard is loaded; writes win over the chain.
+    // A starved I/O budget holds the background loader back meanwhile
+    IoScheduler::Config io;
+    io.bytes_per_second = 1;
+    io.burst_bytes = 1;
+    io.adaptive = false;
+    auto scheduler = std::make_shared<IoScheduler>(io);
+    auto target = std::make_shared<ShardedHashTable>(8, 64 * 1024 * 1024);
+    SnapshotManager restorer(config, target, metrics_);
+    restorer.SetIoScheduler(scheduler);
+    ASSERT_TRUE(restorer.BeginLazyRestore(head_id));
+    EXPECT_FALSE(restorer.BeginLazyRestore(head_id));  // One at a time
+    target->set("key_2", CacheEntry("key_2", {3}));
+    target->discard("key_3");
+
+    EXPECT_EQ(target->get("key_0")->value, std::vector<uint8_t>({2}));
+    EXPECT_FALSE(target->get("key_1").has_value());
+    EXPECT_EQ(target->get("key_2")->value, std::vector<uint8_t>({3}));
+    EXPECT_FALSE(target->get("key_3").has_value());
+    EXPECT_EQ(target->get("key_999")->value, std::vector<uint8_t>({1}));
+
+    io.bytes_per_second = 0;
+    scheduler->Reconfigure(io);
+    restorer.WaitForLazyRestore();
+    EXPECT_EQ(target->shards_pending_load(), 0u);
+    EXPECT_EQ(target->size(), 998u);
+
+    auto stats = restorer.GetStats();
+    EXPECT_EQ(stats.lazy_shards_pending, 0u);
+    EXPECT_EQ(stats.lazy_shards_faulted + stats.lazy_shards_background, 8u);
+    EXPECT_GT(stats.lazy_restore_ms, 0);
+    EXPECT_EQ(stats.total_restores, 1u);
+
+    // Chunks only map onto a table with the snapshot's shard count
+    auto resharded = std::make_shared<ShardedHashTable>(16, 64 * 1024 * 1024);
+    SnapshotManager mismatched(config, resharded, metrics_);
+    EXPECT_FALSE(mismatched.BeginLazyRestore(head_id));
+    EXPECT_EQ(resharded->shards_pending_load(), 0u);
+    ASSERT_TRUE(mismatched.RestoreFromSnapshot(head_id));
+    EXPECT_EQ(resharded->size(), 999u);
+}
+
 TEST_F(SnapshotManagerTest, RestoreFromNonExistentSnapshotFails) {
     bool restored = manager_->RestoreFromSnapshot("non-existent");
     EXPECT_FALSE(restored);
@@ -388,3 +836,152 @@ TEST_F(SnapshotManagerTest, SnapshotPreservesDataIntegrity) {
         EXPECT_EQ(entry->version, i);
     }
 }
+
+// ====================
+// Snapshot Bootstrap Tests
+// ====================
+
+TEST_F(SnapshotManagerTest, BootstrapShipsSnapshotChainAndLogTail) {
+    SnapshotManager::Config config;
+    config.node_id = "donor";
+    config.snapshot_dir = snapshot_dir_;
+    config.chunk_size = 100;
+    config.delta_interval_seconds = 3600;  // Tracks deletes for the delta
+    auto donor_storage = std::make_shared<ShardedHashTable>(8, 64 * 1024 * 1024);
+    auto snapshots = std::make_shared<SnapshotManager>(config, donor_storage, metrics_);
+    auto log = std::make_shared<CommitLog>();
+    snapshots->SetSequenceSource([log] { return log->ReadableSequence(); });
+
+    // Every write goes to the table and the log, as the WAL would do it
+    auto set = [&](const std::string& key, uint8_t value) {
+        donor_storage->set(key, CacheEntry(key, {value}));
+        CommitLog::Record record;
+        record.key = key;
+        record.value = std::string(1, static_cast<char>(value));
+        log->Append(std::move(record));
+    };
+    auto del = [&](const std::string& key) {
+        donor_storage->del(key);
+        CommitLog::Record record;
+        record.op = CommitLog::Record::Op::DELETE;
+        record.key = key;
+        log->Append(std::move(record));
+    };
+
+    for (int i = 0; i < 3000; ++i) {
+        set("key_" + std::to_string(i), 1);
+    }
+    ASSERT_FALSE(snapshots->CreateSnapshot().empty());
+    for (int i = 0; i < 20; ++i) {
+        del("key_" + std::to_string(i));
+    }
+    ASSERT_FALSE(snapshots->CreateDeltaSnapshot().empty());
+
+    // A replica has everything up to the delta, so the log keeps only what follows
+    log->Acknowledge("replica", log->ReadableSequence());
+
+    // Written after the last snapshot: only the log tail has them
+    for (int i = 0; i < 200; ++i) {
+        set("tail_" + std::to_string(i), 2);
+    }
+    del("key_20");
+    set("key_21", 3);
+    const int64_t last_sequence = log->ReadableSequence();
+
+    FailoverServiceImpl service(nullptr, donor_storage, metrics_, snapshots, log);
+    int port = 0;
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+    builder.RegisterService(&service);
+    auto server = builder.BuildAndStart();
+    ASSERT_NE(server, nullptr);
+    const std::string address = "127.0.0.1:" + std::to_string(port);
+
+    // Once as a member owning part of the ring, once before joining it
+    for (bool member : {true, false}) {
+        auto ring = std::make_shared<HashRing>(1, 50);
+        ring->add_node(Node{"donor", address});
+        ring->add_node(Node{"other", "127.0.0.1:1"});
+        if (member) {
+            ring->add_node(Node{"joiner", "127.0.0.1:2"});
+        }
+
+        FailoverManager::Config joiner_config;
+        joiner_config.node_id = "joiner";
+        joiner_config.replication_factor = 1;
+        joiner_config.bootstrap_apply_threads = 3;
+        auto storage = std::make_shared<ShardedHashTable>(8, 64 * 1024 * 1024);
+        FailoverManager joiner(joiner_config, ring, storage, nullptr, metrics_);
+
+        auto result = joiner.BootstrapFromPeer(address);
+        ASSERT_TRUE(result.success) << result.error;
+        EXPECT_GT(result.snapshot_chunks, 0u);
+        EXPECT_EQ(result.last_sequence, last_sequence);
+        EXPECT_GT(result.tail_entries, 0u);
+
+        // Exactly the donor's keys that the joiner owns
+        size_t expected = 0;
+        donor_storage->for_each([&](const std::string& key, const CacheEntry& entry) {
+            auto owner = ring->get_node(key);
+            if (!member || owner->id == "joiner") {
+                auto copy = storage->get(key);
+                EXPECT_TRUE(copy.has_value()) << key;
+                if (copy) {
+                    EXPECT_EQ(copy->value, entry.value) << key;
+                }
+                expected++;
+            }
+            return true;
+        });
+        EXPECT_EQ(storage->size(), expected);
+        if (member) {
+            EXPECT_LT(expected, donor_storage->size());
+        }
+        for (const char* key : {"key_0", "key_19", "key_20"}) {
+            EXPECT_FALSE(storage->get(key).has_value()) << key;
+        }
+    }
+
+    // The log is no longer held for the bootstrap
+    log->Acknowledge("replica", last_sequence);
+    EXPECT_EQ(log->GetStats().retained_records, 0u);
+    server->Shutdown();
+}
+
+TEST_F(SnapshotManagerTest, BootstrapIsRefusedWithoutACommitLog) {
+    SnapshotManager::Config config;
+    config.node_id = "donor";
+    config.snapshot_dir = snapshot_dir_;
+    auto donor_storage = std::make_shared<ShardedHashTable>(8, 64 * 1024 * 1024);
+    auto snapshots = std::make_shared<SnapshotManager>(config, donor_storage, metrics_);
+    for (int i = 0; i < 100; ++i) {
+        std::string key = "key_" + std::to_string(i);
+        donor_storage->set(key, CacheEntry(key, {1}));
+    }
+    ASSERT_FALSE(snapshots->CreateSnapshot().empty());
+
+    // Writes after the snapshot could not be sent, so none of it is
+    FailoverServiceImpl service(nullptr, donor_storage, metrics_, snapshots);
+    int port = 0;
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+    builder.RegisterService(&service);
+    auto server = builder.BuildAndStart();
+    ASSERT_NE(server, nullptr);
+    const std::string address = "127.0.0.1:" + std::to_string(port);
+
+    auto ring = std::make_shared<HashRing>(1, 50);
+    ring->add_node(Node{"donor", address});
+    FailoverManager::Config joiner_config;
+    joiner_config.node_id = "joiner";
+    joiner_config.replication_factor = 1;
+    auto storage = std::make_shared<ShardedHashTable>(8, 64 * 1024 * 1024);
+    FailoverManager joiner(joiner_config, ring, storage, nullptr, metrics_);
+
+    auto result = joiner.BootstrapFromPeer(address);
+    EXPECT_FALSE(result.success);
+    EXPECT_NE(result.error.find("commit log"), std::string::npos) << result.error;
+    EXPECT_EQ(storage->size(), 0u);
+    server->Shutdown();
+}
+
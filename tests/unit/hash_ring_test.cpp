@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <atomic>
 #include <cmath>
+#include <map>
 #include <numeric>
 #include <set>
 #include <thread>
@@ -227,6 +228,40 @@ TEST_F(HashRingTest, ReplicaOrderIsConsistent) {
     }
 }
 
+TEST_F(HashRingTest, OwnedRangesMatchReplicaPlacement) {
+    for (int i = 1; i <= 4; ++i) {
+        ring->add_node(Node("node" + std::to_string(i), "localhost:5005" + std::to_string(i)));
+    }
+
+    for (size_t n : {1u, 2u}) {
+        std::map<std::string, std::vector<HashRange>> ranges;
+        for (int i = 1; i <= 4; ++i) {
+            std::string id = "node" + std::to_string(i);
+            ranges[id] = ring->get_owned_ranges(id, n);
+            ASSERT_FALSE(ranges[id].empty());
+            for (size_t r = 1; r < ranges[id].size(); ++r) {
+                EXPECT_GT(ranges[id][r].first, ranges[id][r - 1].last + 1);  // Merged
+            }
+        }
+
+        // A key falls in a node's ranges exactly when it is one of its replicas
+        for (int k = 0; k < 2000; ++k) {
+            std::string key = "key_" + std::to_string(k);
+            std::set<std::string> replicas;
+            for (const auto& node : ring->get_replicas(key, n)) {
+                replicas.insert(node.id);
+            }
+            uint64_t position = HashRing::key_position(key);
+            for (const auto& [id, owned] : ranges) {
+                EXPECT_EQ(hash_ranges_contain(owned, position), replicas.count(id) > 0)
+                    << key << " on " << id << " with n=" << n;
+            }
+        }
+    }
+
+    EXPECT_TRUE(ring->get_owned_ranges("missing", 2).empty());
+}
+
 // ============================================================================
 // Distribution Quality Tests
 // ============================================================================
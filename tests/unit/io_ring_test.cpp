@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include "distcache/io_ring.h"
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+using namespace distcache;
+
+class IORingTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() /
+            ("distcache_io_ring_test_" + std::to_string(::getpid()) + "_" +
+             ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove_all(test_dir_);
+        std::filesystem::create_directories(test_dir_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    static std::string Pattern(size_t size) {
+        std::string data(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>((i * 131 + i / 4096) & 0xFF);
+        }
+        return data;
+    }
+
+    std::filesystem::path test_dir_;
+};
+
+// ====================
+// Ring Tests
+// ====================
+
+TEST_F(IORingTest, LinkedWriteAndFsyncThenRead) {
+    if (!IORing::IsSupported()) {
+        GTEST_SKIP() << "io_uring unavailable";
+    }
+
+    IORing ring;
+    ASSERT_TRUE(ring.Init(8));
+
+    auto path = test_dir_ / "data";
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    ASSERT_GE(fd, 0);
+
+    std::string data = Pattern(8192);
+    ASSERT_TRUE(ring.PrepareWrite(fd, data.data(), data.size(), 0, 1, -1, true));
+    ASSERT_TRUE(ring.PrepareFsync(fd, 2));
+    ASSERT_EQ(ring.Submit(), 2);
+
+    IORing::Completion completion;
+    ASSERT_TRUE(ring.WaitCompletion(completion));
+    EXPECT_EQ(completion.user_data, 1u);
+    EXPECT_EQ(completion.result, 8192);
+    ASSERT_TRUE(ring.WaitCompletion(completion));
+    EXPECT_EQ(completion.user_data, 2u);
+    EXPECT_EQ(completion.result, 0);
+
+    std::string read_back(4096, '\0');
+    ASSERT_TRUE(ring.PrepareRead(fd, &read_back[0], read_back.size(), 4096, 3));
+    ASSERT_EQ(ring.Submit(), 1);
+    ASSERT_TRUE(ring.WaitCompletion(completion));
+    EXPECT_EQ(completion.result, 4096);
+    EXPECT_EQ(read_back, data.substr(4096));
+
+    // Nothing left: a bounded wait times out
+    EXPECT_FALSE(ring.WaitCompletion(completion, std::chrono::microseconds(1000)));
+    ::close(fd);
+}
+
+TEST_F(IORingTest, RegisteredBufferWrite) {
+    if (!IORing::IsSupported()) {
+        GTEST_SKIP() << "io_uring unavailable";
+    }
+
+    IORing ring;
+    ASSERT_TRUE(ring.Init(4));
+
+    std::string buffer = Pattern(4096);
+    ASSERT_TRUE(ring.RegisterBuffers({iovec{&buffer[0], buffer.size()}}));
+
+    auto path = test_dir_ / "fixed";
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    ASSERT_GE(fd, 0);
+    ASSERT_TRUE(ring.PrepareWrite(fd, buffer.data() + 100, 1000, 0, 7, 0));
+    ASSERT_EQ(ring.Submit(), 1);
+
+    IORing::Completion completion;
+    ASSERT_TRUE(ring.WaitCompletion(completion));
+    EXPECT_EQ(completion.user_data, 7u);
+    EXPECT_EQ(completion.result, 1000);
+    ::close(fd);
+
+    std::string contents;
+    ASSERT_TRUE(ReadWholeFile(path, contents, false));
+    EXPECT_EQ(contents, buffer.substr(100, 1000));
+}
+
+TEST_F(IORingTest, FullSubmissionQueueRejectsMore) {
+    if (!IORing::IsSupported()) {
+        GTEST_SKIP() << "io_uring unavailable";
+    }
+
+    IORing ring;
+    ASSERT_TRUE(ring.Init(2));
+    int fd = ::open((test_dir_ / "full").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    ASSERT_GE(fd, 0);
+    for (unsigned i = 0; i < ring.sq_entries(); ++i) {
+        EXPECT_TRUE(ring.PrepareFsync(fd, i));
+    }
+    EXPECT_FALSE(ring.PrepareFsync(fd, 99));
+    EXPECT_EQ(ring.Submit(), static_cast<int>(ring.sq_entries()));
+
+    IORing::Completion completion;
+    for (unsigned i = 0; i < ring.sq_entries(); ++i) {
+        ASSERT_TRUE(ring.WaitCompletion(completion));
+    }
+    ::close(fd);
+}
+
+// ====================
+// File Helper Tests
+// ====================
+
+TEST_F(IORingTest, FileWriterAndReadWholeFileRoundTripOnBothBackends) {
+    std::string data = Pattern(300 * 1000 + 17);
+
+    for (bool use_io_uring : {false, true}) {
+        SCOPED_TRACE(use_io_uring ? "io_uring" : "posix");
+        auto path = test_dir_ / (use_io_uring ? "ring.bin" : "posix.bin");
+
+        FileWriter writer(use_io_uring, 8192, 3);
+        EXPECT_EQ(writer.uses_io_uring(), use_io_uring && IORing::IsSupported());
+        ASSERT_TRUE(writer.Open(path));
+        // Uneven appends straddle chunk boundaries
+        for (size_t offset = 0; offset < data.size(); offset += 1000) {
+            ASSERT_TRUE(writer.Append(data.data() + offset, std::min<size_t>(1000, data.size() - offset)));
+        }
+        EXPECT_EQ(writer.bytes_written(), data.size());
+        ASSERT_TRUE(writer.Finish(true));
+        EXPECT_EQ(std::filesystem::file_size(path), data.size());
+
+        for (bool read_with_ring : {false, true}) {
+            std::string contents;
+            ASSERT_TRUE(ReadWholeFile(path, contents, read_with_ring, 4096, 4));
+            EXPECT_EQ(contents, data);
+        }
+    }
+}
+
+TEST_F(IORingTest, ReadWholeFileHandlesEmptyAndMissingFiles) {
+    auto empty = test_dir_ / "empty";
+    FileWriter writer(true);
+    ASSERT_TRUE(writer.Open(empty));
+    ASSERT_TRUE(writer.Finish(false));
+
+    std::string contents = "stale";
+    EXPECT_TRUE(ReadWholeFile(empty, contents, true));
+    EXPECT_TRUE(contents.empty());
+    EXPECT_FALSE(ReadWholeFile(test_dir_ / "missing", contents, true));
+}
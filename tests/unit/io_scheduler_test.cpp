@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "distcache/io_scheduler.h"
+#include <chrono>
+#include <thread>
+
+using namespace distcache;
+
+namespace {
+
+constexpr uint64_t kMB = 1024 * 1024;
+
+// Feed one interval's worth of foreground samples, then let it close
+void RecordForegroundInterval(IoScheduler& scheduler, std::chrono::microseconds latency,
+                              std::chrono::milliseconds interval) {
+    for (int i = 0; i < 50; ++i) {
+        scheduler.RecordForeground(latency);
+    }
+    std::this_thread::sleep_for(interval + std::chrono::milliseconds(5));
+}
+
+} // namespace
+
+// ====================
+// Token Bucket Tests
+// ====================
+
+TEST(IoSchedulerTest, UnlimitedBudgetNeverWaits) {
+    IoScheduler scheduler;
+
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(scheduler.Acquire(64 * kMB).count(), 0);
+    }
+    auto stats = scheduler.GetStats();
+    EXPECT_EQ(stats.bytes_granted, 100 * 64 * kMB);
+    EXPECT_EQ(stats.requests, 100u);
+    EXPECT_EQ(stats.throttled_requests, 0u);
+    EXPECT_EQ(stats.effective_bytes_per_second, 0u);
+}
+
+TEST(IoSchedulerTest, BackgroundIoIsPacedToTheConfiguredRate) {
+    IoScheduler::Config config;
+    config.bytes_per_second = 10 * kMB;
+    config.burst_bytes = kMB;
+    config.adaptive = false;
+    IoScheduler scheduler(config);
+
+    // The first megabyte comes out of the full bucket, the rest at 10MB/s
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 12; ++i) {
+        scheduler.Acquire(256 * 1024);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(elapsed, std::chrono::milliseconds(150));
+    EXPECT_LT(elapsed, std::chrono::seconds(2));
+
+    auto stats = scheduler.GetStats();
+    EXPECT_EQ(stats.bytes_granted, 3 * kMB);
+    EXPECT_GT(stats.throttled_requests, 0u);
+    EXPECT_GE(stats.throttled_us, 100000u);
+
+    // Oversized requests wait for a full bucket rather than forever
+    scheduler.Acquire(4 * kMB);
+    EXPECT_EQ(scheduler.GetStats().bytes_granted, 7 * kMB);
+}
+
+TEST(IoSchedulerTest, ReconfigureReleasesWaitingCallers) {
+    IoScheduler::Config config;
+    config.bytes_per_second = 1024;  // Would take an hour for the request below
+    config.burst_bytes = 1024;
+    config.adaptive = false;
+    IoScheduler scheduler(config);
+    scheduler.Acquire(1024);
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread background([&] { scheduler.Acquire(4 * kMB); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    config.bytes_per_second = 0;
+    scheduler.Reconfigure(config);
+    background.join();
+
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+    EXPECT_EQ(scheduler.GetConfig().bytes_per_second, 0u);
+    EXPECT_EQ(scheduler.GetStats().throttled_requests, 1u);
+}
+
+// ====================
+// Adaptive Backoff Tests
+// ====================
+
+TEST(IoSchedulerTest, SlowForegroundBacksTheRateOffAndFastOneRestoresIt) {
+    IoScheduler::Config config;
+    config.bytes_per_second = 100 * kMB;
+    config.foreground_p99_target_us = 1000;
+    config.adjust_interval_ms = 20;
+    config.min_bytes_per_second = 10 * kMB;
+    IoScheduler scheduler(config);
+    const auto interval = std::chrono::milliseconds(config.adjust_interval_ms);
+
+    // p99 of 8ms against a 1ms target halves the rate, down to the floor
+    RecordForegroundInterval(scheduler, std::chrono::milliseconds(8), interval);
+    scheduler.Acquire(1);
+    auto stats = scheduler.GetStats();
+    EXPECT_EQ(stats.effective_bytes_per_second, 50 * kMB);
+    EXPECT_EQ(stats.backoffs, 1u);
+    EXPECT_GE(stats.foreground_p99_us, 8000u);
+
+    for (int i = 0; i < 5; ++i) {
+        RecordForegroundInterval(scheduler, std::chrono::milliseconds(8), interval);
+        scheduler.Acquire(1);
+    }
+    EXPECT_EQ(scheduler.GetStats().effective_bytes_per_second, 10 * kMB);
+
+    // Healthy intervals grow it back, never past the configured rate
+    RecordForegroundInterval(scheduler, std::chrono::microseconds(50), interval);
+    scheduler.Acquire(1);
+    EXPECT_EQ(scheduler.GetStats().effective_bytes_per_second, 11 * kMB);
+    for (int i = 0; i < 40; ++i) {
+        RecordForegroundInterval(scheduler, std::chrono::microseconds(50), interval);
+        scheduler.Acquire(1);
+    }
+    EXPECT_EQ(scheduler.GetStats().effective_bytes_per_second, 100 * kMB);
+}
+
+TEST(IoSchedulerTest, UnlimitedBudgetBacksOffFromObservedThroughput) {
+    IoScheduler::Config config;
+    config.foreground_p99_target_us = 1000;
+    config.adjust_interval_ms = 20;
+    config.min_bytes_per_second = kMB;
+    IoScheduler scheduler(config);
+    const auto interval = std::chrono::milliseconds(config.adjust_interval_ms);
+
+    // Background work runs flat out while requests slow down
+    for (int i = 0; i < 16; ++i) {
+        scheduler.Acquire(4 * kMB);
+    }
+    RecordForegroundInterval(scheduler, std::chrono::milliseconds(8), interval);
+    scheduler.Acquire(1);
+    auto stats = scheduler.GetStats();
+    EXPECT_EQ(stats.backoffs, 1u);
+    EXPECT_GE(stats.effective_bytes_per_second, kMB);
+    EXPECT_LE(stats.effective_bytes_per_second, 64 * kMB * 1000 / 20 / 2);
+
+    // Once latency recovers and the limit stops binding, it is lifted
+    RecordForegroundInterval(scheduler, std::chrono::microseconds(50), interval);
+    scheduler.Acquire(1);
+    EXPECT_EQ(scheduler.GetStats().effective_bytes_per_second, 0u);
+}
+
+TEST(IoSchedulerTest, ForegroundTimerRecordsOnlyWithAScheduler) {
+    IoScheduler scheduler;
+    {
+        ForegroundTimer timer(&scheduler);
+        ForegroundTimer ignored(nullptr);
+    }
+    EXPECT_EQ(scheduler.GetStats().foreground_latency.count, 1u);
+}
+
+TEST(IoSchedulerTest, StoppedForegroundTimerRecordsOnce) {
+    IoScheduler scheduler;
+    {
+        ForegroundTimer timer(&scheduler);
+        timer.Stop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));  // e.g. a WAL wait
+    }
+    auto latency = scheduler.GetStats().foreground_latency;
+    EXPECT_EQ(latency.count, 1u);
+    EXPECT_LT(latency.max_us, 20000u);
+}
@@ -3,8 +3,15 @@
 #include "distcache/storage_engine.h"
 #include "distcache/hash_ring.h"
 #include "distcache/metrics.h"
+#include "distcache/wal.h"
+#include <grpcpp/grpcpp.h>
+#include <filesystem>
 #include <thread>
 #include <chrono>
+#include <functional>
+#include <map>
+#include <set>
+#include <unistd.h>
 
 using namespace distcache;
 
@@ -95,6 +102,241 @@ TEST_F(ReplicationManagerTest, StartStop) {
     manager.Stop();
 }
 
+TEST_F(ReplicationManagerTest, LogShippingCatchesUpAReplicaThatWasDown) {
+    auto replica_storage = std::make_shared<ShardedHashTable>(16);
+    ReplicationServiceImpl service(replica_storage, metrics);
+
+    auto start_replica = [&](const std::string& address, int* selected_port) {
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort(address, grpc::InsecureServerCredentials(), selected_port);
+        builder.RegisterService(&service);
+        return builder.BuildAndStart();
+    };
+    int port = 0;
+    auto server = start_replica("127.0.0.1:0", &port);
+    ASSERT_NE(server, nullptr);
+    std::string address = "127.0.0.1:" + std::to_string(port);
+
+    // Two nodes with two copies: every key goes to node2
+    auto shipping_ring = std::make_shared<HashRing>(2, 150);
+    shipping_ring->add_node({"node1", "127.0.0.1:1"});
+    shipping_ring->add_node({"node2", address});
+
+    ReplicationManager::Config config;
+    config.node_id = "node1";
+    config.replication_factor = 2;
+    config.batch_size = 16;
+    config.batch_interval_ms = 10;
+    config.rpc_timeout_ms = 500;
+    auto log = std::make_shared<CommitLog>();
+    ReplicationManager manager(config, shipping_ring, metrics);
+    manager.AttachCommitLog(log);
+    manager.Start();
+
+    auto wait_until = [](const std::function<bool()>& done) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(15);
+        while (!done() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return done();
+    };
+
+    for (int i = 0; i < 50; i++) {
+        EXPECT_TRUE(manager.QueueWrite("key" + std::to_string(i), "v" + std::to_string(i), 0, i));
+    }
+    ASSERT_TRUE(wait_until([&] { return replica_storage->size() == 50; }));
+
+    // Writes made while the replica is down wait in the log
+    server->Shutdown(std::chrono::system_clock::now());
+    server->Wait();
+    server.reset();
+    for (int i = 50; i < 100; i++) {
+        EXPECT_TRUE(manager.QueueWrite("key" + std::to_string(i), "v" + std::to_string(i), 0, i));
+    }
+    EXPECT_TRUE(manager.QueueDelete("key0", 100));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_GT(manager.GetStats().queue_depth, 0u);
+    EXPECT_EQ(manager.GetStats().dropped_ops, 0u);
+
+    server = start_replica(address, nullptr);
+    ASSERT_NE(server, nullptr);
+    ASSERT_TRUE(wait_until([&] { return manager.GetStats().acked_sequence == 101; }));
+
+    EXPECT_EQ(replica_storage->size(), 99u);
+    EXPECT_FALSE(replica_storage->get("key0").has_value());
+    auto entry = replica_storage->get("key99");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(std::string(entry->value.begin(), entry->value.end()), "v99");
+    EXPECT_EQ(service.GetAppliedSequence("node1"), 101);
+    EXPECT_EQ(log->GetStats().retained_records, 0u);
+
+    manager.Stop();
+    server->Shutdown(std::chrono::system_clock::now());
+}
+
+TEST_F(ReplicationManagerTest, EachReplicaGetsExactlyTheKeysItHolds) {
+    struct Replica {
+        std::shared_ptr<ShardedHashTable> storage = std::make_shared<ShardedHashTable>(16);
+        std::unique_ptr<ReplicationServiceImpl> service;
+        std::unique_ptr<grpc::Server> server;
+    };
+    auto dispatch_ring = std::make_shared<HashRing>(2, 150);
+    dispatch_ring->add_node({"node1", "127.0.0.1:1"});
+    std::map<std::string, Replica> replicas;
+    for (const std::string id : {"node2", "node3"}) {
+        auto& replica = replicas[id];
+        replica.service = std::make_unique<ReplicationServiceImpl>(replica.storage, metrics);
+        int port = 0;
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(replica.service.get());
+        replica.server = builder.BuildAndStart();
+        ASSERT_NE(replica.server, nullptr);
+        dispatch_ring->add_node({id, "127.0.0.1:" + std::to_string(port)});
+    }
+    // Nothing listens here; its keys fail without holding the others up
+    dispatch_ring->add_node({"node4", "127.0.0.1:1"});
+
+    ReplicationManager::Config config;
+    config.node_id = "node1";
+    config.replication_factor = 2;
+    config.batch_size = 16;
+    config.batch_interval_ms = 10;
+    config.rpc_timeout_ms = 500;
+    ReplicationManager manager(config, dispatch_ring, metrics);
+    manager.Start();
+
+    std::map<std::string, std::set<std::string>> expected;
+    uint64_t deliveries = 0;
+    for (int i = 0; i < 300; i++) {
+        std::string key = "key" + std::to_string(i);
+        EXPECT_TRUE(manager.QueueWrite(key, "v" + std::to_string(i), 0, i));
+        for (const auto& node : dispatch_ring->get_replicas(key, 2)) {
+            if (node.id != "node1") {
+                expected[node.id].insert(key);
+                deliveries++;
+            }
+        }
+    }
+    ASSERT_FALSE(expected["node2"].empty());
+    ASSERT_FALSE(expected["node3"].empty());
+    ASSERT_FALSE(expected["node4"].empty());
+
+    auto wait_until = [](const std::function<bool()>& done) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(15);
+        while (!done() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return done();
+    };
+    ASSERT_TRUE(wait_until([&] {
+        auto stats = manager.GetStats();
+        return stats.replicated_ops + stats.failed_ops == deliveries;
+    }));
+
+    auto stats = manager.GetStats();
+    EXPECT_EQ(stats.failed_ops, expected["node4"].size());
+    EXPECT_EQ(stats.queue_depth, 0u);
+    EXPECT_EQ(stats.dropped_ops, 0u);
+    for (auto& [id, replica] : replicas) {
+        EXPECT_EQ(replica.storage->size(), expected[id].size()) << id;
+        for (const auto& key : expected[id]) {
+            EXPECT_TRUE(replica.storage->get(key).has_value()) << id << " " << key;
+        }
+    }
+
+    manager.Stop();
+    for (auto& [id, replica] : replicas) {
+        replica.server->Shutdown(std::chrono::system_clock::now());
+    }
+}
+
+TEST_F(ReplicationManagerTest, ReplicatedWritesAreNotShippedBack) {
+    // Two nodes, each logging every write it applies (its own and those
+    // replicated to it) to a WAL that feeds the commit log it ships from
+    struct Node {
+        std::filesystem::path dir;
+        std::shared_ptr<ShardedHashTable> storage = std::make_shared<ShardedHashTable>(16);
+        std::shared_ptr<CommitLog> log = std::make_shared<CommitLog>();
+        std::shared_ptr<WAL> wal;
+        std::unique_ptr<ReplicationServiceImpl> service;
+        std::unique_ptr<grpc::Server> server;
+        std::unique_ptr<ReplicationManager> manager;
+    };
+    std::map<std::string, Node> nodes;
+    auto echo_ring = std::make_shared<HashRing>(2, 150);
+    for (const std::string id : {"node1", "node2"}) {
+        auto& node = nodes[id];
+        node.dir = std::filesystem::temp_directory_path() /
+            ("distcache_echo_" + id + "_" + std::to_string(::getpid()));
+        std::filesystem::remove_all(node.dir);
+
+        WAL::Config wal_config;
+        wal_config.wal_dir = node.dir;
+        wal_config.node_id = id;
+        wal_config.sync_on_write = false;
+        node.wal = std::make_shared<WAL>(wal_config);
+        node.wal->AttachCommitLog(node.log);
+        node.wal->Open();
+        node.storage->set_mutation_listener(node.wal.get());
+
+        node.service = std::make_unique<ReplicationServiceImpl>(node.storage, metrics);
+        int port = 0;
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(node.service.get());
+        node.server = builder.BuildAndStart();
+        ASSERT_NE(node.server, nullptr);
+        echo_ring->add_node({id, "127.0.0.1:" + std::to_string(port)});
+    }
+    for (auto& [id, node] : nodes) {
+        ReplicationManager::Config config;
+        config.node_id = id;
+        config.replication_factor = 2;
+        config.batch_size = 16;
+        config.batch_interval_ms = 10;
+        config.rpc_timeout_ms = 500;
+        node.manager = std::make_unique<ReplicationManager>(config, echo_ring, metrics);
+        node.manager->AttachCommitLog(node.log);
+        node.manager->Start();
+    }
+
+    // Every key has a copy on both nodes
+    for (int i = 0; i < 20; i++) {
+        for (auto& [id, node] : nodes) {
+            std::string key = id + ":key" + std::to_string(i);
+            node.storage->set(key, CacheEntry(key, std::vector<uint8_t>{'v'}));
+        }
+    }
+
+    auto wait_until = [](const std::function<bool()>& done) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(15);
+        while (!done() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return done();
+    };
+    ASSERT_TRUE(wait_until([&] {
+        return nodes["node1"].storage->size() == 40 && nodes["node2"].storage->size() == 40;
+    }));
+
+    // Each node logged its 20 writes and the peer's 20, and sent only its own
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    for (auto& [id, node] : nodes) {
+        EXPECT_EQ(node.log->GetStats().records_appended, 40u) << id;
+        EXPECT_EQ(node.manager->GetStats().replicated_ops, 20u) << id;
+        EXPECT_EQ(node.service->GetStats().entries_applied, 20u) << id;
+    }
+
+    for (auto& [id, node] : nodes) {
+        node.manager->Stop();
+        node.server->Shutdown(std::chrono::system_clock::now());
+        node.storage->set_mutation_listener(nullptr);
+        node.wal->Close();
+        std::filesystem::remove_all(node.dir);
+    }
+}
+
 class ReplicationServiceTest : public ::testing::Test {
 protected:
     void SetUp() override {
@@ -223,3 +465,39 @@ TEST_F(ReplicationServiceTest, Statistics) {
     EXPECT_EQ(stats.entries_applied, 1);
     EXPECT_EQ(stats.last_applied_timestamp, 123456789);
 }
+
+TEST_F(ReplicationServiceTest, ResentLogEntriesAreSkipped) {
+    auto make_batch = [](int first, int last) {
+        v1::ReplicationBatch batch;
+        batch.set_source_node_id("node1");
+        for (int seq = first; seq <= last; seq++) {
+            auto* entry = batch.add_entries();
+            entry->set_op(v1::ReplicationEntry::SET);
+            entry->set_key("key" + std::to_string(seq));
+            entry->set_value("value" + std::to_string(seq));
+            entry->set_sequence(seq);
+        }
+        return batch;
+    };
+
+    v1::ReplicationAck ack;
+    grpc::ServerContext context;
+    auto batch = make_batch(1, 3);
+    ASSERT_TRUE(service->Replicate(&context, &batch, &ack).ok());
+    EXPECT_EQ(ack.last_applied_sequence(), 3);
+
+    // A retry after a lost ack overlaps what was already applied
+    storage->del("key2");
+    batch = make_batch(2, 4);
+    ASSERT_TRUE(service->Replicate(&context, &batch, &ack).ok());
+    EXPECT_TRUE(ack.success());
+    EXPECT_EQ(ack.last_applied_sequence(), 4);
+    EXPECT_FALSE(storage->get("key2").has_value());
+    EXPECT_TRUE(storage->get("key4").has_value());
+
+    auto stats = service->GetStats();
+    EXPECT_EQ(stats.entries_applied, 4u);
+    EXPECT_EQ(stats.entries_skipped, 2u);
+    EXPECT_EQ(service->GetAppliedSequence("node1"), 4);
+    EXPECT_EQ(service->GetAppliedSequence("other"), 0);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "distcache/request_pipeline.h"
+#include <memory>
+#include <string>
+#include <type_traits>
+
+using namespace distcache;
+
+using OpenPipeline = RequestPipeline<NoRateLimit, NoAuth, NoValidation, NoRequestLogging>;
+
+// Disabled stages carry no state
+static_assert(std::is_empty_v<NoRateLimit>);
+static_assert(std::is_empty_v<NoAuth>);
+static_assert(std::is_empty_v<NoValidation>);
+static_assert(std::is_empty_v<NoRequestLogging>);
+
+// ====================
+// Specialization Selection Tests
+// ====================
+
+TEST(RequestPipelineTest, DefaultOptionsSelectOpenPipeline) {
+    RequestPipelineOptions options;
+
+    bool open = MakeRequestPipeline(options, [](auto pipeline) {
+        return std::is_same_v<decltype(pipeline), OpenPipeline>;
+    });
+
+    EXPECT_TRUE(open);
+}
+
+TEST(RequestPipelineTest, OptionsSelectEnabledStages) {
+    RequestPipelineOptions options;
+    options.validator = std::make_shared<Validator>();
+    options.request_logging = true;
+
+    auto flags = MakeRequestPipeline(options, [](auto pipeline) {
+        using Pipeline = decltype(pipeline);
+        return std::string(Pipeline::kRateLimited ? "R" : "-") +
+               (Pipeline::kAuthenticated ? "A" : "-") +
+               (Pipeline::kValidated ? "V" : "-") +
+               (Pipeline::kLogged ? "L" : "-");
+    });
+
+    EXPECT_EQ(flags, "--VL");
+}
+
+// ====================
+// Stage Behavior Tests
+// ====================
+
+TEST(RequestPipelineTest, DisabledStagesNeverRunCallbacks) {
+    OpenPipeline pipeline(NoRateLimit{}, NoAuth{}, NoValidation{}, NoRequestLogging{});
+    grpc::ServerContext context;
+
+    bool checked = false;
+    bool logged = false;
+
+    EXPECT_TRUE(pipeline.admit(&context, Operation::WRITE, "Set").ok());
+    EXPECT_TRUE(pipeline.validate("SET", [&](const Validator&) {
+        checked = true;
+        return ValidationResult::error("should not run");
+    }).ok());
+    pipeline.log([&] { logged = true; });
+
+    EXPECT_FALSE(checked);
+    EXPECT_FALSE(logged);
+    EXPECT_EQ(pipeline.validator(), nullptr);
+}
+
+TEST(RequestPipelineTest, ValidationStageRejectsInvalidInput) {
+    RequestPipelineOptions options;
+    options.validator = std::make_shared<Validator>();
+
+    auto code = MakeRequestPipeline(options, [](auto pipeline) {
+        std::string long_key(1000, 'k');
+        return pipeline.validate("GET", [&](const Validator& v) {
+            return v.validate_key(long_key);
+        }).error_code();
+    });
+
+    EXPECT_EQ(code, grpc::INVALID_ARGUMENT);
+}
+
+TEST(RequestPipelineTest, RateLimitStageRejectsOverLimit) {
+    RateLimiter::Config config;
+    config.client_capacity = 1;
+    config.client_refill_rate = 0.001;
+
+    RequestPipelineOptions options;
+    options.rate_limiter = std::make_shared<RateLimiter>(config);
+
+    MakeRequestPipeline(options, [](auto pipeline) {
+        grpc::ServerContext context;
+        EXPECT_TRUE(pipeline.admit(&context, Operation::READ, "Get").ok());
+        EXPECT_EQ(pipeline.admit(&context, Operation::READ, "Get").error_code(),
+                  grpc::RESOURCE_EXHAUSTED);
+        return 0;
+    });
+}
+
+TEST(RequestPipelineTest, AuthStageRejectsMissingToken) {
+    RequestPipelineOptions options;
+    options.auth_manager = std::make_shared<AuthManager>(
+        std::make_shared<TokenValidator>("test_secret"));
+
+    MakeRequestPipeline(options, [](auto pipeline) {
+        grpc::ServerContext context;
+        EXPECT_EQ(pipeline.admit(&context, Operation::READ, "Get").error_code(),
+                  grpc::UNAUTHENTICATED);
+
+        bool can_read = true;
+        bool can_write = true;
+        EXPECT_EQ(pipeline.auth().resolve(&context, can_read, can_write).error_code(),
+                  grpc::UNAUTHENTICATED);
+        return 0;
+    });
+}
@@ -0,0 +1,383 @@
+#include "distcache/resp_server.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace distcache;
+
+// ============================================================================
+// Parser Tests
+// ============================================================================
+
+TEST(RespParserTest, ParsesMultibulk) {
+    std::string buffer = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n";
+    size_t offset = 0;
+    std::vector<std::string> args;
+    std::string error;
+
+    auto result = RespParser::Parse(buffer, offset, args, error, 1024);
+
+    ASSERT_EQ(result, RespParser::Result::OK);
+    EXPECT_EQ(offset, buffer.size());
+    ASSERT_EQ(args.size(), 3);
+    EXPECT_EQ(args[0], "SET");
+    EXPECT_EQ(args[1], "key");
+    EXPECT_EQ(args[2], "value");
+}
+
+TEST(RespParserTest, ParsesBinarySafeBulk) {
+    std::string value("a\r\nb\0c", 6);
+    std::string buffer = "*2\r\n$3\r\nGET\r\n$6\r\n" + value + "\r\n";
+    size_t offset = 0;
+    std::vector<std::string> args;
+    std::string error;
+
+    ASSERT_EQ(RespParser::Parse(buffer, offset, args, error, 1024), RespParser::Result::OK);
+    ASSERT_EQ(args.size(), 2);
+    EXPECT_EQ(args[1], value);
+}
+
+TEST(RespParserTest, IncompleteInputWaitsForMore) {
+    std::string full = "*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n";
+    for (size_t cut = 1; cut < full.size(); ++cut) {
+        std::string buffer = full.substr(0, cut);
+        size_t offset = 0;
+        std::vector<std::string> args;
+        std::string error;
+
+        EXPECT_EQ(RespParser::Parse(buffer, offset, args, error, 1024),
+                  RespParser::Result::INCOMPLETE) << "cut at " << cut;
+        EXPECT_EQ(offset, 0);
+    }
+}
+
+TEST(RespParserTest, ParsesPipelinedCommands) {
+    std::string buffer = "*1\r\n$4\r\nPING\r\n*2\r\n$3\r\nGET\r\n$1\r\nk\r\n";
+    size_t offset = 0;
+    std::vector<std::string> args;
+    std::string error;
+
+    ASSERT_EQ(RespParser::Parse(buffer, offset, args, error, 1024), RespParser::Result::OK);
+    EXPECT_EQ(args[0], "PING");
+    ASSERT_EQ(RespParser::Parse(buffer, offset, args, error, 1024), RespParser::Result::OK);
+    EXPECT_EQ(args[0], "GET");
+    EXPECT_EQ(offset, buffer.size());
+}
+
+TEST(RespParserTest, ParsesInlineCommand) {
+    std::string buffer = "SET  key\tvalue\r\n";
+    size_t offset = 0;
+    std::vector<std::string> args;
+    std::string error;
+
+    ASSERT_EQ(RespParser::Parse(buffer, offset, args, error, 1024), RespParser::Result::OK);
+    ASSERT_EQ(args.size(), 3);
+    EXPECT_EQ(args[2], "value");
+}
+
+TEST(RespParserTest, RejectsOversizedBulk) {
+    std::string buffer = "*1\r\n$2048\r\n";
+    size_t offset = 0;
+    std::vector<std::string> args;
+    std::string error;
+
+    EXPECT_EQ(RespParser::Parse(buffer, offset, args, error, 1024), RespParser::Result::ERROR);
+    EXPECT_FALSE(error.empty());
+}
+
+TEST(RespParserTest, RejectsMissingBulkMarker) {
+    std::string buffer = "*1\r\n:5\r\n";
+    size_t offset = 0;
+    std::vector<std::string> args;
+    std::string error;
+
+    EXPECT_EQ(RespParser::Parse(buffer, offset, args, error, 1024), RespParser::Result::ERROR);
+}
+
+// ============================================================================
+// Server Tests
+// ============================================================================
+
+class RespServerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        storage = std::make_shared<ShardedHashTable>(16);
+        StartServer();
+    }
+
+    void TearDown() override {
+        StopServer();
+    }
+
+    void StartServer(std::shared_ptr<WAL> wal = nullptr,
+                     std::shared_ptr<StaticDatasets> datasets = nullptr,
+                     size_t num_reactors = 2) {
+        RespServer::Config config;
+        config.bind_address = "127.0.0.1";
+        config.port = 0;
+        config.num_reactors = num_reactors;
+        config.pin_reactors = false;
+
+        server = std::make_unique<RespServer>(config, storage, std::move(wal),
+                                              std::move(datasets));
+        ASSERT_TRUE(server->Start());
+
+        fd = Connect();
+        ASSERT_GE(fd, 0);
+    }
+
+    int Connect() {
+        int client = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(server->port());
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        if (connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(client);
+            return -1;
+        }
+        return client;
+    }
+
+    void StopServer() {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+        server->Stop();
+    }
+
+    // Send raw bytes and read until `expected` bytes of reply have arrived
+    std::string Roundtrip(const std::string& request, size_t expected) {
+        send(fd, request.data(), request.size(), 0);
+
+        std::string reply;
+        char chunk[4096];
+        while (reply.size() < expected) {
+            ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                break;
+            }
+            reply.append(chunk, static_cast<size_t>(received));
+        }
+        return reply;
+    }
+
+    static std::string Command(const std::vector<std::string>& args) {
+        std::string out = "*" + std::to_string(args.size()) + "\r\n";
+        for (const auto& arg : args) {
+            out += "$" + std::to_string(arg.size()) + "\r\n" + arg + "\r\n";
+        }
+        return out;
+    }
+
+    std::string Call(const std::vector<std::string>& args, const std::string& expected) {
+        return Roundtrip(Command(args), expected.size());
+    }
+
+    std::shared_ptr<ShardedHashTable> storage;
+    std::unique_ptr<RespServer> server;
+    int fd = -1;
+};
+
+TEST_F(RespServerTest, SetGetDel) {
+    EXPECT_EQ(Call({"SET", "k", "hello"}, "+OK\r\n"), "+OK\r\n");
+    EXPECT_EQ(Call({"GET", "k"}, "$5\r\nhello\r\n"), "$5\r\nhello\r\n");
+    EXPECT_EQ(Call({"DEL", "k", "missing"}, ":1\r\n"), ":1\r\n");
+    EXPECT_EQ(Call({"GET", "k"}, "$-1\r\n"), "$-1\r\n");
+}
+
+TEST_F(RespServerTest, SharesStorageWithCaller) {
+    storage->set("shared", CacheEntry("shared", std::vector<uint8_t>{'x'}));
+    EXPECT_EQ(Call({"GET", "shared"}, "$1\r\nx\r\n"), "$1\r\nx\r\n");
+
+    Call({"SET", "from_resp", "y"}, "+OK\r\n");
+    auto entry = storage->get("from_resp");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->value[0], 'y');
+}
+
+TEST_F(RespServerTest, MsetMget) {
+    EXPECT_EQ(Call({"MSET", "a", "1", "b", "2"}, "+OK\r\n"), "+OK\r\n");
+    std::string expected = "*3\r\n$1\r\n1\r\n$-1\r\n$1\r\n2\r\n";
+    EXPECT_EQ(Call({"MGET", "a", "nope", "b"}, expected), expected);
+}
+
+TEST_F(RespServerTest, IncrAndExpire) {
+    EXPECT_EQ(Call({"INCR", "n"}, ":1\r\n"), ":1\r\n");
+    EXPECT_EQ(Call({"INCR", "n"}, ":2\r\n"), ":2\r\n");
+    EXPECT_EQ(Call({"EXPIRE", "n", "100"}, ":1\r\n"), ":1\r\n");
+    EXPECT_EQ(Call({"EXPIRE", "missing", "100"}, ":0\r\n"), ":0\r\n");
+
+    Call({"SET", "s", "abc"}, "+OK\r\n");
+    std::string reply = Call({"INCR", "s"}, "-ERR");
+    EXPECT_EQ(reply.substr(0, 4), "-ERR");
+}
+
+TEST_F(RespServerTest, PipelinedRequestsAnsweredInOrder) {
+    std::string request = Command({"SET", "p", "1"}) + Command({"INCR", "p"}) +
+                          Command({"GET", "p"});
+    std::string expected = "+OK\r\n:2\r\n$1\r\n2\r\n";
+    EXPECT_EQ(Roundtrip(request, expected.size()), expected);
+}
+
+TEST_F(RespServerTest, Resp3NullAfterHello) {
+    std::string hello = Call({"HELLO", "3"}, "%6\r\n");
+    EXPECT_EQ(hello.substr(0, 4), "%6\r\n");
+
+    // Drain the rest of the HELLO map before the next command
+    while (hello.find("master\r\n") == std::string::npos) {
+        char chunk[1024];
+        ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        ASSERT_GT(received, 0);
+        hello.append(chunk, static_cast<size_t>(received));
+    }
+
+    EXPECT_EQ(Call({"GET", "missing"}, "_\r\n"), "_\r\n");
+}
+
+TEST_F(RespServerTest, UnknownCommandAndInline) {
+    std::string reply = Call({"FLUSHALL"}, "-ERR unknown command 'FLUSHALL'\r\n");
+    EXPECT_EQ(reply, "-ERR unknown command 'FLUSHALL'\r\n");
+    EXPECT_EQ(Roundtrip("PING\r\n", 7), "+PONG\r\n");
+}
+
+TEST_F(RespServerTest, StatsCountCommands) {
+    Call({"PING"}, "+PONG\r\n");
+    auto stats = server->GetStats();
+    EXPECT_EQ(stats.connections_accepted, 1);
+    EXPECT_GE(stats.commands_processed, 1);
+}
+
+TEST_F(RespServerTest, FrozenWritesAreRefused) {
+    Call({"SET", "k", "v"}, "+OK\r\n");
+    storage->freeze_writes();
+
+    std::string refused = "-ERR handing off to a new server process\r\n";
+    EXPECT_EQ(Call({"SET", "k", "w"}, refused), refused);
+    EXPECT_EQ(Call({"MSET", "a", "1", "b", "2"}, refused), refused);
+    EXPECT_EQ(Call({"DEL", "k"}, refused), refused);
+    EXPECT_EQ(Call({"INCR", "n"}, refused), refused);
+    EXPECT_EQ(Call({"EXPIRE", "k", "10"}, refused), refused);
+    EXPECT_EQ(Call({"GET", "k"}, "$1\r\nv\r\n"), "$1\r\nv\r\n");
+
+    storage->thaw_writes();
+    EXPECT_EQ(Call({"SET", "k", "w"}, "+OK\r\n"), "+OK\r\n");
+}
+
+TEST_F(RespServerTest, WritesAreLoggedBeforeReply) {
+    auto dir = std::filesystem::temp_directory_path() /
+        ("distcache_resp_wal_" + std::to_string(::getpid()));
+    std::filesystem::remove_all(dir);
+
+    WAL::Config wal_config;
+    wal_config.wal_dir = dir;
+    wal_config.node_id = "resp";
+    wal_config.sync_on_write = false;
+    wal_config.max_file_size_bytes = 1024 * 1024;
+    auto wal = std::make_shared<WAL>(wal_config);
+    wal->Open();
+    storage->set_mutation_listener(wal.get());
+
+    StopServer();
+    StartServer(wal);
+
+    std::string request = Command({"SET", "a", "1"}) + Command({"GET", "a"}) +
+                          Command({"DEL", "a"});
+    std::string expected = "+OK\r\n$1\r\n1\r\n:1\r\n";
+    EXPECT_EQ(Roundtrip(request, expected.size()), expected);
+
+    // Acknowledged writes are already in the log
+    std::vector<WAL::WALEntry> entries;
+    for (const auto& id : wal->ListWALFiles()) {
+        EXPECT_TRUE(wal->ReadWALFile(dir / (id + ".wal"), entries));
+    }
+    ASSERT_EQ(entries.size(), 2u);
+    EXPECT_EQ(entries[0].key, "a");
+    EXPECT_EQ(entries[1].key, "a");
+
+    StopServer();
+    storage->set_mutation_listener(nullptr);
+    wal->Close();
+    std::filesystem::remove_all(dir);
+}
+
+TEST_F(RespServerTest, ParkedWriteDoesNotBlockReactor) {
+    auto dir = std::filesystem::temp_directory_path() /
+        ("distcache_resp_park_" + std::to_string(::getpid()));
+    std::filesystem::remove_all(dir);
+
+    // A long commit interval keeps the write parked for a while
+    WAL::Config wal_config;
+    wal_config.wal_dir = dir;
+    wal_config.node_id = "resp";
+    wal_config.sync_on_write = false;
+    wal_config.group_commit_interval_us = 500000;
+    auto wal = std::make_shared<WAL>(wal_config);
+    wal->Open();
+    storage->set_mutation_listener(wal.get());
+    storage->set("b", CacheEntry("b", std::vector<uint8_t>{'2'}));
+
+    StopServer();
+    StartServer(wal, nullptr, 1);
+    int other = Connect();
+    ASSERT_GE(other, 0);
+
+    std::string request = Command({"SET", "a", "1"}) + Command({"GET", "a"});
+    send(fd, request.data(), request.size(), 0);
+
+    // The single reactor still answers another connection meanwhile
+    std::string get = Command({"GET", "b"});
+    send(other, get.data(), get.size(), 0);
+    char chunk[64];
+    ssize_t received = recv(other, chunk, sizeof(chunk), 0);
+    ASSERT_GT(received, 0);
+    EXPECT_EQ(std::string(chunk, static_cast<size_t>(received)), "$1\r\n2\r\n");
+
+    // Nothing, not even the read behind it, is sent before the commit
+    EXPECT_LT(recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT), 0);
+    std::string expected = "+OK\r\n$1\r\n1\r\n";
+    EXPECT_EQ(Roundtrip("", expected.size()), expected);
+
+    close(other);
+    StopServer();
+    storage->set_mutation_listener(nullptr);
+    wal->Close();
+    std::filesystem::remove_all(dir);
+}
+
+TEST_F(RespServerTest, DatasetsAreServedReadOnly) {
+    auto path = std::filesystem::temp_directory_path() /
+        ("distcache_resp_dataset_" + std::to_string(::getpid()));
+    StaticDatasetBuilder builder;
+    builder.Add("k1", "one");
+    ASSERT_TRUE(builder.Write(path));
+
+    auto datasets = std::make_shared<StaticDatasets>();
+    ASSERT_TRUE(datasets->Mount("geo", path));
+    storage->set("geo:k1", CacheEntry("geo:k1", std::vector<uint8_t>{'x'}));  // Shadowed
+
+    StopServer();
+    StartServer(nullptr, datasets);
+
+    EXPECT_EQ(Call({"GET", "geo:k1"}, "$3\r\none\r\n"), "$3\r\none\r\n");
+    EXPECT_EQ(Call({"GET", "geo:k2"}, "$-1\r\n"), "$-1\r\n");
+
+    Call({"SET", "plain", "p"}, "+OK\r\n");
+    std::string expected = "*3\r\n$1\r\np\r\n$3\r\none\r\n$-1\r\n";
+    EXPECT_EQ(Call({"MGET", "plain", "geo:k1", "geo:k2"}, expected), expected);
+
+    std::string refused = "-ERR key belongs to a read-only dataset\r\n";
+    EXPECT_EQ(Call({"SET", "geo:k1", "v"}, refused), refused);
+    EXPECT_EQ(Call({"MSET", "plain", "q", "geo:k2", "v"}, refused), refused);
+    EXPECT_EQ(Call({"DEL", "plain", "geo:k1"}, refused), refused);
+    EXPECT_EQ(Call({"INCR", "geo:n"}, refused), refused);
+    EXPECT_EQ(Call({"EXPIRE", "geo:k1", "10"}, refused), refused);
+    EXPECT_EQ(Call({"GET", "plain"}, "$1\r\np\r\n"), "$1\r\np\r\n");
+
+    StopServer();
+    std::filesystem::remove(path);
+}
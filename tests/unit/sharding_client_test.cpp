@@ -1,5 +1,8 @@
 #include "distcache/sharding_client.h"
+#include "distcache/pipeline_stream.h"
 #include <gtest/gtest.h>
+#include <future>
+#include <thread>
 #include <unordered_set>
 
 using namespace distcache;
@@ -355,3 +358,275 @@ TEST_F(ShardingClientTest, GetNodeCountMatchesConfig) {
         EXPECT_EQ(client.GetNodeCount(), num_nodes);
     }
 }
+
+// ============================================================================
+// Batch Operation Tests
+// ============================================================================
+
+TEST_F(ShardingClientTest, BatchGetEmptyInput) {
+    ClientConfig config;
+    config.node_addresses = {"localhost:50051"};
+
+    ShardingClient client(config);
+
+    auto results = client.BatchGet({});
+    EXPECT_TRUE(results.empty());
+}
+
+TEST_F(ShardingClientTest, BatchGetWithoutNodes) {
+    ClientConfig config;
+
+    ShardingClient client(config);
+
+    auto results = client.BatchGet({"a", "b"});
+    ASSERT_EQ(results.size(), 2);
+    for (const auto& result : results) {
+        EXPECT_FALSE(result.success);
+        EXPECT_EQ(result.error, "No nodes available");
+    }
+}
+
+TEST_F(ShardingClientTest, BatchSetWithoutNodes) {
+    ClientConfig config;
+
+    ShardingClient client(config);
+
+    auto results = client.BatchSet({{"a", "1", std::nullopt}, {"b", "2", 60}});
+    ASSERT_EQ(results.size(), 2);
+    for (const auto& result : results) {
+        EXPECT_FALSE(result.success);
+    }
+}
+
+TEST_F(ShardingClientTest, BatchOperationsUnreachableNodes) {
+    ClientConfig config;
+    config.node_addresses = {"localhost:1", "localhost:2"};
+    config.retry_attempts = 1;
+    config.max_replicas = 1;
+    config.rpc_timeout_ms = 200;
+
+    ShardingClient client(config);
+
+    std::vector<std::string> keys;
+    std::vector<BatchSetItem> items;
+    for (int i = 0; i < 8; ++i) {
+        keys.push_back("key_" + std::to_string(i));
+        items.push_back({keys.back(), "value", std::nullopt});
+    }
+
+    // Every slot gets a failed result, in request order
+    auto get_results = client.BatchGet(keys);
+    ASSERT_EQ(get_results.size(), keys.size());
+    for (const auto& result : get_results) {
+        EXPECT_FALSE(result.success);
+    }
+
+    auto set_results = client.BatchSet(items);
+    ASSERT_EQ(set_results.size(), items.size());
+    for (const auto& result : set_results) {
+        EXPECT_FALSE(result.success);
+    }
+}
+
+// ============================================================================
+// Pipeline Stream Tests
+// ============================================================================
+
+namespace {
+
+// Answers each pair of pipelined Gets in reverse order (value = key).
+// SILENT never answers, SLOW answers each op on its own after a delay,
+// and STALLED stops reading requests altogether.
+class FakePipelineService final : public v1::CacheService::Service {
+public:
+    enum class Mode { PAIRS, SILENT, SLOW, STALLED };
+
+    explicit FakePipelineService(Mode mode = Mode::PAIRS) : mode_(mode) {}
+
+    grpc::Status Pipeline(
+        grpc::ServerContext* context,
+        grpc::ServerReaderWriter<v1::PipelineResponse, v1::PipelineRequest>* stream) override {
+        if (mode_ == Mode::STALLED) {
+            while (!context->IsCancelled()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            return grpc::Status::CANCELLED;
+        }
+
+        std::vector<v1::PipelineRequest> held;
+        v1::PipelineRequest request;
+        while (stream->Read(&request)) {
+            if (mode_ == Mode::SILENT) {
+                continue;
+            }
+            held.push_back(request);
+            if (mode_ == Mode::SLOW) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(300));
+                Flush(stream, held);
+            } else if (held.size() == 2) {
+                Flush(stream, held);
+            }
+        }
+        Flush(stream, held);
+        return grpc::Status::OK;
+    }
+
+private:
+    void Flush(grpc::ServerReaderWriter<v1::PipelineResponse, v1::PipelineRequest>* stream,
+               std::vector<v1::PipelineRequest>& held) {
+        for (auto it = held.rbegin(); it != held.rend(); ++it) {
+            v1::PipelineResponse response;
+            response.set_tag(it->tag());
+            response.mutable_get()->set_found(true);
+            response.mutable_get()->set_value(it->get().key());
+            stream->Write(response);
+        }
+        held.clear();
+    }
+
+    Mode mode_;
+};
+
+class PipelineStreamTest : public ::testing::Test {
+protected:
+    using Mode = FakePipelineService::Mode;
+
+    void Start(Mode mode) {
+        service_ = std::make_unique<FakePipelineService>(mode);
+
+        int port = 0;
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(service_.get());
+        server_ = builder.BuildAndStart();
+        ASSERT_NE(server_, nullptr);
+
+        auto channel = grpc::CreateChannel("127.0.0.1:" + std::to_string(port),
+                                           grpc::InsecureChannelCredentials());
+        stub_ = v1::CacheService::NewStub(channel);
+    }
+
+    void TearDown() override {
+        if (server_) {
+            server_->Shutdown(std::chrono::system_clock::now());
+        }
+    }
+
+    static v1::PipelineRequest GetOp(const std::string& key) {
+        v1::PipelineRequest request;
+        request.mutable_get()->set_key(key);
+        return request;
+    }
+
+    std::unique_ptr<FakePipelineService> service_;
+    std::unique_ptr<grpc::Server> server_;
+    std::unique_ptr<v1::CacheService::Stub> stub_;
+};
+
+}  // namespace
+
+TEST_F(PipelineStreamTest, OutOfOrderResponsesMatchedByTag) {
+    Start(Mode::PAIRS);
+    PipelineStream pipeline(stub_.get(), 16);
+
+    std::vector<std::future<std::pair<grpc::Status, std::string>>> calls;
+    for (int i = 0; i < 8; ++i) {
+        calls.push_back(std::async(std::launch::async, [&pipeline, i]() {
+            v1::PipelineResponse response;
+            auto status = pipeline.Call(GetOp("key_" + std::to_string(i)), &response,
+                                        std::chrono::milliseconds(5000));
+            return std::make_pair(status, response.get().value());
+        }));
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        auto [status, value] = calls[i].get();
+        EXPECT_TRUE(status.ok()) << status.error_message();
+        EXPECT_EQ(value, "key_" + std::to_string(i));
+    }
+    EXPECT_EQ(pipeline.InFlight(), 0);
+}
+
+TEST_F(PipelineStreamTest, TimedOutCallHoldsSlotUntilStreamBreaks) {
+    Start(Mode::SILENT);
+    PipelineStream pipeline(stub_.get(), 1);
+
+    v1::PipelineResponse response;
+    auto status = pipeline.Call(GetOp("a"), &response, std::chrono::milliseconds(100));
+    EXPECT_EQ(status.error_code(), grpc::DEADLINE_EXCEEDED);
+    EXPECT_EQ(pipeline.InFlight(), 1);
+
+    // The server may still be working on it, so the slot stays taken
+    status = pipeline.Call(GetOp("b"), &response, std::chrono::milliseconds(100));
+    EXPECT_EQ(status.error_code(), grpc::DEADLINE_EXCEEDED);
+    EXPECT_EQ(status.error_message(), "Pipeline in-flight limit reached");
+
+    server_->Shutdown(std::chrono::system_clock::now());
+    server_.reset();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!pipeline.IsBroken() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(pipeline.IsBroken());
+    EXPECT_EQ(pipeline.InFlight(), 0);
+}
+
+TEST_F(PipelineStreamTest, TimedOutCallReleasesSlotOnceAnswered) {
+    Start(Mode::SLOW);
+    PipelineStream pipeline(stub_.get(), 1);
+
+    v1::PipelineResponse response;
+    auto status = pipeline.Call(GetOp("a"), &response, std::chrono::milliseconds(100));
+    EXPECT_EQ(status.error_code(), grpc::DEADLINE_EXCEEDED);
+    EXPECT_EQ(pipeline.InFlight(), 1);
+
+    // Waits for the late answer to "a" to free the slot
+    status = pipeline.Call(GetOp("b"), &response, std::chrono::milliseconds(5000));
+    ASSERT_TRUE(status.ok()) << status.error_message();
+    EXPECT_EQ(response.get().value(), "b");
+    EXPECT_EQ(pipeline.InFlight(), 0);
+}
+
+TEST_F(PipelineStreamTest, WriteStuckPastDeadlineBreaksStream) {
+    Start(Mode::STALLED);
+    PipelineStream pipeline(stub_.get(), 4);
+
+    // Far more than the transport buffers while the server is not reading
+    v1::PipelineResponse response;
+    auto started = std::chrono::steady_clock::now();
+    auto status = pipeline.Call(GetOp(std::string(8 * 1024 * 1024, 'k')), &response,
+                                std::chrono::milliseconds(300));
+    EXPECT_FALSE(status.ok());
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(3));
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!pipeline.IsBroken() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(pipeline.IsBroken());
+}
+
+TEST_F(PipelineStreamTest, UnreachableServerMarksStreamBroken) {
+    auto channel = grpc::CreateChannel("localhost:1", grpc::InsecureChannelCredentials());
+    auto stub = v1::CacheService::NewStub(channel);
+    PipelineStream pipeline(stub.get(), 4);
+
+    v1::PipelineResponse response;
+    auto status = pipeline.Call(GetOp("a"), &response, std::chrono::milliseconds(1000));
+    EXPECT_FALSE(status.ok());
+}
+
+TEST_F(ShardingClientTest, PipelinedOperationsUnreachableNodes) {
+    ClientConfig config;
+    config.node_addresses = {"localhost:1"};
+    config.retry_attempts = 2;
+    config.max_replicas = 1;
+    config.rpc_timeout_ms = 200;
+    config.enable_pipelining = true;
+
+    ShardingClient client(config);
+
+    EXPECT_FALSE(client.Get("key").success);
+    EXPECT_FALSE(client.Set("key", "value").success);
+    EXPECT_FALSE(client.Delete("key").success);
+}
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+#include "distcache/static_dataset.h"
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+using namespace distcache;
+
+namespace {
+
+class StaticDatasetTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() /
+               ("distcache_dataset_test_" + std::to_string(::getpid()));
+        std::filesystem::remove_all(dir_);
+        std::filesystem::create_directories(dir_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    // Keys "k<i>" for i < count, valued "<prefix><i>"
+    bool BuildNumbered(const std::filesystem::path& path, size_t count,
+                       const std::string& prefix) {
+        StaticDatasetBuilder builder;
+        for (size_t i = 0; i < count; ++i) {
+            builder.Add("k" + std::to_string(i), prefix + std::to_string(i));
+        }
+        return builder.Write(path);
+    }
+
+    std::filesystem::path dir_;
+};
+
+} // namespace
+
+// ====================
+// Build and Lookup Tests
+// ====================
+
+TEST_F(StaticDatasetTest, EveryKeyIsFoundAndOthersAreNot) {
+    auto path = dir_ / "numbers.dataset";
+    ASSERT_TRUE(BuildNumbered(path, 50000, "v"));
+    EXPECT_FALSE(std::filesystem::exists(dir_ / "numbers.dataset.tmp"));
+
+    auto dataset = StaticDataset::Open(path, /*verify=*/true);
+    ASSERT_NE(dataset, nullptr);
+    EXPECT_EQ(dataset->size(), 50000u);
+    EXPECT_GT(dataset->built_at_ms(), 0);
+
+    for (size_t i = 0; i < 50000; ++i) {
+        auto value = dataset->find("k" + std::to_string(i));
+        ASSERT_TRUE(value.has_value()) << i;
+        EXPECT_EQ(*value, "v" + std::to_string(i));
+    }
+    for (size_t i = 50000; i < 60000; ++i) {
+        EXPECT_FALSE(dataset->find("k" + std::to_string(i)).has_value());
+    }
+    EXPECT_FALSE(dataset->find("").has_value());
+
+    // Index and slot table: well under the 8-byte offset plus 4 bits a key
+    EXPECT_LT(dataset->index_bytes(), 50000u * (8 + 1));
+}
+
+TEST_F(StaticDatasetTest, BinaryAndEmptyValuesRoundTrip) {
+    std::string binary("a\0b\tc\n", 6);
+    StaticDatasetBuilder builder;
+    builder.Add("binary", binary);
+    builder.Add("empty", "");
+    builder.Add("", "empty key");
+    auto path = dir_ / "small.dataset";
+    ASSERT_TRUE(builder.Write(path));
+
+    auto dataset = StaticDataset::Open(path);
+    ASSERT_NE(dataset, nullptr);
+    EXPECT_EQ(*dataset->find("binary"), binary);
+    EXPECT_EQ(*dataset->find("empty"), "");
+    EXPECT_EQ(*dataset->find(""), "empty key");
+}
+
+TEST_F(StaticDatasetTest, EmptyDatasetFindsNothing) {
+    auto path = dir_ / "empty.dataset";
+    ASSERT_TRUE(StaticDatasetBuilder().Write(path));
+
+    auto dataset = StaticDataset::Open(path, /*verify=*/true);
+    ASSERT_NE(dataset, nullptr);
+    EXPECT_EQ(dataset->size(), 0u);
+    EXPECT_FALSE(dataset->find("anything").has_value());
+}
+
+TEST_F(StaticDatasetTest, DuplicateKeysFailTheBuild) {
+    auto path = dir_ / "dupes.dataset";
+    StaticDatasetBuilder builder;
+    for (int i = 0; i < 1000; ++i) {
+        builder.Add("k" + std::to_string(i), "v");
+    }
+    builder.Add("k500", "again");
+    EXPECT_FALSE(builder.Write(path));
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST_F(StaticDatasetTest, DamagedFilesAreRejected) {
+    auto path = dir_ / "damaged.dataset";
+    ASSERT_TRUE(BuildNumbered(path, 1000, "v"));
+    auto size = std::filesystem::file_size(path);
+
+    // A flipped byte in the data only shows up when the body is verified
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(size - 1));
+        file.put('X');
+    }
+    EXPECT_NE(StaticDataset::Open(path), nullptr);
+    EXPECT_EQ(StaticDataset::Open(path, /*verify=*/true), nullptr);
+
+    std::filesystem::resize_file(path, size - 8);
+    EXPECT_EQ(StaticDataset::Open(path), nullptr);
+
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(16);
+        file.put('\x7f');
+    }
+    EXPECT_EQ(StaticDataset::Open(path), nullptr);
+    EXPECT_EQ(StaticDataset::Open(dir_ / "missing.dataset"), nullptr);
+}
+
+// ====================
+// Mount Tests
+// ====================
+
+TEST_F(StaticDatasetTest, MountedNamespaceIsServedReadOnly) {
+    auto path = dir_ / "geo.dataset";
+    ASSERT_TRUE(BuildNumbered(path, 100, "geo"));
+
+    StaticDatasets datasets;
+    EXPECT_FALSE(datasets.lookup("geo:k1").dataset);  // Nothing mounted yet
+    ASSERT_TRUE(datasets.Mount("geo", path));
+    EXPECT_FALSE(datasets.Mount("bad:name", path));
+    EXPECT_FALSE(datasets.Mount("other", dir_ / "missing.dataset"));
+
+    auto hit = datasets.lookup("geo:k42");
+    ASSERT_TRUE(hit.dataset);
+    EXPECT_EQ(*hit.value, "geo42");
+
+    auto miss = datasets.lookup("geo:k1000");
+    EXPECT_TRUE(miss.dataset);
+    EXPECT_FALSE(miss.value.has_value());
+
+    // Other keys are left to the hash table
+    EXPECT_FALSE(datasets.lookup("k42").dataset);
+    EXPECT_FALSE(datasets.lookup("geox:k42").dataset);
+    EXPECT_TRUE(datasets.is_read_only("geo:anything"));
+    EXPECT_FALSE(datasets.is_read_only("user:1"));
+
+    auto stats = datasets.GetStats();
+    EXPECT_EQ(stats.datasets, 1u);
+    EXPECT_EQ(stats.keys, 100u);
+    EXPECT_EQ(stats.lookups, 2u);
+    EXPECT_EQ(stats.hits, 1u);
+
+    EXPECT_TRUE(datasets.Unmount("geo"));
+    EXPECT_FALSE(datasets.lookup("geo:k42").dataset);
+}
+
+TEST_F(StaticDatasetTest, ReplacedFileIsSwappedInAtomically) {
+    StaticDatasets::Config config;
+    config.check_interval_seconds = 0;
+    StaticDatasets datasets(config);
+    auto path = dir_ / "nightly.dataset";
+    ASSERT_TRUE(BuildNumbered(path, 1000, "old"));
+    ASSERT_TRUE(datasets.Mount("n", path));
+    EXPECT_EQ(datasets.Refresh(), 0u);
+
+    // A reader in the middle of a request keeps the version it looked up
+    auto held = datasets.lookup("n:k7");
+    ASSERT_TRUE(held.value.has_value());
+
+    ASSERT_TRUE(BuildNumbered(path, 2000, "new"));
+    EXPECT_EQ(datasets.Refresh(), 1u);
+    EXPECT_EQ(*datasets.lookup("n:k7").value, "new7");
+    EXPECT_EQ(*datasets.lookup("n:k1500").value, "new1500");
+    EXPECT_EQ(*held.value, "old7");
+
+    // A broken replacement leaves the mounted version serving
+    {
+        std::ofstream broken(dir_ / "broken", std::ios::binary);
+        broken << "not a dataset";
+    }
+    std::filesystem::rename(dir_ / "broken", path);
+    EXPECT_EQ(datasets.Refresh(), 0u);
+    EXPECT_EQ(datasets.Refresh(), 0u);  // Not retried until it changes again
+    EXPECT_EQ(*datasets.lookup("n:k7").value, "new7");
+
+    auto stats = datasets.GetStats();
+    EXPECT_EQ(stats.swaps, 1u);
+    EXPECT_EQ(stats.swap_failures, 1u);
+}
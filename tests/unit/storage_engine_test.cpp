@@ -1,5 +1,8 @@
 #include "distcache/storage_engine.h"
+#include "distcache/alloc_tracker.h"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
 #include <thread>
 #include <vector>
 #include <chrono>
@@ -431,3 +434,430 @@ TEST_F(StorageEngineTest, SpecialCharactersInKey) {
     auto result = storage->get(special_key);
     EXPECT_TRUE(result.has_value());
 }
+
+// ====================
+// Batch Operations Tests
+// ====================
+
+TEST_F(StorageEngineTest, MultiGetPreservesRequestOrder) {
+    for (int i = 0; i < 10; ++i) {
+        std::string key = "batch_key_" + std::to_string(i);
+        std::vector<uint8_t> value = {'b', static_cast<uint8_t>(i)};
+        storage->set(key, CacheEntry(key, value));
+    }
+
+    std::vector<std::string> keys = {"batch_key_7", "missing", "batch_key_2", "batch_key_7"};
+    auto results = storage->multi_get(keys);
+
+    ASSERT_EQ(results.size(), keys.size());
+    ASSERT_TRUE(results[0].has_value());
+    EXPECT_EQ(results[0]->value[1], 7);
+    EXPECT_FALSE(results[1].has_value());
+    ASSERT_TRUE(results[2].has_value());
+    EXPECT_EQ(results[2]->value[1], 2);
+    ASSERT_TRUE(results[3].has_value());
+    EXPECT_EQ(results[3]->value[1], 7);
+}
+
+TEST_F(StorageEngineTest, MultiGetEmpty) {
+    auto results = storage->multi_get({});
+    EXPECT_TRUE(results.empty());
+}
+
+TEST_F(StorageEngineTest, MultiSetStoresAllEntries) {
+    std::vector<CacheEntry> entries;
+    for (int i = 0; i < 50; ++i) {
+        std::string key = "mset_key_" + std::to_string(i);
+        std::vector<uint8_t> value = {'m', static_cast<uint8_t>(i)};
+        entries.emplace_back(key, value);
+    }
+
+    auto results = storage->multi_set(std::move(entries));
+
+    ASSERT_EQ(results.size(), 50);
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_TRUE(results[i]);
+        auto entry = storage->get("mset_key_" + std::to_string(i));
+        ASSERT_TRUE(entry.has_value());
+        EXPECT_EQ(entry->value[1], i);
+    }
+    EXPECT_EQ(storage->size(), 50);
+}
+
+TEST_F(StorageEngineTest, MultiSetLastDuplicateWins) {
+    std::vector<CacheEntry> entries;
+    entries.emplace_back("dup", std::vector<uint8_t>{'1'});
+    entries.emplace_back("other", std::vector<uint8_t>{'o'});
+    entries.emplace_back("dup", std::vector<uint8_t>{'2'});
+
+    auto results = storage->multi_set(std::move(entries));
+
+    ASSERT_EQ(results.size(), 3);
+    auto entry = storage->get("dup");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->value[0], '2');
+    EXPECT_EQ(storage->size(), 2);
+}
+
+TEST_F(StorageEngineTest, ExecuteBatchMixedOperations) {
+    storage->set("existing", CacheEntry("existing", std::vector<uint8_t>{'e'}));
+
+    using Op = ShardedHashTable::BatchOp;
+    std::vector<Op> ops(5);
+    ops[0].type = Op::Type::SET;
+    ops[0].key = "new";
+    ops[0].entry = CacheEntry("new", std::vector<uint8_t>{'n'});
+    ops[1].type = Op::Type::GET;
+    ops[1].key = "new";
+    ops[2].type = Op::Type::CAS;
+    ops[2].key = "existing";
+    ops[2].expected_version = 1;
+    ops[2].entry = CacheEntry("existing", std::vector<uint8_t>{'c'});
+    ops[3].type = Op::Type::DELETE;
+    ops[3].key = "missing";
+    ops[4].type = Op::Type::GET;
+    ops[4].key = "existing";
+
+    std::vector<size_t> completed;
+    storage->execute_batch(ops, [&](size_t index) { completed.push_back(index); });
+
+    // Every op reports completion exactly once
+    ASSERT_EQ(completed.size(), ops.size());
+    std::sort(completed.begin(), completed.end());
+    for (size_t i = 0; i < completed.size(); ++i) {
+        EXPECT_EQ(completed[i], i);
+    }
+
+    // Same-key ops run in batch order
+    EXPECT_TRUE(ops[0].success);
+    ASSERT_TRUE(ops[1].found.has_value());
+    EXPECT_EQ(ops[1].found->value[0], 'n');
+    EXPECT_TRUE(ops[2].cas.success);
+    EXPECT_EQ(ops[2].cas.new_version, 2);
+    EXPECT_FALSE(ops[3].success);
+    ASSERT_TRUE(ops[4].found.has_value());
+    EXPECT_EQ(ops[4].found->value[0], 'c');
+}
+
+TEST_F(StorageEngineTest, ExecuteBatchCASVersionMismatch) {
+    storage->set("key", CacheEntry("key", std::vector<uint8_t>{'v'}));
+
+    using Op = ShardedHashTable::BatchOp;
+    std::vector<Op> ops(1);
+    ops[0].type = Op::Type::CAS;
+    ops[0].key = "key";
+    ops[0].expected_version = 7;
+    ops[0].entry = CacheEntry("key", std::vector<uint8_t>{'x'});
+
+    storage->execute_batch(ops);
+
+    EXPECT_FALSE(ops[0].success);
+    EXPECT_EQ(ops[0].cas.actual_version, 1);
+    EXPECT_EQ(storage->get("key")->value[0], 'v');
+}
+
+// ====================
+// Increment and Expire Tests
+// ====================
+
+TEST_F(StorageEngineTest, IncrByCreatesMissingKey) {
+    auto result = storage->incr_by("counter", 5);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.value, 5);
+
+    result = storage->incr_by("counter", -7);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.value, -2);
+
+    auto entry = storage->get("counter");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(std::string(entry->value.begin(), entry->value.end()), "-2");
+}
+
+TEST_F(StorageEngineTest, IncrByRejectsNonInteger) {
+    storage->set("text", CacheEntry("text", std::vector<uint8_t>{'a', 'b'}));
+
+    auto result = storage->incr_by("text", 1);
+    EXPECT_FALSE(result.success);
+    EXPECT_FALSE(result.error.empty());
+}
+
+TEST_F(StorageEngineTest, IncrByDetectsOverflow) {
+    std::string max = std::to_string(INT64_MAX);
+    storage->set("big", CacheEntry("big", std::vector<uint8_t>(max.begin(), max.end())));
+
+    auto result = storage->incr_by("big", 1);
+    EXPECT_FALSE(result.success);
+}
+
+TEST_F(StorageEngineTest, IncrByKeepsTTL) {
+    storage->set("ttl_counter", CacheEntry("ttl_counter", std::vector<uint8_t>{'1'}, 60));
+
+    ASSERT_TRUE(storage->incr_by("ttl_counter", 1).success);
+
+    auto entry = storage->get("ttl_counter");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_TRUE(entry->expires_at_ms.has_value());
+}
+
+TEST_F(StorageEngineTest, ExpireSetsAndRemoves) {
+    EXPECT_FALSE(storage->expire("missing", 10));
+
+    storage->set("key", CacheEntry("key", std::vector<uint8_t>{'v'}));
+    EXPECT_TRUE(storage->expire("key", 10));
+    auto entry = storage->get("key");
+    ASSERT_TRUE(entry.has_value());
+    ASSERT_TRUE(entry->ttl_seconds.has_value());
+    EXPECT_EQ(*entry->ttl_seconds, 10);
+
+    // Non-positive TTL deletes immediately
+    EXPECT_TRUE(storage->expire("key", 0));
+    EXPECT_FALSE(storage->get("key").has_value());
+}
+
+// ====================
+// Zero-Copy Read & Allocation Tracking Tests
+// ====================
+
+TEST_F(StorageEngineTest, GetWithVisitsStoredEntry) {
+    storage->set("key", CacheEntry("key", std::vector<uint8_t>{'a', 'b', 'c'}));
+
+    std::string seen;
+    int64_t version = 0;
+    bool found = storage->get_with("key", [&](const CacheEntry& entry) {
+        seen.assign(entry.value.begin(), entry.value.end());
+        version = entry.version;
+    });
+
+    EXPECT_TRUE(found);
+    EXPECT_EQ(seen, "abc");
+    EXPECT_EQ(version, 1);
+    EXPECT_EQ(storage->metrics().cache_hits.load(), 1u);
+}
+
+TEST_F(StorageEngineTest, GetWithMissDoesNotInvokeCallback) {
+    bool called = false;
+    EXPECT_FALSE(storage->get_with("missing", [&](const CacheEntry&) { called = true; }));
+    EXPECT_FALSE(called);
+    EXPECT_EQ(storage->metrics().cache_misses.load(), 1u);
+}
+
+TEST_F(StorageEngineTest, AllocationScopeCountsThreadAllocations) {
+    Metrics metrics;
+    {
+        AllocationScope allocs(&metrics);
+        auto owned = std::make_unique<int>(42);
+        std::vector<int> values(16);
+        EXPECT_GE(allocs.allocations(), 2u);
+    }
+
+    EXPECT_EQ(metrics.requests_tracked.load(), 1u);
+    EXPECT_GE(metrics.request_allocations_total.load(), 2u);
+    EXPECT_EQ(metrics.request_allocations_max.load(),
+              metrics.request_allocations_total.load());
+
+    // An allocation-free scope still counts as a request
+    {
+        AllocationScope allocs(&metrics);
+    }
+    EXPECT_EQ(metrics.requests_tracked.load(), 2u);
+    EXPECT_DOUBLE_EQ(metrics.allocations_per_request(),
+                     metrics.request_allocations_total.load() / 2.0);
+}
+
+TEST_F(StorageEngineTest, GetWithDoesNotCopyValue) {
+    storage->set("big", CacheEntry("big", std::vector<uint8_t>(4096, 'x')));
+
+    size_t size = 0;
+    AllocationScope allocs;
+    storage->get_with("big", [&](const CacheEntry& entry) { size = entry.value.size(); });
+
+    EXPECT_EQ(size, 4096u);
+    EXPECT_EQ(allocs.allocations(), 0u);
+}
+
+// ====================
+// Change Tracking Tests
+// ====================
+
+TEST_F(StorageEngineTest, TombstonesTrackDeletesUntilTheKeyReturns) {
+    auto table = std::make_unique<ShardedHashTable>(1);
+    table->set_tombstone_tracking(true);
+
+    int64_t before = CacheEntry::get_current_time_ms();
+    table->set("kept", CacheEntry("kept", {1}));
+    table->set("gone", CacheEntry("gone", {1}));
+    table->set("back", CacheEntry("back", {1}));
+    EXPECT_TRUE(table->del("gone"));
+    EXPECT_TRUE(table->del("back"));
+    EXPECT_EQ(table->tombstone_count(), 2u);
+
+    // Setting a key again forgets its tombstone
+    table->set("back", CacheEntry("back", {2}));
+    EXPECT_EQ(table->tombstone_count(), 1u);
+
+    std::vector<std::string> changed;
+    std::vector<std::string> deleted;
+    table->for_each_changed_in_shard(
+        0, before,
+        [&](const std::string& key, const CacheEntry&) { changed.push_back(key); },
+        [&](const std::string& key, int64_t) { deleted.push_back(key); });
+    std::sort(changed.begin(), changed.end());
+    EXPECT_EQ(changed, std::vector<std::string>({"back", "kept"}));
+    EXPECT_EQ(deleted, std::vector<std::string>({"gone"}));
+
+    // Nothing changed after now
+    changed.clear();
+    deleted.clear();
+    table->for_each_changed_in_shard(
+        0, CacheEntry::get_current_time_ms() + 1000,
+        [&](const std::string& key, const CacheEntry&) { changed.push_back(key); },
+        [&](const std::string& key, int64_t) { deleted.push_back(key); });
+    EXPECT_TRUE(changed.empty());
+    EXPECT_TRUE(deleted.empty());
+
+    table->drop_tombstones_before(CacheEntry::get_current_time_ms() + 1);
+    EXPECT_EQ(table->tombstone_count(), 0u);
+}
+
+// ====================
+// Lazy Load Tests
+// ====================
+
+namespace {
+
+// Hands out a fixed set of entries per shard and counts the loads
+struct FakeShardSource {
+    explicit FakeShardSource(ShardedHashTable& table)
+        : table(table), entries(table.shard_count()), loads(table.shard_count()) {}
+
+    void add(const std::string& key, uint8_t value) {
+        entries[table.get_shard_index(key)].push_back(CacheEntry(key, {value}));
+    }
+
+    ShardedHashTable::ShardLoader loader() {
+        return [this](size_t shard, bool on_demand) {
+            loads[shard]++;
+            (on_demand ? on_demand_loads : background_loads)++;
+            if (delay.count() > 0) {
+                std::this_thread::sleep_for(delay);
+            }
+            return entries[shard];
+        };
+    }
+
+    ShardedHashTable& table;
+    std::vector<std::vector<CacheEntry>> entries;
+    std::vector<std::atomic<int>> loads;
+    std::atomic<int> on_demand_loads{0};
+    std::atomic<int> background_loads{0};
+    std::chrono::milliseconds delay{0};
+};
+
+struct RecordingListener : MutationListener {
+    void on_set(const std::string& key, const CacheEntry&) override { sets.push_back(key); }
+    void on_delete(const std::string& key) override { deletes.push_back(key); }
+
+    std::vector<std::string> sets;
+    std::vector<std::string> deletes;
+};
+
+} // namespace
+
+TEST_F(StorageEngineTest, LazyLoadFaultsShardsInOnFirstUse) {
+    ShardedHashTable table(4);
+    FakeShardSource source(table);
+    for (int i = 0; i < 100; ++i) {
+        source.add("key_" + std::to_string(i), static_cast<uint8_t>(i));
+    }
+    table.begin_lazy_load(source.loader());
+    EXPECT_EQ(table.shards_pending_load(), 4u);
+    EXPECT_EQ(table.size(), 0u);
+
+    // A read loads just its own shard, once
+    auto found = table.get("key_7");
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->value, std::vector<uint8_t>({7}));
+    EXPECT_EQ(table.shards_pending_load(), 3u);
+    EXPECT_TRUE(table.exists("key_7"));
+    EXPECT_EQ(source.loads[table.get_shard_index("key_7")].load(), 1);
+    EXPECT_EQ(source.on_demand_loads.load(), 1);
+
+    // The rest can be loaded ahead of demand
+    for (size_t shard = 0; shard < table.shard_count(); ++shard) {
+        table.load_shard(shard);
+    }
+    EXPECT_EQ(table.shards_pending_load(), 0u);
+    EXPECT_EQ(source.background_loads.load(), 3);
+    EXPECT_EQ(table.size(), 100u);
+    EXPECT_FALSE(table.load_shard(0));
+
+    // Scans see everything, with no further loads
+    size_t seen = 0;
+    table.for_each([&](const std::string&, const CacheEntry&) { seen++; });
+    EXPECT_EQ(seen, 100u);
+    EXPECT_EQ(source.on_demand_loads.load() + source.background_loads.load(), 4);
+}
+
+TEST_F(StorageEngineTest, BlindWritesSupersedeLazilyLoadedEntries) {
+    ShardedHashTable table(1);
+    FakeShardSource source(table);
+    source.add("updated", 1);
+    source.add("deleted", 1);
+    source.add("set_then_deleted", 1);
+    source.add("kept", 1);
+    table.begin_lazy_load(source.loader());
+
+    RecordingListener listener;
+    table.set_mutation_listener(&listener);
+
+    // None of these needs the shard's old contents, so none waits for it
+    EXPECT_TRUE(table.set("updated", CacheEntry("updated", {2})));
+    table.discard("deleted");
+    table.set("set_then_deleted", CacheEntry("set_then_deleted", {2}));
+    table.discard("set_then_deleted");
+    table.multi_set({CacheEntry("added", {2})});
+    EXPECT_EQ(source.on_demand_loads.load(), 0);
+    EXPECT_EQ(table.shards_pending_load(), 1u);
+
+    // Blind deletes are logged even though the key was not in memory
+    EXPECT_EQ(listener.sets, std::vector<std::string>({"updated", "set_then_deleted", "added"}));
+    EXPECT_EQ(listener.deletes, std::vector<std::string>({"deleted", "set_then_deleted"}));
+
+    // Reading loads the shard; the writes win over the loaded entries
+    EXPECT_EQ(table.get("updated")->value, std::vector<uint8_t>({2}));
+    EXPECT_EQ(source.on_demand_loads.load(), 1);
+    EXPECT_FALSE(table.get("deleted").has_value());
+    EXPECT_FALSE(table.get("set_then_deleted").has_value());
+    EXPECT_EQ(table.get("kept")->value, std::vector<uint8_t>({1}));
+    EXPECT_EQ(table.size(), 3u);
+
+    // Loaded entries are not reported as mutations
+    EXPECT_EQ(listener.sets.size(), 3u);
+    table.set_mutation_listener(nullptr);
+}
+
+TEST_F(StorageEngineTest, ConcurrentReadsWaitForOneShardLoad) {
+    ShardedHashTable table(1);
+    FakeShardSource source(table);
+    source.add("key", 1);
+    source.delay = std::chrono::milliseconds(50);
+    table.begin_lazy_load(source.loader());
+
+    std::atomic<int> hits{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 8; ++i) {
+        readers.emplace_back([&] {
+            if (table.get("key").has_value()) {
+                hits++;
+            }
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(hits.load(), 8);
+    EXPECT_EQ(source.loads[0].load(), 1);
+    EXPECT_EQ(table.shards_pending_load(), 0u);
+}
@@ -0,0 +1,403 @@
+#include <gtest/gtest.h>
+#include "distcache/wal.h"
+#include "distcache/cache_entry.h"
+#include "distcache/crc32c.h"
+#include "distcache/metrics.h"
+#include "distcache/recovery_manager.h"
+#include "distcache/snapshot_manager.h"
+#include "distcache/storage_engine.h"
+#include "wal.pb.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace distcache;
+
+// ====================
+// CRC32C Tests
+// ====================
+
+TEST(CRC32CTest, KnownVectors) {
+    const std::string check = "123456789";
+    EXPECT_EQ(crc32c::Value(check.data(), check.size()), 0xE3069283u);
+
+    std::vector<uint8_t> zeros(32, 0);
+    EXPECT_EQ(crc32c::Value(zeros.data(), zeros.size()), 0x8A9136AAu);
+
+    std::vector<uint8_t> ones(32, 0xFF);
+    EXPECT_EQ(crc32c::Value(ones.data(), ones.size()), 0x62A8AB43u);
+
+    EXPECT_EQ(crc32c::Value(nullptr, 0), 0u);
+}
+
+TEST(CRC32CTest, AcceleratedMatchesPortable) {
+    std::mt19937 rng(42);
+    std::vector<uint8_t> data(4096 + 8);
+    for (auto& b : data) {
+        b = static_cast<uint8_t>(rng());
+    }
+
+    for (size_t offset = 0; offset < 8; ++offset) {
+        for (size_t size : {0u, 1u, 7u, 8u, 9u, 63u, 64u, 1000u, 4096u}) {
+            EXPECT_EQ(crc32c::Value(data.data() + offset, size),
+                      crc32c::ExtendPortable(0, data.data() + offset, size))
+                << "offset " << offset << " size " << size;
+        }
+    }
+}
+
+TEST(CRC32CTest, ExtendIsIncremental) {
+    const std::string text = "The quick brown fox jumps over the lazy dog";
+    uint32_t whole = crc32c::Value(text.data(), text.size());
+
+    for (size_t split = 0; split <= text.size(); ++split) {
+        uint32_t crc = crc32c::Value(text.data(), split);
+        crc = crc32c::Extend(crc, text.data() + split, text.size() - split);
+        EXPECT_EQ(crc, whole) << "split " << split;
+    }
+}
+
+// ====================
+// Corruption Tests
+// ====================
+
+class WALCorruptionTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() /
+            ("distcache_wal_corruption_test_" + std::to_string(::getpid()) + "_" +
+             ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove_all(test_dir_);
+
+        config_.wal_dir = test_dir_;
+        config_.node_id = "test-node";
+        config_.sync_on_write = false;
+        config_.max_file_size_bytes = 64 * 1024;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    /**
+     * Write count records and return the segment path along with the
+     * offset at which each record starts (plus the end of the last one).
+     */
+    std::filesystem::path WriteRecords(int count, std::vector<size_t>& offsets) {
+        WAL wal(config_);
+        wal.Open();
+        auto path = test_dir_ / (wal.GetCurrentLogId() + ".wal");
+
+        for (int i = 0; i < count; ++i) {
+            offsets.push_back(wal.GetStats().current_file_size);
+            CacheEntry entry("key:" + std::to_string(i),
+                             std::vector<uint8_t>(20 + i, static_cast<uint8_t>('a' + i % 26)));
+            EXPECT_TRUE(wal.AppendSet(entry.key, entry));
+        }
+        offsets.push_back(wal.GetStats().current_file_size);
+        wal.Close();
+        return path;
+    }
+
+    static std::string ReadFile(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), {});
+    }
+
+    static void WriteFile(const std::filesystem::path& path, const std::string& data) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    std::filesystem::path test_dir_;
+    WAL::Config config_;
+};
+
+TEST_F(WALCorruptionTest, IntactFileReportsNoCorruption) {
+    std::vector<size_t> offsets;
+    auto path = WriteRecords(10, offsets);
+
+    WAL reader(config_);
+    std::vector<WAL::WALEntry> entries;
+    WAL::ReadReport report;
+    ASSERT_TRUE(reader.ReadWALFile(path, entries, &report));
+
+    EXPECT_EQ(entries.size(), 10u);
+    EXPECT_FALSE(report.corrupted);
+    EXPECT_EQ(report.valid_bytes, offsets.back());
+    EXPECT_EQ(report.discarded_bytes, 0u);
+}
+
+TEST_F(WALCorruptionTest, TornTailIsCutAtLastCompleteRecord) {
+    std::vector<size_t> offsets;
+    auto path = WriteRecords(8, offsets);
+    const std::string original = ReadFile(path);
+
+    // Simulate a write that stopped part-way through the last records:
+    // keep a prefix and zero the rest, as an unflushed page would be
+    for (size_t cut = offsets[5] + 1; cut < offsets.back(); cut += 3) {
+        std::string torn = original;
+        std::fill(torn.begin() + static_cast<std::ptrdiff_t>(cut), torn.end(), '\0');
+        WriteFile(path, torn);
+
+        size_t intact = 0;
+        while (intact + 1 < offsets.size() && offsets[intact + 1] <= cut) {
+            intact++;
+        }
+
+        WAL reader(config_);
+        std::vector<WAL::WALEntry> entries;
+        WAL::ReadReport report;
+        ASSERT_TRUE(reader.ReadWALFile(path, entries, &report));
+
+        // A partial record is only detectable once a non-zero byte of it
+        // has reached the disk
+        bool partial = std::any_of(original.begin() + static_cast<std::ptrdiff_t>(offsets[intact]),
+                                   original.begin() + static_cast<std::ptrdiff_t>(cut),
+                                   [](char c) { return c != 0; });
+
+        ASSERT_EQ(entries.size(), intact) << "cut at " << cut;
+        EXPECT_EQ(report.valid_bytes, offsets[intact]) << "cut at " << cut;
+        EXPECT_EQ(report.corrupted, partial) << "cut at " << cut;
+        EXPECT_LE(report.discarded_bytes, cut - offsets[intact]) << "cut at " << cut;
+        if (partial) {
+            EXPECT_GT(report.discarded_bytes, 0u) << "cut at " << cut;
+        }
+    }
+}
+
+TEST_F(WALCorruptionTest, BitFlipsStopAtDamagedRecord) {
+    std::vector<size_t> offsets;
+    auto path = WriteRecords(20, offsets);
+    const std::string original = ReadFile(path);
+
+    std::mt19937 rng(1234);
+    for (int trial = 0; trial < 200; ++trial) {
+        size_t record = rng() % 20;
+        size_t span = offsets[record + 1] - offsets[record];
+        size_t position = offsets[record] + rng() % span;
+        uint8_t bit = static_cast<uint8_t>(1u << (rng() % 8));
+
+        std::string damaged = original;
+        damaged[position] = static_cast<char>(damaged[position] ^ bit);
+        WriteFile(path, damaged);
+
+        WAL reader(config_);
+        std::vector<WAL::WALEntry> entries;
+        WAL::ReadReport report;
+        ASSERT_TRUE(reader.ReadWALFile(path, entries, &report));
+
+        ASSERT_EQ(entries.size(), record) << "flip at " << position;
+        EXPECT_TRUE(report.corrupted) << "flip at " << position;
+        EXPECT_EQ(report.valid_bytes, offsets[record]);
+        EXPECT_EQ(report.discarded_bytes, offsets.back() - offsets[record]);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            EXPECT_EQ(entries[i].key, "key:" + std::to_string(i));
+        }
+    }
+}
+
+TEST_F(WALCorruptionTest, RandomGarbageNeverCrashes) {
+    std::vector<size_t> offsets;
+    auto path = WriteRecords(1, offsets);
+    const std::string original = ReadFile(path);
+
+    std::mt19937 rng(99);
+    for (int trial = 0; trial < 200; ++trial) {
+        std::string damaged = original.substr(0, offsets[0]);
+        size_t garbage = rng() % 512;
+        for (size_t i = 0; i < garbage; ++i) {
+            damaged.push_back(static_cast<char>(rng()));
+        }
+        WriteFile(path, damaged);
+
+        WAL reader(config_);
+        std::vector<WAL::WALEntry> entries;
+        WAL::ReadReport report;
+        ASSERT_TRUE(reader.ReadWALFile(path, entries, &report));
+
+        EXPECT_TRUE(entries.empty());
+        EXPECT_EQ(report.valid_bytes, offsets[0]);
+        EXPECT_LE(report.discarded_bytes, garbage);
+    }
+}
+
+TEST_F(WALCorruptionTest, RecoveryTruncatesDamagedTail) {
+    std::vector<size_t> offsets;
+    auto path = WriteRecords(10, offsets);
+
+    // Damage the payload of record 6
+    std::string damaged = ReadFile(path);
+    damaged[offsets[6] + 12] ^= 0x40;
+    WriteFile(path, damaged);
+
+    auto recover = [&]() {
+        auto storage = std::make_shared<ShardedHashTable>(4);
+        auto wal = std::make_shared<WAL>(config_);
+
+        SnapshotManager::Config snapshot_config;
+        snapshot_config.node_id = "test-node";
+        snapshot_config.snapshot_dir = test_dir_ / "snapshots";
+        auto snapshots = std::make_shared<SnapshotManager>(
+            snapshot_config, storage, std::make_shared<Metrics>());
+
+        RecoveryManager::Config recovery_config;
+        recovery_config.node_id = "test-node";
+        recovery_config.snapshot_dir = snapshot_config.snapshot_dir;
+        recovery_config.wal_dir = test_dir_;
+        RecoveryManager recovery(recovery_config, storage, snapshots, wal);
+
+        auto result = recovery.Recover();
+        EXPECT_TRUE(result.success);
+        EXPECT_TRUE(storage->get("key:5").has_value());
+        EXPECT_FALSE(storage->get("key:6").has_value());
+        return result;
+    };
+
+    auto first = recover();
+    EXPECT_EQ(first.wal_entries_replayed, 6u);
+    EXPECT_EQ(first.wal_corrupt_files, 1u);
+    EXPECT_EQ(first.wal_bytes_discarded, offsets.back() - offsets[6]);
+    EXPECT_EQ(std::filesystem::file_size(path), offsets[6]);
+
+    auto second = recover();
+    EXPECT_EQ(second.wal_entries_replayed, 6u);
+    EXPECT_EQ(second.wal_corrupt_files, 0u);
+    EXPECT_EQ(second.wal_bytes_discarded, 0u);
+}
+
+TEST_F(WALCorruptionTest, RecoveryRefusesDamageBeforeLaterSegments) {
+    config_.max_log_files = 10;
+    std::filesystem::path first_segment;
+    std::vector<size_t> offsets;
+    {
+        WAL wal(config_);
+        wal.Open();
+        first_segment = test_dir_ / (wal.GetCurrentLogId() + ".wal");
+        for (int i = 0; i < 20; ++i) {
+            if (i == 10) {
+                ASSERT_TRUE(wal.RotateLog());
+            }
+            if (i < 10) {
+                offsets.push_back(wal.GetStats().current_file_size);
+            }
+            CacheEntry entry("key:" + std::to_string(i), std::vector<uint8_t>(20, 'v'));
+            ASSERT_TRUE(wal.AppendSet(entry.key, entry));
+        }
+        wal.Close();
+    }
+
+    // Damage record 6 of the first of the stream's two segments
+    std::string damaged = ReadFile(first_segment);
+    damaged[offsets[6] + 12] ^= 0x40;
+    WriteFile(first_segment, damaged);
+    auto size_before = std::filesystem::file_size(first_segment);
+
+    auto storage = std::make_shared<ShardedHashTable>(4);
+    auto wal = std::make_shared<WAL>(config_);
+    SnapshotManager::Config snapshot_config;
+    snapshot_config.node_id = "test-node";
+    snapshot_config.snapshot_dir = test_dir_ / "snapshots";
+    auto snapshots = std::make_shared<SnapshotManager>(
+        snapshot_config, storage, std::make_shared<Metrics>());
+    RecoveryManager::Config recovery_config;
+    recovery_config.node_id = "test-node";
+    recovery_config.snapshot_dir = snapshot_config.snapshot_dir;
+    recovery_config.wal_dir = test_dir_;
+    RecoveryManager recovery(recovery_config, storage, snapshots, wal);
+
+    // Replay stops at the hole instead of skipping it, and keeps the file
+    auto result = recovery.Recover();
+    EXPECT_FALSE(result.success);
+    EXPECT_NE(result.error_message.find(first_segment.filename().string()), std::string::npos);
+    EXPECT_EQ(result.wal_corrupt_files, 1u);
+    EXPECT_FALSE(storage->get("key:6").has_value());
+    EXPECT_FALSE(storage->get("key:15").has_value());
+    EXPECT_EQ(std::filesystem::file_size(first_segment), size_before);
+}
+
+TEST_F(WALCorruptionTest, DamagedCompressedBlockDropsWholeBatch) {
+    config_.enable_compression = true;
+    config_.group_commit_interval_us = 1000000;
+    config_.group_commit_max_records = 10;
+
+    std::filesystem::path path;
+    std::vector<size_t> batch_offsets;
+    {
+        WAL wal(config_);
+        wal.Open();
+        path = test_dir_ / (wal.GetCurrentLogId() + ".wal");
+
+        CacheEntry entry("k", std::vector<uint8_t>(200, 'z'));
+        for (int batch = 0; batch < 3; ++batch) {
+            batch_offsets.push_back(wal.GetStats().current_file_size);
+            for (int i = 0; i < 10; ++i) {
+                wal.on_set("key:" + std::to_string(batch * 10 + i), entry);
+            }
+            ASSERT_TRUE(wal.WaitForCommit(wal.GetLastSequenceNumber()));
+        }
+        ASSERT_EQ(wal.GetStats().total_compressed_blocks, 3u);
+        wal.Close();
+    }
+
+    // Damage the compressed bytes of the second block
+    std::string damaged = ReadFile(path);
+    damaged[batch_offsets[1] + 20] ^= 0x01;
+    WriteFile(path, damaged);
+
+    WAL reader(config_);
+    std::vector<WAL::WALEntry> entries;
+    WAL::ReadReport report;
+    ASSERT_TRUE(reader.ReadWALFile(path, entries, &report));
+
+    EXPECT_EQ(entries.size(), 10u);
+    EXPECT_TRUE(report.corrupted);
+    EXPECT_EQ(report.valid_bytes, batch_offsets[1]);
+}
+
+TEST_F(WALCorruptionTest, ReadsLegacyUnframedFiles) {
+    std::filesystem::create_directories(test_dir_);
+    auto path = test_dir_ / "wal-test-node-legacy.wal";
+
+    // Format 1: size-prefixed header and entries, no checksums
+    std::string data;
+    auto append_message = [&data](const google::protobuf::MessageLite& message) {
+        std::string bytes = message.SerializeAsString();
+        uint32_t size = static_cast<uint32_t>(bytes.size());
+        data.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        data.append(bytes);
+    };
+
+    v1::WALHeader header;
+    header.set_wal_id("wal-test-node-legacy");
+    header.set_node_id("test-node");
+    header.set_wal_version(1);
+    append_message(header);
+
+    for (int i = 1; i <= 3; ++i) {
+        v1::WALEntry entry;
+        entry.set_sequence_number(i);
+        entry.set_type(v1::WAL_ENTRY_SET);
+        entry.set_key("legacy:" + std::to_string(i));
+        entry.set_value("v");
+        entry.set_version(1);
+        append_message(entry);
+    }
+    WriteFile(path, data);
+
+    WAL reader(config_);
+    std::vector<WAL::WALEntry> entries;
+    WAL::ReadReport report;
+    ASSERT_TRUE(reader.ReadWALFile(path, entries, &report));
+
+    ASSERT_EQ(entries.size(), 3u);
+    EXPECT_EQ(entries[2].key, "legacy:3");
+    EXPECT_EQ(entries[2].sequence_number, 3);
+    EXPECT_FALSE(report.corrupted);
+    EXPECT_EQ(report.valid_bytes, data.size());
+}
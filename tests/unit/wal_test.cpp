@@ -0,0 +1,1341 @@
+#include <gtest/gtest.h>
+#include "distcache/wal.h"
+#include "distcache/cache_entry.h"
+#include "distcache/io_scheduler.h"
+#include "distcache/recovery_manager.h"
+#include "distcache/snapshot_manager.h"
+#include "distcache/storage_engine.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace distcache;
+
+class WALTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() /
+            ("distcache_wal_test_" + std::to_string(::getpid()) + "_" +
+             ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::remove_all(test_dir_);
+
+        config_.wal_dir = test_dir_;
+        config_.node_id = "test-node";
+        config_.sync_on_write = false;
+        config_.max_file_size_bytes = 1024 * 1024;  // Segments are preallocated
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    std::vector<WAL::WALEntry> ReadAll(WAL& wal) {
+        std::vector<WAL::WALEntry> entries;
+        for (const auto& id : wal.ListWALFiles()) {
+            EXPECT_TRUE(wal.ReadWALFile(test_dir_ / (id + ".wal"), entries));
+        }
+        return entries;
+    }
+
+    std::filesystem::path test_dir_;
+    WAL::Config config_;
+};
+
+// ====================
+// Record Encoding Tests
+// ====================
+
+TEST_F(WALTest, SetDeleteCASRoundTrip) {
+    WAL wal(config_);
+    wal.Open();
+    ASSERT_TRUE(wal.IsOpen());
+
+    CacheEntry set_entry("user:1", std::vector<uint8_t>{'a', 'b', 'c'}, 60);
+    set_entry.version = 7;
+    ASSERT_TRUE(wal.AppendSet("user:1", set_entry));
+    ASSERT_TRUE(wal.AppendDelete("user:2"));
+
+    CacheEntry cas_entry("user:3", std::vector<uint8_t>{'x'});
+    cas_entry.version = 4;
+    ASSERT_TRUE(wal.AppendCAS("user:3", cas_entry, 3));
+    wal.Close();
+
+    auto entries = ReadAll(wal);
+    ASSERT_EQ(entries.size(), 3u);
+
+    EXPECT_EQ(entries[0].type, WAL::WALEntry::SET);
+    EXPECT_EQ(entries[0].sequence_number, 1);
+    EXPECT_EQ(entries[0].key, "user:1");
+    EXPECT_EQ(entries[0].value, set_entry.value);
+    EXPECT_EQ(entries[0].version, 7);
+    EXPECT_EQ(entries[0].timestamp_ms, set_entry.created_at_ms);
+    ASSERT_TRUE(entries[0].ttl_seconds.has_value());
+    EXPECT_EQ(*entries[0].ttl_seconds, 60);
+    EXPECT_FALSE(entries[0].expected_version.has_value());
+
+    EXPECT_EQ(entries[1].type, WAL::WALEntry::DELETE);
+    EXPECT_EQ(entries[1].sequence_number, 2);
+    EXPECT_EQ(entries[1].key, "user:2");
+    EXPECT_TRUE(entries[1].value.empty());
+    EXPECT_FALSE(entries[1].ttl_seconds.has_value());
+
+    EXPECT_EQ(entries[2].type, WAL::WALEntry::CAS);
+    EXPECT_EQ(entries[2].sequence_number, 3);
+    EXPECT_EQ(entries[2].version, 4);
+    ASSERT_TRUE(entries[2].expected_version.has_value());
+    EXPECT_EQ(*entries[2].expected_version, 3);
+}
+
+TEST_F(WALTest, EdgeValuesRoundTrip) {
+    WAL wal(config_);
+    wal.Open();
+
+    // Negative TTL and zero version exercise sign extension and omitted
+    // default fields; the large binary value needs a multi-byte length
+    std::vector<uint8_t> large(300000);
+    for (size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<uint8_t>(i * 31);
+    }
+    CacheEntry entry("bin", large, -5);
+    entry.version = 0;
+    ASSERT_TRUE(wal.AppendSet("bin", entry));
+
+    CacheEntry empty("empty", std::vector<uint8_t>{});
+    ASSERT_TRUE(wal.AppendSet("empty", empty));
+    wal.Close();
+
+    auto entries = ReadAll(wal);
+    ASSERT_EQ(entries.size(), 2u);
+
+    EXPECT_EQ(entries[0].value, large);
+    EXPECT_EQ(entries[0].version, 0);
+    ASSERT_TRUE(entries[0].ttl_seconds.has_value());
+    EXPECT_EQ(*entries[0].ttl_seconds, -5);
+
+    EXPECT_EQ(entries[1].key, "empty");
+    EXPECT_TRUE(entries[1].value.empty());
+}
+
+TEST_F(WALTest, StatsTrackWrites) {
+    WAL wal(config_);
+    wal.Open();
+
+    size_t initial_size = wal.GetCurrentLogSize();
+    CacheEntry entry("k", std::vector<uint8_t>{'v'});
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(wal.AppendSet("k", entry));
+    }
+
+    auto stats = wal.GetStats();
+    EXPECT_EQ(stats.total_entries_written, 10u);
+    EXPECT_EQ(stats.last_sequence_number, 10);
+    EXPECT_GT(stats.current_file_size, initial_size);
+    wal.Close();
+}
+
+TEST_F(WALTest, AppendFailsWhenClosed) {
+    WAL wal(config_);
+    CacheEntry entry("k", std::vector<uint8_t>{'v'});
+    EXPECT_FALSE(wal.AppendSet("k", entry));
+}
+
+// ====================
+// Group Commit Tests
+// ====================
+
+TEST_F(WALTest, ConcurrentAppendsShareGroupCommits) {
+    config_.sync_on_write = true;
+    config_.group_commit_interval_us = 2000;
+    WAL wal(config_);
+    wal.Open();
+
+    constexpr int kThreads = 8;
+    constexpr int kPerThread = 50;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&wal, t] {
+            for (int i = 0; i < kPerThread; ++i) {
+                std::string key = "t" + std::to_string(t) + ":" + std::to_string(i);
+                CacheEntry entry(key, std::vector<uint8_t>{'v'});
+                EXPECT_TRUE(wal.AppendSet(key, entry));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto stats = wal.GetStats();
+    EXPECT_EQ(stats.total_entries_written, static_cast<uint64_t>(kThreads * kPerThread));
+    EXPECT_LT(stats.total_group_commits, stats.total_entries_written);
+    EXPECT_GT(stats.max_group_commit_records, 1u);
+    EXPECT_EQ(stats.total_syncs, stats.total_group_commits + 1);  // + file header
+    wal.Close();
+
+    // Records land in the log in sequence order
+    auto entries = ReadAll(wal);
+    ASSERT_EQ(entries.size(), static_cast<size_t>(kThreads * kPerThread));
+    for (size_t i = 0; i < entries.size(); ++i) {
+        EXPECT_EQ(entries[i].sequence_number, static_cast<int64_t>(i + 1));
+    }
+}
+
+TEST_F(WALTest, BatchLimitCommitsWithoutWaitingForInterval) {
+    config_.group_commit_interval_us = 10 * 1000 * 1000;  // Would stall the test
+    config_.group_commit_max_records = 1;
+    WAL wal(config_);
+    wal.Open();
+
+    auto start = std::chrono::steady_clock::now();
+    CacheEntry entry("k", std::vector<uint8_t>{'v'});
+    ASSERT_TRUE(wal.AppendSet("k", entry));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    wal.Close();
+}
+
+TEST_F(WALTest, MutationListenerLogsStorageWrites) {
+    WAL wal(config_);
+    wal.Open();
+
+    ShardedHashTable storage(4);
+    storage.set_mutation_listener(&wal);
+
+    storage.set("a", CacheEntry("a", std::vector<uint8_t>{'1'}));
+    storage.compare_and_swap("a", 1, CacheEntry("a", std::vector<uint8_t>{'2'}));
+    storage.set("b", CacheEntry("b", std::vector<uint8_t>{'3'}));
+    storage.del("b");
+    storage.del("missing");  // Not applied, not logged
+    storage.set_mutation_listener(nullptr);
+
+    ASSERT_TRUE(wal.WaitForCommit(wal.GetLastSequenceNumber()));
+    wal.Close();
+
+    auto entries = ReadAll(wal);
+    ASSERT_EQ(entries.size(), 4u);
+    EXPECT_EQ(entries[0].type, WAL::WALEntry::SET);
+    EXPECT_EQ(entries[1].type, WAL::WALEntry::SET);
+    EXPECT_EQ(entries[1].version, 2);  // Version as stored by the CAS
+    EXPECT_EQ(entries[1].value, std::vector<uint8_t>{'2'});
+    EXPECT_EQ(entries[2].key, "b");
+    EXPECT_EQ(entries[3].type, WAL::WALEntry::DELETE);
+    EXPECT_EQ(entries[3].key, "b");
+}
+
+TEST_F(WALTest, WritersWaitForTheirOwnSequence) {
+    WAL wal(config_);
+    wal.Open();
+    ShardedHashTable storage(4);
+    storage.set_mutation_listener(&wal);
+
+    storage.set("mine", CacheEntry("mine", std::vector<uint8_t>{'1'}));
+    const int64_t mine = WAL::LastSubmittedSequence();
+
+    // A later writer's records do not move this thread's sequence
+    std::thread([&storage] {
+        for (int i = 0; i < 10; ++i) {
+            storage.set("theirs", CacheEntry("theirs", std::vector<uint8_t>{'2'}));
+        }
+        EXPECT_EQ(WAL::LastSubmittedSequence(), 11);
+    }).join();
+
+    EXPECT_EQ(mine, 1);
+    EXPECT_EQ(WAL::LastSubmittedSequence(), mine);
+    EXPECT_TRUE(wal.WaitForCommit(mine));
+    storage.set_mutation_listener(nullptr);
+    wal.Close();
+}
+
+TEST_F(WALTest, OwnCommitsCoverEveryStreamTheThreadWrote) {
+    config_.num_streams = 4;
+    WAL wal(config_);
+    wal.Open();
+    ShardedHashTable storage(4);
+    storage.set_mutation_listener(&wal);
+
+    // A thread that queued nothing has nothing to wait for
+    EXPECT_TRUE(wal.WaitForOwnCommits());
+
+    for (int i = 0; i < 16; ++i) {
+        std::string key = "k" + std::to_string(i);
+        storage.set(key, CacheEntry(key, std::vector<uint8_t>{'v'}));
+    }
+    ASSERT_TRUE(wal.WaitForOwnCommits());
+    EXPECT_EQ(ReadAll(wal).size(), 16u);
+
+    // Another thread's waits are independent of this one's records
+    std::thread([&wal] { EXPECT_TRUE(wal.WaitForOwnCommits()); }).join();
+
+    storage.set_mutation_listener(nullptr);
+    wal.Close();
+}
+
+TEST_F(WALTest, ResumeContinuesSequenceNumbers) {
+    WAL wal(config_);
+    wal.ResumeFromSequence(41);
+    wal.Open();
+
+    ASSERT_TRUE(wal.AppendDelete("k"));
+    EXPECT_EQ(wal.GetLastSequenceNumber(), 42);
+    wal.Close();
+}
+
+// ====================
+// Recovery Tests
+// ====================
+
+TEST_F(WALTest, RecoveryReplaysLoggedWrites) {
+    int64_t last_sequence = 0;
+    {
+        WAL wal(config_);
+        wal.Open();
+
+        ShardedHashTable storage(4);
+        storage.set_mutation_listener(&wal);
+        storage.set("keep", CacheEntry("keep", std::vector<uint8_t>{'k'}, 3600));
+        storage.set("gone", CacheEntry("gone", std::vector<uint8_t>{'g'}));
+        storage.del("gone");
+        storage.set_mutation_listener(nullptr);
+
+        ASSERT_TRUE(wal.Sync());
+        last_sequence = wal.GetLastSequenceNumber();
+        wal.Close();
+    }
+
+    auto storage = std::make_shared<ShardedHashTable>(4);
+    auto wal = std::make_shared<WAL>(config_);
+
+    SnapshotManager::Config snapshot_config;
+    snapshot_config.node_id = "test-node";
+    snapshot_config.snapshot_dir = test_dir_ / "snapshots";
+    auto snapshots = std::make_shared<SnapshotManager>(
+        snapshot_config, storage, std::make_shared<Metrics>());
+
+    RecoveryManager::Config recovery_config;
+    recovery_config.node_id = "test-node";
+    recovery_config.snapshot_dir = snapshot_config.snapshot_dir;
+    recovery_config.wal_dir = test_dir_;
+    RecoveryManager recovery(recovery_config, storage, snapshots, wal);
+
+    auto result = recovery.Recover();
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.wal_entries_replayed, 3u);
+    EXPECT_EQ(result.last_sequence_number, last_sequence);
+
+    auto keep = storage->get("keep");
+    ASSERT_TRUE(keep.has_value());
+    EXPECT_EQ(keep->value, std::vector<uint8_t>{'k'});
+    ASSERT_TRUE(keep->ttl_seconds.has_value());
+    EXPECT_EQ(*keep->ttl_seconds, 3600);
+    EXPECT_FALSE(storage->get("gone").has_value());
+}
+
+TEST_F(WALTest, LazyRecoveryReplaysTheLogOverAPendingSnapshot) {
+    auto storage = std::make_shared<ShardedHashTable>(4);
+    auto wal = std::make_shared<WAL>(config_);
+
+    SnapshotManager::Config snapshot_config;
+    snapshot_config.node_id = "test-node";
+    snapshot_config.snapshot_dir = test_dir_ / "snapshots";
+    {
+        // Snapshot taken without a watermark, so the whole log replays on top
+        SnapshotManager snapshots(snapshot_config, storage, std::make_shared<Metrics>());
+        for (int i = 0; i < 100; ++i) {
+            std::string key = "snap_" + std::to_string(i);
+            storage->set(key, CacheEntry(key, std::vector<uint8_t>{'s'}));
+        }
+        ASSERT_FALSE(snapshots.CreateSnapshot().empty());
+
+        WAL writer(config_);
+        writer.Open();
+        storage->set_mutation_listener(&writer);
+        storage->set("snap_0", CacheEntry("snap_0", std::vector<uint8_t>{'w'}));
+        storage->del("snap_1");
+        storage->set("logged", CacheEntry("logged", std::vector<uint8_t>{'w'}));
+        storage->set_mutation_listener(nullptr);
+        ASSERT_TRUE(writer.Sync());
+        writer.Close();
+    }
+
+    auto restored = std::make_shared<ShardedHashTable>(4);
+    auto snapshots = std::make_shared<SnapshotManager>(
+        snapshot_config, restored, std::make_shared<Metrics>());
+    RecoveryManager::Config recovery_config;
+    recovery_config.node_id = "test-node";
+    recovery_config.snapshot_dir = snapshot_config.snapshot_dir;
+    recovery_config.wal_dir = test_dir_;
+    recovery_config.lazy_restore = true;
+    RecoveryManager recovery(recovery_config, restored, snapshots, wal);
+
+    auto result = recovery.Recover();
+    ASSERT_TRUE(result.success);
+    EXPECT_TRUE(result.snapshot_lazy);
+    EXPECT_EQ(result.wal_entries_replayed, 3u);
+
+    EXPECT_EQ(restored->get("snap_0")->value, std::vector<uint8_t>{'w'});
+    EXPECT_FALSE(restored->get("snap_1").has_value());
+    EXPECT_EQ(restored->get("snap_2")->value, std::vector<uint8_t>{'s'});
+    EXPECT_TRUE(restored->exists("logged"));
+
+    snapshots->WaitForLazyRestore();
+    EXPECT_EQ(restored->size(), 100u);
+}
+
+TEST_F(WALTest, SnapshotWatermarkSkipsCoveredRecordsAndTruncates) {
+    config_.max_file_size_bytes = 64 * 1024;
+    config_.max_log_files = 1000;
+
+    auto make_recovery = [this](std::shared_ptr<ShardedHashTable> storage,
+                                std::shared_ptr<WAL> wal,
+                                std::shared_ptr<SnapshotManager>& snapshots) {
+        SnapshotManager::Config snapshot_config;
+        snapshot_config.node_id = "test-node";
+        snapshot_config.snapshot_dir = test_dir_ / "snapshots";
+        snapshots = std::make_shared<SnapshotManager>(
+            snapshot_config, storage, std::make_shared<Metrics>());
+
+        RecoveryManager::Config recovery_config;
+        recovery_config.node_id = "test-node";
+        recovery_config.snapshot_dir = snapshot_config.snapshot_dir;
+        recovery_config.wal_dir = test_dir_;
+        return std::make_unique<RecoveryManager>(recovery_config, storage, snapshots, wal);
+    };
+
+    {
+        auto storage = std::make_shared<ShardedHashTable>(4);
+        auto wal = std::make_shared<WAL>(config_);
+        std::shared_ptr<SnapshotManager> snapshots;
+        auto recovery = make_recovery(storage, wal, snapshots);
+        ASSERT_TRUE(recovery->Recover().success);
+        recovery->LinkSnapshotsToWAL();
+
+        wal->Open();
+        storage->set_mutation_listener(wal.get());
+
+        CacheEntry entry("k", std::vector<uint8_t>(200, 'a'));
+        for (int i = 0; i < 1000; ++i) {
+            storage->set("before:" + std::to_string(i), entry);
+            if (i % 100 == 99) {
+                ASSERT_TRUE(wal->Sync());  // Keep batches well under a segment
+            }
+        }
+        size_t files_before = wal->ListWALFiles().size();
+        ASSERT_GT(files_before, 2u);
+
+        // The snapshot covers everything so far and retires the old segments
+        std::string snapshot_id = snapshots->CreateSnapshot();
+        ASSERT_FALSE(snapshot_id.empty());
+        EXPECT_EQ(snapshots->GetSnapshotMetadata(snapshot_id)->wal_sequence, 1000);
+        EXPECT_LT(wal->ListWALFiles().size(), files_before);
+
+        for (int i = 0; i < 10; ++i) {
+            storage->set("after:" + std::to_string(i), entry);
+        }
+        ASSERT_TRUE(wal->Sync());
+        storage->set_mutation_listener(nullptr);
+        wal->Close();
+    }
+
+    auto storage = std::make_shared<ShardedHashTable>(4);
+    auto wal = std::make_shared<WAL>(config_);
+    std::shared_ptr<SnapshotManager> snapshots;
+    auto recovery = make_recovery(storage, wal, snapshots);
+
+    auto result = recovery->Recover();
+    ASSERT_TRUE(result.success);
+    EXPECT_TRUE(result.snapshot_restored);
+    EXPECT_EQ(result.snapshot_sequence, 1000);
+    EXPECT_EQ(result.wal_entries_replayed, 10u);
+    EXPECT_EQ(result.last_sequence_number, 1010);
+    EXPECT_EQ(storage->size(), 1010u);
+
+    // Cold-start time is split into its two phases
+    EXPECT_GE(result.recovery_duration_ms, result.snapshot_restore_ms);
+    EXPECT_GE(result.recovery_duration_ms, result.wal_replay_ms);
+}
+
+TEST_F(WALTest, FailedSnapshotFallsBackOnlyWhenTheWALStillCoversIt) {
+    config_.max_file_size_bytes = 64 * 1024;
+    config_.max_log_files = 1000;
+
+    SnapshotManager::Config snapshot_config;
+    snapshot_config.node_id = "test-node";
+    snapshot_config.snapshot_dir = test_dir_ / "snapshots";
+    RecoveryManager::Config recovery_config;
+    recovery_config.node_id = "test-node";
+    recovery_config.snapshot_dir = snapshot_config.snapshot_dir;
+    recovery_config.wal_dir = test_dir_;
+
+    std::string older_id;
+    std::string latest_id;
+    {
+        auto storage = std::make_shared<ShardedHashTable>(4);
+        auto wal = std::make_shared<WAL>(config_);
+        SnapshotManager snapshots(snapshot_config, storage, std::make_shared<Metrics>());
+        snapshots.SetSequenceSource([&wal] { return wal->GetLastSequenceNumber(); });
+        wal->Open();
+        storage->set_mutation_listener(wal.get());
+
+        // Two snapshots; nothing is truncated, so the log covers both
+        CacheEntry entry("k", std::vector<uint8_t>(200, 'a'));
+        for (int i = 0; i < 1000; ++i) {
+            storage->set("key:" + std::to_string(i), entry);
+            if (i % 100 == 99) {
+                ASSERT_TRUE(wal->Sync());
+            }
+            if (i == 499) {
+                older_id = snapshots.CreateSnapshot();
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        latest_id = snapshots.CreateSnapshot();
+        ASSERT_FALSE(older_id.empty());
+        ASSERT_FALSE(latest_id.empty());
+        ASSERT_NE(older_id, latest_id);
+        EXPECT_EQ(snapshots.GetSnapshotMetadata(older_id)->wal_sequence, 500);
+
+        // The latest snapshot is damaged
+        std::ofstream(snapshots.GetSnapshotMetadata(latest_id)->file_path,
+                      std::ios::binary | std::ios::trunc) << "not a snapshot";
+
+        storage->set_mutation_listener(nullptr);
+        wal->Close();
+    }
+
+    auto recover = [&](std::shared_ptr<ShardedHashTable> storage) {
+        auto wal = std::make_shared<WAL>(config_);
+        auto snapshots = std::make_shared<SnapshotManager>(
+            snapshot_config, storage, std::make_shared<Metrics>());
+        RecoveryManager recovery(recovery_config, storage, snapshots, wal);
+        return recovery.Recover();
+    };
+
+    auto storage = std::make_shared<ShardedHashTable>(4);
+    auto result = recover(storage);
+    ASSERT_TRUE(result.success) << result.error_message;
+    EXPECT_EQ(result.snapshot_id, older_id);
+    EXPECT_EQ(result.wal_entries_replayed, 500u);
+    EXPECT_EQ(storage->size(), 1000u);
+
+    // Once the log is cut past the older snapshot, neither it nor the
+    // empty state is complete, so recovery refuses to guess
+    {
+        WAL wal(config_);
+        wal.ResumeFromSequence(1000);
+        wal.Open();
+        CacheEntry entry("k", std::vector<uint8_t>{'b'});
+        ASSERT_TRUE(wal.AppendSet("key:0", entry));
+        wal.TruncateBeforeSequence(1001);
+        wal.Close();
+        EXPECT_EQ(wal.GetFirstSequenceNumber(), 1001);
+    }
+    result = recover(std::make_shared<ShardedHashTable>(4));
+    EXPECT_FALSE(result.success);
+    EXPECT_FALSE(result.error_message.empty());
+}
+
+TEST_F(WALTest, ParallelReplayMergesFilesAndKeepsPerKeyOrder) {
+    config_.max_file_size_bytes = 64 * 1024;  // Force many segments
+    config_.max_log_files = 1000;
+
+    // Every key is overwritten many times, interleaved with other keys
+    // and spread over several files; only the last write may survive
+    constexpr int kKeys = 64;
+    constexpr int kRounds = 100;
+    {
+        WAL wal(config_);
+        wal.Open();
+        for (int round = 0; round < kRounds; ++round) {
+            for (int k = 0; k < kKeys; ++k) {
+                CacheEntry entry("key:" + std::to_string(k),
+                                 std::vector<uint8_t>(64, static_cast<uint8_t>(round)));
+                wal.on_set(entry.key, entry);
+            }
+            if (round % 10 == 9) {
+                ASSERT_TRUE(wal.AppendDelete("key:0"));
+            }
+        }
+        ASSERT_TRUE(wal.Sync());
+        EXPECT_GT(wal.ListWALFiles().size(), 3u);
+        wal.Close();
+    }
+
+    auto storage = std::make_shared<ShardedHashTable>(16);
+    auto wal = std::make_shared<WAL>(config_);
+
+    SnapshotManager::Config snapshot_config;
+    snapshot_config.node_id = "test-node";
+    snapshot_config.snapshot_dir = test_dir_ / "snapshots";
+    auto snapshots = std::make_shared<SnapshotManager>(
+        snapshot_config, storage, std::make_shared<Metrics>());
+
+    std::vector<RecoveryManager::ReplayProgress> progress;
+    RecoveryManager::Config recovery_config;
+    recovery_config.node_id = "test-node";
+    recovery_config.snapshot_dir = snapshot_config.snapshot_dir;
+    recovery_config.wal_dir = test_dir_;
+    recovery_config.replay_threads = 4;
+    recovery_config.progress_callback = [&progress](const RecoveryManager::ReplayProgress& p) {
+        progress.push_back(p);
+    };
+    RecoveryManager recovery(recovery_config, storage, snapshots, wal);
+
+    auto result = recovery.Recover();
+    ASSERT_TRUE(result.success);
+    size_t total = kKeys * kRounds + kRounds / 10;
+    EXPECT_EQ(result.wal_entries_replayed, total);
+    EXPECT_EQ(result.last_sequence_number, static_cast<int64_t>(total));
+
+    // key:0 was deleted after its last write in round 99
+    EXPECT_FALSE(storage->get("key:0").has_value());
+    for (int k = 1; k < kKeys; ++k) {
+        auto entry = storage->get("key:" + std::to_string(k));
+        ASSERT_TRUE(entry.has_value());
+        EXPECT_EQ(entry->value[0], static_cast<uint8_t>(kRounds - 1));
+    }
+
+    ASSERT_FALSE(progress.empty());
+    EXPECT_EQ(progress.back().entries_applied, total);
+    EXPECT_EQ(progress.back().entries_read, total);
+    EXPECT_EQ(progress.back().files_done, progress.back().files_total);
+    EXPECT_GT(progress.back().bytes_read, 0u);
+}
+
+TEST_F(WALTest, ReaderStreamsEntriesInOrder) {
+    {
+        WAL wal(config_);
+        wal.Open();
+        CacheEntry entry("k", std::vector<uint8_t>{'v'});
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(wal.AppendSet("k" + std::to_string(i), entry));
+        }
+        wal.Close();
+    }
+
+    WAL wal(config_);
+    auto files = wal.ListWALFiles();
+    ASSERT_EQ(files.size(), 1u);
+
+    WAL::Reader reader(test_dir_ / (files[0] + ".wal"));
+    ASSERT_TRUE(reader.Open());
+    WAL::WALEntry entry;
+    int64_t expected = 1;
+    while (reader.Next(entry)) {
+        EXPECT_EQ(entry.sequence_number, expected++);
+    }
+    EXPECT_EQ(expected, 11);
+    EXPECT_FALSE(reader.report().corrupted);
+    EXPECT_EQ(reader.bytes_consumed(), reader.report().valid_bytes);
+}
+
+// ====================
+// Stream Tests
+// ====================
+
+TEST_F(WALTest, StreamsLogConcurrentWritersInTheirOwnDirectories) {
+    config_.num_streams = 4;
+    constexpr int kThreads = 8;
+    constexpr int kPerThread = 200;
+    {
+        WAL wal(config_);
+        wal.Open();
+        ASSERT_TRUE(wal.IsOpen());
+        EXPECT_EQ(wal.GetStats().num_streams, 4u);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&wal, t] {
+                for (int i = 0; i < kPerThread; ++i) {
+                    std::string key = "t" + std::to_string(t) + ":" + std::to_string(i % 10);
+                    CacheEntry entry(key, std::vector<uint8_t>{static_cast<uint8_t>(i)});
+                    ASSERT_TRUE(wal.AppendSet(key, entry));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        ASSERT_TRUE(wal.Sync());
+
+        auto stats = wal.GetStats();
+        EXPECT_EQ(stats.total_entries_written, static_cast<uint64_t>(kThreads * kPerThread));
+        EXPECT_EQ(stats.last_sequence_number, kThreads * kPerThread);
+        wal.Close();
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(std::filesystem::is_directory(test_dir_ / ("stream-" + std::to_string(i))));
+    }
+
+    // Every sequence number appears exactly once across the streams, and
+    // each stream file is in sequence order
+    WAL reader(config_);
+    std::vector<int64_t> sequences;
+    for (const auto& id : reader.ListWALFiles()) {
+        EXPECT_EQ(id.rfind("stream-", 0), 0u);
+        std::vector<WAL::WALEntry> entries;
+        ASSERT_TRUE(reader.ReadWALFile(test_dir_ / (id + ".wal"), entries));
+        for (size_t i = 1; i < entries.size(); ++i) {
+            EXPECT_LT(entries[i - 1].sequence_number, entries[i].sequence_number);
+        }
+        for (const auto& entry : entries) {
+            sequences.push_back(entry.sequence_number);
+        }
+    }
+    std::sort(sequences.begin(), sequences.end());
+    ASSERT_EQ(sequences.size(), static_cast<size_t>(kThreads * kPerThread));
+    for (size_t i = 0; i < sequences.size(); ++i) {
+        EXPECT_EQ(sequences[i], static_cast<int64_t>(i + 1));
+    }
+}
+
+TEST_F(WALTest, RecoveryMergesStreamsAcrossStreamCountChanges) {
+    // Log under one stream count, then under another: recovery must merge
+    // all of it by sequence so the last write of every key wins
+    constexpr int kKeys = 32;
+    int64_t last_sequence = 0;
+    for (size_t streams : {size_t{1}, size_t{3}, size_t{8}}) {
+        config_.num_streams = streams;
+        WAL wal(config_);
+        wal.ResumeFromSequence(last_sequence);
+        wal.Open();
+        for (int k = 0; k < kKeys; ++k) {
+            std::string key = "key:" + std::to_string(k);
+            CacheEntry entry(key, std::vector<uint8_t>{static_cast<uint8_t>(streams)});
+            ASSERT_TRUE(wal.AppendSet(key, entry));
+        }
+        if (streams == 3) {
+            ASSERT_TRUE(wal.AppendDelete("key:0"));
+        }
+        ASSERT_TRUE(wal.Sync());
+        last_sequence = wal.GetLastSequenceNumber();
+        wal.Close();
+    }
+    ASSERT_TRUE(std::filesystem::exists(test_dir_ / "stream-7"));
+
+    auto storage = std::make_shared<ShardedHashTable>(16);
+    auto wal = std::make_shared<WAL>(config_);
+
+    SnapshotManager::Config snapshot_config;
+    snapshot_config.node_id = "test-node";
+    snapshot_config.snapshot_dir = test_dir_ / "snapshots";
+    auto snapshots = std::make_shared<SnapshotManager>(
+        snapshot_config, storage, std::make_shared<Metrics>());
+
+    RecoveryManager::Config recovery_config;
+    recovery_config.node_id = "test-node";
+    recovery_config.snapshot_dir = snapshot_config.snapshot_dir;
+    recovery_config.wal_dir = test_dir_;
+    recovery_config.replay_threads = 4;
+    RecoveryManager recovery(recovery_config, storage, snapshots, wal);
+
+    auto result = recovery.Recover();
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.wal_entries_replayed, static_cast<size_t>(3 * kKeys + 1));
+    EXPECT_EQ(result.last_sequence_number, last_sequence);
+    for (int k = 0; k < kKeys; ++k) {
+        auto entry = storage->get("key:" + std::to_string(k));
+        ASSERT_TRUE(entry.has_value());
+        EXPECT_EQ(entry->value, std::vector<uint8_t>{8});
+    }
+}
+
+TEST_F(WALTest, TruncationRetiresCoveredSegmentsOfEveryStream) {
+    config_.num_streams = 2;
+    config_.max_file_size_bytes = 16 * 1024;
+    config_.max_log_files = 1000;
+
+    WAL wal(config_);
+    wal.Open();
+    for (int i = 0; i < 2000; ++i) {
+        std::string key = "key:" + std::to_string(i);
+        CacheEntry entry(key, std::vector<uint8_t>(64, 'v'));
+        ASSERT_TRUE(wal.AppendSet(key, entry));
+    }
+    ASSERT_TRUE(wal.Sync());
+    size_t files_before = wal.ListWALFiles().size();
+    ASSERT_GT(files_before, 4u);
+
+    wal.TruncateBeforeSequence(wal.GetLastSequenceNumber() + 1);
+
+    // Only the segment each stream is writing survives
+    auto remaining = wal.ListWALFiles();
+    ASSERT_EQ(remaining.size(), 2u);
+    EXPECT_EQ(remaining[0].rfind("stream-0/", 0), 0u);
+    EXPECT_EQ(remaining[1].rfind("stream-1/", 0), 0u);
+}
+
+// ====================
+// Commit Log Tests
+// ====================
+
+TEST_F(WALTest, StreamsFeedOneOrderedDurableCommitLog) {
+    config_.num_streams = 4;
+    config_.group_commit_interval_us = 0;
+
+    CommitLog::Config log_config;
+    log_config.gate_on_durable = true;
+    log_config.max_bytes = 32 * (sizeof(CommitLog::Record) + 128);  // Forces eviction
+    auto log = std::make_shared<CommitLog>(log_config);
+
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 100;
+    WAL wal(config_);
+    wal.ResumeFromSequence(10);
+    wal.AttachCommitLog(log);
+    wal.Open();
+    ASSERT_TRUE(wal.IsOpen());
+    log->Acknowledge("replica", 10);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&wal, t] {
+            for (int i = 0; i < kPerThread; ++i) {
+                std::string key = "t" + std::to_string(t) + ":" + std::to_string(i);
+                CacheEntry entry(key, std::vector<uint8_t>(64, static_cast<uint8_t>(i)));
+                ASSERT_TRUE(wal.AppendSet(key, entry));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_TRUE(wal.AppendDelete("t0:0"));
+
+    const int64_t last = 10 + kThreads * kPerThread + 1;
+    EXPECT_TRUE(log->WaitForRecords(last - 1, std::chrono::seconds(5)));
+    EXPECT_EQ(log->ReadableSequence(), last);
+    EXPECT_GT(log->GetStats().records_evicted, 0u);
+
+    // Evicted records are read back from the segments, so a consumer
+    // starting at the beginning still sees every write once, in order
+    std::vector<CommitLog::RecordPtr> records;
+    int64_t through = 10;
+    while (through < last) {
+        through = log->Read(through, 50, records);
+        ASSERT_GT(through, 0);
+    }
+    ASSERT_EQ(records.size(), static_cast<size_t>(kThreads * kPerThread + 1));
+    for (size_t i = 0; i < records.size(); ++i) {
+        EXPECT_EQ(records[i]->sequence, static_cast<int64_t>(11 + i));
+    }
+    EXPECT_EQ(records.back()->op, CommitLog::Record::Op::DELETE);
+    EXPECT_EQ(records.back()->key, "t0:0");
+    EXPECT_EQ(records.front()->value_view().size(), 64u);
+    EXPECT_GT(log->GetStats().records_backfilled, 0u);
+
+    // Records still held in memory share the WAL's encoded batch
+    const auto& shared = records[records.size() - 2];
+    ASSERT_NE(shared->buffer, nullptr);
+    EXPECT_TRUE(shared->value.empty());
+    EXPECT_EQ(shared->value_view(), std::string(64, static_cast<char>(kPerThread - 1)));
+    wal.Close();
+}
+
+// ====================
+// Compaction Tests
+// ====================
+
+TEST_F(WALTest, CompactionKeepsLatestRecordPerKeyForRecovery) {
+    config_.num_streams = 2;
+    config_.max_log_files = 1000;
+
+    // Hot keys overwritten in every segment, plus one key deleted
+    constexpr int kKeys = 20;
+    constexpr int kSegments = 6;
+    int64_t last_sequence = 0;
+    {
+        WAL wal(config_);
+        wal.Open();
+        for (int segment = 0; segment < kSegments; ++segment) {
+            for (int k = 0; k < kKeys; ++k) {
+                std::string key = "hot:" + std::to_string(k);
+                CacheEntry entry(key, std::vector<uint8_t>{static_cast<uint8_t>(segment)});
+                ASSERT_TRUE(wal.AppendSet(key, entry));
+            }
+            ASSERT_TRUE(wal.RotateLog());
+        }
+        ASSERT_TRUE(wal.AppendDelete("hot:0"));
+        ASSERT_TRUE(wal.RotateLog());
+
+        size_t files_before = wal.ListWALFiles().size();
+        auto result = wal.CompactSegments();
+        EXPECT_EQ(result.records_read, static_cast<size_t>(kKeys * kSegments + 1));
+        EXPECT_EQ(result.records_kept, static_cast<size_t>(kKeys));
+        EXPECT_EQ(result.segments_compacted, files_before - 2);
+        EXPECT_LT(result.bytes_written, result.bytes_read);
+
+        // One compacted segment and the segment being written, per stream
+        EXPECT_EQ(wal.ListWALFiles().size(), 4u);
+        auto stats = wal.GetStats();
+        EXPECT_EQ(stats.total_compactions, 2u);
+        EXPECT_EQ(stats.total_records_compacted_away,
+                  static_cast<uint64_t>(kKeys * (kSegments - 1) + 1));
+
+        // Writes continue after the compacted segments
+        CacheEntry entry("hot:1", std::vector<uint8_t>{'z'});
+        ASSERT_TRUE(wal.AppendSet("hot:1", entry));
+        ASSERT_TRUE(wal.Sync());
+        last_sequence = wal.GetLastSequenceNumber();
+        wal.Close();
+    }
+
+    auto storage = std::make_shared<ShardedHashTable>(16);
+    auto wal = std::make_shared<WAL>(config_);
+
+    SnapshotManager::Config snapshot_config;
+    snapshot_config.node_id = "test-node";
+    snapshot_config.snapshot_dir = test_dir_ / "snapshots";
+    auto snapshots = std::make_shared<SnapshotManager>(
+        snapshot_config, storage, std::make_shared<Metrics>());
+
+    RecoveryManager::Config recovery_config;
+    recovery_config.node_id = "test-node";
+    recovery_config.snapshot_dir = snapshot_config.snapshot_dir;
+    recovery_config.wal_dir = test_dir_;
+    RecoveryManager recovery(recovery_config, storage, snapshots, wal);
+
+    auto result = recovery.Recover();
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.wal_entries_replayed, static_cast<size_t>(kKeys + 1));
+    EXPECT_EQ(result.last_sequence_number, last_sequence);
+
+    EXPECT_FALSE(storage->get("hot:0").has_value());
+    auto hot1 = storage->get("hot:1");
+    ASSERT_TRUE(hot1.has_value());
+    EXPECT_EQ(hot1->value, std::vector<uint8_t>{'z'});
+    for (int k = 2; k < kKeys; ++k) {
+        auto entry = storage->get("hot:" + std::to_string(k));
+        ASSERT_TRUE(entry.has_value());
+        EXPECT_EQ(entry->value, std::vector<uint8_t>{kSegments - 1});
+    }
+}
+
+TEST_F(WALTest, CompactionKeepsTombstonesUntilASnapshotCoversThem) {
+    WAL wal(config_);
+    wal.Open();
+
+    CacheEntry a("a", std::vector<uint8_t>{'a'});
+    CacheEntry c("c", std::vector<uint8_t>{'c'});
+    ASSERT_TRUE(wal.AppendSet("a", a));   // 1
+    ASSERT_TRUE(wal.AppendDelete("b"));   // 2
+    ASSERT_TRUE(wal.AppendSet("c", c));   // 3
+    ASSERT_TRUE(wal.AppendDelete("e"));   // 4
+    ASSERT_TRUE(wal.RotateLog());
+    ASSERT_TRUE(wal.AppendSet("c", c));   // 5
+    ASSERT_TRUE(wal.RotateLog());
+
+    // A snapshot holding everything up to sequence 2; the first segment
+    // also has later records, so truncation keeps it
+    wal.TruncateBeforeSequence(3);
+    ASSERT_EQ(wal.ListWALFiles().size(), 3u);
+
+    auto result = wal.CompactSegments(2);
+    EXPECT_EQ(result.segments_compacted, 2u);
+    EXPECT_EQ(result.records_kept, 2u);
+
+    auto entries = ReadAll(wal);
+    ASSERT_EQ(entries.size(), 2u);
+    EXPECT_EQ(entries[0].type, WAL::WALEntry::DELETE);
+    EXPECT_EQ(entries[0].key, "e");
+    EXPECT_EQ(entries[0].sequence_number, 4);
+    EXPECT_EQ(entries[1].key, "c");
+    EXPECT_EQ(entries[1].sequence_number, 5);
+
+    // Once a snapshot covers every compacted record the segment goes away
+    wal.TruncateBeforeSequence(6);
+    EXPECT_EQ(wal.ListWALFiles().size(), 1u);
+}
+
+TEST_F(WALTest, BackgroundCompactionRunsAndCleansUpInterruptedOutput) {
+    std::filesystem::create_directories(test_dir_);
+    std::ofstream(test_dir_ / "wal-test-node-1.compacting") << "partial";
+
+    config_.compaction_interval_ms = 10;
+    config_.compaction_min_segments = 3;
+    config_.max_log_files = 1000;
+    config_.enable_compression = true;
+    config_.compression_min_bytes = 64;
+
+    WAL wal(config_);
+    wal.Open();
+    EXPECT_FALSE(std::filesystem::exists(test_dir_ / "wal-test-node-1.compacting"));
+
+    for (int segment = 0; segment < 4; ++segment) {
+        for (int k = 0; k < 50; ++k) {
+            std::string key = "key:" + std::to_string(k);
+            CacheEntry entry(key, std::vector<uint8_t>(32, static_cast<uint8_t>(segment)));
+            ASSERT_TRUE(wal.AppendSet(key, entry));
+        }
+        ASSERT_TRUE(wal.RotateLog());
+    }
+
+    for (int i = 0; i < 500 && wal.GetStats().total_compactions == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_GT(wal.GetStats().total_compactions, 0u);
+    wal.Close();
+
+    // Compaction may have run before the last segment closed; either way
+    // dead writes are gone and each key's latest record survives
+    auto entries = ReadAll(wal);
+    EXPECT_LT(entries.size(), 200u);
+    std::map<std::string, WAL::WALEntry> latest;
+    for (auto& entry : entries) {
+        latest[entry.key] = std::move(entry);
+    }
+    ASSERT_EQ(latest.size(), 50u);
+    for (const auto& [key, entry] : latest) {
+        EXPECT_EQ(entry.value, std::vector<uint8_t>(32, 3)) << key;
+    }
+}
+
+TEST_F(WALTest, CompactionIsPacedByTheIoScheduler) {
+    config_.max_log_files = 1000;
+    auto scheduler = std::make_shared<IoScheduler>();
+
+    WAL wal(config_);
+    wal.AttachIoScheduler(scheduler);
+    wal.Open();
+    for (int segment = 0; segment < 4; ++segment) {
+        for (int k = 0; k < 200; ++k) {
+            std::string key = "key:" + std::to_string(k);
+            CacheEntry entry(key, std::vector<uint8_t>(64, static_cast<uint8_t>(segment)));
+            ASSERT_TRUE(wal.AppendSet(key, entry));
+        }
+        ASSERT_TRUE(wal.RotateLog());
+    }
+
+    // Group commits are foreground work and never charged
+    EXPECT_EQ(scheduler->GetStats().requests, 0u);
+
+    // Compaction reads and writes take about a second at this budget
+    IoScheduler::Config io;
+    io.bytes_per_second = 64 * 1024;
+    io.burst_bytes = 4096;
+    io.adaptive = false;
+    scheduler->Reconfigure(io);
+    auto result = wal.CompactSegments();
+    ASSERT_GT(result.segments_compacted, 0u);
+    EXPECT_EQ(scheduler->GetStats().bytes_granted, result.bytes_read + result.bytes_written);
+    EXPECT_GT(wal.GetStats().io_throttled_ms, 0u);
+
+    // Backfill reads for lagging consumers are charged too
+    uint64_t before = scheduler->GetStats().bytes_granted;
+    io.bytes_per_second = 0;
+    scheduler->Reconfigure(io);
+    std::vector<WAL::WALEntry> entries;
+    ASSERT_TRUE(wal.ReadEntriesAfter(0, wal.GetLastSequenceNumber(), 10, entries));
+    EXPECT_EQ(entries.size(), 10u);
+    EXPECT_GT(scheduler->GetStats().bytes_granted, before);
+    wal.Close();
+}
+
+TEST_F(WALTest, BackfillRefusesRangesRemovedFromDisk) {
+    config_.max_log_files = 100;
+    WAL wal(config_);
+    wal.Open();
+    for (int segment = 0; segment < 3; ++segment) {
+        for (int i = 0; i < 10; ++i) {
+            std::string key = "key:" + std::to_string(segment * 10 + i);
+            ASSERT_TRUE(wal.AppendSet(key, CacheEntry(key, std::vector<uint8_t>{'v'})));
+        }
+        ASSERT_TRUE(wal.RotateLog());
+    }
+
+    // Ranges are found by where each segment starts
+    std::vector<WAL::WALEntry> entries;
+    ASSERT_TRUE(wal.ReadEntriesAfter(12, 25, 100, entries));
+    ASSERT_EQ(entries.size(), 13u);
+    EXPECT_EQ(entries.front().sequence_number, 13);
+    EXPECT_EQ(entries.back().sequence_number, 25);
+
+    // Records 1-10 go with the first segment
+    wal.TruncateBeforeSequence(15);
+    entries.clear();
+    EXPECT_FALSE(wal.ReadEntriesAfter(0, 30, 100, entries));
+    EXPECT_FALSE(wal.ReadEntriesAfter(9, 30, 100, entries));
+    EXPECT_TRUE(entries.empty());
+
+    ASSERT_TRUE(wal.ReadEntriesAfter(10, 30, 100, entries));
+    ASSERT_EQ(entries.size(), 20u);
+    EXPECT_EQ(entries.front().sequence_number, 11);
+    wal.Close();
+}
+
+// ====================
+// Segment Tests
+// ====================
+
+TEST_F(WALTest, SegmentIsPreallocatedAndOverwrittenInPlace) {
+    WAL wal(config_);
+    wal.Open();
+
+    auto path = test_dir_ / (wal.GetCurrentLogId() + ".wal");
+    size_t allocated = std::filesystem::file_size(path);
+    EXPECT_GE(allocated, config_.max_file_size_bytes);
+
+    CacheEntry entry("k", std::vector<uint8_t>(100, 'v'));
+    for (int i = 0; i < 50; ++i) {
+        ASSERT_TRUE(wal.AppendSet("k", entry));
+    }
+
+    // Appends fill the preallocated segment without growing it
+    EXPECT_EQ(std::filesystem::file_size(path), allocated);
+    EXPECT_LT(wal.GetCurrentLogSize(), allocated);
+    wal.Close();
+
+    EXPECT_EQ(ReadAll(wal).size(), 50u);
+}
+
+TEST_F(WALTest, SegmentNamesSortInCreationOrder) {
+    config_.max_log_files = 100;
+    WAL wal(config_);
+    wal.Open();
+
+    // Far more rotations than milliseconds, so many share a timestamp
+    std::vector<std::string> created{wal.GetCurrentLogId()};
+    for (int i = 0; i < 30; ++i) {
+        ASSERT_TRUE(wal.RotateLog());
+        created.push_back(wal.GetCurrentLogId());
+    }
+    wal.Close();
+
+    EXPECT_EQ(wal.ListWALFiles(), created);
+}
+
+TEST_F(WALTest, RetiredSegmentsAreRecycled) {
+    config_.max_file_size_bytes = 64 * 1024;
+    config_.max_log_files = 1;
+    config_.max_recycled_segments = 2;
+    WAL wal(config_);
+    wal.Open();
+
+    // ~40 records per segment, so this rotates many times
+    constexpr int kRecords = 400;
+    CacheEntry entry("k", std::vector<uint8_t>(1500, 'v'));
+    for (int i = 0; i < kRecords; ++i) {
+        ASSERT_TRUE(wal.AppendSet("k", entry));
+    }
+
+    auto stats = wal.GetStats();
+    EXPECT_GT(stats.total_rotations, 5u);
+    EXPECT_GT(stats.total_segments_recycled, 0u);
+    wal.Close();
+
+    // Only the newest segment remains; stale records from its previous
+    // life must not be read back
+    auto entries = ReadAll(wal);
+    ASSERT_FALSE(entries.empty());
+    EXPECT_EQ(entries.back().sequence_number, kRecords);
+    for (size_t i = 1; i < entries.size(); ++i) {
+        EXPECT_EQ(entries[i].sequence_number, entries[i - 1].sequence_number + 1);
+    }
+}
+
+TEST_F(WALTest, DirectIORoundTrip) {
+    // O_DIRECT falls back to buffered I/O where the filesystem refuses it
+    config_.use_direct_io = true;
+    config_.sync_on_write = true;
+    WAL wal(config_);
+    wal.Open();
+    ASSERT_TRUE(wal.IsOpen());
+
+    CacheEntry entry("key", std::vector<uint8_t>(5000, 'x'), 30);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(wal.AppendSet("key", entry));
+    }
+    wal.Close();
+
+    auto entries = ReadAll(wal);
+    ASSERT_EQ(entries.size(), 3u);
+    EXPECT_EQ(entries[2].value, entry.value);
+}
+
+TEST_F(WALTest, IOUringCommitsAcrossRotationsInSequenceOrder) {
+    // Falls back to pwrite/fdatasync where io_uring is unavailable
+    config_.use_io_uring = true;
+    config_.sync_on_write = true;
+    config_.io_uring_depth = 3;
+    config_.max_file_size_bytes = 64 * 1024;
+    config_.max_log_files = 1000;
+    config_.group_commit_interval_us = 0;
+
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 150;
+    {
+        WAL wal(config_);
+        wal.Open();
+        ASSERT_TRUE(wal.IsOpen());
+        EXPECT_EQ(wal.GetStats().io_uring, IORing::IsSupported());
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&wal, t] {
+                for (int i = 0; i < kPerThread; ++i) {
+                    std::string key = "t" + std::to_string(t) + ":" + std::to_string(i);
+                    CacheEntry entry(key, std::vector<uint8_t>(300, static_cast<uint8_t>(i)));
+                    ASSERT_TRUE(wal.AppendSet(key, entry));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        ASSERT_TRUE(wal.RotateLog());
+        ASSERT_TRUE(wal.AppendDelete("t0:0"));
+
+        auto stats = wal.GetStats();
+        EXPECT_EQ(stats.total_entries_written, static_cast<uint64_t>(kThreads * kPerThread + 1));
+        EXPECT_GT(stats.total_rotations, 1u);
+        EXPECT_GE(stats.total_syncs, stats.total_group_commits);
+        EXPECT_EQ(stats.fsync_latency.count, stats.total_syncs);
+        wal.Close();
+    }
+
+    WAL reader(config_);
+    auto entries = ReadAll(reader);
+    ASSERT_EQ(entries.size(), static_cast<size_t>(kThreads * kPerThread + 1));
+    for (size_t i = 0; i < entries.size(); ++i) {
+        EXPECT_EQ(entries[i].sequence_number, static_cast<int64_t>(i + 1));
+    }
+    EXPECT_EQ(entries.back().type, WAL::WALEntry::DELETE);
+}
+
+TEST_F(WALTest, StatsRecordSyncLatency) {
+    config_.sync_on_write = true;
+    WAL wal(config_);
+    wal.Open();
+
+    CacheEntry entry("k", std::vector<uint8_t>{'v'});
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(wal.AppendSet("k", entry));
+    }
+
+    auto stats = wal.GetStats();
+    EXPECT_EQ(stats.fsync_latency.count, stats.total_syncs);
+    EXPECT_EQ(stats.write_latency.count, stats.total_group_commits + 1);  // + header
+    EXPECT_GE(stats.fsync_latency.percentile_us(99), stats.fsync_latency.percentile_us(50));
+    wal.Close();
+}
+
+// ====================
+// Compression Tests
+// ====================
+
+TEST_F(WALTest, CompressedBatchesRoundTrip) {
+    config_.enable_compression = true;
+    config_.group_commit_interval_us = 1000000;
+    config_.group_commit_max_records = 64;
+
+    {
+        WAL wal(config_);
+        wal.Open();
+
+        // Value-heavy, repetitive payloads, queued without waiting so
+        // they commit in full batches
+        CacheEntry entry("doc", std::vector<uint8_t>(512, 'x'));
+        for (int i = 0; i < 256; ++i) {
+            std::string key = "doc:" + std::to_string(i);
+            entry.value[0] = static_cast<uint8_t>(i);
+            wal.on_set(key, entry);
+        }
+        ASSERT_TRUE(wal.Sync());
+
+        auto stats = wal.GetStats();
+        EXPECT_EQ(stats.total_entries_written, 256u);
+        EXPECT_GE(stats.total_compressed_blocks, 1u);
+        EXPECT_EQ(stats.total_compressed_blocks, stats.total_group_commits);
+        EXPECT_LT(stats.total_written_bytes, stats.total_record_bytes);
+        EXPECT_GT(stats.compression_ratio, 4.0);
+        wal.Close();
+    }
+
+    WAL reader(config_);
+    auto entries = ReadAll(reader);
+    ASSERT_EQ(entries.size(), 256u);
+    for (int i = 0; i < 256; ++i) {
+        EXPECT_EQ(entries[i].sequence_number, i + 1);
+        EXPECT_EQ(entries[i].key, "doc:" + std::to_string(i));
+        ASSERT_EQ(entries[i].value.size(), 512u);
+        EXPECT_EQ(entries[i].value[0], static_cast<uint8_t>(i));
+    }
+}
+
+TEST_F(WALTest, SmallBatchesStayUncompressed) {
+    config_.enable_compression = true;
+    config_.compression_min_bytes = 4096;
+
+    WAL wal(config_);
+    wal.Open();
+    CacheEntry entry("k", std::vector<uint8_t>(16, 'v'));
+    ASSERT_TRUE(wal.AppendSet("k", entry));
+
+    auto stats = wal.GetStats();
+    EXPECT_EQ(stats.total_compressed_blocks, 0u);
+    EXPECT_EQ(stats.total_written_bytes, stats.total_record_bytes);
+    EXPECT_DOUBLE_EQ(stats.compression_ratio, 1.0);
+    wal.Close();
+
+    EXPECT_EQ(ReadAll(wal).size(), 1u);
+}
+
+TEST(CompressionTest, CodecsRoundTrip) {
+    std::string input;
+    for (int i = 0; i < 10000; ++i) {
+        input += "record-" + std::to_string(i % 97) + ";";
+    }
+
+    for (auto codec : {compression::Codec::kNone, compression::Codec::kZlib,
+                       compression::Codec::kLZ4}) {
+        if (!compression::IsAvailable(codec)) {
+            continue;
+        }
+        std::string compressed = "prefix";
+        ASSERT_TRUE(compression::Compress(codec, input.data(), input.size(), compressed))
+            << compression::CodecName(codec);
+        ASSERT_EQ(compressed.compare(0, 6, "prefix"), 0);
+
+        std::string output;
+        ASSERT_TRUE(compression::Decompress(codec, compressed.data() + 6, compressed.size() - 6,
+                                            input.size(), output));
+        EXPECT_EQ(output, input) << compression::CodecName(codec);
+
+        // A wrong size or damaged input is rejected, not trusted
+        EXPECT_FALSE(compression::Decompress(codec, compressed.data() + 6,
+                                             compressed.size() - 6, input.size() + 1, output));
+    }
+    EXPECT_TRUE(compression::IsAvailable(compression::DefaultCodec()));
+}
+
+// ====================
+// Latency Histogram Tests
+// ====================
+
+TEST(LatencyHistogramTest, BucketsByPowerOfTwo) {
+    LatencyHistogram histogram;
+    histogram.record(std::chrono::nanoseconds(500));     // < 1us
+    histogram.record(std::chrono::microseconds(3));      // [2, 4)
+    histogram.record(std::chrono::microseconds(1000));   // [512, 1024)
+
+    auto snap = histogram.snapshot();
+    EXPECT_EQ(snap.count, 3u);
+    EXPECT_EQ(snap.buckets[0], 1u);
+    EXPECT_EQ(snap.buckets[2], 1u);
+    EXPECT_EQ(snap.buckets[10], 1u);
+    EXPECT_EQ(snap.max_us, 1000u);
+    EXPECT_EQ(snap.percentile_us(100), 1024u);
+    EXPECT_EQ(snap.percentile_us(0), 1u);
+}
+
+TEST(LatencyHistogramTest, EmptyHistogram) {
+    LatencyHistogram histogram;
+    auto snap = histogram.snapshot();
+    EXPECT_EQ(snap.count, 0u);
+    EXPECT_EQ(snap.percentile_us(50), 0u);
+    EXPECT_EQ(snap.mean_us(), 0.0);
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include "distcache/warm_handoff.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace distcache;
+
+namespace {
+
+CacheEntry MakeEntry(const std::string& key, const std::string& value) {
+    return CacheEntry(key, std::vector<uint8_t>(value.begin(), value.end()));
+}
+
+std::string ValueOf(const CacheEntry& entry) {
+    return std::string(entry.value.begin(), entry.value.end());
+}
+
+class WarmHandoffTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() /
+               ("distcache_handoff_test_" + std::to_string(::getpid()));
+        std::filesystem::remove_all(dir_);
+        std::filesystem::create_directories(dir_);
+
+        config_.socket_path = dir_ / "handoff.sock";
+        config_.segment_dir = dir_;
+        config_.node_id = "test-node";
+        config_.timeout_ms = 2000;
+
+        old_table_ = std::make_shared<ShardedHashTable>(16);
+        for (int i = 0; i < 1000; ++i) {
+            old_table_->set("key" + std::to_string(i), MakeEntry("key" + std::to_string(i),
+                                                                 "value" + std::to_string(i)));
+        }
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    std::filesystem::path dir_;
+    handoff::Config config_;
+    std::shared_ptr<ShardedHashTable> old_table_;
+};
+
+} // namespace
+
+// ====================
+// Handoff Tests
+// ====================
+
+TEST_F(WarmHandoffTest, HandoffMovesTableAndFreezesTheOldOne) {
+    std::atomic<int> releases{0};
+    std::atomic<bool> reclaimed{false};
+    std::atomic<bool> stopped{false};
+    HandoffServer::Callbacks callbacks;
+    callbacks.release = [&] { releases++; return int64_t{42}; };
+    callbacks.reclaim = [&] { reclaimed = true; };
+    callbacks.handed_off = [&] { stopped = true; };
+    HandoffServer server(config_, old_table_, callbacks);
+    ASSERT_TRUE(server.Start());
+
+    auto new_table = std::make_shared<ShardedHashTable>(16);
+    HandoffClient client(config_, new_table);
+    auto result = client.Attach();
+    ASSERT_TRUE(result.success) << result.error;
+    EXPECT_EQ(result.wal_sequence, 42);
+    EXPECT_EQ(result.keys, 1000u);
+    EXPECT_EQ(releases.load(), 1);
+
+    // Until TAKEN the old process holds the data but accepts no writes
+    EXPECT_TRUE(old_table_->writes_frozen());
+    EXPECT_FALSE(old_table_->set("late", MakeEntry("late", "write")));
+    EXPECT_FALSE(old_table_->del("key1"));
+    EXPECT_TRUE(old_table_->get("key1").has_value());
+
+    // Confirm returns only once the old process has released the table
+    ASSERT_TRUE(client.Confirm());
+    for (int i = 0; i < 100 && !stopped.load(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(stopped.load());
+    EXPECT_TRUE(server.handed_off());
+    EXPECT_FALSE(reclaimed.load());
+    EXPECT_TRUE(old_table_->writes_frozen());
+
+    auto entry = new_table->get("key7");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(ValueOf(*entry), "value7");
+    EXPECT_TRUE(new_table->set("fresh", MakeEntry("fresh", "write")));
+    client.WaitForLoad();
+    EXPECT_EQ(new_table->size(), 1001u);
+    EXPECT_FALSE(std::filesystem::exists(handoff::SegmentPath(config_)));
+}
+
+TEST_F(WarmHandoffTest, AbortedHandoffThawsTheOldProcess) {
+    std::atomic<bool> reclaimed{false};
+    HandoffServer::Callbacks callbacks;
+    callbacks.release = [] { return int64_t{7}; };
+    callbacks.reclaim = [&] { reclaimed = true; };
+    HandoffServer server(config_, old_table_, callbacks);
+    ASSERT_TRUE(server.Start());
+
+    {
+        auto new_table = std::make_shared<ShardedHashTable>(16);
+        HandoffClient client(config_, new_table);
+        ASSERT_TRUE(client.Attach().success);
+        EXPECT_TRUE(old_table_->writes_frozen());
+        client.Abort();
+    }
+
+    for (int i = 0; i < 100 && old_table_->writes_frozen(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_FALSE(old_table_->writes_frozen());
+    EXPECT_TRUE(reclaimed.load());
+    EXPECT_FALSE(server.handed_off());
+    EXPECT_TRUE(old_table_->set("after", MakeEntry("after", "abort")));
+    EXPECT_FALSE(std::filesystem::exists(handoff::SegmentPath(config_)));
+}
+
+TEST_F(WarmHandoffTest, MismatchedLayoutIsRefusedWithoutFreezing) {
+    HandoffServer server(config_, old_table_, HandoffServer::Callbacks{});
+    ASSERT_TRUE(server.Start());
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(fd, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, config_.socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+
+    std::string request = "TAKEOVER " + std::to_string(handoff::kProtocolVersion) + " " +
+                          std::to_string(handoff::kLayoutVersion + 1) + "\n";
+    ASSERT_EQ(::send(fd, request.data(), request.size(), 0),
+              static_cast<ssize_t>(request.size()));
+    char reply[64] = {};
+    ASSERT_GT(::recv(fd, reply, sizeof(reply) - 1, 0), 0);
+    ::close(fd);
+
+    EXPECT_EQ(std::string(reply).rfind("ERROR", 0), 0u);
+    EXPECT_FALSE(old_table_->writes_frozen());
+    EXPECT_TRUE(old_table_->set("still", MakeEntry("still", "writable")));
+}
+
+TEST_F(WarmHandoffTest, AttachFailsWithoutARunningProcess) {
+    auto new_table = std::make_shared<ShardedHashTable>(16);
+    HandoffClient client(config_, new_table);
+    auto result = client.Attach();
+    EXPECT_FALSE(result.success);
+    EXPECT_FALSE(result.error.empty());
+    EXPECT_EQ(new_table->size(), 0u);
+}